@@ -14,42 +14,109 @@
 
 #include <SDL.h>
 #include <SDL_image.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <time.h>
 
 #include "actor.h"
+#include "allocator.h"
+#include "canvas.h"
+#include "capture.h"
 #include "pickup.h"
-
-#define SNAKE_RADIUS      (64)
+#include "game.h"
+#include "hud.h"
+#include "metrics.h"
+#include "mixer.h"
+#include "options.h"
+#include "particles.h"
+#include "simulation.h"
+#include "snapshot.h"
+#include "recording.h"
+#include "tournament.h"
+#include "trace.h"
+#include "viewports.h"
 
 #define BODY_OFFSET       (SNAKE_RADIUS*8)
 #define BODY_ALT_OFFSET   (SNAKE_RADIUS*9)
 #define BODY_EAT_OFFSET   (SNAKE_RADIUS)
 
-#define PLAYER1_SCALE     (1)
-#define PLAYER1_SPAWNX    (WIDTH/4)
-#define PLAYER1_SPAWNY    (HEIGHT/4)
-#define PLAYER1_SEGMENTS  (24)
+// Timing - ms
+#define GAME_OVER_RED_DELAY (1000)  // Red snakes on their own before the scores are shown
+#define GAME_OVER_DURATION  (3000)  // A new match starts by itself after this long
+
+// Particle bursts
+#define GEM_BURST         (48)
+#define KNIGHT_BURST      (96)
+#define SEGMENT_BURST     (6)       // For every segment of a snake that collided with itself
+#define BURST_SPEED       (180.0f)  // Pixels a second
+#define BURST_LIFE        (0.8f)    // Seconds
+#define MAX_FRAME_SECONDS (0.1f)    // Particles don't jump after a stall
+
+#define WALL_BATCH        (64)      // Walls filled in each call
 
-#define PLAYER2_SCALE     (1)
-#define PLAYER2_SPAWNX    (WIDTH/4)
-#define PLAYER2_SPAWNY    (HEIGHT/2)
-#define PLAYER2_SEGMENTS  (24)
+// What the main loop is showing, the match itself is tracked by the simulation's GameState
+typedef enum{
+  SCREEN_PLAYING,
+  SCREEN_GAME_OVER,   // Events are still polled, space or return restarts straight away
+  SCREEN_RESTARTING   // Waiting for the simulation to publish the new match
+} ScreenState;
 
-const int WIDTH=800;
-const int HEIGHT=600;
+// Assets
+SDL_Surface *loadImage(const char *_path);
+void freeImage(SDL_Surface *_image);
 
 // Rendering
-void renderBackground(SDL_Renderer *_renderer, SDL_Texture  *_tex);
-void displayGameOver(SDL_Renderer *_renderer, SDL_Texture  *_tex, int _firstScore, int _secondScore);
-void renderSnakeHead( Node *_head, SDL_Renderer * _renderer, SDL_Texture *_tex);
-void renderSnakeBody( Node *_head, Node *_tail, SDL_Renderer *_renderer, SDL_Texture *_tex );
+void renderBackground(Canvas *_canvas, const Sheet *_sheet, const SDL_Rect *_area);
+void renderWalls(Canvas *_canvas, const ArenaMap *_map, const SDL_Rect *_area);
+void displayGameOver(Canvas *_canvas, const Sheet *_sheet, int _firstScore, int _secondScore);
+void renderSnakeHead( Node *_head, Canvas *_canvas, const Sheet *_sheet);
+void renderSnakeSegment( Node *_segment, Canvas *_canvas, const Sheet *_sheet );
+void renderView(const Snapshot *_frame, const Viewport *_view, const ArenaMap *_map, bool _isPlaying,
+                Canvas *_canvas, const Sheet *_background, const Sheet *_pickupSheet, const Sheet *_specialSheet,
+                Sheet *const _snakeSheets[PLAYER_TOTAL], const Particles *_particles);
+void renderDividers(const Viewports *_views, Canvas *_canvas);
+
+// Effects
+void emitPickupBursts(Particles *io_particles, const Snapshot *_frame, Pickups *io_last,
+                      const SDL_Color _colours[PLAYER_TOTAL]);
+void emitBurst(Particles *io_particles, const Snapshot *_frame, int _x, int _y, int _count,
+               const SDL_Color _colours[PLAYER_TOTAL]);
+void emitCollisionBursts(Particles *io_particles, const Snapshot *_frame);
 
 // Input
 Move getInputMovement(SDL_Scancode _up, SDL_Scancode _down, SDL_Scancode _left, SDL_Scancode _right, Move _oldDirectio);
 
-int main()
+int main(int argc, char *argv[])
 {
+  Options options;
+  if(!parseOptions(argc, argv, &options))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Has to start before any other thread so their events are recorded too
+  if(options.tracePath != NULL && !startTracing(options.tracePath))
+  {
+    printf("Unable to start tracing\n");
+    return EXIT_FAILURE;
+  }
+
+  // Headless matches never open a window
+  if(options.matchCount > 0)
+  {
+    const int c_status = runTournament(&options);
+    stopTracing();
+    printMemoryReport(true);
+    return c_status;
+  }
+
+  if(options.inspectPath != NULL)
+  {
+    const int c_status = inspectRecording(options.inspectPath, options.inspectFrame);
+    stopTracing();
+    return c_status;
+  }
+
   if (SDL_Init(SDL_INIT_EVERYTHING) == -1)
   {
     printf("%s\n",SDL_GetError());
@@ -81,11 +148,11 @@ int main()
   SDL_Surface *imageGameOver = NULL;
   SDL_Surface *imageBackground = NULL;
 
-  imageSnake = IMG_Load("snake.png");
-  imagePickup = IMG_Load("Gems2.png");
-  imageKnight = IMG_Load("Sprite1.png");
-  imageGameOver = IMG_Load("GameOver.png");
-  imageBackground = IMG_Load("background.png");
+  imageSnake = loadImage("snake.png");
+  imagePickup = loadImage("Gems2.png");
+  imageKnight = loadImage("Sprite1.png");
+  imageGameOver = loadImage("GameOver.png");
+  imageBackground = loadImage("background.png");
 
   if(!imageSnake || !imagePickup || !imageKnight || !imageGameOver || !imageBackground)
   {
@@ -93,289 +160,377 @@ int main()
     return EXIT_FAILURE;
   }
 
-  srand(time(NULL));
+  // Either draws through the renderer, or blends on the CPU when there is no GPU to speak of
+  Canvas canvas;
+  if(!createCanvas(&canvas, renderer, options.isSoftwareRender, WIDTH, HEIGHT))
+  {
+    printf("%s\n",SDL_GetError());
+    return EXIT_FAILURE;
+  }
 
   // Load textures from file
-  SDL_Texture *gameOver = NULL;
-  gameOver = SDL_CreateTextureFromSurface(renderer, imageGameOver);
-  SDL_FreeSurface(imageGameOver);
+  Sheet gameOver;
+  Sheet background;
+  Sheet pickup;
+  Sheet special;
+  Sheet snakePlayer1;
+  Sheet snakePlayer2;
 
-  SDL_Texture *background = NULL;
-  background = SDL_CreateTextureFromSurface(renderer, imageBackground);
-  SDL_FreeSurface(imageBackground);
+  bool isLoaded = createSheet(&gameOver, &canvas, imageGameOver);
+  freeImage(imageGameOver);
 
-  SDL_Texture *pickup = NULL;
-  pickup = SDL_CreateTextureFromSurface(renderer, imagePickup);
-  SDL_FreeSurface(imagePickup);
+  isLoaded &= createSheet(&background, &canvas, imageBackground);
+  freeImage(imageBackground);
 
-  SDL_Texture *special = NULL;
-  special = SDL_CreateTextureFromSurface(renderer, imageKnight);
-  SDL_FreeSurface(imageKnight);
+  isLoaded &= createSheet(&pickup, &canvas, imagePickup);
+  freeImage(imagePickup);
 
-  SDL_Texture *snakePlayer1 = NULL;
-  SDL_Texture *snakePlayer2 = NULL;
-  snakePlayer1  = SDL_CreateTextureFromSurface(renderer, imageSnake);
-  snakePlayer2 = SDL_CreateTextureFromSurface(renderer, imageSnake);
-  SDL_FreeSurface(imageSnake);
+  isLoaded &= createSheet(&special, &canvas, imageKnight);
+  freeImage(imageKnight);
+
+  isLoaded &= createSheet(&snakePlayer1, &canvas, imageSnake);
+  isLoaded &= createSheet(&snakePlayer2, &canvas, imageSnake);
+  freeImage(imageSnake);
+
+  if(!isLoaded)
+  {
+    printf("%s\n",SDL_GetError());
+    return EXIT_FAILURE;
+  }
 
   // Set player colours
-  SDL_SetTextureColorMod(snakePlayer1, 255, 96, 0);
-  SDL_SetTextureColorMod(snakePlayer2, 255, 255, 0);
-
-  // Initialising snake spawns and sizes
-  Node player1HeadData;
-    setState(&player1HeadData, HEAD);
-    player1HeadData.next = NULL;
-    player1HeadData.prev = NULL;
-
-    player1HeadData.pos.x = PLAYER1_SPAWNX;
-    player1HeadData.pos.y = PLAYER1_SPAWNY;
-    player1HeadData.pos.w = SNAKE_RADIUS*PLAYER1_SCALE;
-    player1HeadData.pos.h = SNAKE_RADIUS*PLAYER1_SCALE;
-
-    player1HeadData.anim.currentFrame = 0;
-    player1HeadData.idleDirection = RIGHT;
-
-  Node player1BodyData = player1HeadData;
-    setState(&player1BodyData, BODY);
-
-  Node player2HeadData = player1HeadData;
-    player2HeadData.pos.x = PLAYER2_SPAWNX;
-    player2HeadData.pos.y = PLAYER2_SPAWNY;
-    player2HeadData.pos.w = SNAKE_RADIUS*PLAYER2_SCALE;
-    player2HeadData.pos.h = SNAKE_RADIUS*PLAYER2_SCALE;
-
-  Node player2BodyData = player1BodyData;
-    setState(&player2BodyData, BODY);
-
-
-  // Initialise snakes (implemented using a linked list)
-  Node *player1Head = createSnake(&player1HeadData, PLAYER1_SEGMENTS, &player1BodyData);
-  Node *player1Tail = getLastSegment(player1Head);
-  Move player1Direction = NOTMOVING;
-  int  player1PickupCount = 0;
-
-  Node *player2Head = createSnake(&player2HeadData, PLAYER2_SEGMENTS, &player2BodyData);
-  Node *player2Tail = getLastSegment(player2Head);
-  Move player2Direction = NOTMOVING;
-  int  player2PickupCount = 0;
-
-  Pickup gems[PICKUP_TOTAL];
-  initialisePickups(gems);
-
-  // Timing - ms
-  const unsigned int c_playerFrameDelay = 150;
-  const unsigned int c_PickupFrameDelay = 50;
-  const unsigned int c_knightDirUpdate = 1500;
-  const unsigned int c_gameLoopDelay = 30;
-
-  unsigned int currentTime = SDL_GetTicks();
-  unsigned int lastPlayerFrameUpdate = 0;
-  unsigned int lastPickupFrameUpdate = 0;
-  unsigned int lastKnightDirChange = 0;
-  unsigned int lastGameUpdate = 0;
+  const SDL_Color c_playerColours[PLAYER_TOTAL] = { {255, 96, 0, 255}, {255, 255, 0, 255} };
+  Sheet *snakeSheets[PLAYER_TOTAL] = { &snakePlayer1, &snakePlayer2 };
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    setSheetTint(snakeSheets[p], c_playerColours[p].r, c_playerColours[p].g, c_playerColours[p].b);
+  }
+
+  Hud hud;
+  if(!createHud(&hud, &canvas, c_playerColours))
+  {
+    printf("%s\n",SDL_GetError());
+    return EXIT_FAILURE;
+  }
+
+  // Bursts for eating and dying, only ever touched by this thread so they cost the simulation nothing
+  Particles particles;
+  if(!createParticles(&particles, (unsigned int)time(NULL)))
+  {
+    printf("Unable to allocate the particles\n");
+    return EXIT_FAILURE;
+  }
+
+  // Each view follows a snake, what they can see is worked out together once a frame
+  Viewports views;
+  initialiseViewports(&views, options.viewportCount, WIDTH, HEIGHT);
+
+  // What was on the board last frame, a burst goes off wherever a pickup disappears
+  Pickups lastPickups;
+  lastPickups.gems.count = 0;
+  lastPickups.knights.count = 0;
+  unsigned int lastMatch = 0;
+  Uint64 lastFrame = SDL_GetPerformanceCounter();
+
+  // Recording reads each frame back before it is presented and leaves the rest to a writer thread
+  FrameCapture capture;
+  FrameCapture *recording = NULL;
+
+  if(options.capturePath != NULL)
+  {
+    if(!startCapture(&capture, options.capturePath, WIDTH, HEIGHT))
+    {
+      return EXIT_FAILURE;
+    }
+
+    recording = &capture;
+  }
+
+  // The game ticks on its own thread, this one just reads input and draws whatever it last published
+  // Over the network both peers have to start from the same seed
+  const bool c_isNetplay = isNetplay(&options);
+  const unsigned int c_seed = c_isNetplay ? options.seed : (unsigned int)time(NULL);
+
+  // Sound is optional, the game plays on silently without a device
+  Mixer mixer;
+  const bool c_hasAudio = !options.isMuted && startMixer(&mixer);
+
+  // Scrapes are answered on their own thread, the game only updates counters
+  Metrics metricsServer;
+  Metrics *metrics = NULL;
+
+  if(options.metricsPort > 0)
+  {
+    if(!startMetrics(&metricsServer, options.metricsPort, c_hasAudio ? &mixer : NULL))
+    {
+      return EXIT_FAILURE;
+    }
+
+    metrics = &metricsServer;
+  }
+
+  Simulation sim;
+  if(!startSimulation(&sim, &options, c_seed, c_hasAudio ? &mixer : NULL, metrics))
+  {
+    printf("Unable to start the simulation\n");
+    return EXIT_FAILURE;
+  }
 
   // now we are going to loop forever, process the keys then draw
   int quit=false;
 
+  ScreenState screen = SCREEN_PLAYING;
+  Uint32 gameOverStart = 0;
+  Uint32 lastMemoryReport = SDL_GetTicks();
+
   while (quit != true)
   {
-    currentTime = SDL_GetTicks();
+    TRACE_BEGIN("frame");
+
+    const Uint64 c_frameStart = SDL_GetPerformanceCounter();
+    bool isRestartPressed = false;
+
+    // Shows how memory grows over a long session
+    if(options.memoryLogSeconds > 0 && SDL_GetTicks() - lastMemoryReport >= options.memoryLogSeconds * 1000)
+    {
+      printMemoryReport(false);
+      lastMemoryReport = SDL_GetTicks();
+    }
 
-    if(currentTime > (lastGameUpdate + c_gameLoopDelay))
+    // grab the SDL event (this will be keys etc)
+    TRACE_BEGIN("pollEvents");
+
+    SDL_Event event;
+    while (SDL_PollEvent(&event))
     {
-      // grab the SDL event (this will be keys etc)
-      SDL_Event event;
-      while (SDL_PollEvent(&event))
+      // If the window is closed
+      if (event.type == SDL_QUIT)
       {
-        // If the window is closed
-        if (event.type == SDL_QUIT)
-        {
-          quit = true;
-        }
+        quit = true;
+      }
 
-        if (event.type == SDL_KEYDOWN)
+      if (event.type == SDL_KEYDOWN)
+      {
+        switch (event.key.keysym.sym)
         {
-          switch (event.key.keysym.sym)
-          {
-            // if we have an escape quit
-            case SDLK_ESCAPE :
-              quit = true;
-              break;
-          }
+          // if we have an escape quit
+          case SDLK_ESCAPE :
+            quit = true;
+            break;
+
+          case SDLK_SPACE :
+          case SDLK_RETURN :
+            isRestartPressed = true;
+            break;
         }
-      }// end PollEvent loop
-
-      player1Direction = getInputMovement(SDL_SCANCODE_UP,   SDL_SCANCODE_DOWN,
-                                          SDL_SCANCODE_LEFT, SDL_SCANCODE_RIGHT,
-                                          player1Head->idleDirection);
+      }
+    }// end PollEvent loop
 
-      player2Direction = getInputMovement(SDL_SCANCODE_W,  SDL_SCANCODE_S,
-                                          SDL_SCANCODE_A,  SDL_SCANCODE_D,
-                                          player2Head->idleDirection);
+    TRACE_END("pollEvents");
 
+    const Snapshot *frame = acquireSnapshot(&sim.snapshots);
+    const ArenaMap *c_map = sim.hasMap ? &sim.map : NULL;
 
-      // Check if the snakes collect any Pickups
-      for(int i = 0; i < PICKUP_TOTAL; i++)
-      {
-        if(gems[i].isVisible)
-        {
-          SDL_Rect gemPosition = { gems[i].pos.x,
-                                   gems[i].pos.y,
-                                   PICKUP_SIZE,
-                                   PICKUP_SIZE };
-
-          if(detectCollision(&player1Head->pos, &gemPosition, 6))
-          {
-            growsnake(player1Head, &player1Tail, &player1BodyData);
-
-            gems[i].isVisible = false;
-            player1PickupCount++;
-          }
-
-          if(detectCollision(&player2Head->pos, &gemPosition, 6))
-          {
-            growsnake(player2Head, &player2Tail, &player2BodyData);
-
-            gems[i].isVisible = false;
-            player2PickupCount++;
-          }
-        }
-      }// End collision Pickup check
+    const Uint64 c_now = SDL_GetPerformanceCounter();
+    float seconds = (float)(c_now - lastFrame) / (float)SDL_GetPerformanceFrequency();
+    lastFrame = c_now;
 
+    if(seconds > MAX_FRAME_SECONDS)
+    {
+      seconds = MAX_FRAME_SECONDS;
+    }
 
-      // Exit the game if all the Pickups have been collected
-      // or a player collides with their body
-      if( (collidesWithSelf(player1Head) || collidesWithSelf(player2Head)) ||
-          (player1PickupCount + player2PickupCount >= PICKUP_TOTAL) )
-      {
-        // Make the snakes red to make it obvious the player did something wrong
-        SDL_RenderClear(renderer);
+    TRACE_BEGIN("updateParticles");
 
-        SDL_SetTextureColorMod(snakePlayer1, 255, 0, 0);
-        SDL_SetTextureColorMod(snakePlayer2, 255, 0, 0);
+    // A new match scatters its pickups under the same ids, none of those have been collected
+    if(frame->match != lastMatch)
+    {
+      lastPickups = frame->pickups;
+      lastMatch = frame->match;
+    }
 
-        renderSnakeBody(player1Head, player1Tail, renderer, snakePlayer1);
-        renderSnakeHead(player1Head, renderer, snakePlayer1);
-        renderSnakeBody(player2Head, player2Tail, renderer, snakePlayer2);
-        renderSnakeHead(player2Head, renderer, snakePlayer2);
+    emitPickupBursts(&particles, frame, &lastPickups, c_playerColours);
+    updateParticles(&particles, seconds);
+    TRACE_END("updateParticles");
 
-        SDL_RenderPresent(renderer);
+    // The match ends if all the Pickups have been collected
+    // or a player collides with their body
+    if(screen == SCREEN_PLAYING && frame->state != GAME_RUNNING)
+    {
+      emitCollisionBursts(&particles, frame);
 
-        SDL_Delay(1000);
+      // Make the snakes red to make it obvious the player did something wrong
+      for(int p = 0; p < PLAYER_TOTAL; ++p)
+      {
+        setSheetTint(snakeSheets[p], 255, 0, 0);
+      }
 
-        displayGameOver(renderer, gameOver, player1PickupCount, player2PickupCount);
+      gameOverStart = SDL_GetTicks();
+      screen = SCREEN_GAME_OVER;
+    }
 
-        SDL_Delay(2000);
+    // The simulation resets the match in place, so nothing is reloaded or reallocated.
+    // Networked matches stay on the scores until escape, the peers can't restart together
+    if(screen == SCREEN_GAME_OVER && !c_isNetplay &&
+       (isRestartPressed || SDL_GetTicks() - gameOverStart >= GAME_OVER_DURATION))
+    {
+      restartSimulation(&sim, (unsigned int)SDL_GetPerformanceCounter());
+      screen = SCREEN_RESTARTING;
+    }
 
-        quit = true;
+    // Snapshots of the old match are all game over, so the first running one is the new match
+    if(screen == SCREEN_RESTARTING && frame->state == GAME_RUNNING)
+    {
+      for(int p = 0; p < PLAYER_TOTAL; ++p)
+      {
+        setSheetTint(snakeSheets[p], c_playerColours[p].r, c_playerColours[p].g, c_playerColours[p].b);
       }
 
-      // Update player movement direction and the snake position
-      updateSnakePos(player1Head, &player1Tail, player1Direction);
-      updateSnakePos(player2Head, &player2Tail, player2Direction);
+      screen = SCREEN_PLAYING;
+    }
 
+    TRACE_BEGIN("cullViewports");
+    prepareParticles(&particles);
+    cullViewports(&views, frame);
+    TRACE_END("cullViewports");
 
-      // Update ticks and check time specific functions
-      currentTime = SDL_GetTicks();
+    if(screen != SCREEN_PLAYING)
+    {
+      clearCanvas(&canvas);
 
-      // Increment the frames only every frameDelay ms
-      if(currentTime > (lastPlayerFrameUpdate + c_playerFrameDelay))
+      for(int v = 0; v < views.count; ++v)
       {
-        updateSegmentFrames(player1Head);
-        updateSegmentFrames(player2Head);
-
-        lastPlayerFrameUpdate = currentTime;
+        renderView(frame, &views.views[v], c_map, false, &canvas, &background, &pickup, &special,
+                   snakeSheets, &particles);
       }
-      else
-      {
-        // Just incase the frame didn't update in time
-        // Reset it to 0 if the player isn't moving
-        if( !getState(player1Head, MOVING) )
-        {
-          player1Head->anim.currentFrame = 0;
-        }
 
-        if( !getState(player2Head, MOVING) )
-        {
-          player2Head->anim.currentFrame = 0;
-        }
+      setCanvasViewport(&canvas, NULL, 0, 0);
+      renderDividers(&views, &canvas);
+
+      if(SDL_GetTicks() - gameOverStart >= GAME_OVER_RED_DELAY)
+      {
+        displayGameOver(&canvas, &gameOver, frame->pickupCount[0], frame->pickupCount[1]);
       }
 
-      // Update knight animations and positions
-      if(currentTime > (lastPickupFrameUpdate + c_PickupFrameDelay))
+      drawHud(&hud, &canvas, frame);
+
+      if(recording) { captureFrame(recording, &canvas); }
+      if(metrics)
       {
-        for(int i = 0; i < PICKUP_TOTAL; ++i)
-        {
-          if(gems[i].canTravel)
-          {
-             Move dir = gems[i].Anim.offset.y;
+        recordFrame(metrics, (unsigned int)((SDL_GetPerformanceCounter() - c_frameStart) * 1000000 /
+                                            SDL_GetPerformanceFrequency()), canvas.drawCalls);
+      }
 
-             gems[i].Anim.offset.x++;
-             gems[i].Anim.offset.x %= KNIGHT_FRAMETOTAL;
+      presentCanvas(&canvas);
 
-             moveSprite(dir, &gems[i].pos, 2);
-          }
-        }
+      TRACE_END("frame");
+      continue;
+    }
+
+    TRACE_BEGIN("getInputMovement");
 
-        lastPickupFrameUpdate = currentTime;
+    if(c_isNetplay)
+    {
+      // Each peer plays its own snake with the arrow keys
+      const int c_local = sim.netplay.localPlayer;
+
+      setSimulationInput(&sim, c_local, getInputMovement(SDL_SCANCODE_UP,   SDL_SCANCODE_DOWN,
+                                                         SDL_SCANCODE_LEFT, SDL_SCANCODE_RIGHT,
+                                                         getSnapshotHead(frame, c_local)->idleDirection));
+    }
+    else
+    {
+      if(!options.isAIPlayer[0])
+      {
+        setSimulationInput(&sim, 0, getInputMovement(SDL_SCANCODE_UP,   SDL_SCANCODE_DOWN,
+                                                     SDL_SCANCODE_LEFT, SDL_SCANCODE_RIGHT,
+                                                     getSnapshotHead(frame, 0)->idleDirection));
       }
 
-      // Randomise each knights movement every few ms
-      if(currentTime > (lastKnightDirChange + c_knightDirUpdate))
+      if(!options.isAIPlayer[1])
       {
-        for(int i = 0; i < PICKUP_TOTAL; ++i)
-        {
-          if(gems[i].canTravel)
-          {
-            Move direction = NOTMOVING;
+        setSimulationInput(&sim, 1, getInputMovement(SDL_SCANCODE_W,  SDL_SCANCODE_S,
+                                                     SDL_SCANCODE_A,  SDL_SCANCODE_D,
+                                                     getSnapshotHead(frame, 1)->idleDirection));
+      }
+    }
 
-            // Push knights away from the edge so they don't get hidden
-            if(gems[i].pos.x < KNIGHT_SIZE) { direction = RIGHT; }
-            if(gems[i].pos.y < KNIGHT_SIZE) { direction = DOWN;  }
+    TRACE_END("getInputMovement");
 
-            if(gems[i].pos.x > WIDTH - KNIGHT_SIZE*2) { direction = LEFT; }
-            if(gems[i].pos.y > HEIGHT- KNIGHT_SIZE*2) { direction = UP;   }
+    // now we clear the screen (will use the clear colour set previously)
+    clearCanvas(&canvas);
 
-            if(direction==NOTMOVING)
-            {
-              direction = getRandomMovement();
-            }
+    for(int v = 0; v < views.count; ++v)
+    {
+      TRACE_BEGIN("renderView");
+      renderView(frame, &views.views[v], c_map, true, &canvas, &background, &pickup, &special,
+                 snakeSheets, &particles);
+      TRACE_END("renderView");
+    }
 
-            gems[i].Anim.offset.y = direction;
-          }
-        }
+    // The HUD covers the whole window
+    setCanvasViewport(&canvas, NULL, 0, 0);
+    renderDividers(&views, &canvas);
 
-        lastKnightDirChange = currentTime;
-      }
+    TRACE_BEGIN("drawHud");
+    drawHud(&hud, &canvas, frame);
+    TRACE_END("drawHud");
+
+    if(recording) { captureFrame(recording, &canvas); }
 
-      // now we clear the screen (will use the clear colour set previously)
-      SDL_RenderClear(renderer);
+    // Everything but the wait for vsync, which would hide what drawing costs
+    if(metrics)
+    {
+      recordFrame(metrics, (unsigned int)((SDL_GetPerformanceCounter() - c_frameStart) * 1000000 /
+                                          SDL_GetPerformanceFrequency()), canvas.drawCalls);
+    }
 
-      renderBackground(renderer, background);
+    // Update screen, this waits for vsync but the simulation carries on regardless
+    TRACE_BEGIN("present");
+    presentCanvas(&canvas);
+    TRACE_END("present");
 
-      // Copy every Pickup to renderer, ready for drawing to the screen
-      // Any Pickup that has been 'picked up' by the player will not be drawn
-      renderPickups(gems, renderer, pickup, special);
+    TRACE_END("frame");
+  } // end game loop
 
-      renderSnakeBody(player1Head, player1Tail, renderer, snakePlayer1);
-      renderSnakeHead(player1Head, renderer, snakePlayer1);
+  // Stops the simulation thread and cleans up the snake lists
+  stopSimulation(&sim);
 
-      renderSnakeBody(player2Head, player2Tail, renderer, snakePlayer2);
-      renderSnakeHead(player2Head, renderer, snakePlayer2);
+  // The server reads the mixer's underruns, so it goes first
+  if(metrics)
+  {
+    stopMetrics(metrics);
+  }
 
+  // Nothing posts sounds any more
+  if(c_hasAudio)
+  {
+    stopMixer(&mixer);
+  }
 
-      // Update screen
-      SDL_RenderPresent(renderer);
+  // Finishes writing any frames still queued
+  if(recording)
+  {
+    stopCapture(recording);
+  }
 
-      // Update time
-      lastGameUpdate = currentTime;
-    } //
-  } // end game loop
+  freeViewports(&views);
+  freeParticles(&particles);
+  freeHud(&hud);
+  freeSheet(&gameOver);
+  freeSheet(&background);
+  freeSheet(&pickup);
+  freeSheet(&special);
+  freeSheet(&snakePlayer1);
+  freeSheet(&snakePlayer2);
+  freeCanvas(&canvas);
 
-  // Clean up snake lists
-  freeList(&player1Head);
-  freeList(&player2Head);
+  // Every other thread has stopped, so their rings can be written out
+  stopTracing();
+
+  // Anything still counted now was leaked
+  printMemoryReport(true);
 
   // exit SDL nicely and free resources
   SDL_Quit();
@@ -383,25 +538,50 @@ int main()
 }
 
 ///
-/// \brief RenderBackground Tile the background texture until it fills the entire screen
-/// \param _renderer The renderer
-/// \param _tex
+/// \brief LoadImage Decodes an image, counting it as an asset until freeImage
+/// \param _path
+/// \return NULL if it could not be loaded
+///
+SDL_Surface *loadImage(const char *_path)
+{
+  SDL_Surface *image = IMG_Load(_path);
+
+  if(image != NULL)
+  {
+    trackMemory(MEMORY_ASSETS, (long)image->pitch * image->h);
+  }
+
+  return image;
+}
+
+void freeImage(SDL_Surface *_image)
+{
+  trackMemory(MEMORY_ASSETS, -(long)_image->pitch * _image->h);
+  SDL_FreeSurface(_image);
+}
+
+///
+/// \brief RenderBackground Tile the background texture until it fills an area of the arena
+/// \param _canvas
+/// \param _sheet
+/// \param _area Only the tiles that overlap it are drawn
 ///
-void renderBackground(SDL_Renderer *_renderer,
-                      SDL_Texture  *_tex)
+void renderBackground(Canvas *_canvas,
+                      const Sheet *_sheet,
+                      const SDL_Rect *_area)
 {
   const int c_bgSize = 128;
 
   SDL_Rect bgSrc = {0, 0, c_bgSize, c_bgSize};
-  SDL_Rect bgDst = {0, 0, c_bgSize, c_bgSize};
+  SDL_Rect bgDst = {_area->x / c_bgSize * c_bgSize, 0, c_bgSize, c_bgSize};
 
-  while(bgDst.x < WIDTH)
+  while(bgDst.x < _area->x + _area->w)
   {
-    bgDst.y = 0;
+    bgDst.y = _area->y / c_bgSize * c_bgSize;
 
-    while(bgDst.y < HEIGHT)
+    while(bgDst.y < _area->y + _area->h)
     {
-      SDL_RenderCopy(_renderer, _tex, &bgSrc, &bgDst);
+      drawSprite(_canvas, _sheet, &bgSrc, &bgDst);
 
       bgDst.y += c_bgSize;
     }
@@ -411,15 +591,59 @@ void renderBackground(SDL_Renderer *_renderer,
 
 }
 
+///
+/// \brief RenderWalls Fills every wall that overlaps _area, a batch at a time
+/// \param _canvas
+/// \param _map NULL when there are no walls
+/// \param _area
+///
+void renderWalls(Canvas *_canvas,
+                 const ArenaMap *_map,
+                 const SDL_Rect *_area)
+{
+  if(_map == NULL)
+  {
+    return;
+  }
+
+  const SDL_Color c_colour = {48, 44, 56, 255};
+
+  SDL_Rect rects[WALL_BATCH];
+  SDL_Color colours[WALL_BATCH];
+  int count = 0;
+
+  for(int i = 0; i < _map->wallCount; ++i)
+  {
+    const SDL_Rect *c_wall = &_map->walls[i];
+
+    if(c_wall->x >= _area->x + _area->w || c_wall->x + c_wall->w <= _area->x ||
+       c_wall->y >= _area->y + _area->h || c_wall->y + c_wall->h <= _area->y)
+    {
+      continue;
+    }
+
+    rects[count] = *c_wall;
+    colours[count] = c_colour;
+
+    if(++count == WALL_BATCH)
+    {
+      fillRects(_canvas, rects, colours, count);
+      count = 0;
+    }
+  }
+
+  fillRects(_canvas, rects, colours, count);
+}
+
 ///
 /// \brief DisplayGameOver
-/// \param _renderer
-/// \param _tex
+/// \param _canvas
+/// \param _sheet
 /// \param _firstScore The first players score
 /// \param _secondScore The second players score
 ///
-void displayGameOver(SDL_Renderer *_renderer,
-                     SDL_Texture  *_tex,
+void displayGameOver(Canvas *_canvas,
+                     const Sheet *_sheet,
                      int _firstScore,
                      int _secondScore)
 {
@@ -442,7 +666,7 @@ void displayGameOver(SDL_Renderer *_renderer,
   dst.x = screenCenter.x - c_imageWidth;
   dst.y = screenCenter.y + c_rowHeight;
 
-  SDL_RenderCopy(_renderer, _tex, &src, &dst);
+  drawSprite(_canvas, _sheet, &src, &dst);
 
   // Player text offsets
   if(_firstScore != _secondScore)
@@ -459,280 +683,157 @@ void displayGameOver(SDL_Renderer *_renderer,
   // Next row onscreen
   dst.y += c_rowHeight;
 
-  SDL_RenderCopy(_renderer, _tex, &src, &dst);
-
-  SDL_RenderPresent(_renderer);
+  drawSprite(_canvas, _sheet, &src, &dst);
 }
 
 
-////
-/// \brief GetState Checks a node's state
-/// \param _node
-/// \param _state
-/// \return True if the node contains the state, otherwise false
 ///
-bool getState(Node *_node,
-              NodeState _state)
-{
-  if((_node->state & _state) == _state)
-  {
-    return true;
-  }
-
-  return false;
-}
-
-
-void addState(Node *_node,
-              NodeState _state)
-{
-  _node->state |= _state;
-}
-
-void removeState(Node *_node,
-                 NodeState _state)
-{
-  if(getState(_node, _state))
-  {
-    _node->state -= _state;
-  }
-}
-
-void setState(Node *_node,
-              NodeState _state)
-{
-  _node->state = _state;
-}
-
-///
-/// \brief freeList Frees all of the memory used by a list of segments
-/// \param io_root
+/// \brief RenderSnakeHead
+/// \param _head
+/// \param _canvas
+/// \param _sheet The spritesheet to use to render the head
 ///
-void freeList(Node **io_root)
+void renderSnakeHead( Node *_head,
+                      Canvas *_canvas,
+                      const Sheet *_sheet)
 {
-  Node *tmp;
+  // The spritesheet column to start in,
+  // the move animation begins +32 pixels from the left
+  int startOffset = getState(_head, MOVING) ? SNAKE_RADIUS : 0;
 
-  while(*io_root != NULL)
-  {
-    tmp = (*io_root);
-    (*io_root) = (*io_root)->next;
+  SDL_Rect src = getFrameOffset(_head->idleDirection, SNAKE_RADIUS,
+                                _head->anim.currentFrame, startOffset);
+  SDL_Rect dst = _head->pos;
 
-    free(tmp);
-  }
+  drawSprite(_canvas, _sheet, &src, &dst);
 }
 
-////
-/// \brief LinkSegments
-/// Helper function that correctly updates 2 segments to be linked to each other
-/// \param Node
-/// \param NodeToLinkTo
 ///
-void linkSegments(Node *_node,
-                  Node *_nodeToLinkTo)
-{
-  if(_node!=NULL && _nodeToLinkTo!=NULL)
-  {
-      _node->next = _nodeToLinkTo;
-      _nodeToLinkTo->prev = _node;
-  }
-}
-
-void unlinkNextSegment(Node *_linkedNode)
-{
-  if(_linkedNode->next != NULL)
-  {
-    _linkedNode->next->prev = _linkedNode->prev;
-    _linkedNode->next = NULL;
-  }
-}
-
-void unlinkPrevSegment(Node *_linkedNode)
-{
-  if(_linkedNode->prev != NULL)
-  {
-    _linkedNode->prev->next = _linkedNode->next;
-    _linkedNode->prev = NULL;
-  }
-}
-
-////
-/// \brief InsertAfterSegment
-/// \param _listNode
-/// \param _newNode
-/// \param _isNewNodeLinked
+/// \brief RenderSnakeSegment Renders one body segment, swallowing if it is eating
+/// \param _segment
+/// \param _canvas
+/// \param _sheet The spritesheet to use to render the body
 ///
-void insertAfterSegment(Node *_listNode,
-                        Node *_newNode,
-                        bool _isNewNodeLinked)
+void renderSnakeSegment( Node *_segment,
+                         Canvas *_canvas,
+                         const Sheet *_sheet )
 {
-  if(_isNewNodeLinked)
+  SDL_Rect src;
+  src.w = SNAKE_RADIUS;
+  src.h = SNAKE_RADIUS;
+  src.x = _segment->anim.currentFrame * SNAKE_RADIUS;
+
+  // Create the lump that moves through the snakes body when it eats
+  if(getState(_segment, EATING))
   {
-    unlinkNextSegment(_newNode);
-    unlinkPrevSegment(_newNode);
+    src.x += BODY_EAT_OFFSET;
   }
 
-  _newNode->prev = _listNode;
-  _newNode->next = _listNode->next;
+  // Set the darker/alternate segments
+  src.y = (getState(_segment, ALT)) ? BODY_ALT_OFFSET : BODY_OFFSET;
 
-  _listNode->next = _newNode;
+  drawSprite(_canvas, _sheet, &src, &_segment->pos);
 }
 
 ///
-/// \brief Growsnake Adds a new segment to the snake
-/// \param _head
-/// \param io_tail
-/// \param _data Data that will be copied over to the new segment
+/// \brief RenderView Draws what the culling pass found inside a view's camera
+/// \param _frame
+/// \param _view
+/// \param _map NULL when the arena has no walls
+/// \param _isPlaying False once the match is over, only the snakes and particles are left
+/// \param _canvas
+/// \param _background
+/// \param _pickupSheet
+/// \param _specialSheet
+/// \param _snakeSheets One spritesheet per player
+/// \param _particles Already prepared this frame
 ///
-void growsnake(Node *_head,
-               Node **io_tail,
-               Node *_data)
+void renderView(const Snapshot *_frame,
+                const Viewport *_view,
+                const ArenaMap *_map,
+                bool _isPlaying,
+                Canvas *_canvas,
+                const Sheet *_background,
+                const Sheet *_pickupSheet,
+                const Sheet *_specialSheet,
+                Sheet *const _snakeSheets[PLAYER_TOTAL],
+                const Particles *_particles)
 {
-  if(io_tail==NULL || (*io_tail)==NULL)
-  {
-    return;
-  }
+  setCanvasViewport(_canvas, &_view->screen, _view->camera.x, _view->camera.y);
 
-  if(_head!=NULL && _head->next!=NULL)
+  if(_isPlaying)
   {
-    // The body will use this state to give the impression
-    // that the snake is swallowing it's prey
-    addState(_head->next, EATING);
-  }
-
-  Node *newTail = createSegment(_data);
-  // Quick way of ensuring the new tail is hidden until the player moves
-  newTail->pos.x = 0 - SNAKE_RADIUS*2;
-  newTail->pos.y = 0 - SNAKE_RADIUS*2;
+    renderBackground(_canvas, _background, &_view->camera);
+    renderWalls(_canvas, _map, &_view->camera);
 
-  newTail->prev = (*io_tail);
-  (*io_tail) = newTail;
-  (*io_tail)->anim.currentFrame = (*io_tail)->prev->anim.currentFrame;
-}
-
-///
-/// \brief GetLastSegment
-/// \param _root
-/// \return The last segment in a chain of segments
-///
-Node *getLastSegment(Node * _root)
-{
-  if(_root!=NULL)
-  {
-    while( _root->next != NULL )
-    {
-      _root = _root->next;
-    }
+    // Any Pickup that has been 'picked up' by the player is no longer in the lists
+    renderPickups(&_frame->pickups, _view->gems, _view->gemCount, _view->knights, _view->knightCount,
+                  _canvas, _pickupSheet, _specialSheet);
   }
 
-  return _root;
-}
-
-/////
-/// \brief CreateSegment Allocates memory for a new segment
-/// \param _data Data that will be copied over to the new segment
-/// \return A pointer to the new segment
-///
-Node *createSegment(Node * _data)
-{
-    Node *newSegment = malloc(sizeof(Node));
-    *newSegment = *_data;
-    newSegment->next = NULL;
-    newSegment->prev = NULL;
-
-    return newSegment;
-}
-
-////
-/// \brief UpdateSegmentFrames Checks the state of every segment in the snake and updates the frame accordingly
-/// \param _head The first segment Node in the snake
-///
-void updateSegmentFrames(Node *_head)
-{
-  // Frame totals
-  const unsigned int c_bodyMove = 1;
-  const unsigned int c_headMove = 2;
+  // Segments are listed tail first, so each head is placed on top of its own body
+  int first = 0;
 
-  bool isMoving = getState(_head, MOVING);
-
-  Node *node = _head;
-
-  while(node!=NULL)
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
   {
-    if(isMoving)
+    for(int i = first; i < _view->segmentEnd[p]; ++i)
     {
-      unsigned int frameTotal = getState(node, HEAD) ? c_headMove : c_bodyMove;
+      const int c_segment = _view->segments[i];
+      Node *segment = &_frame->segments[p][c_segment];
 
-      if(node->anim.currentFrame < frameTotal)
+      if(c_segment == 0)
       {
-        node->anim.currentFrame++;
+        renderSnakeHead(segment, _canvas, _snakeSheets[p]);
       }
       else
       {
-        node->anim.currentFrame = 0;
+        renderSnakeSegment(segment, _canvas, _snakeSheets[p]);
       }
     }
 
-    node = node->next;
+    first = _view->segmentEnd[p];
   }
-}
-
-///
-/// \brief RenderSnakeHead
-/// \param _head
-/// \param _renderer
-/// \param _tex The spritesheet to use to render the head
-///
-void renderSnakeHead( Node *_head,
-                      SDL_Renderer * _renderer,
-                      SDL_Texture *_tex)
-{
-  // The spritesheet column to start in,
-  // the move animation begins +32 pixels from the left
-  int startOffset = getState(_head, MOVING) ? SNAKE_RADIUS : 0;
-
-  SDL_Rect src = getFrameOffset(_head->idleDirection, SNAKE_RADIUS,
-                                _head->anim.currentFrame, startOffset);
-  SDL_Rect dst = _head->pos;
 
-  SDL_RenderCopy(_renderer, _tex, &src, &dst);
+  drawParticles(_particles, _canvas);
 }
 
-////
-/// \brief RenderSnake Renders tail first, so the head is placed correctly on top of the other segments
-/// \param _tail
-/// \param _renderer
-/// \param _tex The spritesheet to use to render the body
 ///
-void renderSnakeBody( Node *_head,
-                      Node *_tail,
-                      SDL_Renderer *_renderer,
-                      SDL_Texture *_tex )
+/// \brief RenderDividers Draws a line between each pair of neighbouring views
+/// \param _views
+/// \param _canvas Its viewport must be the whole canvas
+///
+void renderDividers(const Viewports *_views,
+                    Canvas *_canvas)
 {
-  _head = _head->next;
+  const int c_thickness = 2;
+  const SDL_Color c_colour = {0, 0, 0, 255};
 
-  SDL_Rect src;
-  src.w = SNAKE_RADIUS;
-  src.h = SNAKE_RADIUS;
-  src.y = BODY_OFFSET;
+  SDL_Rect lines[VIEWPORT_MAX * 2];
+  SDL_Color colours[VIEWPORT_MAX * 2];
+  int count = 0;
 
-  while(_tail != NULL)
+  for(int v = 0; v < _views->count; ++v)
   {
-    src.x = _tail->anim.currentFrame * SNAKE_RADIUS;
+    const SDL_Rect *c_screen = &_views->views[v].screen;
 
-    // Create the lump that moves through the snakes body when it eats
-    if(getState(_tail, EATING))
+    if(c_screen->x + c_screen->w < _canvas->w)
     {
-      src.x += BODY_EAT_OFFSET;
+      const SDL_Rect c_line = {c_screen->x + c_screen->w - c_thickness / 2, c_screen->y, c_thickness, c_screen->h};
+      lines[count] = c_line;
+      colours[count++] = c_colour;
     }
 
-    // Set the darker/alternate segments
-    src.y = (getState(_tail, ALT)) ? BODY_ALT_OFFSET : BODY_OFFSET;
-
-    SDL_RenderCopy(_renderer, _tex, &src, &_tail->pos);
-
-    _tail = _tail->prev;
+    if(c_screen->y + c_screen->h < _canvas->h)
+    {
+      const SDL_Rect c_line = {c_screen->x, c_screen->y + c_screen->h - c_thickness / 2, c_screen->w, c_thickness};
+      lines[count] = c_line;
+      colours[count++] = c_colour;
+    }
   }
+
+  fillRects(_canvas, lines, colours, count);
 }
+
 ////
 /// \brief GetInputMovement Checks for input from the user, pressing opposing keys will return NOTMOVING
 /// \param _up
@@ -781,17 +882,126 @@ Move getInputMovement(SDL_Scancode _up,
 
   // Quick and dirty way of checking if the user is trying to move in 2 directions at once
   // (this would mean instant death for them, as the snake collides with itself)
-  bool opposingDirection = (_oldDirection == LEFT   && newDirection == RIGHT)
-                        || (_oldDirection == RIGHT  && newDirection == LEFT)
-                        || (_oldDirection == UP     && newDirection == DOWN)
-                        || (_oldDirection == DOWN   && newDirection == UP)
-                        || (_oldDirection == UPRIGHT   && newDirection == DOWNLEFT)
-                        || (_oldDirection == UPLEFT    && newDirection == DOWNRIGHT)
-                        || (_oldDirection == DOWNLEFT  && newDirection == UPRIGHT)
-                        || (_oldDirection == DOWNRIGHT && newDirection == UPLEFT);
+  bool opposingDirection = isOppositeMove(_oldDirection, newDirection);
 
   return (opposingDirection) ? NOTMOVING : newDirection;
 }
 
+///
+/// \brief EmitPickupBursts Sends out a burst wherever a pickup has been collected since the
+/// last frame. Comparing snapshots rather than watching the game means nothing is missed
+/// when the renderer skips some
+/// \param io_particles
+/// \param _frame
+/// \param io_last What was on the board last frame, updated to this one
+/// \param _colours Each player's colour
+///
+void emitPickupBursts(Particles *io_particles,
+                      const Snapshot *_frame,
+                      Pickups *io_last,
+                      const SDL_Color _colours[PLAYER_TOTAL])
+{
+  bool isGemLive[PICKUP_TOTAL] = { false };
+  bool isKnightLive[PICKUP_TOTAL] = { false };
+  Coord gemPositions[PICKUP_TOTAL];
+
+  for(int i = 0; i < _frame->pickups.gems.count; ++i)
+  {
+    const int c_id = _frame->pickups.gems.id[i];
+
+    isGemLive[c_id] = true;
+    gemPositions[c_id].x = _frame->pickups.gems.x[i];
+    gemPositions[c_id].y = _frame->pickups.gems.y[i];
+  }
+
+  for(int i = 0; i < _frame->pickups.knights.count; ++i)
+  {
+    isKnightLive[_frame->pickups.knights.id[i]] = true;
+  }
+
+  const Gems *c_gems = &io_last->gems;
+
+  // With --respawn a new gem can take the id of one collected since the last frame,
+  // so a gem that is somewhere else now has been collected too
+  for(int i = 0; i < c_gems->count; ++i)
+  {
+    const int c_id = c_gems->id[i];
+
+    if(!isGemLive[c_id] || gemPositions[c_id].x != c_gems->x[i] || gemPositions[c_id].y != c_gems->y[i])
+    {
+      emitBurst(io_particles, _frame, c_gems->x[i] + PICKUP_SIZE/2, c_gems->y[i] + PICKUP_SIZE/2,
+                GEM_BURST, _colours);
+    }
+  }
+
+  const Knights *c_knights = &io_last->knights;
+
+  for(int i = 0; i < c_knights->count; ++i)
+  {
+    if(!isKnightLive[c_knights->id[i]])
+    {
+      emitBurst(io_particles, _frame, c_knights->x[i] + KNIGHT_SIZE/2, c_knights->y[i] + KNIGHT_SIZE/2,
+                KNIGHT_BURST, _colours);
+    }
+  }
+
+  *io_last = _frame->pickups;
+}
+
+///
+/// \brief EmitBurst Sends out _count particles from a point, in the colour of the nearest snake
+///
+void emitBurst(Particles *io_particles,
+               const Snapshot *_frame,
+               int _x,
+               int _y,
+               int _count,
+               const SDL_Color _colours[PLAYER_TOTAL])
+{
+  int nearest = 0;
+  int nearestDistance = INT_MAX;
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    const Node *c_head = getSnapshotHead(_frame, p);
+
+    if(c_head != NULL)
+    {
+      const int c_dx = c_head->pos.x + c_head->pos.w / 2 - _x;
+      const int c_dy = c_head->pos.y + c_head->pos.h / 2 - _y;
+
+      if(c_dx * c_dx + c_dy * c_dy < nearestDistance)
+      {
+        nearestDistance = c_dx * c_dx + c_dy * c_dy;
+        nearest = p;
+      }
+    }
+  }
+
+  emitParticles(io_particles, (float)_x, (float)_y, _count, BURST_SPEED, BURST_LIFE, _colours[nearest]);
+}
+
+///
+/// \brief EmitCollisionBursts Breaks up every snake that collided with itself into red particles
+///
+void emitCollisionBursts(Particles *io_particles,
+                         const Snapshot *_frame)
+{
+  const SDL_Color c_red = {255, 0, 0, 255};
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    if(!_frame->hasCollided[p])
+    {
+      continue;
+    }
 
+    for(int i = 0; i < _frame->segmentCount[p]; ++i)
+    {
+      const SDL_Rect *c_pos = &_frame->segments[p][i].pos;
 
+      emitParticles(io_particles, (float)(c_pos->x + c_pos->w / 2), (float)(c_pos->y + c_pos->h / 2),
+                    SEGMENT_BURST, BURST_SPEED * 0.5f, BURST_LIFE * 2.0f, c_red);
+    }
+  }
+}
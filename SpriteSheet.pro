@@ -4,7 +4,31 @@ DESTDIR=./
 SOURCES+=SpriteSheet.c \
     actor.c \
     pickup.c \
-    utils.c
+    utils.c \
+    observation.c \
+    ai.c \
+    options.c \
+    game.c \
+    tournament.c \
+    snapshot.c \
+    simulation.c \
+    canvas.c \
+    capture.c \
+    trace.c \
+    statehash.c \
+    netplay.c \
+    statefeed.c \
+    recording.c \
+    timerwheel.c \
+    hud.c \
+    particles.c \
+    neighbours.c \
+    mixer.c \
+    viewports.c \
+    metrics.c \
+    allocator.c \
+    arena.c \
+    spawner.c
 cache()
 
 QMAKE_CFLAGS=-std=c99
@@ -14,11 +38,46 @@ message(output from sdl2-config --cflags added to CXXFLAGS= $$QMAKE_CFLAGS)
 LIBS+=$$system(sdl2-config  --libs)
 message(output from sdl2-config --libs added to LIB=$$LIBS)
 LIBS+=-lSDL2_image
+unix:!macx: LIBS+=-lrt
+unix: LIBS+=-lm
 macx:DEFINES+=MAC_OS_X_VERSION_MIN_REQUIRED=1060
 CONFIG += console
 CONFIG -= app_bundle
 
+# make check builds the unit tests in tests.c against every module but the game's main, and runs them
+unittests.target = tests
+unittests.depends = tests.o $(filter-out SpriteSheet.o,$(OBJECTS))
+unittests.commands = $(LINK) $(LFLAGS) -o tests tests.o $(filter-out SpriteSheet.o,$(OBJECTS)) $(LIBS)
+check.depends = tests
+check.commands = ./tests
+QMAKE_EXTRA_TARGETS += unittests check
+
 HEADERS += \
     actor.h \
     pickup.h \
-    utils.h
+    utils.h \
+    observation.h \
+    ai.h \
+    options.h \
+    game.h \
+    tournament.h \
+    snapshot.h \
+    simulation.h \
+    canvas.h \
+    capture.h \
+    trace.h \
+    statehash.h \
+    netplay.h \
+    statefeed.h \
+    feedformat.h \
+    recording.h \
+    timerwheel.h \
+    hud.h \
+    particles.h \
+    neighbours.h \
+    mixer.h \
+    viewports.h \
+    metrics.h \
+    allocator.h \
+    arena.h \
+    spawner.h
@@ -1,66 +1,126 @@
 #include "actor.h"
 
+#include "allocator.h"
+
+#define SELF_SEGMENT_SKIP (8)   // collidesWithSelf only checks every few segments, as they overlap
+#define SELF_PADDING      (14)  // And only counts a collision this far into a segment
+
+const int WIDTH=800;
+const int HEIGHT=600;
+
 Node *createSnake(Node *_head,
                   int _count,
-                  Node *_body)
+                  Node *_body,
+                  Node **io_spare)
 {
-  Node *root = createSegment(_head);
+  Node *root = reuseSegment(io_spare, _head);
   setState(root, HEAD);
   setState(_body, BODY);
 
+  if(_count <= 0)
+  {
+    return root;
+  }
+
   const int StripeSize = 3;
+  const int c_moveOffset = root->pos.h/4;
+
+  // Laid out as if the head had moved right once per segment, each new segment being
+  // dropped where the head was and becoming its neck, but built in one pass from the
+  // tail forwards so a long snake costs no more per segment than a short one
+  SDL_Rect headPos = root->pos;
+  Node *neck = NULL;
   int counter = 0;
 
-  Node *listptr = root;
-  if(_count > 0)
+  for(int i = 0; i < _count; ++i)
   {
-    //Create and position the body segments
-    for(int i = 0; i < _count; ++i)
+    // Set the initial strip pattern on the snake
+    // and change the starting frame for a ripple effect
+    counter++;
+    if(counter <= StripeSize)
     {
-      if(listptr!=NULL)
-      {
-        // Set the initial strip pattern on the snake
-        // and change the starting frame for a ripple effect
-        counter++;
-        if(counter <= StripeSize)
-        {
-          addState(_body, ALT);
-          _body->anim.currentFrame = 1;
-        }
-        else if(counter < (StripeSize*2))
-        {
-          removeState(_body, ALT);
-          _body->anim.currentFrame = 0;
-        }
-        else
-        {
-          counter = 0;
-        }
+      addState(_body, ALT);
+      _body->anim.currentFrame = 1;
+    }
+    else if(counter < (StripeSize*2))
+    {
+      removeState(_body, ALT);
+      _body->anim.currentFrame = 0;
+    }
+    else
+    {
+      counter = 0;
+    }
 
-        insertAfterSegment(listptr, createSegment(_body), false);
-        updateSnakePos(root, &listptr->next, RIGHT);
+    Node *segment = reuseSegment(io_spare, _body);
+    segment->pos = headPos;
+    linkSegments(segment, neck);
+    neck = segment;
 
-        listptr = getLastSegment(root);
-      }
-    }
+    moveSprite(RIGHT, &headPos, c_moveOffset);
   }
 
+  linkSegments(root, neck);
+
+  root->pos = headPos;
+  root->idleDirection = RIGHT;
+  addState(root, MOVING);
+
   return root;
 }
 
+Node *reuseSegment(Node **io_spare,
+                   Node *_data)
+{
+  if(io_spare == NULL || *io_spare == NULL)
+  {
+    return createSegment(_data);
+  }
+
+  Node *segment = *io_spare;
+  (*io_spare) = segment->next;
+
+  *segment = *_data;
+  segment->next = NULL;
+  segment->prev = NULL;
+
+  return segment;
+}
+
+void recycleSnake(Node *_tail,
+                  Node **io_spare)
+{
+  while(_tail != NULL)
+  {
+    Node *prev = _tail->prev;
+
+    _tail->next = (*io_spare);
+    (*io_spare) = _tail;
+
+    _tail = prev;
+  }
+}
+
 Node *getLastSegment(Node * _root);
 Node *createSegment(Node * _dataSegment);
 void insertAfterSegment(Node *_listNode, Node *_newNode, bool _isNewNodeLinked);
-void growsnake(Node *_head, Node **io_tail, Node *_data);
+void growsnake(Node *_head, Node **io_tail, Node *_data, Node **io_spare);
 void linkSegments(Node *_node, Node *_nodeToLinkTo);
 void unlinkNextSegment(Node *_linkedNode);
 void unlinkPrevSegment(Node *_linkedNode);
 void updateSegmentFrames(Node *_head);
 void freeList(Node **io_root);
 bool collidesWithSelf(Node *_head);
+int sweepSelfCollision(Node *_head, int _stepX, int _stepY, int _steps, SegmentSweep o_tailEnd[],
+                       int *o_tailEndCount);
+bool collidesWithSegment(const Node *_head, const SegmentSweep *_segment, int _check);
 
 // Movement
 void moveSprite(Move _dir, SDL_Rect *io_pos, int _offset);
+void wrapSprite(SDL_Rect *io_pos);
+bool sweepSprite(const SDL_Rect *_from, int _stepX, int _stepY, int _steps, const SDL_Rect *_target,
+                 int _clipRadius, int *o_first, int *o_last);
+bool isOppositeMove(Move _a, Move _b);
 void updateSnakePos(Node * _head, Node ** io_tail, Move _dir);
 void shiftSnakeBody(Node *_head, Node **_tail, SDL_Rect *_oldHeadPos);
 
@@ -99,13 +159,126 @@ void moveSprite(Move _dir,
     if(_dir == DOWNRIGHT) { io_pos->x += _offset; }
   }
 
+  wrapSprite(io_pos);
+}
+
+void wrapSprite(SDL_Rect *io_pos)
+{
   // If the player attempts to walk offscreen, wrap their position around to the opposite side
   if(io_pos->y <= -io_pos->h)    { io_pos->y += (HEIGHT + io_pos->h * 2); }
   if(io_pos->y >= HEIGHT)        { io_pos->y -= (HEIGHT + io_pos->h * 2); }
 
   if(io_pos->x <= -io_pos->w)    { io_pos->x += (WIDTH + io_pos->w * 2); }
   if(io_pos->x >= WIDTH)         { io_pos->x -= (WIDTH + io_pos->w * 2); }
+}
+
+bool sweepSprite(const SDL_Rect *_from,
+                 int _stepX,
+                 int _stepY,
+                 int _steps,
+                 const SDL_Rect *_target,
+                 int _clipRadius,
+                 int *o_first,
+                 int *o_last)
+{
+  const int c_dx = _stepX * _steps;
+  const int c_dy = _stepY * _steps;
+
+  // wrapSprite keeps a sprite from twice its size off the left or top up to the far edge, and
+  // moves it a screen plus twice its size back once it leaves. Each place the line does is a
+  // cut, from where the target has to be tried that far the other way to meet the sprite
+  int cuts[2];
+  int shiftX[2] = { 0, 0 };
+  int shiftY[2] = { 0, 0 };
+  int cutCount = 0;
+
+  if(c_dx > 0 && _from->x + c_dx >= WIDTH)
+  {
+    cuts[cutCount] = (int)((Sint64)(WIDTH - _from->x) * SWEEP_TIME_ONE / c_dx);
+    shiftX[cutCount++] = WIDTH + _from->w * 2;
+  }
+  else if(c_dx < 0 && _from->x + c_dx < -_from->w * 2)
+  {
+    cuts[cutCount] = (int)((Sint64)(_from->x + _from->w * 2 + 1) * SWEEP_TIME_ONE / -c_dx);
+    shiftX[cutCount++] = -(WIDTH + _from->w * 2);
+  }
+
+  if(c_dy > 0 && _from->y + c_dy >= HEIGHT)
+  {
+    cuts[cutCount] = (int)((Sint64)(HEIGHT - _from->y) * SWEEP_TIME_ONE / c_dy);
+    shiftY[cutCount++] = HEIGHT + _from->h * 2;
+  }
+  else if(c_dy < 0 && _from->y + c_dy < -_from->h * 2)
+  {
+    cuts[cutCount] = (int)((Sint64)(_from->y + _from->h * 2 + 1) * SWEEP_TIME_ONE / -c_dy);
+    shiftY[cutCount++] = -(HEIGHT + _from->h * 2);
+  }
+
+  // A diagonal line can cross both, earliest first
+  if(cutCount == 2 && cuts[1] < cuts[0])
+  {
+    const int c_cut = cuts[0];
+    cuts[0] = cuts[1];
+    cuts[1] = c_cut;
+    shiftX[1] = shiftX[0];
+    shiftX[0] = 0;
+    shiftY[0] = shiftY[1];
+    shiftY[1] = 0;
+  }
+
+  SDL_Rect target = *_target;
+  int start = 0;
+  int first = SWEEP_TIME_ONE + 1;
+  int last = -1;
+
+  // The cuts are rounded down, so each piece is stretched a time past them both ways
+  for(int piece = 0; piece <= cutCount; ++piece)
+  {
+    const int c_end = (piece < cutCount) ? (cuts[piece] + 1) : SWEEP_TIME_ONE;
+    int enter;
+    int leave;
+
+    if(sweepCollision(_from, c_dx, c_dy, &target, _clipRadius, &enter, &leave) &&
+       enter <= c_end && leave >= start)
+    {
+      if(enter < start) { enter = start; }
+      if(leave > c_end) { leave = c_end; }
+      if(enter < first) { first = enter; }
+      if(leave > last)  { last = leave; }
+    }
+
+    if(piece < cutCount)
+    {
+      start = cuts[piece];
+      target.x += shiftX[piece];
+      target.y += shiftY[piece];
+    }
+  }
+
+  if(last < 0)
+  {
+    return false;
+  }
+
+  *o_first = (int)((Sint64)first * _steps / SWEEP_TIME_ONE);
+  *o_last = (int)(((Sint64)last * _steps + SWEEP_TIME_ONE - 1) / SWEEP_TIME_ONE);
+
+  if(*o_last > _steps) { *o_last = _steps; }
 
+  return true;
+}
+
+bool isOppositeMove(Move _a,
+                    Move _b)
+{
+  return (_a == LEFT      && _b == RIGHT)
+      || (_a == RIGHT     && _b == LEFT)
+      || (_a == UP        && _b == DOWN)
+      || (_a == DOWN      && _b == UP)
+      || (_a == UPRIGHT   && _b == DOWNLEFT)
+      || (_a == UPLEFT    && _b == DOWNRIGHT)
+      || (_a == DOWNLEFT  && _b == UPRIGHT)
+      || (_a == DOWNRIGHT && _b == UPLEFT);
 }
 
 ///
@@ -184,18 +357,15 @@ void shiftSnakeBody(Node *_head,
 
 bool collidesWithSelf(Node *_head)
 {
-  // Only check every few segments, as they overlap
-  const int c_segmentsToSkip = 8;
-  const int c_segmentPadding = 14;
   int counter = 1; // Start at first segment
 
   Node *tmp = _head;
 
   while(tmp != NULL)
   {
-    if((counter++ % c_segmentsToSkip) == 0)
+    if((counter++ % SELF_SEGMENT_SKIP) == 0)
     {
-      if(detectCollision(&_head->pos, &tmp->pos, c_segmentPadding))
+      if(detectCollision(&_head->pos, &tmp->pos, SELF_PADDING))
       {
         return true;
       }
@@ -207,3 +377,294 @@ bool collidesWithSelf(Node *_head)
   return false;
 }
 
+int sweepSelfCollision(Node *_head,
+                       int _stepX,
+                       int _stepY,
+                       int _steps,
+                       SegmentSweep o_tailEnd[],
+                       int *o_tailEndCount)
+{
+  const bool c_isMoving = (_stepX != 0 || _stepY != 0);
+
+  int length = 0;
+
+  for(const Node *tmp = _head; tmp != NULL; tmp = tmp->next)
+  {
+    ++length;
+  }
+
+  int hit = _steps + 1;
+  int index = 1;
+
+  *o_tailEndCount = 0;
+
+  for(const Node *tmp = _head->next; tmp != NULL; tmp = tmp->next, ++index)
+  {
+    int first;
+    int last;
+
+    if(!sweepSprite(&_head->pos, _stepX, _stepY, _steps, &tmp->pos, SELF_PADDING, &first, &last) ||
+       first >= hit)
+    {
+      continue;
+    }
+
+    // Each move takes the tail for the new neck, which growing can put off, so a segment
+    // the tail could reach during the moves may or may not still be there
+    if(c_isMoving && index + _steps >= length)
+    {
+      const SegmentSweep c_segment = { tmp, index, first, last };
+      o_tailEnd[(*o_tailEndCount)++] = c_segment;
+      continue;
+    }
+
+    // A head that isn't moving checks the same segments in the same place every time
+    if(!c_isMoving)
+    {
+      last = first;
+    }
+
+    for(int check = first; check <= last && check < hit; ++check)
+    {
+      // Every move shifts the segment one further along the body
+      const int c_counter = index + (c_isMoving ? check : 0) + 1;
+
+      if(c_counter % SELF_SEGMENT_SKIP == 0)
+      {
+        SDL_Rect pos = _head->pos;
+        pos.x += check * _stepX;
+        pos.y += check * _stepY;
+        wrapSprite(&pos);
+
+        if(detectCollision(&pos, &tmp->pos, SELF_PADDING))
+        {
+          hit = check;
+        }
+      }
+    }
+  }
+
+  return hit;
+}
+
+bool collidesWithSegment(const Node *_head,
+                         const SegmentSweep *_segment,
+                         int _check)
+{
+  return _segment->segment != NULL && _check >= _segment->first && _check <= _segment->last &&
+         (_segment->index + _check + 1) % SELF_SEGMENT_SKIP == 0 &&
+         detectCollision(&_head->pos, &_segment->segment->pos, SELF_PADDING);
+}
+
+////
+/// \brief GetState Checks a node's state
+/// \param _node
+/// \param _state
+/// \return True if the node contains the state, otherwise false
+///
+bool getState(Node *_node,
+              NodeState _state)
+{
+  if((_node->state & _state) == _state)
+  {
+    return true;
+  }
+
+  return false;
+}
+
+
+void addState(Node *_node,
+              NodeState _state)
+{
+  _node->state |= _state;
+}
+
+void removeState(Node *_node,
+                 NodeState _state)
+{
+  if(getState(_node, _state))
+  {
+    _node->state -= _state;
+  }
+}
+
+void setState(Node *_node,
+              NodeState _state)
+{
+  _node->state = _state;
+}
+
+///
+/// \brief freeList Frees all of the memory used by a list of segments
+/// \param io_root
+///
+void freeList(Node **io_root)
+{
+  Node *tmp;
+
+  while(*io_root != NULL)
+  {
+    tmp = (*io_root);
+    (*io_root) = (*io_root)->next;
+
+    freeMemory(tmp);
+  }
+}
+
+////
+/// \brief LinkSegments
+/// Helper function that correctly updates 2 segments to be linked to each other
+/// \param Node
+/// \param NodeToLinkTo
+///
+void linkSegments(Node *_node,
+                  Node *_nodeToLinkTo)
+{
+  if(_node!=NULL && _nodeToLinkTo!=NULL)
+  {
+      _node->next = _nodeToLinkTo;
+      _nodeToLinkTo->prev = _node;
+  }
+}
+
+void unlinkNextSegment(Node *_linkedNode)
+{
+  if(_linkedNode->next != NULL)
+  {
+    _linkedNode->next->prev = _linkedNode->prev;
+    _linkedNode->next = NULL;
+  }
+}
+
+void unlinkPrevSegment(Node *_linkedNode)
+{
+  if(_linkedNode->prev != NULL)
+  {
+    _linkedNode->prev->next = _linkedNode->next;
+    _linkedNode->prev = NULL;
+  }
+}
+
+////
+/// \brief InsertAfterSegment
+/// \param _listNode
+/// \param _newNode
+/// \param _isNewNodeLinked
+///
+void insertAfterSegment(Node *_listNode,
+                        Node *_newNode,
+                        bool _isNewNodeLinked)
+{
+  if(_isNewNodeLinked)
+  {
+    unlinkNextSegment(_newNode);
+    unlinkPrevSegment(_newNode);
+  }
+
+  _newNode->prev = _listNode;
+  _newNode->next = _listNode->next;
+
+  _listNode->next = _newNode;
+}
+
+///
+/// \brief Growsnake Adds a new segment to the snake
+/// \param _head
+/// \param io_tail
+/// \param _data Data that will be copied over to the new segment
+/// \param io_spare Segments to reuse before allocating, can be NULL
+///
+void growsnake(Node *_head,
+               Node **io_tail,
+               Node *_data,
+               Node **io_spare)
+{
+  if(io_tail==NULL || (*io_tail)==NULL)
+  {
+    return;
+  }
+
+  if(_head!=NULL && _head->next!=NULL)
+  {
+    // The body will use this state to give the impression
+    // that the snake is swallowing it's prey
+    addState(_head->next, EATING);
+  }
+
+  Node *newTail = reuseSegment(io_spare, _data);
+  // Quick way of ensuring the new tail is hidden until the player moves
+  newTail->pos.x = 0 - SNAKE_RADIUS*2;
+  newTail->pos.y = 0 - SNAKE_RADIUS*2;
+
+  newTail->prev = (*io_tail);
+  (*io_tail) = newTail;
+  (*io_tail)->anim.currentFrame = (*io_tail)->prev->anim.currentFrame;
+}
+
+///
+/// \brief GetLastSegment
+/// \param _root
+/// \return The last segment in a chain of segments
+///
+Node *getLastSegment(Node * _root)
+{
+  if(_root!=NULL)
+  {
+    while( _root->next != NULL )
+    {
+      _root = _root->next;
+    }
+  }
+
+  return _root;
+}
+
+/////
+/// \brief CreateSegment Allocates memory for a new segment
+/// \param _data Data that will be copied over to the new segment
+/// \return A pointer to the new segment
+///
+Node *createSegment(Node * _data)
+{
+    Node *newSegment = allocateMemory(MEMORY_SEGMENTS, sizeof(Node));
+    *newSegment = *_data;
+    newSegment->next = NULL;
+    newSegment->prev = NULL;
+
+    return newSegment;
+}
+
+////
+/// \brief UpdateSegmentFrames Checks the state of every segment in the snake and updates the frame accordingly
+/// \param _head The first segment Node in the snake
+///
+void updateSegmentFrames(Node *_head)
+{
+  // Frame totals
+  const unsigned int c_bodyMove = 1;
+  const unsigned int c_headMove = 2;
+
+  bool isMoving = getState(_head, MOVING);
+
+  Node *node = _head;
+
+  while(node!=NULL)
+  {
+    if(isMoving)
+    {
+      unsigned int frameTotal = getState(node, HEAD) ? c_headMove : c_bodyMove;
+
+      if(node->anim.currentFrame < frameTotal)
+      {
+        node->anim.currentFrame++;
+      }
+      else
+      {
+        node->anim.currentFrame = 0;
+      }
+    }
+
+    node = node->next;
+  }
+}
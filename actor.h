@@ -7,6 +7,8 @@
 extern const int WIDTH;
 extern const int HEIGHT;
 
+#define SNAKE_RADIUS      (64)
+
 // These correspond to each row in the knight/snake spritesheets
 typedef enum{
     NOTMOVING = -1,
@@ -47,22 +49,44 @@ typedef struct Node{
   struct Node *prev;
 } Node;
 
+// A segment a head's path was swept against, and the checks along the path it might collide on
+typedef struct SegmentSweep{
+  const Node *segment;  // NULL once it has moved, it is then left alone
+  int index;            // How far along the body it was when swept, the neck is 1
+  int first;            // Checks, 0 for where the head starts
+  int last;
+} SegmentSweep;
+
 ////
 /// \brief CreateSnake
 ///  Creates the head, and optionally a specified amount of body, of a snake.
+///  The body is laid out to the left of where the head ends up, in a single pass
 /// \param _headSegment Template data to use to make the head segment
 /// \param _bodySegmentCount How many body segments to create
 /// \param _bodySegment Template data to use to make the body segments
+/// \param io_spare Segments to use before allocating new ones, can be NULL
 /// \return A pointer to the root/head segment of a new snake
 ///
 Node *createSnake(Node *_head,
                   int _count,
-                  Node *_body);
+                  Node *_body,
+                  Node **io_spare);
 
 Node *getLastSegment(Node * _root);
 Node *createSegment(Node * _dataSegment);
+///
+/// \brief ReuseSegment Takes a segment from the spare list if there is one, otherwise allocates it
+/// \param io_spare Spare segments chained through next, can be NULL
+/// \param _data Data that will be copied over to the segment
+///
+Node *reuseSegment(Node **io_spare, Node *_data);
+///
+/// \brief RecycleSnake Moves every segment of a snake onto the spare list, walking
+/// from the tail so segments growsnake hasn't linked forwards yet aren't missed
+///
+void recycleSnake(Node *_tail, Node **io_spare);
 void insertAfterSegment(Node *_listNode, Node *_newNode, bool _isNewNodeLinked);
-void growsnake(Node *_head, Node **io_tail, Node *_data);
+void growsnake(Node *_head, Node **io_tail, Node *_data, Node **io_spare);
 void linkSegments(Node *_node, Node *_nodeToLinkTo);
 void unlinkNextSegment(Node *_linkedNode);
 void unlinkPrevSegment(Node *_linkedNode);
@@ -74,9 +98,58 @@ void freeList(Node **io_root);
 /// \return True if there is any collision, otherwise false
 ///
 bool collidesWithSelf(Node *_head);
+///
+/// \brief SweepSelfCollision CollidesWithSelf for each check of a head about to make several
+/// moves in a straight line, a check before each move. The path is swept against every segment
+/// once, and only the checks the sweep leaves are made, with the segment as far along the body
+/// as those moves will have shifted it. The segments the head passes on the way can't be
+/// reached again in a straight line
+/// \param _head The root segment, where the first check is
+/// \param _stepX How far each move goes, 0 for a head that isn't moving
+/// \param _stepY
+/// \param _steps Moves between the first check and the last, 0 to check only where it is
+/// \param o_tailEnd Segments the tail might take before the head reaches them, which only the
+/// caller can tell, with room for _steps. Check them with collidesWithSegment
+/// \param o_tailEndCount
+/// \return The first check that collides with any other segment, _steps + 1 if none does
+///
+int sweepSelfCollision(Node *_head, int _stepX, int _stepY, int _steps, SegmentSweep o_tailEnd[],
+                       int *o_tailEndCount);
+///
+/// \brief CollidesWithSegment CollidesWithSelf for one segment left by sweepSelfCollision,
+/// which the head has moved _check times towards since
+///
+bool collidesWithSegment(const Node *_head, const SegmentSweep *_segment, int _check);
 
 // Movement
 void moveSprite(Move _dir, SDL_Rect *io_pos, int _offset);
+///
+/// \brief WrapSprite Puts a sprite that has gone wholly off one side of the screen back on the
+/// other, as moveSprite does after every move. Only undoes one move's worth of going off
+///
+void wrapSprite(SDL_Rect *io_pos);
+///
+/// \brief SweepSprite Finds which of a sprite's next few moves with moveSprite might leave it
+/// colliding with a target, without trying each. The line it moves along is cut where it
+/// wraps, and each piece is swept with sweepCollision against the target moved the other way.
+/// Either end of the range can be a move further out than the first or last that collides
+/// \param _from Where it starts
+/// \param _stepX Each move, shorter than a screen in all
+/// \param _stepY
+/// \param _steps Moves after the start, 0 to only test where it is
+/// \param _target
+/// \param _clipRadius As detectCollision
+/// \param o_first 0 for where it starts to _steps for the end of the last move
+/// \param o_last
+/// \return False if it collides at no point along the moves
+///
+bool sweepSprite(const SDL_Rect *_from, int _stepX, int _stepY, int _steps, const SDL_Rect *_target,
+                 int _clipRadius, int *o_first, int *o_last);
+///
+/// \brief IsOppositeMove Checks if two directions point directly away from each other,
+/// turning from one to the other would mean instant death as the snake collides with itself
+///
+bool isOppositeMove(Move _a, Move _b);
 void updateSnakePos(Node * _head, Node ** io_tail, Move _dir);
 ///
 /// \brief shiftSnakeBody
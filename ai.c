@@ -0,0 +1,529 @@
+#include "ai.h"
+
+#include <string.h>
+
+#include "allocator.h"
+
+// Mirrors the checks done by collidesWithSelf and the pickup loop in updateGame()
+static const int c_segmentsToSkip = 8;
+static const int c_segmentPadding = 14;
+static const int c_pickupPadding  = 6;
+static const int c_lookAhead      = 4;
+
+static const int c_neighbourX[8] = { 0, -1, 0, 1, -1,  1, -1, 1 };
+static const int c_neighbourY[8] = {-1,  0, 1, 0, -1, -1,  1, 1 };
+
+static int wrapCell(int _cell, int _total);
+static int getNeighbour(const AIPlanner *_planner, int _cell, int _n);
+static void raiseCell(AIPlanner *io_planner, int _cell);
+static void queueCell(AIPlanner *io_planner, int _cell);
+static int getCellIndex(const AIPlanner *_planner, int _x, int _y);
+static void markRange(const AIPlanner *_planner, Uint8 *io_cells,
+                      int _x0, int _y0, int _x1, int _y1);
+static void startBuild(AIPlanner *io_planner, Node *const *_snakes, int _snakeCount,
+                       const Pickups *_pickups);
+static void addGoal(AIPlanner *io_planner, int _x, int _y);
+static int getSafeMoves(Node *_head, Move _dir, int _moveOffset);
+static void markWalls(AIPlanner *io_planner, const ArenaMap *_map);
+
+bool createAIPlanner(AIPlanner *o_planner,
+                     int _segmentSize,
+                     unsigned int _budgetUs,
+                     const ArenaMap *_map)
+{
+  o_planner->segmentSize = _segmentSize;
+  o_planner->cellSize = _segmentSize/4;
+
+  // wrapSprite wraps a sprite once it is fully offscreen, so a full lap
+  // is the screen plus the sprite's size on either side
+  o_planner->wrapWidth  = WIDTH  + _segmentSize*2;
+  o_planner->wrapHeight = HEIGHT + _segmentSize*2;
+  o_planner->cols = (o_planner->wrapWidth  + o_planner->cellSize - 1) / o_planner->cellSize;
+  o_planner->rows = (o_planner->wrapHeight + o_planner->cellSize - 1) / o_planner->cellSize;
+
+  const int c_cellTotal = o_planner->cols * o_planner->rows;
+
+  o_planner->walls       = allocateMemory(MEMORY_AI, c_cellTotal * sizeof(Uint8));
+  o_planner->blocked     = allocateMemory(MEMORY_AI, c_cellTotal * sizeof(Uint8));
+  o_planner->nextBlocked = allocateMemory(MEMORY_AI, c_cellTotal * sizeof(Uint8));
+  o_planner->isGoal      = allocateMemory(MEMORY_AI, c_cellTotal * sizeof(Uint8));
+  o_planner->isQueued    = allocateMemory(MEMORY_AI, c_cellTotal * sizeof(Uint8));
+  o_planner->distance    = allocateMemory(MEMORY_AI, c_cellTotal * sizeof(Uint16));
+  o_planner->building    = allocateMemory(MEMORY_AI, c_cellTotal * sizeof(Uint16));
+  o_planner->raised      = allocateMemory(MEMORY_AI, c_cellTotal * sizeof(int));
+  o_planner->queue       = allocateMemory(MEMORY_AI, c_cellTotal * sizeof(int));
+
+  o_planner->budget = (SDL_GetPerformanceFrequency() * _budgetUs) / 1000000;
+
+  if(!o_planner->walls || !o_planner->blocked || !o_planner->nextBlocked || !o_planner->isGoal ||
+     !o_planner->isQueued || !o_planner->distance || !o_planner->building || !o_planner->raised ||
+     !o_planner->queue)
+  {
+    freeAIPlanner(o_planner);
+    return false;
+  }
+
+  markWalls(o_planner, _map);
+
+  resetAIPlanner(o_planner);
+
+  return true;
+}
+
+void freeAIPlanner(AIPlanner *io_planner)
+{
+  freeMemory(io_planner->walls);
+  freeMemory(io_planner->blocked);
+  freeMemory(io_planner->nextBlocked);
+  freeMemory(io_planner->isGoal);
+  freeMemory(io_planner->isQueued);
+  freeMemory(io_planner->distance);
+  freeMemory(io_planner->building);
+  freeMemory(io_planner->raised);
+  freeMemory(io_planner->queue);
+
+  io_planner->walls = NULL;
+  io_planner->blocked = NULL;
+  io_planner->nextBlocked = NULL;
+  io_planner->isGoal = NULL;
+  io_planner->isQueued = NULL;
+  io_planner->distance = NULL;
+  io_planner->building = NULL;
+  io_planner->raised = NULL;
+  io_planner->queue = NULL;
+}
+
+void resetAIPlanner(AIPlanner *io_planner)
+{
+  const int c_cellTotal = io_planner->cols * io_planner->rows;
+
+  // Until the first build completes every snake just carries on in a straight line.
+  // With no goals nothing is reachable, so the first build repairs from an empty field
+  for(int i = 0; i < c_cellTotal; ++i)
+  {
+    io_planner->distance[i] = AI_UNREACHABLE;
+  }
+
+  memcpy(io_planner->blocked, io_planner->walls, c_cellTotal);
+  memset(io_planner->isQueued, 0, c_cellTotal);
+
+  io_planner->raisedHead = 0;
+  io_planner->raisedTail = 0;
+  io_planner->queueHead = 0;
+  io_planner->queueCount = 0;
+  io_planner->isBuilding = false;
+}
+
+void updateAIPlanner(AIPlanner *io_planner,
+                     Node *const *_snakes,
+                     int _snakeCount,
+                     const Pickups *_pickups)
+{
+  if(!io_planner->isBuilding)
+  {
+    startBuild(io_planner, _snakes, _snakeCount, _pickups);
+  }
+
+  const Uint64 c_start = SDL_GetPerformanceCounter();
+  const int c_checkInterval = 256;
+  int expanded = 0;
+
+  const int c_cellTotal = io_planner->cols * io_planner->rows;
+  const Uint16 *c_old = io_planner->distance;
+  Uint16 *field = io_planner->building;
+
+  while(io_planner->raisedHead < io_planner->raisedTail || io_planner->queueCount > 0)
+  {
+    if(io_planner->raisedHead < io_planner->raisedTail)
+    {
+      // A neighbour one further out only got its distance through this cell, unless another
+      // neighbour was just as close. Either way clearing it is safe, lowering puts it back.
+      // Anything left standing next to a cleared cell is where the lowering starts from
+      const int c_cell = io_planner->raised[io_planner->raisedHead++];
+      const int c_dependent = (int)c_old[c_cell] + 1;
+
+      for(int n = 0; n < 8; ++n)
+      {
+        const int c_neighbour = getNeighbour(io_planner, c_cell, n);
+
+        if(io_planner->nextBlocked[c_neighbour])
+        {
+          continue;
+        }
+
+        if(field[c_neighbour] == c_old[c_neighbour] && c_old[c_neighbour] == c_dependent)
+        {
+          raiseCell(io_planner, c_neighbour);
+        }
+        else if(field[c_neighbour] != AI_UNREACHABLE)
+        {
+          queueCell(io_planner, c_neighbour);
+        }
+      }
+    }
+    else
+    {
+      // Breadth first outwards from every cell that got closer, 8-connected and wrapping at
+      // the edges. A cell can be queued again if a shorter way to it turns up later
+      const int c_cell = io_planner->queue[io_planner->queueHead];
+
+      io_planner->queueHead = (io_planner->queueHead + 1) % c_cellTotal;
+      io_planner->queueCount--;
+      io_planner->isQueued[c_cell] = 0;
+
+      if(field[c_cell] == AI_UNREACHABLE)
+      {
+        continue;
+      }
+
+      const Uint16 c_next = field[c_cell] + 1;
+
+      for(int n = 0; n < 8; ++n)
+      {
+        const int c_neighbour = getNeighbour(io_planner, c_cell, n);
+
+        if(c_next < field[c_neighbour] && !io_planner->nextBlocked[c_neighbour])
+        {
+          field[c_neighbour] = c_next;
+          queueCell(io_planner, c_neighbour);
+        }
+      }
+    }
+
+    // Only look at the clock every so often, it costs more than a cell expansion
+    if(io_planner->budget > 0 && (++expanded % c_checkInterval) == 0)
+    {
+      if(SDL_GetPerformanceCounter() - c_start > io_planner->budget)
+      {
+        return;
+      }
+    }
+  }
+
+  // Build finished, swap it in so the snakes steer with it from now on
+  Uint8 *blocked = io_planner->blocked;
+
+  io_planner->blocked = io_planner->nextBlocked;
+  io_planner->nextBlocked = blocked;
+  io_planner->building = io_planner->distance;
+  io_planner->distance = field;
+  io_planner->isBuilding = false;
+}
+
+Move getAIMovement(const AIPlanner *_planner,
+                   Node *_head)
+{
+  const int c_moveOffset = _head->pos.h/4;
+  const Move c_current = _head->idleDirection;
+
+  Move bestMove = NOTMOVING;
+  Uint16 bestDistance = AI_UNREACHABLE;
+
+  // When every move runs into something, the one that stays clear the longest.
+  // Stopping would freeze the snake, carrying on at least ends the match
+  Move fallbackMove = c_current;
+  int fallbackMoves = 0;
+
+  // Check the current direction first so ties keep the snake going straight
+  const Move c_order[9] = { c_current, UP, LEFT, DOWN, RIGHT, UPLEFT, UPRIGHT, DOWNLEFT, DOWNRIGHT };
+
+  for(int i = 0; i < 9; ++i)
+  {
+    const Move c_dir = c_order[i];
+
+    if(c_dir == NOTMOVING || (i > 0 && c_dir == c_current) || isOppositeMove(c_current, c_dir))
+    {
+      continue;
+    }
+
+    SDL_Rect newPos = _head->pos;
+    moveSprite(c_dir, &newPos, c_moveOffset);
+
+    const int c_cell = getCellIndex(_planner, newPos.x, newPos.y);
+
+    if(_planner->walls[c_cell])
+    {
+      continue;
+    }
+
+    const int c_safeMoves = getSafeMoves(_head, c_dir, c_moveOffset);
+
+    if(c_safeMoves < c_lookAhead)
+    {
+      if(c_safeMoves > fallbackMoves)
+      {
+        fallbackMove = c_dir;
+        fallbackMoves = c_safeMoves;
+      }
+
+      continue;
+    }
+
+    const Uint16 c_distance = _planner->distance[c_cell];
+
+    if(bestMove == NOTMOVING || c_distance < bestDistance)
+    {
+      bestMove = c_dir;
+      bestDistance = c_distance;
+    }
+  }
+
+  return (bestMove != NOTMOVING) ? bestMove : fallbackMove;
+}
+
+///
+/// \brief WrapCell Wraps a cell coordinate that has stepped one cell off either edge
+///
+static int wrapCell(int _cell,
+                    int _total)
+{
+  if(_cell < 0)       { return _cell + _total; }
+  if(_cell >= _total) { return _cell - _total; }
+  return _cell;
+}
+
+///
+/// \brief GetNeighbour One of the 8 cells around _cell, wrapping at the edges
+///
+static int getNeighbour(const AIPlanner *_planner,
+                        int _cell,
+                        int _n)
+{
+  const int c_x = _cell % _planner->cols;
+  const int c_y = _cell / _planner->cols;
+
+  return wrapCell(c_y + c_neighbourY[_n], _planner->rows) * _planner->cols +
+         wrapCell(c_x + c_neighbourX[_n], _planner->cols);
+}
+
+///
+/// \brief RaiseCell Clears a cell whose distance can no longer be trusted
+///
+static void raiseCell(AIPlanner *io_planner,
+                      int _cell)
+{
+  io_planner->building[_cell] = AI_UNREACHABLE;
+  io_planner->raised[io_planner->raisedTail++] = _cell;
+}
+
+///
+/// \brief QueueCell Queues a cell to pass its distance on, unless it is already waiting
+///
+static void queueCell(AIPlanner *io_planner,
+                      int _cell)
+{
+  if(io_planner->isQueued[_cell])
+  {
+    return;
+  }
+
+  const int c_cellTotal = io_planner->cols * io_planner->rows;
+
+  io_planner->isQueued[_cell] = 1;
+  io_planner->queue[(io_planner->queueHead + io_planner->queueCount) % c_cellTotal] = _cell;
+  io_planner->queueCount++;
+}
+
+///
+/// \brief GetCellIndex Converts a segment's top left position into a cell index. Positions
+/// are wrapped by the same period as wrapSprite first, so any lap lands on the same cell
+/// even when the period is not a whole number of cells
+///
+static int getCellIndex(const AIPlanner *_planner,
+                        int _x,
+                        int _y)
+{
+  const int c_x = _x + _planner->segmentSize;
+  const int c_y = _y + _planner->segmentSize;
+  const int c_wrappedX = c_x - floorDiv(c_x, _planner->wrapWidth)  * _planner->wrapWidth;
+  const int c_wrappedY = c_y - floorDiv(c_y, _planner->wrapHeight) * _planner->wrapHeight;
+
+  return (c_wrappedY / _planner->cellSize) * _planner->cols + c_wrappedX / _planner->cellSize;
+}
+
+///
+/// \brief MarkRange Sets every cell a head could occupy between the two top left positions
+///
+static void markRange(const AIPlanner *_planner,
+                      Uint8 *io_cells,
+                      int _x0,
+                      int _y0,
+                      int _x1,
+                      int _y1)
+{
+  for(int y = _y0; y <= _y1 + _planner->cellSize - 1; y += _planner->cellSize)
+  {
+    for(int x = _x0; x <= _x1 + _planner->cellSize - 1; x += _planner->cellSize)
+    {
+      io_cells[getCellIndex(_planner, (x > _x1) ? _x1 : x, (y > _y1) ? _y1 : y)] = 1;
+    }
+  }
+}
+
+///
+/// \brief StartBuild Captures where the bodies and pickups are, and works out which cells
+/// of the last field that changes. Those are cleared or queued for updateAIPlanner to repair
+///
+static void startBuild(AIPlanner *io_planner,
+                       Node *const *_snakes,
+                       int _snakeCount,
+                       const Pickups *_pickups)
+{
+  const int c_cellTotal = io_planner->cols * io_planner->rows;
+  const int c_size = io_planner->segmentSize;
+
+  memcpy(io_planner->nextBlocked, io_planner->walls, c_cellTotal);
+  memset(io_planner->isGoal, 0, c_cellTotal);
+
+  // Block every head position that would overlap a body segment, the first few
+  // segments behind each head are skipped as they always overlap it
+  const int c_reach = c_size - c_segmentPadding*2;
+
+  for(int s = 0; s < _snakeCount; ++s)
+  {
+    int counter = 1;
+
+    for(Node *node = _snakes[s]; node != NULL; node = node->next)
+    {
+      if(counter++ >= c_segmentsToSkip)
+      {
+        markRange(io_planner, io_planner->nextBlocked,
+                  node->pos.x - c_reach, node->pos.y - c_reach,
+                  node->pos.x + c_reach, node->pos.y + c_reach);
+      }
+    }
+  }
+
+  // Every head position that would collect a pickup is a goal
+  for(int i = 0; i < _pickups->gems.count; ++i)
+  {
+    addGoal(io_planner, _pickups->gems.x[i], _pickups->gems.y[i]);
+  }
+
+  for(int i = 0; i < _pickups->knights.count; ++i)
+  {
+    addGoal(io_planner, _pickups->knights.x[i], _pickups->knights.y[i]);
+  }
+
+  memcpy(io_planner->building, io_planner->distance, c_cellTotal * sizeof(Uint16));
+
+  io_planner->raisedHead = 0;
+  io_planner->raisedTail = 0;
+  io_planner->queueHead = 0;
+  io_planner->queueCount = 0;
+
+  for(int i = 0; i < c_cellTotal; ++i)
+  {
+    if(io_planner->isGoal[i])
+    {
+      if(io_planner->building[i] != 0)
+      {
+        io_planner->building[i] = 0;
+        queueCell(io_planner, i);
+      }
+    }
+    else if(io_planner->nextBlocked[i] != io_planner->blocked[i] || io_planner->distance[i] == 0)
+    {
+      // Newly blocked, newly opened, or a pickup that has gone
+      raiseCell(io_planner, i);
+    }
+  }
+
+  io_planner->isBuilding = true;
+}
+
+///
+/// \brief AddGoal Marks every open cell a head could collect a pickup from as a goal,
+/// knights are collected by the same PICKUP_SIZE box as gems
+/// \param io_planner
+/// \param _x Top left of the pickup
+/// \param _y
+///
+static void addGoal(AIPlanner *io_planner,
+                    int _x,
+                    int _y)
+{
+  const int c_size = io_planner->segmentSize;
+
+  const int c_x0 = _x + c_pickupPadding*2 - c_size;
+  const int c_y0 = _y + c_pickupPadding*2 - c_size;
+  const int c_x1 = _x + PICKUP_SIZE - c_pickupPadding*2;
+  const int c_y1 = _y + PICKUP_SIZE - c_pickupPadding*2;
+
+  for(int y = c_y0; y <= c_y1; y += io_planner->cellSize)
+  {
+    for(int x = c_x0; x <= c_x1; x += io_planner->cellSize)
+    {
+      const int c_cell = getCellIndex(io_planner, x, y);
+
+      if(!io_planner->nextBlocked[c_cell])
+      {
+        io_planner->isGoal[c_cell] = 1;
+      }
+    }
+  }
+}
+
+///
+/// \brief GetSafeMoves Checks the head against the segments collidesWithSelf will test
+/// over the next few ticks if the snake carries on in _dir. Each move shifts the body
+/// up by one, so after m moves the segment at index i is tested when (i + m) is a multiple
+/// of c_segmentsToSkip
+/// \return How many moves it makes before hitting itself, c_lookAhead if it never does
+///
+static int getSafeMoves(Node *_head,
+                        Move _dir,
+                        int _moveOffset)
+{
+  SDL_Rect newPos = _head->pos;
+
+  for(int m = 1; m <= c_lookAhead; ++m)
+  {
+    moveSprite(_dir, &newPos, _moveOffset);
+
+    int index = 1;
+
+    for(Node *node = _head->next; node != NULL; node = node->next, ++index)
+    {
+      if(((index + m) % c_segmentsToSkip) == 0 &&
+         detectCollision(&newPos, &node->pos, c_segmentPadding))
+      {
+        return m - 1;
+      }
+    }
+  }
+
+  return c_lookAhead;
+}
+
+///
+/// \brief MarkWalls Marks every cell whose head position, give or take half a cell, is close
+/// enough to a wall to hit it. These never change, so each build starts from a copy
+///
+static void markWalls(AIPlanner *io_planner,
+                      const ArenaMap *_map)
+{
+  const int c_cellTotal = io_planner->cols * io_planner->rows;
+
+  memset(io_planner->walls, 0, c_cellTotal);
+
+  if(_map == NULL)
+  {
+    return;
+  }
+
+  const int c_half = io_planner->segmentSize / 2;
+  const int c_reach = ARENA_HEAD_CLEARANCE + io_planner->cellSize / 2;
+
+  for(int y = 0; y < io_planner->rows; ++y)
+  {
+    for(int x = 0; x < io_planner->cols; ++x)
+    {
+      // The reverse of getCellIndex, to the centre of the head at the middle of the cell
+      const int c_centreX = x * io_planner->cellSize - io_planner->segmentSize + io_planner->cellSize / 2 + c_half;
+      const int c_centreY = y * io_planner->cellSize - io_planner->segmentSize + io_planner->cellSize / 2 + c_half;
+
+      io_planner->walls[y * io_planner->cols + x] = getArenaCell(_map, c_centreX, c_centreY)->distance < c_reach;
+    }
+  }
+}
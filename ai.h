@@ -0,0 +1,85 @@
+#ifndef AI_H
+#define AI_H
+
+#include <stdbool.h>
+
+#include "utils.h"
+#include "actor.h"
+#include "arena.h"
+#include "pickup.h"
+
+#define AI_UNREACHABLE (0xFFFF)
+
+// A distance field over the wrap-around arena, shared by every computer controlled snake.
+// Each cell holds how many moves it takes a head at that position to reach the nearest pickup
+typedef struct AIPlanner{
+  int segmentSize;
+  int cellSize;     // Pixels per cell, matches the snake's move offset
+  int wrapWidth;    // Distance wrapSprite moves a segment by, the field repeats with the same period
+  int wrapHeight;
+  int cols;         // Enough to cover the wrap period, the last column or row may be part filled
+  int rows;
+
+  Uint8  *walls;       // Head positions that would hit a wall, worked out once from the arena's field
+  Uint8  *blocked;     // Walls plus body occupancy the last complete field was built around
+  Uint8  *nextBlocked; // The same, captured when the current build started
+  Uint8  *isGoal;      // Cells that collect a pickup in the current build
+  Uint8  *isQueued;    // Cells waiting in the lowering queue
+  Uint16 *distance;    // Last complete field, used to steer
+  Uint16 *building;    // Copy of the last field being repaired, may take several ticks to finish
+
+  // Each build only repairs what changed since the last one. Cells that lost whatever their
+  // distance came from are cleared first, then distances spread back in from their neighbours
+  int *raised;         // Cells cleared so far, their dependents are cleared in turn
+  int  raisedHead;
+  int  raisedTail;
+  int *queue;          // Circular queue of cells whose distance went down
+  int  queueHead;
+  int  queueCount;
+  bool isBuilding;
+
+  Uint64 budget;    // Performance counter ticks allowed per update, 0 means no limit
+} AIPlanner;
+
+///
+/// \brief CreateAIPlanner Allocates the distance fields for the arena
+/// \param o_planner
+/// \param _segmentSize Size of the snake segments, one cell covers one move of the head
+/// \param _budgetUs How many microseconds updateAIPlanner may spend per call, 0 for no limit
+/// \param _map Walls to steer around, can be NULL
+/// \return False if the fields could not be allocated
+///
+bool createAIPlanner(AIPlanner *o_planner, int _segmentSize, unsigned int _budgetUs, const ArenaMap *_map);
+void freeAIPlanner(AIPlanner *io_planner);
+
+///
+/// \brief ResetAIPlanner Forgets the current field and any build in progress, for a new match
+///
+void resetAIPlanner(AIPlanner *io_planner);
+
+///
+/// \brief UpdateAIPlanner Continues building the distance field until it completes or the
+/// time budget runs out. The last complete field keeps steering the snakes in the meantime,
+/// and a new build (with fresh body positions) starts as soon as the previous one finishes.
+/// Builds repair the previous field, so they cost about as much as what moved since
+/// \param io_planner
+/// \param _snakes Heads of every snake in the arena, all of them are treated as obstacles
+/// \param _snakeCount
+/// \param _pickups Every gem and knight still on the board is a target
+///
+void updateAIPlanner(AIPlanner *io_planner,
+                     Node *const *_snakes,
+                     int _snakeCount,
+                     const Pickups *_pickups);
+
+///
+/// \brief GetAIMovement Picks the move that leads downhill in the distance field,
+/// never reversing and never steering the head into the snake's own body.
+/// Boxed in, it takes whichever move stays clear the longest, or carries straight on
+/// \param _planner
+/// \param _head The snake to steer
+/// \return A move direction, as if it came from getInputMovement
+///
+Move getAIMovement(const AIPlanner *_planner, Node *_head);
+
+#endif // AI_H
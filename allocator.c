@@ -0,0 +1,188 @@
+#include "allocator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Goes in front of every block so it can be uncounted when freed. Padded to 16 bytes so
+// the block after it keeps the alignment malloc gave, which the SSE code relies on
+typedef union MemoryHeader{
+  struct{
+    size_t size;
+    MemoryTag tag;
+  } block;
+  char alignment[16];
+} MemoryHeader;
+
+// Bytes in use and the most there have been, per tag and for everything together.
+// Ints, so a tag can count up to 2GB
+typedef struct MemoryCount{
+  SDL_atomic_t current;
+  SDL_atomic_t peak;
+} MemoryCount;
+
+static MemoryCount s_counts[MEMORY_TAG_TOTAL];
+static MemoryCount s_total;
+static SDL_atomic_t s_allocations;
+
+static const char *s_tagNames[MEMORY_TAG_TOTAL] = {
+  "segments", "snapshots", "rollback", "assets", "textures", "audio",
+  "render", "ai", "replays", "capture", "trace", "tournament", "arena", "pickups"
+};
+
+static void addBytes(MemoryCount *io_count, long _bytes);
+static void raisePeak(MemoryCount *io_count, int _current);
+
+void *allocateMemory(MemoryTag _tag,
+                     size_t _size)
+{
+  MemoryHeader *header = malloc(sizeof(MemoryHeader) + _size);
+
+  if(header == NULL)
+  {
+    return NULL;
+  }
+
+  header->block.size = _size;
+  header->block.tag = _tag;
+
+  SDL_AtomicAdd(&s_allocations, 1);
+  trackMemory(_tag, (long)_size);
+
+  return header + 1;
+}
+
+void *allocateZeroed(MemoryTag _tag,
+                     size_t _count,
+                     size_t _size)
+{
+  if(_size != 0 && _count > ((size_t)-1 - sizeof(MemoryHeader)) / _size)
+  {
+    return NULL;
+  }
+
+  void *block = allocateMemory(_tag, _count * _size);
+
+  if(block != NULL)
+  {
+    memset(block, 0, _count * _size);
+  }
+
+  return block;
+}
+
+void *reallocateMemory(MemoryTag _tag,
+                       void *_block,
+                       size_t _size)
+{
+  if(_block == NULL)
+  {
+    return allocateMemory(_tag, _size);
+  }
+
+  MemoryHeader *header = (MemoryHeader *)_block - 1;
+  const size_t c_oldSize = header->block.size;
+
+  header = realloc(header, sizeof(MemoryHeader) + _size);
+
+  if(header == NULL)
+  {
+    return NULL;
+  }
+
+  header->block.size = _size;
+
+  SDL_AtomicAdd(&s_allocations, 1);
+  trackMemory(header->block.tag, (long)_size - (long)c_oldSize);
+
+  return header + 1;
+}
+
+void freeMemory(void *_block)
+{
+  if(_block == NULL)
+  {
+    return;
+  }
+
+  MemoryHeader *header = (MemoryHeader *)_block - 1;
+
+  trackMemory(header->block.tag, -(long)header->block.size);
+  free(header);
+}
+
+void trackMemory(MemoryTag _tag,
+                 long _bytes)
+{
+  addBytes(&s_counts[_tag], _bytes);
+  addBytes(&s_total, _bytes);
+}
+
+void getMemoryUsage(MemoryTag _tag,
+                    size_t *o_current,
+                    size_t *o_peak)
+{
+  const int c_current = SDL_AtomicGet(&s_counts[_tag].current);
+
+  *o_current = c_current > 0 ? (size_t)c_current : 0;
+  *o_peak = (size_t)SDL_AtomicGet(&s_counts[_tag].peak);
+}
+
+const char *getMemoryTagName(MemoryTag _tag)
+{
+  return s_tagNames[_tag];
+}
+
+int getAllocationCount(void)
+{
+  return SDL_AtomicGet(&s_allocations);
+}
+
+void printMemoryReport(bool _isExiting)
+{
+  printf("Memory %s, KB in use and peak:\n", _isExiting ? "at exit" : "so far");
+
+  for(int t = 0; t < MEMORY_TAG_TOTAL; ++t)
+  {
+    size_t current;
+    size_t peak;
+    getMemoryUsage((MemoryTag)t, &current, &peak);
+
+    if(peak == 0)
+    {
+      continue;
+    }
+
+    printf("  %-11s %9.1f %9.1f%s\n", s_tagNames[t], current / 1024.0, peak / 1024.0,
+           (_isExiting && current > 0) ? "  leaked" : "");
+  }
+
+  printf("  %-11s %9.1f %9.1f\n  %d allocations\n", "total",
+         SDL_AtomicGet(&s_total.current) / 1024.0, SDL_AtomicGet(&s_total.peak) / 1024.0,
+         getAllocationCount());
+}
+
+static void addBytes(MemoryCount *io_count,
+                     long _bytes)
+{
+  const int c_current = SDL_AtomicAdd(&io_count->current, (int)_bytes) + (int)_bytes;
+
+  if(_bytes > 0)
+  {
+    raisePeak(io_count, c_current);
+  }
+}
+
+///
+/// \brief RaisePeak Another thread may be raising it too, so only a higher value is ever stored
+///
+static void raisePeak(MemoryCount *io_count,
+                      int _current)
+{
+  int peak = SDL_AtomicGet(&io_count->peak);
+
+  while(_current > peak && !SDL_AtomicCAS(&io_count->peak, peak, _current))
+  {
+    peak = SDL_AtomicGet(&io_count->peak);
+  }
+}
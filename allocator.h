@@ -0,0 +1,83 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "utils.h"
+
+// What each block of memory is for. The counts are kept per tag, so a tag that keeps
+// growing over a long session, or is still holding memory at exit, points at its owner
+typedef enum{
+  MEMORY_SEGMENTS,    // Snake segments, including the spares kept for reuse
+  MEMORY_SNAPSHOTS,   // Copies of the snakes handed to the render thread
+  MEMORY_ROLLBACK,    // Saved games netplay rewinds to
+  MEMORY_ASSETS,      // Decoded images and the CPU copies of sheets, the HUD and the framebuffer
+  MEMORY_TEXTURES,    // An estimate, four bytes a texel for every texture, see trackMemory
+  MEMORY_AUDIO,       // The sound bank and the sounds decoded into it
+  MEMORY_RENDER,      // Per frame scratch, culled views, particles and geometry
+  MEMORY_AI,          // Planner grids and observations
+  MEMORY_REPLAYS,     // Recordings being written or read back
+  MEMORY_CAPTURE,     // Frames queued for the capture writer
+  MEMORY_TRACE,       // Trace event rings
+  MEMORY_TOURNAMENT,  // Workers and hash logs for headless matches
+  MEMORY_ARENA,       // Walls and the field built from them
+  MEMORY_PICKUPS,     // Grids for spawning pickups
+  MEMORY_TAG_TOTAL
+} MemoryTag;
+
+///
+/// \brief AllocateMemory Same as malloc, but counted against _tag. Blocks must be freed with freeMemory.
+/// Safe from any thread
+/// \param _tag
+/// \param _size
+/// \return NULL if there was no memory
+///
+void *allocateMemory(MemoryTag _tag, size_t _size);
+
+///
+/// \brief AllocateZeroed Same as calloc, but counted against _tag
+///
+void *allocateZeroed(MemoryTag _tag, size_t _count, size_t _size);
+
+///
+/// \brief ReallocateMemory Same as realloc, the block stays counted against the tag it was allocated with
+/// \param _tag Used when _block is NULL
+/// \param _block
+/// \param _size
+/// \return NULL if the block could not grow, it is then left as it was
+///
+void *reallocateMemory(MemoryTag _tag, void *_block, size_t _size);
+
+///
+/// \brief FreeMemory Same as free, for blocks from the functions above. NULL is ignored
+///
+void freeMemory(void *_block);
+
+///
+/// \brief TrackMemory Counts memory that something else allocated, such as a surface or texture
+/// \param _tag
+/// \param _bytes Negative once it has been freed
+///
+void trackMemory(MemoryTag _tag, long _bytes);
+
+///
+/// \brief GetMemoryUsage Bytes in use for a tag now, and the most there has been at once
+///
+void getMemoryUsage(MemoryTag _tag, size_t *o_current, size_t *o_peak);
+
+const char *getMemoryTagName(MemoryTag _tag);
+
+///
+/// \brief GetAllocationCount Blocks allocated or grown since the program started
+///
+int getAllocationCount(void);
+
+///
+/// \brief PrintMemoryReport Prints every tag's current and peak use
+/// \param _isExiting True once everything should have been freed, anything still
+/// counted is then reported as leaked
+///
+void printMemoryReport(bool _isExiting);
+
+#endif // ALLOCATOR_H
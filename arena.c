@@ -0,0 +1,392 @@
+#include "arena.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "allocator.h"
+
+#define ARENA_LINE_MAX  (256)
+#define ARENA_UNSEEN    (1e20f)   // Squared distance before the transform has found anything
+
+static void transformField(float *io_field, int _cols, int _rows, float *io_line, float *io_out,
+                           int *io_parabolas, float *io_bounds);
+static void transformLine(const float *_f, int _count, float *o_d, int *io_parabolas, float *io_bounds);
+static float getCrossing(const float *_f, int _v, int _q);
+static int toDistance(float _squared, bool _isInside);
+static void findGradients(ArenaMap *io_map);
+static int clampCell(int _cell, int _total);
+
+bool loadArenaMap(ArenaMap *o_map,
+                  const char *_path,
+                  int _w,
+                  int _h)
+{
+  FILE *file = fopen(_path, "r");
+
+  if(file == NULL)
+  {
+    printf("Unable to open map %s\n", _path);
+    return false;
+  }
+
+  SDL_Rect *walls = NULL;
+  int wallCount = 0;
+  int capacity = 0;
+  bool isRead = true;
+
+  char line[ARENA_LINE_MAX];
+  int lineNumber = 0;
+
+  while(isRead && fgets(line, sizeof(line), file) != NULL)
+  {
+    ++lineNumber;
+
+    char keyword[16];
+    SDL_Rect wall;
+    char extra;
+
+    // Blank lines and comments
+    if(sscanf(line, " %15s", keyword) != 1 || keyword[0] == '#')
+    {
+      continue;
+    }
+
+    if(strcmp(keyword, "wall") != 0 ||
+       sscanf(line, " wall %d %d %d %d %c", &wall.x, &wall.y, &wall.w, &wall.h, &extra) != 4 ||
+       wall.w <= 0 || wall.h <= 0)
+    {
+      printf("%s:%d: expected \"wall x y w h\" with a positive size\n", _path, lineNumber);
+      isRead = false;
+      break;
+    }
+
+    if(wallCount == capacity)
+    {
+      capacity = capacity ? capacity * 2 : 64;
+      SDL_Rect *grown = reallocateMemory(MEMORY_ARENA, walls, capacity * sizeof(SDL_Rect));
+
+      if(grown == NULL)
+      {
+        isRead = false;
+        break;
+      }
+
+      walls = grown;
+    }
+
+    walls[wallCount++] = wall;
+  }
+
+  fclose(file);
+
+  const bool c_isBuilt = isRead && buildArenaMap(o_map, walls, wallCount, _w, _h);
+  freeMemory(walls);
+
+  return c_isBuilt;
+}
+
+bool buildArenaMap(ArenaMap *o_map,
+                   const SDL_Rect *_walls,
+                   int _wallCount,
+                   int _w,
+                   int _h)
+{
+  o_map->w = _w;
+  o_map->h = _h;
+  o_map->cols = (_w + ARENA_CELL_SIZE - 1) / ARENA_CELL_SIZE;
+  o_map->rows = (_h + ARENA_CELL_SIZE - 1) / ARENA_CELL_SIZE;
+  o_map->wordsPerRow = (o_map->cols + 31) / 32;
+  o_map->wallCount = _wallCount;
+
+  const int c_cellTotal = o_map->cols * o_map->rows;
+  const int c_lineMax = (o_map->cols > o_map->rows) ? o_map->cols : o_map->rows;
+
+  o_map->blocked = allocateZeroed(MEMORY_ARENA, o_map->wordsPerRow * o_map->rows, sizeof(Uint32));
+  o_map->cells = allocateMemory(MEMORY_ARENA, c_cellTotal * sizeof(ArenaCell));
+  o_map->walls = (_wallCount > 0) ? allocateMemory(MEMORY_ARENA, _wallCount * sizeof(SDL_Rect)) : NULL;
+
+  // Scratch for the transforms, squared distances in cells
+  float *outside = allocateMemory(MEMORY_ARENA, c_cellTotal * sizeof(float));
+  float *inside = allocateMemory(MEMORY_ARENA, c_cellTotal * sizeof(float));
+  float *line = allocateMemory(MEMORY_ARENA, c_lineMax * 2 * sizeof(float));
+  float *bounds = allocateMemory(MEMORY_ARENA, (c_lineMax + 1) * sizeof(float));
+  int *parabolas = allocateMemory(MEMORY_ARENA, c_lineMax * sizeof(int));
+
+  // A map without walls has no wall list to copy
+  const bool c_isAllocated = o_map->blocked && o_map->cells && (o_map->walls || _wallCount == 0) &&
+                             outside && inside && line && bounds && parabolas;
+
+  if(c_isAllocated)
+  {
+    if(_wallCount > 0)
+    {
+      memcpy(o_map->walls, _walls, _wallCount * sizeof(SDL_Rect));
+    }
+
+    // Every cell a wall overlaps at all is blocked
+    for(int i = 0; i < _wallCount; ++i)
+    {
+      const int c_x0 = clampCell(floorDiv(_walls[i].x, ARENA_CELL_SIZE), o_map->cols);
+      const int c_y0 = clampCell(floorDiv(_walls[i].y, ARENA_CELL_SIZE), o_map->rows);
+      const int c_x1 = clampCell(floorDiv(_walls[i].x + _walls[i].w - 1, ARENA_CELL_SIZE), o_map->cols);
+      const int c_y1 = clampCell(floorDiv(_walls[i].y + _walls[i].h - 1, ARENA_CELL_SIZE), o_map->rows);
+
+      // Entirely off the arena
+      if(_walls[i].x >= _w || _walls[i].y >= _h || _walls[i].x + _walls[i].w <= 0 || _walls[i].y + _walls[i].h <= 0)
+      {
+        continue;
+      }
+
+      for(int y = c_y0; y <= c_y1; ++y)
+      {
+        Uint32 *row = o_map->blocked + y * o_map->wordsPerRow;
+
+        for(int x = c_x0; x <= c_x1; ++x)
+        {
+          row[x >> 5] |= 1u << (x & 31);
+        }
+      }
+    }
+
+    // How far every open cell is from a blocked one and every blocked cell from an open one
+    for(int y = 0; y < o_map->rows; ++y)
+    {
+      for(int x = 0; x < o_map->cols; ++x)
+      {
+        const bool c_isBlocked = (o_map->blocked[y * o_map->wordsPerRow + (x >> 5)] >> (x & 31)) & 1;
+
+        outside[y * o_map->cols + x] = c_isBlocked ? 0.0f : ARENA_UNSEEN;
+        inside[y * o_map->cols + x] = c_isBlocked ? ARENA_UNSEEN : 0.0f;
+      }
+    }
+
+    transformField(outside, o_map->cols, o_map->rows, line, line + c_lineMax, parabolas, bounds);
+    transformField(inside, o_map->cols, o_map->rows, line, line + c_lineMax, parabolas, bounds);
+
+    for(int i = 0; i < c_cellTotal; ++i)
+    {
+      const bool c_isInside = (outside[i] == 0.0f);
+      o_map->cells[i].distance = (Sint16)toDistance(c_isInside ? inside[i] : outside[i], c_isInside);
+    }
+
+    findGradients(o_map);
+  }
+
+  freeMemory(outside);
+  freeMemory(inside);
+  freeMemory(line);
+  freeMemory(bounds);
+  freeMemory(parabolas);
+
+  if(!c_isAllocated)
+  {
+    freeArenaMap(o_map);
+  }
+
+  return c_isAllocated;
+}
+
+void freeArenaMap(ArenaMap *io_map)
+{
+  freeMemory(io_map->blocked);
+  freeMemory(io_map->cells);
+  freeMemory(io_map->walls);
+
+  io_map->blocked = NULL;
+  io_map->cells = NULL;
+  io_map->walls = NULL;
+  io_map->wallCount = 0;
+}
+
+bool isArenaBlocked(const ArenaMap *_map,
+                    int _x,
+                    int _y)
+{
+  const int c_x = clampCell(floorDiv(_x, ARENA_CELL_SIZE), _map->cols);
+  const int c_y = clampCell(floorDiv(_y, ARENA_CELL_SIZE), _map->rows);
+
+  return (_map->blocked[c_y * _map->wordsPerRow + (c_x >> 5)] >> (c_x & 31)) & 1;
+}
+
+const ArenaCell *getArenaCell(const ArenaMap *_map,
+                              int _x,
+                              int _y)
+{
+  const int c_x = clampCell(floorDiv(_x, ARENA_CELL_SIZE), _map->cols);
+  const int c_y = clampCell(floorDiv(_y, ARENA_CELL_SIZE), _map->rows);
+
+  return &_map->cells[c_y * _map->cols + c_x];
+}
+
+///
+/// \brief TransformField Squared Euclidean distance transform, in place. Down every column
+/// then along every row, which is exact because squared distance separates by axis
+/// \param io_field 0 where distances are measured from, ARENA_UNSEEN everywhere else
+/// \param _cols
+/// \param _rows
+/// \param io_line Scratch, as long as the longer side
+/// \param io_out Scratch, as long as the longer side
+/// \param io_parabolas Scratch, as long as the longer side
+/// \param io_bounds Scratch, one longer than the longer side
+///
+static void transformField(float *io_field,
+                           int _cols,
+                           int _rows,
+                           float *io_line,
+                           float *io_out,
+                           int *io_parabolas,
+                           float *io_bounds)
+{
+  for(int x = 0; x < _cols; ++x)
+  {
+    for(int y = 0; y < _rows; ++y)
+    {
+      io_line[y] = io_field[y * _cols + x];
+    }
+
+    transformLine(io_line, _rows, io_out, io_parabolas, io_bounds);
+
+    for(int y = 0; y < _rows; ++y)
+    {
+      io_field[y * _cols + x] = io_out[y];
+    }
+  }
+
+  for(int y = 0; y < _rows; ++y)
+  {
+    transformLine(io_field + y * _cols, _cols, io_out, io_parabolas, io_bounds);
+    memcpy(io_field + y * _cols, io_out, _cols * sizeof(float));
+  }
+}
+
+///
+/// \brief TransformLine One dimensional pass of Felzenszwalb and Huttenlocher's transform.
+/// Each cell is a parabola rooted at its value, the lower envelope of all of them is found
+/// in one sweep and then read back, so the whole line is linear time
+/// \param _f Values along the line
+/// \param _count
+/// \param o_d The lowest of every parabola at each cell
+/// \param io_parabolas Cells whose parabolas make up the envelope, left to right
+/// \param io_bounds Where each envelope parabola takes over from the one before
+///
+static void transformLine(const float *_f,
+                          int _count,
+                          float *o_d,
+                          int *io_parabolas,
+                          float *io_bounds)
+{
+  int k = 0;
+  io_parabolas[0] = 0;
+  io_bounds[0] = -ARENA_UNSEEN;
+  io_bounds[1] = ARENA_UNSEEN;
+
+  for(int q = 1; q < _count; ++q)
+  {
+    float s = getCrossing(_f, io_parabolas[k], q);
+
+    // Parabolas that the new one is lower than everywhere they took over are dropped.
+    // The first bound is further left than any crossing, so the first parabola never is
+    while(s <= io_bounds[k])
+    {
+      s = getCrossing(_f, io_parabolas[--k], q);
+    }
+
+    ++k;
+    io_parabolas[k] = q;
+    io_bounds[k] = s;
+    io_bounds[k + 1] = ARENA_UNSEEN;
+  }
+
+  k = 0;
+
+  for(int q = 0; q < _count; ++q)
+  {
+    while(io_bounds[k + 1] < (float)q)
+    {
+      ++k;
+    }
+
+    const int c_v = io_parabolas[k];
+    o_d[q] = (float)((q - c_v) * (q - c_v)) + _f[c_v];
+  }
+}
+
+///
+/// \brief GetCrossing Where the parabolas rooted at cells _v and _q meet, _v is left of _q
+///
+static float getCrossing(const float *_f,
+                         int _v,
+                         int _q)
+{
+  return ((_f[_q] + (float)(_q * _q)) - (_f[_v] + (float)(_v * _v))) / (float)(2 * _q - 2 * _v);
+}
+
+///
+/// \brief ToDistance Converts a squared distance between cell centres into pixels to the
+/// nearest edge of the other kind of cell, which is half a cell closer
+///
+static int toDistance(float _squared,
+                      bool _isInside)
+{
+  if(_squared >= ARENA_UNSEEN)
+  {
+    return _isInside ? -ARENA_FAR : ARENA_FAR;
+  }
+
+  float pixels = sqrtf(_squared) * ARENA_CELL_SIZE - ARENA_CELL_SIZE * 0.5f;
+
+  if(pixels > ARENA_FAR)
+  {
+    pixels = ARENA_FAR;
+  }
+
+  return _isInside ? -(int)(pixels + 0.5f) : (int)(pixels + 0.5f);
+}
+
+///
+/// \brief FindGradients Central differences of the distance, the edges reuse their own cell
+///
+static void findGradients(ArenaMap *io_map)
+{
+  const int c_cols = io_map->cols;
+  const int c_rows = io_map->rows;
+  ArenaCell *cells = io_map->cells;
+
+  for(int y = 0; y < c_rows; ++y)
+  {
+    const int c_up = clampCell(y - 1, c_rows) * c_cols;
+    const int c_down = clampCell(y + 1, c_rows) * c_cols;
+
+    for(int x = 0; x < c_cols; ++x)
+    {
+      const int c_left = clampCell(x - 1, c_cols);
+      const int c_right = clampCell(x + 1, c_cols);
+
+      const float c_dx = (float)cells[y * c_cols + c_right].distance - cells[y * c_cols + c_left].distance;
+      const float c_dy = (float)cells[c_down + x].distance - cells[c_up + x].distance;
+      const float c_length = sqrtf(c_dx * c_dx + c_dy * c_dy);
+
+      ArenaCell *cell = &cells[y * c_cols + x];
+
+      if(c_length > 0.0f)
+      {
+        cell->gradientX = (Sint8)(c_dx * 127.0f / c_length);
+        cell->gradientY = (Sint8)(c_dy * 127.0f / c_length);
+      }
+      else
+      {
+        cell->gradientX = 0;
+        cell->gradientY = 0;
+      }
+    }
+  }
+}
+
+static int clampCell(int _cell,
+                     int _total)
+{
+  if(_cell < 0)       { return 0; }
+  if(_cell >= _total) { return _total - 1; }
+  return _cell;
+}
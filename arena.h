@@ -0,0 +1,69 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+
+#include "utils.h"
+
+#define ARENA_CELL_SIZE       (8)     // Pixels, walls are only this precise
+#define ARENA_HEAD_CLEARANCE  (16)    // A snake head whose centre is closer than this to a wall has hit it
+#define ARENA_FAR             (32767) // Distance everywhere when there are no walls
+
+// What the field holds for each cell, kept together so a query is one load
+typedef struct ArenaCell{
+  Sint16 distance;    // Pixels from the cell's centre to the nearest wall edge, negative inside a wall
+  Sint8 gradientX;    // Direction the distance grows fastest, away from the nearest wall,
+  Sint8 gradientY;    // 127 long. 0, 0 where it's flat
+} ArenaCell;
+
+// Walls loaded from a map file and compiled into a grid of cells covering the arena, so
+// asking whether somewhere is blocked, how far it is from a wall or which way is away from
+// the walls is a single lookup however many walls there are. Nothing changes once it is
+// built, so every game and thread can share one
+typedef struct ArenaMap{
+  int w;
+  int h;
+  int cols;
+  int rows;
+
+  Uint32 *blocked;    // One bit a cell, each row starts on a new word
+  int wordsPerRow;
+  ArenaCell *cells;
+
+  // As loaded, for drawing. NULL when there are none
+  SDL_Rect *walls;
+  int wallCount;
+} ArenaMap;
+
+///
+/// \brief LoadArenaMap Reads a map file and builds its field. Each line is either blank, a
+/// # comment, or "wall x y w h" in pixels. Walls past the edge of the arena are cut off
+/// \param o_map
+/// \param _path
+/// \param _w Size of the arena the field covers
+/// \param _h
+/// \return False if the file could not be read or has a line that isn't understood,
+/// which has been printed
+///
+bool loadArenaMap(ArenaMap *o_map, const char *_path, int _w, int _h);
+
+///
+/// \brief BuildArenaMap Compiles walls into the field, for maps that weren't read from a file.
+/// The walls are copied
+/// \return False if the field could not be allocated
+///
+bool buildArenaMap(ArenaMap *o_map, const SDL_Rect *_walls, int _wallCount, int _w, int _h);
+void freeArenaMap(ArenaMap *io_map);
+
+///
+/// \brief IsArenaBlocked True if the cell under a point overlaps any wall. Points off the
+/// arena use the nearest cell on it
+///
+bool isArenaBlocked(const ArenaMap *_map, int _x, int _y);
+
+///
+/// \brief GetArenaCell The distance and gradient at a point, off the arena uses the nearest cell
+///
+const ArenaCell *getArenaCell(const ArenaMap *_map, int _x, int _y);
+
+#endif // ARENA_H
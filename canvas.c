@@ -0,0 +1,746 @@
+#include "canvas.h"
+
+#include <string.h>
+
+#include "allocator.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CANVAS_HAS_X86 (1)
+#endif
+
+#define ALPHA_MASK (0xFF000000u)
+
+// Blends _count tinted source pixels over the destination row, both ARGB8888
+typedef void (*BlendRow)(Uint32 *io_dst, const Uint32 *_src, int _count, SDL_Color _tint);
+
+static BlendRow s_blendRow = NULL;
+
+static void blendRowScalar(Uint32 *io_dst, const Uint32 *_src, int _count, SDL_Color _tint);
+static void drawStretched(Canvas *io_canvas, const Sheet *_sheet, const SDL_Rect *_src, const SDL_Rect *_dst);
+static Uint32 blendPixel(Uint32 _dst, Uint32 _src, SDL_Color _tint);
+static void fillRectsSoftware(Canvas *io_canvas, const SDL_Rect *_rects, const SDL_Color *_colours, int _count);
+static SDL_Rect toCanvas(const Canvas *_canvas, const SDL_Rect *_rect);
+static void clipToViewport(const Canvas *_canvas, int *io_x0, int *io_y0, int *io_x1, int *io_y1);
+static long getTextureBytes(int _w, int _h);
+#ifdef CANVAS_HAS_GEOMETRY
+static bool reserveRects(Canvas *io_canvas, int _count);
+#endif
+
+#ifdef CANVAS_HAS_X86
+static void blendRowSSE2(Uint32 *io_dst, const Uint32 *_src, int _count, SDL_Color _tint);
+static void blendRowAVX2(Uint32 *io_dst, const Uint32 *_src, int _count, SDL_Color _tint);
+#endif
+
+bool createCanvas(Canvas *o_canvas,
+                  SDL_Renderer *_renderer,
+                  bool _isSoftware,
+                  int _w,
+                  int _h)
+{
+  o_canvas->renderer = _renderer;
+  o_canvas->target = NULL;
+  o_canvas->pixels = NULL;
+  o_canvas->w = _w;
+  o_canvas->h = _h;
+
+  o_canvas->viewport.x = 0;
+  o_canvas->viewport.y = 0;
+  o_canvas->viewport.w = _w;
+  o_canvas->viewport.h = _h;
+  o_canvas->origin.x = 0;
+  o_canvas->origin.y = 0;
+  o_canvas->drawCalls = 0;
+
+#ifdef CANVAS_HAS_GEOMETRY
+  o_canvas->vertices = NULL;
+  o_canvas->indices = NULL;
+  o_canvas->rectCapacity = 0;
+#endif
+
+  if(!_isSoftware)
+  {
+    return true;
+  }
+
+  // Pick the widest blend kernel this CPU supports
+  s_blendRow = blendRowScalar;
+#ifdef CANVAS_HAS_X86
+  s_blendRow = SDL_HasAVX2() ? blendRowAVX2 : blendRowSSE2;
+#endif
+
+  o_canvas->pixels = allocateMemory(MEMORY_ASSETS, _w * _h * sizeof(Uint32));
+  o_canvas->target = SDL_CreateTexture(_renderer, SDL_PIXELFORMAT_ARGB8888,
+                                       SDL_TEXTUREACCESS_STREAMING, _w, _h);
+
+  if(o_canvas->target)
+  {
+    trackMemory(MEMORY_TEXTURES, getTextureBytes(_w, _h));
+  }
+
+  if(!o_canvas->pixels || !o_canvas->target)
+  {
+    freeCanvas(o_canvas);
+    return false;
+  }
+
+  return true;
+}
+
+void freeCanvas(Canvas *io_canvas)
+{
+  if(io_canvas->target)
+  {
+    SDL_DestroyTexture(io_canvas->target);
+    trackMemory(MEMORY_TEXTURES, -getTextureBytes(io_canvas->w, io_canvas->h));
+  }
+
+  freeMemory(io_canvas->pixels);
+
+  io_canvas->target = NULL;
+  io_canvas->pixels = NULL;
+
+#ifdef CANVAS_HAS_GEOMETRY
+  freeMemory(io_canvas->vertices);
+  freeMemory(io_canvas->indices);
+
+  io_canvas->vertices = NULL;
+  io_canvas->indices = NULL;
+  io_canvas->rectCapacity = 0;
+#endif
+}
+
+bool createSheet(Sheet *o_sheet,
+                 const Canvas *_canvas,
+                 SDL_Surface *_surface)
+{
+  o_sheet->texture = SDL_CreateTextureFromSurface(_canvas->renderer, _surface);
+  o_sheet->pixels = NULL;
+  o_sheet->w = _surface->w;
+  o_sheet->h = _surface->h;
+  o_sheet->isOpaque = false;
+  o_sheet->tint.r = 255;
+  o_sheet->tint.g = 255;
+  o_sheet->tint.b = 255;
+  o_sheet->tint.a = 255;
+
+  if(!o_sheet->texture)
+  {
+    return false;
+  }
+
+  trackMemory(MEMORY_TEXTURES, getTextureBytes(o_sheet->w, o_sheet->h));
+
+  if(_canvas->pixels == NULL)
+  {
+    return true;
+  }
+
+  // The blitter reads straight from a tightly packed ARGB8888 copy
+  SDL_Surface *converted = SDL_ConvertSurfaceFormat(_surface, SDL_PIXELFORMAT_ARGB8888, 0);
+  o_sheet->pixels = allocateMemory(MEMORY_ASSETS, o_sheet->w * o_sheet->h * sizeof(Uint32));
+
+  if(!converted || !o_sheet->pixels)
+  {
+    if(converted)
+    {
+      SDL_FreeSurface(converted);
+    }
+
+    freeSheet(o_sheet);
+    return false;
+  }
+
+  SDL_LockSurface(converted);
+
+  Uint32 opaque = ALPHA_MASK;
+  for(int y = 0; y < o_sheet->h; ++y)
+  {
+    const Uint32 *row = (const Uint32 *)((const Uint8 *)converted->pixels + y * converted->pitch);
+    memcpy(o_sheet->pixels + y * o_sheet->w, row, o_sheet->w * sizeof(Uint32));
+
+    for(int x = 0; x < o_sheet->w; ++x)
+    {
+      opaque &= row[x];
+    }
+  }
+
+  SDL_UnlockSurface(converted);
+  SDL_FreeSurface(converted);
+
+  o_sheet->isOpaque = (opaque == ALPHA_MASK);
+
+  return true;
+}
+
+bool createStreamingSheet(Sheet *o_sheet,
+                          const Canvas *_canvas,
+                          int _w,
+                          int _h)
+{
+  o_sheet->pixels = NULL;
+  o_sheet->w = _w;
+  o_sheet->h = _h;
+  o_sheet->isOpaque = false;
+  o_sheet->tint.r = 255;
+  o_sheet->tint.g = 255;
+  o_sheet->tint.b = 255;
+  o_sheet->tint.a = 255;
+
+  // The software blitter only ever reads the pixel copy
+  if(_canvas->pixels != NULL)
+  {
+    o_sheet->texture = NULL;
+    o_sheet->pixels = allocateZeroed(MEMORY_ASSETS, _w * _h, sizeof(Uint32));
+    return o_sheet->pixels != NULL;
+  }
+
+  o_sheet->texture = SDL_CreateTexture(_canvas->renderer, SDL_PIXELFORMAT_ARGB8888,
+                                       SDL_TEXTUREACCESS_STREAMING, _w, _h);
+
+  if(!o_sheet->texture)
+  {
+    return false;
+  }
+
+  trackMemory(MEMORY_TEXTURES, getTextureBytes(_w, _h));
+  SDL_SetTextureBlendMode(o_sheet->texture, SDL_BLENDMODE_BLEND);
+
+  return true;
+}
+
+void updateSheet(Sheet *io_sheet,
+                 const Uint32 *_pixels)
+{
+  if(io_sheet->pixels != NULL)
+  {
+    memcpy(io_sheet->pixels, _pixels, io_sheet->w * io_sheet->h * sizeof(Uint32));
+  }
+  else
+  {
+    SDL_UpdateTexture(io_sheet->texture, NULL, _pixels, io_sheet->w * sizeof(Uint32));
+  }
+}
+
+void freeSheet(Sheet *io_sheet)
+{
+  if(io_sheet->texture)
+  {
+    SDL_DestroyTexture(io_sheet->texture);
+    trackMemory(MEMORY_TEXTURES, -getTextureBytes(io_sheet->w, io_sheet->h));
+  }
+
+  freeMemory(io_sheet->pixels);
+
+  io_sheet->texture = NULL;
+  io_sheet->pixels = NULL;
+}
+
+void setSheetTint(Sheet *io_sheet,
+                  Uint8 _r,
+                  Uint8 _g,
+                  Uint8 _b)
+{
+  io_sheet->tint.r = _r;
+  io_sheet->tint.g = _g;
+  io_sheet->tint.b = _b;
+
+  SDL_SetTextureColorMod(io_sheet->texture, _r, _g, _b);
+}
+
+void clearCanvas(Canvas *io_canvas)
+{
+  if(io_canvas->pixels == NULL)
+  {
+    SDL_RenderClear(io_canvas->renderer);
+    return;
+  }
+
+  // Same as the black clear colour set on the renderer
+  const int c_total = io_canvas->w * io_canvas->h;
+  for(int i = 0; i < c_total; ++i)
+  {
+    io_canvas->pixels[i] = ALPHA_MASK;
+  }
+}
+
+void setCanvasViewport(Canvas *io_canvas,
+                       const SDL_Rect *_viewport,
+                       int _originX,
+                       int _originY)
+{
+  const SDL_Rect c_whole = {0, 0, io_canvas->w, io_canvas->h};
+
+  io_canvas->viewport = (_viewport != NULL) ? *_viewport : c_whole;
+  io_canvas->origin.x = _originX;
+  io_canvas->origin.y = _originY;
+
+  if(io_canvas->pixels == NULL)
+  {
+    SDL_RenderSetViewport(io_canvas->renderer, _viewport);
+  }
+}
+
+void drawSprite(Canvas *io_canvas,
+                const Sheet *_sheet,
+                const SDL_Rect *_src,
+                const SDL_Rect *_dst)
+{
+  const SDL_Rect c_dst = toCanvas(io_canvas, _dst);
+
+  ++io_canvas->drawCalls;
+
+  if(io_canvas->pixels == NULL || _sheet->pixels == NULL)
+  {
+    SDL_RenderCopy(io_canvas->renderer, _sheet->texture, _src, &c_dst);
+    return;
+  }
+
+  if(_src->w != c_dst.w || _src->h != c_dst.h)
+  {
+    drawStretched(io_canvas, _sheet, _src, &c_dst);
+    return;
+  }
+
+  // Clip against the viewport, moving the source by the same amount
+  int x0 = c_dst.x;
+  int y0 = c_dst.y;
+  int x1 = c_dst.x + c_dst.w;
+  int y1 = c_dst.y + c_dst.h;
+
+  clipToViewport(io_canvas, &x0, &y0, &x1, &y1);
+
+  if(x0 >= x1 || y0 >= y1)
+  {
+    return;
+  }
+
+  const int c_srcX = _src->x + (x0 - c_dst.x);
+  const int c_srcY = _src->y + (y0 - c_dst.y);
+  const int c_count = x1 - x0;
+
+  const bool c_isUntinted = (_sheet->tint.r & _sheet->tint.g & _sheet->tint.b) == 255;
+
+  for(int y = y0; y < y1; ++y)
+  {
+    Uint32 *dstRow = io_canvas->pixels + y * io_canvas->w + x0;
+    const Uint32 *srcRow = _sheet->pixels + (c_srcY + (y - y0)) * _sheet->w + c_srcX;
+
+    if(_sheet->isOpaque && c_isUntinted)
+    {
+      memcpy(dstRow, srcRow, c_count * sizeof(Uint32));
+    }
+    else
+    {
+      s_blendRow(dstRow, srcRow, c_count, _sheet->tint);
+    }
+  }
+}
+
+void fillRects(Canvas *io_canvas,
+               const SDL_Rect *_rects,
+               const SDL_Color *_colours,
+               int _count)
+{
+  if(_count <= 0)
+  {
+    return;
+  }
+
+  ++io_canvas->drawCalls;
+
+  if(io_canvas->pixels != NULL)
+  {
+    fillRectsSoftware(io_canvas, _rects, _colours, _count);
+    return;
+  }
+
+  SDL_SetRenderDrawBlendMode(io_canvas->renderer, SDL_BLENDMODE_BLEND);
+
+#ifdef CANVAS_HAS_GEOMETRY
+  if(reserveRects(io_canvas, _count))
+  {
+    SDL_Vertex *vertex = io_canvas->vertices;
+
+    const float c_originX = (float)io_canvas->origin.x;
+    const float c_originY = (float)io_canvas->origin.y;
+
+    for(int i = 0; i < _count; ++i, vertex += 4)
+    {
+      const float c_x0 = _rects[i].x - c_originX;
+      const float c_y0 = _rects[i].y - c_originY;
+      const float c_x1 = c_x0 + _rects[i].w;
+      const float c_y1 = c_y0 + _rects[i].h;
+
+      vertex[0].position.x = c_x0;  vertex[0].position.y = c_y0;
+      vertex[1].position.x = c_x1;  vertex[1].position.y = c_y0;
+      vertex[2].position.x = c_x1;  vertex[2].position.y = c_y1;
+      vertex[3].position.x = c_x0;  vertex[3].position.y = c_y1;
+
+      for(int v = 0; v < 4; ++v)
+      {
+        vertex[v].color = _colours[i];
+      }
+    }
+
+    SDL_RenderGeometry(io_canvas->renderer, NULL, io_canvas->vertices, _count * 4,
+                       io_canvas->indices, _count * 6);
+    return;
+  }
+#endif
+
+  // Older SDL, or the scratch couldn't grow, one call per rect
+  for(int i = 0; i < _count; ++i)
+  {
+    const SDL_Rect c_rect = toCanvas(io_canvas, &_rects[i]);
+
+    SDL_SetRenderDrawColor(io_canvas->renderer, _colours[i].r, _colours[i].g, _colours[i].b, _colours[i].a);
+    SDL_RenderFillRect(io_canvas->renderer, &c_rect);
+  }
+
+  // Put back the black the renderer clears with
+  SDL_SetRenderDrawColor(io_canvas->renderer, 0, 0, 0, 255);
+}
+
+void presentCanvas(Canvas *io_canvas)
+{
+  if(io_canvas->pixels != NULL)
+  {
+    SDL_UpdateTexture(io_canvas->target, NULL, io_canvas->pixels, io_canvas->w * sizeof(Uint32));
+    SDL_RenderCopy(io_canvas->renderer, io_canvas->target, NULL, NULL);
+  }
+
+  SDL_RenderPresent(io_canvas->renderer);
+  io_canvas->drawCalls = 0;
+}
+
+///
+/// \brief BlendPixel Tints _src then blends it over _dst. Channels and alpha are scaled
+/// to 0-256 so every product fits in 16 bits, which is what the SIMD kernels rely on
+///
+static Uint32 blendPixel(Uint32 _dst,
+                         Uint32 _src,
+                         SDL_Color _tint)
+{
+  const Uint32 c_alpha = _src >> 24;
+  const Uint32 c_a = c_alpha + (c_alpha >> 7);
+
+  const Uint32 c_r = ((((_src >> 16) & 0xFF) * (_tint.r + (_tint.r >> 7))) >> 8);
+  const Uint32 c_g = ((((_src >>  8) & 0xFF) * (_tint.g + (_tint.g >> 7))) >> 8);
+  const Uint32 c_b = ((((_src      ) & 0xFF) * (_tint.b + (_tint.b >> 7))) >> 8);
+
+  const Uint32 c_outR = (c_r * c_a + ((_dst >> 16) & 0xFF) * (256 - c_a)) >> 8;
+  const Uint32 c_outG = (c_g * c_a + ((_dst >>  8) & 0xFF) * (256 - c_a)) >> 8;
+  const Uint32 c_outB = (c_b * c_a + ((_dst      ) & 0xFF) * (256 - c_a)) >> 8;
+
+  return ALPHA_MASK | (c_outR << 16) | (c_outG << 8) | c_outB;
+}
+
+static void blendRowScalar(Uint32 *io_dst,
+                           const Uint32 *_src,
+                           int _count,
+                           SDL_Color _tint)
+{
+  for(int i = 0; i < _count; ++i)
+  {
+    if(_src[i] & ALPHA_MASK)
+    {
+      io_dst[i] = blendPixel(io_dst[i], _src[i], _tint);
+    }
+  }
+}
+
+///
+/// \brief FillRectsSoftware Clips each rect to the viewport and blends its colour over it
+///
+static void fillRectsSoftware(Canvas *io_canvas,
+                              const SDL_Rect *_rects,
+                              const SDL_Color *_colours,
+                              int _count)
+{
+  const SDL_Color c_untinted = {255, 255, 255, 255};
+
+  const int c_offsetX = io_canvas->viewport.x - io_canvas->origin.x;
+  const int c_offsetY = io_canvas->viewport.y - io_canvas->origin.y;
+
+  for(int i = 0; i < _count; ++i)
+  {
+    int x0 = _rects[i].x + c_offsetX;
+    int y0 = _rects[i].y + c_offsetY;
+    int x1 = x0 + _rects[i].w;
+    int y1 = y0 + _rects[i].h;
+
+    clipToViewport(io_canvas, &x0, &y0, &x1, &y1);
+
+    if(x0 >= x1 || y0 >= y1 || _colours[i].a == 0)
+    {
+      continue;
+    }
+
+    const Uint32 c_colour = ((Uint32)_colours[i].a << 24) | ((Uint32)_colours[i].r << 16) |
+                            ((Uint32)_colours[i].g << 8) | _colours[i].b;
+
+    for(int y = y0; y < y1; ++y)
+    {
+      Uint32 *row = io_canvas->pixels + y * io_canvas->w;
+
+      for(int x = x0; x < x1; ++x)
+      {
+        row[x] = blendPixel(row[x], c_colour, c_untinted);
+      }
+    }
+  }
+}
+
+///
+/// \brief ToCanvas Moves a rect so the canvas's origin is at the viewport's top left. SDL
+/// already draws relative to its viewport, the framebuffer needs the viewport's position too
+///
+static SDL_Rect toCanvas(const Canvas *_canvas,
+                         const SDL_Rect *_rect)
+{
+  SDL_Rect rect = *_rect;
+
+  rect.x -= _canvas->origin.x;
+  rect.y -= _canvas->origin.y;
+
+  if(_canvas->pixels != NULL)
+  {
+    rect.x += _canvas->viewport.x;
+    rect.y += _canvas->viewport.y;
+  }
+
+  return rect;
+}
+
+///
+/// \brief ClipToViewport Shrinks the framebuffer area x0,y0 to x1,y1 to fit the viewport
+///
+static void clipToViewport(const Canvas *_canvas,
+                           int *io_x0,
+                           int *io_y0,
+                           int *io_x1,
+                           int *io_y1)
+{
+  const SDL_Rect *c_view = &_canvas->viewport;
+
+  if(*io_x0 < c_view->x)              { *io_x0 = c_view->x; }
+  if(*io_y0 < c_view->y)              { *io_y0 = c_view->y; }
+  if(*io_x1 > c_view->x + c_view->w)  { *io_x1 = c_view->x + c_view->w; }
+  if(*io_y1 > c_view->y + c_view->h)  { *io_y1 = c_view->y + c_view->h; }
+}
+
+#ifdef CANVAS_HAS_GEOMETRY
+///
+/// \brief ReserveRects Grows the fillRects scratch to hold at least _count rects. The
+/// indices never change, so they are only written when it grows
+///
+static bool reserveRects(Canvas *io_canvas,
+                         int _count)
+{
+  if(_count <= io_canvas->rectCapacity)
+  {
+    return true;
+  }
+
+  const int c_capacity = _count * 2;
+  SDL_Vertex *vertices = reallocateMemory(MEMORY_RENDER, io_canvas->vertices, c_capacity * 4 * sizeof(SDL_Vertex));
+
+  if(vertices == NULL)
+  {
+    return false;
+  }
+
+  io_canvas->vertices = vertices;
+
+  int *indices = reallocateMemory(MEMORY_RENDER, io_canvas->indices, c_capacity * 6 * sizeof(int));
+
+  if(indices == NULL)
+  {
+    return false;
+  }
+
+  io_canvas->indices = indices;
+
+  for(int i = 0; i < c_capacity; ++i)
+  {
+    const int c_first = i * 4;
+    int *index = indices + i * 6;
+
+    index[0] = c_first;      index[1] = c_first + 1;  index[2] = c_first + 2;
+    index[3] = c_first;      index[4] = c_first + 2;  index[5] = c_first + 3;
+
+    // Untextured, only the colour is used
+    for(int v = 0; v < 4; ++v)
+    {
+      vertices[c_first + v].tex_coord.x = 0.0f;
+      vertices[c_first + v].tex_coord.y = 0.0f;
+    }
+  }
+
+  io_canvas->rectCapacity = c_capacity;
+
+  return true;
+}
+#endif
+
+///
+/// \brief GetTextureBytes What an ARGB8888 texture most likely takes, the driver decides where
+/// and how it is really stored so this is only an estimate
+///
+static long getTextureBytes(int _w,
+                            int _h)
+{
+  return (long)_w * _h * (long)sizeof(Uint32);
+}
+
+///
+/// \brief DrawStretched Nearest neighbour scaling, only used for the game over text
+///
+static void drawStretched(Canvas *io_canvas,
+                          const Sheet *_sheet,
+                          const SDL_Rect *_src,
+                          const SDL_Rect *_dst)
+{
+  int x0 = 0;
+  int y0 = 0;
+  int x1 = io_canvas->w;
+  int y1 = io_canvas->h;
+
+  clipToViewport(io_canvas, &x0, &y0, &x1, &y1);
+
+  for(int y = 0; y < _dst->h; ++y)
+  {
+    const int c_dstY = _dst->y + y;
+
+    if(c_dstY < y0 || c_dstY >= y1)
+    {
+      continue;
+    }
+
+    const Uint32 *srcRow = _sheet->pixels + (_src->y + y * _src->h / _dst->h) * _sheet->w;
+    Uint32 *dstRow = io_canvas->pixels + c_dstY * io_canvas->w;
+
+    for(int x = 0; x < _dst->w; ++x)
+    {
+      const int c_dstX = _dst->x + x;
+      const Uint32 c_pixel = srcRow[_src->x + x * _src->w / _dst->w];
+
+      if(c_dstX >= x0 && c_dstX < x1 && (c_pixel & ALPHA_MASK))
+      {
+        dstRow[c_dstX] = blendPixel(dstRow[c_dstX], c_pixel, _sheet->tint);
+      }
+    }
+  }
+}
+
+#ifdef CANVAS_HAS_X86
+
+///
+/// \brief BlendRowSSE2 Four pixels at a time, each channel widened to 16 bits.
+/// Groups of fully transparent pixels, most of a snake sprite, are skipped
+///
+static void blendRowSSE2(Uint32 *io_dst,
+                         const Uint32 *_src,
+                         int _count,
+                         SDL_Color _tint)
+{
+  const __m128i c_zero = _mm_setzero_si128();
+  const __m128i c_256 = _mm_set1_epi16(256);
+  const __m128i c_alphaMask = _mm_set1_epi32((int)ALPHA_MASK);
+
+  // Lanes are B, G, R, A for each pixel, alpha is multiplied by 256 so it passes through
+  const __m128i c_tint = _mm_setr_epi16(_tint.b + (_tint.b >> 7), _tint.g + (_tint.g >> 7),
+                                        _tint.r + (_tint.r >> 7), 256,
+                                        _tint.b + (_tint.b >> 7), _tint.g + (_tint.g >> 7),
+                                        _tint.r + (_tint.r >> 7), 256);
+  int i = 0;
+
+  for(; i + 4 <= _count; i += 4)
+  {
+    const __m128i c_src = _mm_loadu_si128((const __m128i *)(_src + i));
+
+    if(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(c_src, c_alphaMask), c_zero)) == 0xFFFF)
+    {
+      continue;
+    }
+
+    const __m128i c_dst = _mm_loadu_si128((const __m128i *)(io_dst + i));
+
+    __m128i srcLo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(c_src, c_zero), c_tint), 8);
+    __m128i srcHi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(c_src, c_zero), c_tint), 8);
+
+    __m128i alphaLo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(srcLo, 0xFF), 0xFF);
+    __m128i alphaHi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(srcHi, 0xFF), 0xFF);
+    alphaLo = _mm_add_epi16(alphaLo, _mm_srli_epi16(alphaLo, 7));
+    alphaHi = _mm_add_epi16(alphaHi, _mm_srli_epi16(alphaHi, 7));
+
+    const __m128i c_outLo = _mm_srli_epi16(
+          _mm_add_epi16(_mm_mullo_epi16(srcLo, alphaLo),
+                        _mm_mullo_epi16(_mm_unpacklo_epi8(c_dst, c_zero), _mm_sub_epi16(c_256, alphaLo))), 8);
+    const __m128i c_outHi = _mm_srli_epi16(
+          _mm_add_epi16(_mm_mullo_epi16(srcHi, alphaHi),
+                        _mm_mullo_epi16(_mm_unpackhi_epi8(c_dst, c_zero), _mm_sub_epi16(c_256, alphaHi))), 8);
+
+    _mm_storeu_si128((__m128i *)(io_dst + i),
+                     _mm_or_si128(_mm_packus_epi16(c_outLo, c_outHi), c_alphaMask));
+  }
+
+  blendRowScalar(io_dst + i, _src + i, _count - i, _tint);
+}
+
+///
+/// \brief BlendRowAVX2 The SSE2 kernel at twice the width, unpack and pack
+/// both work within 128 bit lanes so pixel order is preserved
+///
+__attribute__((target("avx2")))
+static void blendRowAVX2(Uint32 *io_dst,
+                         const Uint32 *_src,
+                         int _count,
+                         SDL_Color _tint)
+{
+  const __m256i c_zero = _mm256_setzero_si256();
+  const __m256i c_256 = _mm256_set1_epi16(256);
+  const __m256i c_alphaMask = _mm256_set1_epi32((int)ALPHA_MASK);
+
+  const short c_b = _tint.b + (_tint.b >> 7);
+  const short c_g = _tint.g + (_tint.g >> 7);
+  const short c_r = _tint.r + (_tint.r >> 7);
+  const __m256i c_tint = _mm256_setr_epi16(c_b, c_g, c_r, 256, c_b, c_g, c_r, 256,
+                                           c_b, c_g, c_r, 256, c_b, c_g, c_r, 256);
+  int i = 0;
+
+  for(; i + 8 <= _count; i += 8)
+  {
+    const __m256i c_src = _mm256_loadu_si256((const __m256i *)(_src + i));
+
+    if(_mm256_testz_si256(c_src, c_alphaMask))
+    {
+      continue;
+    }
+
+    const __m256i c_dst = _mm256_loadu_si256((const __m256i *)(io_dst + i));
+
+    __m256i srcLo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(c_src, c_zero), c_tint), 8);
+    __m256i srcHi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(c_src, c_zero), c_tint), 8);
+
+    __m256i alphaLo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(srcLo, 0xFF), 0xFF);
+    __m256i alphaHi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(srcHi, 0xFF), 0xFF);
+    alphaLo = _mm256_add_epi16(alphaLo, _mm256_srli_epi16(alphaLo, 7));
+    alphaHi = _mm256_add_epi16(alphaHi, _mm256_srli_epi16(alphaHi, 7));
+
+    const __m256i c_outLo = _mm256_srli_epi16(
+          _mm256_add_epi16(_mm256_mullo_epi16(srcLo, alphaLo),
+                           _mm256_mullo_epi16(_mm256_unpacklo_epi8(c_dst, c_zero), _mm256_sub_epi16(c_256, alphaLo))), 8);
+    const __m256i c_outHi = _mm256_srli_epi16(
+          _mm256_add_epi16(_mm256_mullo_epi16(srcHi, alphaHi),
+                           _mm256_mullo_epi16(_mm256_unpackhi_epi8(c_dst, c_zero), _mm256_sub_epi16(c_256, alphaHi))), 8);
+
+    _mm256_storeu_si256((__m256i *)(io_dst + i),
+                        _mm256_or_si256(_mm256_packus_epi16(c_outLo, c_outHi), c_alphaMask));
+  }
+
+  blendRowSSE2(io_dst + i, _src + i, _count - i, _tint);
+}
+
+#endif
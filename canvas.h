@@ -0,0 +1,125 @@
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include <stdbool.h>
+
+#include "utils.h"
+
+// SDL_RenderGeometry can draw any number of coloured quads in a single call
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+#define CANVAS_HAS_GEOMETRY (1)
+#endif
+
+// A spritesheet that can be drawn through the SDL renderer or by the software blitter
+typedef struct Sheet{
+  SDL_Texture *texture;
+  Uint32 *pixels;   // ARGB8888 copy for the software blitter, NULL when it isn't in use
+  int w;
+  int h;
+  bool isOpaque;    // Every pixel has full alpha, so the blitter can copy instead of blend
+  SDL_Color tint;   // Same as SDL_SetTextureColorMod
+} Sheet;
+
+// Everything that gets drawn goes through a canvas. Normally that is just SDL_RenderCopy,
+// with a software canvas sprites are blended into a framebuffer on the CPU and uploaded to
+// a streaming texture once per frame, which avoids the per-call overhead of SDL's own
+// software renderer on machines without a GPU
+typedef struct Canvas{
+  SDL_Renderer *renderer;
+
+  SDL_Texture *target;  // Streaming texture for the framebuffer, NULL when drawing through SDL
+  Uint32 *pixels;
+  int w;
+  int h;
+
+  // Drawing is clipped to the viewport, and positions are moved so that origin lands on its
+  // top left, which lets the same world positions be drawn into several views
+  SDL_Rect viewport;
+  SDL_Point origin;
+
+  int drawCalls;        // Calls to drawSprite and fillRects since the last present
+
+#ifdef CANVAS_HAS_GEOMETRY
+  // Scratch for fillRects, four corners and two triangles a rect, grown as needed
+  SDL_Vertex *vertices;
+  int *indices;
+  int rectCapacity;
+#endif
+} Canvas;
+
+///
+/// \brief CreateCanvas
+/// \param o_canvas
+/// \param _renderer
+/// \param _isSoftware True to blit on the CPU into a _w by _h framebuffer
+/// \return False if the framebuffer or its texture could not be created
+///
+bool createCanvas(Canvas *o_canvas, SDL_Renderer *_renderer, bool _isSoftware, int _w, int _h);
+void freeCanvas(Canvas *io_canvas);
+
+///
+/// \brief CreateSheet Creates the texture for a spritesheet, and keeps
+/// a copy of the pixels if the canvas blits in software
+/// \return False if the texture or the pixel copy could not be created
+///
+bool createSheet(Sheet *o_sheet, const Canvas *_canvas, SDL_Surface *_surface);
+
+///
+/// \brief CreateStreamingSheet Creates a blank _w by _h sheet whose pixels are replaced
+/// with updateSheet, for images made at runtime
+/// \return False if the texture or the pixel copy could not be created
+///
+bool createStreamingSheet(Sheet *o_sheet, const Canvas *_canvas, int _w, int _h);
+
+///
+/// \brief UpdateSheet Replaces every pixel of a streaming sheet
+/// \param io_sheet
+/// \param _pixels ARGB8888, w by h and tightly packed
+///
+void updateSheet(Sheet *io_sheet, const Uint32 *_pixels);
+
+void freeSheet(Sheet *io_sheet);
+void setSheetTint(Sheet *io_sheet, Uint8 _r, Uint8 _g, Uint8 _b);
+
+///
+/// \brief ClearCanvas Clears the whole canvas, whatever the viewport
+///
+void clearCanvas(Canvas *io_canvas);
+
+///
+/// \brief SetCanvasViewport Limits drawing to part of the canvas, through SDL_RenderSetViewport
+/// when drawing through SDL
+/// \param io_canvas
+/// \param _viewport Area of the canvas to draw to, NULL for all of it
+/// \param _originX Position that is drawn at the viewport's top left
+/// \param _originY
+///
+void setCanvasViewport(Canvas *io_canvas, const SDL_Rect *_viewport, int _originX, int _originY);
+
+///
+/// \brief DrawSprite Copies part of a spritesheet onto the canvas,
+/// equivalent to SDL_RenderCopy with alpha blending and the sheet's tint
+/// \param io_canvas
+/// \param _sheet
+/// \param _src Area of the sheet to draw
+/// \param _dst Where to draw it, stretched if the size differs from _src
+///
+void drawSprite(Canvas *io_canvas, const Sheet *_sheet, const SDL_Rect *_src, const SDL_Rect *_dst);
+
+///
+/// \brief FillRects Blends solid rects onto the canvas, each in its own colour and alpha.
+/// Drawing through SDL this is a single SDL_RenderGeometry call however many there are
+/// \param io_canvas
+/// \param _rects
+/// \param _colours One for each rect
+/// \param _count
+///
+void fillRects(Canvas *io_canvas, const SDL_Rect *_rects, const SDL_Color *_colours, int _count);
+
+///
+/// \brief PresentCanvas Uploads the framebuffer if there is one, then presents the renderer
+/// and starts counting draw calls again
+///
+void presentCanvas(Canvas *io_canvas);
+
+#endif // CANVAS_H
@@ -0,0 +1,329 @@
+#include "capture.h"
+
+#include <string.h>
+
+#include "allocator.h"
+#include "trace.h"
+
+static int runWriter(void *_data);
+static void convertToRGBA(Uint8 *o_bytes, const Uint32 *_pixels, int _count);
+static void convertToYUV420(Uint8 *o_bytes, const Uint32 *_pixels, int _w, int _h);
+static void freeCapture(FrameCapture *io_capture);
+
+bool startCapture(FrameCapture *o_capture,
+                  const char *_path,
+                  int _w,
+                  int _h)
+{
+  const char *c_extension = strrchr(_path, '.');
+
+  o_capture->isPipe = (strcmp(_path, "-") == 0);
+  o_capture->format = (c_extension != NULL && strcmp(c_extension, ".y4m") == 0) ? CAPTURE_Y4M
+                                                                                : CAPTURE_RAW_RGBA;
+  o_capture->w = _w;
+  o_capture->h = _h;
+
+  o_capture->output = o_capture->isPipe ? stdout : fopen(_path, "wb");
+  o_capture->converted = allocateMemory(MEMORY_CAPTURE, _w * _h * 4);
+  o_capture->lock = SDL_CreateMutex();
+  o_capture->isQueued = SDL_CreateCond();
+  o_capture->thread = NULL;
+
+  bool isCreated = (o_capture->output && o_capture->converted && o_capture->lock && o_capture->isQueued);
+
+  for(int i = 0; i < CAPTURE_BUFFERS; ++i)
+  {
+    o_capture->buffers[i] = allocateMemory(MEMORY_CAPTURE, _w * _h * sizeof(Uint32));
+    o_capture->freeBuffers[i] = i;
+    isCreated &= (o_capture->buffers[i] != NULL);
+  }
+
+  o_capture->freeCount = CAPTURE_BUFFERS;
+  o_capture->queueHead = 0;
+  o_capture->queueCount = 0;
+  o_capture->quit = false;
+  o_capture->hasFailed = false;
+  o_capture->captured = 0;
+  o_capture->written = 0;
+  o_capture->dropped = 0;
+
+  if(!isCreated)
+  {
+    fprintf(stderr, "Unable to open %s for capture\n", _path);
+    freeCapture(o_capture);
+    return false;
+  }
+
+  if(o_capture->format == CAPTURE_Y4M)
+  {
+    // Frames are written as they are presented, which is the vsync rate
+    fprintf(o_capture->output, "YUV4MPEG2 W%d H%d F60:1 Ip A1:1 C420jpeg\n", _w, _h);
+  }
+
+  o_capture->thread = SDL_CreateThread(runWriter, "capture", o_capture);
+
+  if(!o_capture->thread)
+  {
+    fprintf(stderr, "%s\n", SDL_GetError());
+    freeCapture(o_capture);
+    return false;
+  }
+
+  return true;
+}
+
+void stopCapture(FrameCapture *io_capture)
+{
+  SDL_LockMutex(io_capture->lock);
+  io_capture->quit = true;
+  SDL_CondSignal(io_capture->isQueued);
+  SDL_UnlockMutex(io_capture->lock);
+
+  SDL_WaitThread(io_capture->thread, NULL);
+  io_capture->thread = NULL;
+
+  // stdout may be the video stream itself
+  fprintf(stderr, "Captured %u frames, wrote %u, dropped %u\n",
+          io_capture->captured, io_capture->written, io_capture->dropped);
+
+  freeCapture(io_capture);
+}
+
+void captureFrame(FrameCapture *io_capture,
+                  const Canvas *_canvas)
+{
+  TRACE_BEGIN("captureFrame");
+
+  SDL_LockMutex(io_capture->lock);
+
+  io_capture->captured++;
+
+  if(io_capture->freeCount == 0 || io_capture->hasFailed)
+  {
+    io_capture->dropped++;
+    SDL_UnlockMutex(io_capture->lock);
+    TRACE_END("captureFrame");
+    return;
+  }
+
+  const int c_index = io_capture->freeBuffers[--io_capture->freeCount];
+
+  SDL_UnlockMutex(io_capture->lock);
+
+  // The buffer belongs to this thread until it is queued, so the copy happens outside the lock
+  Uint32 *buffer = io_capture->buffers[c_index];
+  const int c_pitch = io_capture->w * sizeof(Uint32);
+  bool isRead = true;
+
+  if(_canvas->pixels != NULL)
+  {
+    // The software framebuffer is already in memory, there's nothing to read back
+    memcpy(buffer, _canvas->pixels, c_pitch * io_capture->h);
+  }
+  else
+  {
+    isRead = (SDL_RenderReadPixels(_canvas->renderer, NULL, SDL_PIXELFORMAT_ARGB8888, buffer, c_pitch) == 0);
+  }
+
+  SDL_LockMutex(io_capture->lock);
+
+  if(isRead)
+  {
+    io_capture->queue[(io_capture->queueHead + io_capture->queueCount) % CAPTURE_BUFFERS] = c_index;
+    io_capture->queueCount++;
+    SDL_CondSignal(io_capture->isQueued);
+  }
+  else
+  {
+    io_capture->freeBuffers[io_capture->freeCount++] = c_index;
+    io_capture->dropped++;
+  }
+
+  SDL_UnlockMutex(io_capture->lock);
+
+  TRACE_END("captureFrame");
+}
+
+///
+/// \brief RunWriter Thread entry point, converts and writes queued frames in order
+/// until told to quit, then drains whatever is left
+/// \param _data The FrameCapture
+///
+static int runWriter(void *_data)
+{
+  FrameCapture *capture = _data;
+
+  setTraceThreadName("capture");
+
+  const int c_pixelTotal = capture->w * capture->h;
+  const size_t c_frameSize = (capture->format == CAPTURE_Y4M) ? (size_t)(c_pixelTotal + c_pixelTotal/2)
+                                                              : (size_t)c_pixelTotal * 4;
+
+  SDL_LockMutex(capture->lock);
+
+  for(;;)
+  {
+    while(capture->queueCount == 0 && !capture->quit)
+    {
+      SDL_CondWait(capture->isQueued, capture->lock);
+    }
+
+    if(capture->queueCount == 0)
+    {
+      break;
+    }
+
+    const int c_index = capture->queue[capture->queueHead];
+    capture->queueHead = (capture->queueHead + 1) % CAPTURE_BUFFERS;
+    capture->queueCount--;
+
+    SDL_UnlockMutex(capture->lock);
+
+    TRACE_BEGIN("writeFrame");
+
+    bool isWritten = !capture->hasFailed;
+
+    if(isWritten)
+    {
+      if(capture->format == CAPTURE_Y4M)
+      {
+        convertToYUV420(capture->converted, capture->buffers[c_index], capture->w, capture->h);
+        isWritten = (fputs("FRAME\n", capture->output) >= 0);
+      }
+      else
+      {
+        convertToRGBA(capture->converted, capture->buffers[c_index], c_pixelTotal);
+      }
+
+      isWritten = isWritten && (fwrite(capture->converted, 1, c_frameSize, capture->output) == c_frameSize);
+    }
+
+    TRACE_END("writeFrame");
+
+    SDL_LockMutex(capture->lock);
+
+    capture->freeBuffers[capture->freeCount++] = c_index;
+
+    if(isWritten)
+    {
+      capture->written++;
+    }
+    else
+    {
+      // A closed pipe or full disk won't recover, so stop trying
+      if(!capture->hasFailed)
+      {
+        fprintf(stderr, "Frame capture stopped, the output could not be written\n");
+      }
+
+      capture->hasFailed = true;
+      capture->dropped++;
+    }
+  }
+
+  SDL_UnlockMutex(capture->lock);
+
+  fflush(capture->output);
+
+  return 0;
+}
+
+///
+/// \brief ConvertToRGBA Reorders ARGB8888 pixels into R G B A bytes
+///
+static void convertToRGBA(Uint8 *o_bytes,
+                          const Uint32 *_pixels,
+                          int _count)
+{
+  for(int i = 0; i < _count; ++i)
+  {
+    const Uint32 c_pixel = _pixels[i];
+
+    o_bytes[i*4 + 0] = (Uint8)(c_pixel >> 16);
+    o_bytes[i*4 + 1] = (Uint8)(c_pixel >>  8);
+    o_bytes[i*4 + 2] = (Uint8)(c_pixel      );
+    o_bytes[i*4 + 3] = (Uint8)(c_pixel >> 24);
+  }
+}
+
+///
+/// \brief ConvertToYUV420 BT.601 limited range, writes the Y plane then the U and V
+/// planes with each chroma sample averaged over a 2x2 block. _w and _h must be even
+///
+static void convertToYUV420(Uint8 *o_bytes,
+                            const Uint32 *_pixels,
+                            int _w,
+                            int _h)
+{
+  Uint8 *yPlane = o_bytes;
+  Uint8 *uPlane = yPlane + _w*_h;
+  Uint8 *vPlane = uPlane + (_w/2)*(_h/2);
+
+  for(int y = 0; y < _h; y += 2)
+  {
+    for(int x = 0; x < _w; x += 2)
+    {
+      int r = 0;
+      int g = 0;
+      int b = 0;
+
+      for(int i = 0; i < 4; ++i)
+      {
+        const int c_offset = (y + (i >> 1)) * _w + x + (i & 1);
+        const Uint32 c_pixel = _pixels[c_offset];
+
+        const int c_r = (c_pixel >> 16) & 0xFF;
+        const int c_g = (c_pixel >>  8) & 0xFF;
+        const int c_b = (c_pixel      ) & 0xFF;
+
+        yPlane[c_offset] = (Uint8)(((66*c_r + 129*c_g + 25*c_b + 128) >> 8) + 16);
+
+        r += c_r;
+        g += c_g;
+        b += c_b;
+      }
+
+      r = (r + 2) >> 2;
+      g = (g + 2) >> 2;
+      b = (b + 2) >> 2;
+
+      const int c_chroma = (y/2) * (_w/2) + x/2;
+      uPlane[c_chroma] = (Uint8)(((-38*r -  74*g + 112*b + 128) >> 8) + 128);
+      vPlane[c_chroma] = (Uint8)(((112*r -  94*g -  18*b + 128) >> 8) + 128);
+    }
+  }
+}
+
+///
+/// \brief FreeCapture Releases everything startCapture created, the writer must have stopped
+///
+static void freeCapture(FrameCapture *io_capture)
+{
+  if(io_capture->output && !io_capture->isPipe)
+  {
+    fclose(io_capture->output);
+  }
+
+  for(int i = 0; i < CAPTURE_BUFFERS; ++i)
+  {
+    freeMemory(io_capture->buffers[i]);
+    io_capture->buffers[i] = NULL;
+  }
+
+  freeMemory(io_capture->converted);
+
+  if(io_capture->isQueued)
+  {
+    SDL_DestroyCond(io_capture->isQueued);
+  }
+
+  if(io_capture->lock)
+  {
+    SDL_DestroyMutex(io_capture->lock);
+  }
+
+  io_capture->output = NULL;
+  io_capture->converted = NULL;
+  io_capture->isQueued = NULL;
+  io_capture->lock = NULL;
+}
@@ -0,0 +1,71 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "canvas.h"
+
+// Frames that can be waiting for the writer before new ones are dropped
+#define CAPTURE_BUFFERS (8)
+
+typedef enum CaptureFormat{
+  CAPTURE_RAW_RGBA, // Every frame is width*height*4 bytes, R G B A
+  CAPTURE_Y4M       // YUV4MPEG2 4:2:0, which ffmpeg and most players read directly
+} CaptureFormat;
+
+// Records every presented frame. The render thread only reads the pixels back into a
+// free buffer from the pool, a writer thread converts them and does the I/O, so a slow
+// disk or pipe costs dropped frames rather than a stalled game loop
+typedef struct FrameCapture{
+  FILE *output;
+  bool isPipe;          // Writing to stdout, so it isn't closed
+  CaptureFormat format;
+  int w;
+  int h;
+
+  Uint32 *buffers[CAPTURE_BUFFERS];  // ARGB8888 frames, reused for the whole recording
+  Uint8 *converted;                  // Writer thread's output for one frame
+
+  SDL_mutex *lock;      // Guards the queues and counters below
+  SDL_cond *isQueued;
+  int freeBuffers[CAPTURE_BUFFERS];
+  int freeCount;
+  int queue[CAPTURE_BUFFERS];        // Ring of buffers waiting to be written, oldest first
+  int queueHead;
+  int queueCount;
+  bool quit;
+  bool hasFailed;       // A write failed, everything after it is counted as dropped
+
+  unsigned int captured;
+  unsigned int written;
+  unsigned int dropped;
+
+  SDL_Thread *thread;
+} FrameCapture;
+
+///
+/// \brief StartCapture Opens the output and starts the writer thread
+/// \param o_capture
+/// \param _path File to write, "-" for stdout. A .y4m extension writes Y4M, anything else raw RGBA
+/// \param _w
+/// \param _h
+/// \return False if the output, the buffers or the thread could not be created
+///
+bool startCapture(FrameCapture *o_capture, const char *_path, int _w, int _h);
+
+///
+/// \brief StopCapture Writes whatever is still queued, stops the writer and reports the totals
+///
+void stopCapture(FrameCapture *io_capture);
+
+///
+/// \brief CaptureFrame Queues the canvas's current frame for writing, must be called
+/// before presentCanvas as the back buffer is undefined once it has been presented.
+/// Never waits on the writer, if every buffer is in use the frame is dropped
+/// \param io_capture
+/// \param _canvas
+///
+void captureFrame(FrameCapture *io_capture, const Canvas *_canvas);
+
+#endif // CAPTURE_H
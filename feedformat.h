@@ -0,0 +1,60 @@
+#ifndef FEEDFORMAT_H
+#define FEEDFORMAT_H
+
+// Layout of the live state feed in POSIX shared memory. Only fixed size types are used
+// and nothing here needs SDL, so external tools can include this header on its own.
+//
+// The shared memory holds a FeedHeader followed by FEED_SLOTS FeedSlots. Every tick the
+// game writes the next slot in turn and then bumps published, so the newest tick is in
+// slot (published - 1) % FEED_SLOTS.
+//
+// Each slot is guarded by a seqlock: its sequence is odd while it is being written. To read
+// one, load sequence (acquire), copy the slot if it's even, then load sequence again after
+// an acquire fence. If the two loads differ the copy may be torn and has to be retried.
+// The game never waits for readers, see feedreader.c for a complete reader
+
+#include <stdint.h>
+
+#define FEED_MAGIC         (0x44454546u)  // "FEED", written last so readers know the feed is ready
+#define FEED_VERSION       (1)
+#define FEED_SLOTS         (8)
+#define FEED_PLAYERS       (2)
+#define FEED_MAX_SEGMENTS  (256)          // Longer snakes are cut short, segmentCount is still the full length
+#define FEED_MAX_PICKUPS   (32)
+
+typedef struct FeedPoint{
+  int16_t x;
+  int16_t y;
+} FeedPoint;
+
+typedef struct FeedPickup{
+  int16_t x;
+  int16_t y;
+  uint8_t isVisible;
+  uint8_t isKnight;
+  uint8_t type;       // Gem colour, or the knight's direction
+  uint8_t padding;
+} FeedPickup;
+
+typedef struct FeedSlot{
+  uint32_t sequence;
+  uint32_t tick;
+  uint32_t state;                             // 0 while running, see GameState
+  int32_t scores[FEED_PLAYERS];
+  uint16_t segmentCount[FEED_PLAYERS];
+  uint16_t pickupCount;                       // Pickups still on the board, filled in from the start of pickups, at most FEED_MAX_PICKUPS
+  uint16_t padding;
+  FeedPickup pickups[FEED_MAX_PICKUPS];
+  FeedPoint segments[FEED_PLAYERS][FEED_MAX_SEGMENTS]; // Top left of each segment, head first
+} FeedSlot;
+
+typedef struct FeedHeader{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slotCount;
+  uint32_t slotSize;
+  uint64_t published;                         // Ticks written so far
+  uint64_t padding[5];                        // Keeps the slots on their own cache lines
+} FeedHeader;
+
+#endif // FEEDFORMAT_H
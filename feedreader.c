@@ -0,0 +1,125 @@
+// Reference reader for the live state feed, prints the tick rate and the latest scores
+// once a second. It only needs feedformat.h, not SDL or the rest of the game:
+//
+//   cc -std=c99 -O2 feedreader.c -o feedreader -lrt
+//   ./SpriteSheet --feed /snakes &
+//   ./feedreader /snakes
+
+// shm_open, mmap and nanosleep are POSIX rather than C99
+#define _POSIX_C_SOURCE 200112L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "feedformat.h"
+
+///
+/// \brief ReadLatestSlot Copies the newest tick out of the feed, retrying while the game is writing it
+/// \param _header The mapped feed
+/// \param o_slot
+/// \return Ticks published so far, 0 if there is nothing to read yet
+///
+static uint64_t readLatestSlot(const FeedHeader *_header, FeedSlot *o_slot)
+{
+  const FeedSlot *c_slots = (const FeedSlot *)(_header + 1);
+
+  for(;;)
+  {
+    const uint64_t c_published = __atomic_load_n(&_header->published, __ATOMIC_ACQUIRE);
+
+    if(c_published == 0)
+    {
+      return 0;
+    }
+
+    const FeedSlot *c_slot = &c_slots[(c_published - 1) % FEED_SLOTS];
+    const uint32_t c_before = __atomic_load_n(&c_slot->sequence, __ATOMIC_ACQUIRE);
+
+    if(c_before & 1)
+    {
+      continue;
+    }
+
+    memcpy(o_slot, c_slot, sizeof(FeedSlot));
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    const uint32_t c_after = __atomic_load_n(&c_slot->sequence, __ATOMIC_RELAXED);
+
+    // The game may have lapped the ring during the copy, then try again with the new newest slot
+    if(c_before == c_after)
+    {
+      return c_published;
+    }
+  }
+}
+
+int main(int _argc, char *_argv[])
+{
+  const char *c_name = _argc > 1 ? _argv[1] : "/snakes";
+
+  const int c_file = shm_open(c_name, O_RDONLY, 0);
+
+  if(c_file < 0)
+  {
+    printf("Unable to open shared memory %s: %s\n", c_name, strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  struct stat info;
+  const void *memory = MAP_FAILED;
+
+  if(fstat(c_file, &info) == 0 && (size_t)info.st_size >= sizeof(FeedHeader))
+  {
+    memory = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, c_file, 0);
+  }
+
+  close(c_file);
+
+  if(memory == MAP_FAILED)
+  {
+    printf("Unable to map shared memory %s\n", c_name);
+    return EXIT_FAILURE;
+  }
+
+  const FeedHeader *c_header = memory;
+
+  if(__atomic_load_n(&c_header->magic, __ATOMIC_ACQUIRE) != FEED_MAGIC ||
+     c_header->version != FEED_VERSION ||
+     c_header->slotSize != sizeof(FeedSlot) ||
+     (size_t)info.st_size < sizeof(FeedHeader) + c_header->slotCount * sizeof(FeedSlot))
+  {
+    printf("%s is not a version %d state feed\n", c_name, FEED_VERSION);
+    return EXIT_FAILURE;
+  }
+
+  const struct timespec c_second = {1, 0};
+  uint64_t lastPublished = 0;
+  FeedSlot slot;
+
+  // Runs until interrupted, the game unlinking the feed leaves the last tick readable
+  for(;;)
+  {
+    const uint64_t c_published = readLatestSlot(c_header, &slot);
+
+    if(c_published > 0)
+    {
+      printf("tick %u  %llu ticks/s  scores %d - %d  lengths %u - %u%s\n",
+             slot.tick,
+             (unsigned long long)(lastPublished > 0 ? c_published - lastPublished : 0),
+             slot.scores[0], slot.scores[1],
+             slot.segmentCount[0], slot.segmentCount[1],
+             slot.state != 0 ? "  (over)" : "");
+      fflush(stdout);
+    }
+
+    lastPublished = c_published;
+    nanosleep(&c_second, NULL);
+  }
+}
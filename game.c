@@ -0,0 +1,1146 @@
+#include "game.h"
+
+#include "allocator.h"
+#include "statehash.h"
+#include "trace.h"
+
+#define PLAYER1_SCALE     (1)
+#define PLAYER1_SPAWNX    (WIDTH/4)
+#define PLAYER1_SPAWNY    (HEIGHT/4)
+
+#define PLAYER2_SCALE     (1)
+#define PLAYER2_SPAWNX    (WIDTH/4)
+#define PLAYER2_SPAWNY    (HEIGHT/2)
+
+#define PICKUP_CLIP       (6)   // How far into a pickup a head has to reach to collect it
+
+// The straight line a head moves along this tick, checked where it is before each move
+typedef struct HeadPath{
+  SDL_Rect from;        // Where the head is for the first check
+  int stepX;            // Each move, 0 for a head that isn't moving
+  int stepY;
+  int steps;            // Moves between the first check and the last
+} HeadPath;
+
+// A pickup a head's path was swept against, and the checks it might reach it on
+typedef struct PickupSweep{
+  int id;
+  int first;
+  int last;
+} PickupSweep;
+
+// What sweeping one head's path at the start of a tick found, all the checks before each
+// move have to look at
+typedef struct HeadSweep{
+  HeadPath path;
+  int selfCheck;        // First check it collides with its body on, past the last if none
+  int wallCheck;        // The same for walls
+  SegmentSweep tailEnd[GAME_TICK_MOVES_MAX];
+  int tailEndCount;
+  PickupSweep pickups[PICKUP_TOTAL + GAME_TICK_MOVES_MAX];  // Every pickup, and a gem spawned after each move
+  int pickupCount;
+} HeadSweep;
+
+// Every head's sweep, and where each pickup has got to in its arrays as others are collected
+typedef struct TickSweep{
+  HeadSweep heads[PLAYER_TOTAL];
+  int gemSlots[PICKUP_TOTAL];       // By id, -1 when it isn't a gem on the board
+  int knightSlots[PICKUP_TOTAL];
+  Uint8 gemReached[PICKUP_TOTAL];   // By slot, a bit for each head that reached it this check
+  Uint8 knightReached[PICKUP_TOTAL];
+} TickSweep;
+
+static void growPlayer(Player *io_player, Uint64 *io_hash, PickupSpawner *io_spawner);
+static void movePlayer(Player *io_player, Uint64 *io_hash, PickupSpawner *io_spawner);
+static void getHeadPath(const Player *_player, int _moves, HeadPath *o_path);
+static SDL_Rect getHeadAt(const HeadPath *_path, int _check);
+static void sweepHeads(Game *io_game, TickSweep *o_sweep);
+static void sweepGem(const Game *_game, TickSweep *io_sweep, int _gem, int _fromCheck);
+static void sweepKnight(const Game *_game, TickSweep *io_sweep, int _knight);
+static void addPickupSweep(TickSweep *io_sweep, int _id, const SDL_Rect *_box, int _fromCheck);
+static bool checkHeads(Game *io_game, TickSweep *io_sweep, int _check);
+static void collectPickups(Game *io_game, TickSweep *io_sweep, int _check);
+static bool isPickupReached(const SDL_Rect *_head, int _x, int _y);
+static void growReached(Game *io_game, int _reached);
+static void runTimers(Game *io_game);
+static void updateKnights(Game *io_game, const Uint8 _isStepDue[], const Uint8 _isTurnDue[]);
+static int hitsWall(const ArenaMap *_map, const HeadPath *_path);
+static void spawnGem(Game *io_game);
+static void coverSnakes(Game *io_game);
+static void coverKnights(Game *io_game, const Uint8 _isCovered[], bool _isCovering);
+
+void initialiseGame(Game *o_game,
+                    unsigned int _seed,
+                    const ArenaMap *_map,
+                    PickupSpawner *io_spawner,
+                    int _startLength,
+                    int _movesPerTick)
+{
+  o_game->map = _map;
+  o_game->spawner = io_spawner;
+  o_game->startLength = _startLength;
+  o_game->movesPerTick = _movesPerTick;
+
+  for(int i = 0; i < PLAYER_TOTAL; ++i)
+  {
+    o_game->players[i].head = NULL;
+    o_game->players[i].tail = NULL;
+    o_game->players[i].spare = NULL;
+  }
+
+  resetGame(o_game, _seed);
+}
+
+void resetGame(Game *io_game,
+               unsigned int _seed)
+{
+  // Keep every segment of the last match for the new snakes
+  for(int i = 0; i < PLAYER_TOTAL; ++i)
+  {
+    recycleSnake(io_game->players[i].tail, &io_game->players[i].spare);
+  }
+
+  // Initialising snake spawns and sizes
+  Node player1HeadData;
+    setState(&player1HeadData, HEAD);
+    player1HeadData.next = NULL;
+    player1HeadData.prev = NULL;
+
+    player1HeadData.pos.x = PLAYER1_SPAWNX;
+    player1HeadData.pos.y = PLAYER1_SPAWNY;
+    player1HeadData.pos.w = SNAKE_RADIUS*PLAYER1_SCALE;
+    player1HeadData.pos.h = SNAKE_RADIUS*PLAYER1_SCALE;
+
+    player1HeadData.anim.xOffset = 0;
+    player1HeadData.anim.yOffset = 0;
+    player1HeadData.anim.currentFrame = 0;
+    player1HeadData.idleDirection = RIGHT;
+
+  Node player1BodyData = player1HeadData;
+    setState(&player1BodyData, BODY);
+
+  Node player2HeadData = player1HeadData;
+    player2HeadData.pos.x = PLAYER2_SPAWNX;
+    player2HeadData.pos.y = PLAYER2_SPAWNY;
+    player2HeadData.pos.w = SNAKE_RADIUS*PLAYER2_SCALE;
+    player2HeadData.pos.h = SNAKE_RADIUS*PLAYER2_SCALE;
+
+  Node player2BodyData = player1BodyData;
+    setState(&player2BodyData, BODY);
+
+  // Initialise snakes (implemented using a linked list)
+  Player *player1 = &io_game->players[0];
+  player1->head = createSnake(&player1HeadData, io_game->startLength, &player1BodyData, &player1->spare);
+  player1->tail = getLastSegment(player1->head);
+  player1->bodyData = player1BodyData;
+
+  Player *player2 = &io_game->players[1];
+  player2->head = createSnake(&player2HeadData, io_game->startLength, &player2BodyData, &player2->spare);
+  player2->tail = getLastSegment(player2->head);
+  player2->bodyData = player2BodyData;
+
+  for(int i = 0; i < PLAYER_TOTAL; ++i)
+  {
+    io_game->players[i].direction = NOTMOVING;
+    io_game->players[i].pickupCount = 0;
+    io_game->players[i].hasCollided = false;
+  }
+
+  io_game->seed = _seed;
+
+  // The first gems are kept clear of the snakes as well as each other. From here on the
+  // cover is kept up to date as the snakes and knights move
+  if(io_game->spawner != NULL)
+  {
+    clearPickupSpawner(io_game->spawner);
+    coverSnakes(io_game);
+  }
+
+  initialisePickups(&io_game->pickups, &io_game->seed, io_game->map, io_game->spawner);
+
+  io_game->ticks = 0;
+  io_game->time = 0;
+
+  // Every knight keeps its own timers, so they can each run to their own schedule. A build
+  // with a larger PICKUP_TOTAL has to raise TIMER_CAPACITY to match, see pickup.h
+  typedef char hasRoomForTimers[(2 + PICKUP_TOTAL*2 <= TIMER_CAPACITY) ? 1 : -1];
+  (void)sizeof(hasRoomForTimers);
+
+  initialiseTimerWheel(&io_game->timers);
+
+  const unsigned int c_playerFrames = GAME_TICKS_AFTER(PLAYER_FRAME_DELAY);
+  const unsigned int c_step = GAME_TICKS_AFTER(PICKUP_FRAME_DELAY);
+  const unsigned int c_turn = GAME_TICKS_AFTER(KNIGHT_DIR_UPDATE);
+
+  scheduleTimer(&io_game->timers, c_playerFrames, c_playerFrames, TIMER_PLAYER_FRAMES, 0);
+
+  for(int i = 0; i < io_game->pickups.knights.count; ++i)
+  {
+    const int c_id = io_game->pickups.knights.id[i];
+
+    io_game->knightStepTimers[c_id] = scheduleTimer(&io_game->timers, c_step, c_step, TIMER_KNIGHT_STEP, c_id);
+    io_game->knightTurnTimers[c_id] = scheduleTimer(&io_game->timers, c_turn, c_turn, TIMER_KNIGHT_TURN, c_id);
+  }
+
+  if(io_game->spawner != NULL)
+  {
+    const unsigned int c_spawn = GAME_TICKS_AFTER(PICKUP_SPAWN_DELAY);
+    scheduleTimer(&io_game->timers, c_spawn, c_spawn, TIMER_PICKUP_SPAWN, 0);
+  }
+
+  io_game->state = GAME_RUNNING;
+
+  // From here on the sums are kept up to date as things change
+  for(int i = 0; i < PLAYER_TOTAL; ++i)
+  {
+    io_game->segmentHash[i] = computeSegmentHash(io_game->players[i].tail);
+  }
+
+  io_game->pickupHash = computePickupHash(&io_game->pickups);
+}
+
+void freeGame(Game *io_game)
+{
+  for(int i = 0; i < PLAYER_TOTAL; ++i)
+  {
+    // Frees from the tail so segments that were only linked backwards aren't leaked
+    recycleSnake(io_game->players[i].tail, &io_game->players[i].spare);
+    freeList(&io_game->players[i].spare);
+
+    io_game->players[i].head = NULL;
+    io_game->players[i].tail = NULL;
+  }
+}
+
+bool updateGame(Game *io_game,
+                const Move _moves[PLAYER_TOTAL])
+{
+  if(io_game->state != GAME_RUNNING)
+  {
+    return false;
+  }
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    io_game->players[p].direction = _moves[p];
+  }
+
+  // Each head goes in a straight line for the whole tick, so its path is swept once against
+  // everything it could reach, and the check before each move only looks at what was found
+  TRACE_BEGIN("sweepHeads");
+
+  TickSweep sweep;
+  sweepHeads(io_game, &sweep);
+
+  TRACE_END("sweepHeads");
+
+  // Each move is checked, made and followed by whatever timers it brings due, just as if it
+  // had a tick of its own, so a match plays out the same however many moves a tick makes
+  for(int m = 0; m < io_game->movesPerTick; ++m)
+  {
+    if(!checkHeads(io_game, &sweep, m))
+    {
+      return false;
+    }
+
+    if(m == 0)
+    {
+      io_game->ticks++;
+    }
+
+    // Update player movement direction and the snake position
+    TRACE_BEGIN("updateSnakePos");
+
+    for(int p = 0; p < PLAYER_TOTAL; ++p)
+    {
+      Player *player = &io_game->players[p];
+      HeadSweep *head = &sweep.heads[p];
+
+      // The tail is about to become the neck, so a segment left to check for it is gone
+      for(int i = 0; i < head->tailEndCount; ++i)
+      {
+        if(head->tailEnd[i].segment == player->tail)
+        {
+          head->tailEnd[i].segment = NULL;
+        }
+      }
+
+      movePlayer(player, &io_game->segmentHash[p], io_game->spawner);
+    }
+
+    TRACE_END("updateSnakePos");
+
+    const int c_gemCount = io_game->pickups.gems.count;
+
+    io_game->time += GAME_TICK_DELAY;
+    runTimers(io_game);
+
+    // Gems spawned since the sweep are swept from the next check on
+    for(int i = c_gemCount; i < io_game->pickups.gems.count; ++i)
+    {
+      sweepGem(io_game, &sweep, i, m + 1);
+    }
+  }
+
+  return true;
+}
+
+///
+/// \brief CheckHeads Checks each head where it is before a move for collisions and pickups,
+/// looking only at what the sweep found it might reach then. Collects what it reaches and
+/// ends the match if it collided or nothing is left
+/// \param io_game
+/// \param io_sweep
+/// \param _check Moves into the tick
+/// \return False once the match is over
+///
+static bool checkHeads(Game *io_game,
+                       TickSweep *io_sweep,
+                       int _check)
+{
+  TRACE_BEGIN("collidesWithSelf");
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    Player *player = &io_game->players[p];
+    const HeadSweep *c_head = &io_sweep->heads[p];
+
+    player->hasCollided = (c_head->selfCheck <= _check);
+
+    for(int i = 0; i < c_head->tailEndCount && !player->hasCollided; ++i)
+    {
+      player->hasCollided = collidesWithSegment(player->head, &c_head->tailEnd[i], _check);
+    }
+  }
+
+  TRACE_END("collidesWithSelf");
+
+  TRACE_BEGIN("hitsWall");
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    if(io_sweep->heads[p].wallCheck <= _check)
+    {
+      io_game->players[p].hasCollided = true;
+    }
+  }
+
+  TRACE_END("hitsWall");
+
+  // Check if the snakes collect any Pickups
+  TRACE_BEGIN("pickupCollisions");
+  collectPickups(io_game, io_sweep, _check);
+  TRACE_END("pickupCollisions");
+
+  int pickupTotal = 0;
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    pickupTotal += io_game->players[p].pickupCount;
+  }
+
+  // The match ends if all the Pickups have been collected
+  // or a player collides with their body
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    if(io_game->players[p].hasCollided)
+    {
+      io_game->state = GAME_OVER_COLLISION;
+      return false;
+    }
+  }
+
+  if(io_game->spawner == NULL && pickupTotal >= PICKUP_TOTAL)
+  {
+    io_game->state = GAME_OVER_PICKUPS;
+    return false;
+  }
+
+  return true;
+}
+
+///
+/// \brief RunTimers Moves the timers on by one move and does whatever is due
+/// \param io_game
+///
+static void runTimers(Game *io_game)
+{
+  // Sort out what is due this move by kind, which is the order they happen in
+  advanceTimerWheel(&io_game->timers);
+
+  bool isPlayerFrame = false;
+  bool isPickupSpawn = false;
+  Uint8 isStepDue[PICKUP_TOTAL] = {0};  // By knight id
+  Uint8 isTurnDue[PICKUP_TOTAL] = {0};
+
+  int kind;
+  int data;
+
+  while(popExpiredTimer(&io_game->timers, &kind, &data))
+  {
+    switch(kind)
+    {
+      case TIMER_PLAYER_FRAMES: isPlayerFrame = true; break;
+      case TIMER_KNIGHT_STEP:   isStepDue[data] = 1;  break;
+      case TIMER_KNIGHT_TURN:   isTurnDue[data] = 1;  break;
+      case TIMER_PICKUP_SPAWN:  isPickupSpawn = true; break;
+      default: break;
+    }
+  }
+
+  if(isPlayerFrame)
+  {
+    for(int p = 0; p < PLAYER_TOTAL; ++p)
+    {
+      updateSegmentFrames(io_game->players[p].head);
+    }
+  }
+  else
+  {
+    // Just incase the frame didn't update in time
+    // Reset it to 0 if the player isn't moving
+    for(int p = 0; p < PLAYER_TOTAL; ++p)
+    {
+      if( !getState(io_game->players[p].head, MOVING) )
+      {
+        io_game->players[p].head->anim.currentFrame = 0;
+      }
+    }
+  }
+
+  TRACE_BEGIN("updateKnights");
+  updateKnights(io_game, isStepDue, isTurnDue);
+  TRACE_END("updateKnights");
+
+  if(isPickupSpawn)
+  {
+    spawnGem(io_game);
+  }
+}
+
+void initialiseGameSave(GameSave *o_save)
+{
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    o_save->segments[p] = NULL;
+    o_save->segmentCount[p] = 0;
+    o_save->linkedCount[p] = 0;
+    o_save->segmentCapacity[p] = 0;
+  }
+}
+
+void freeGameSave(GameSave *io_save)
+{
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    freeMemory(io_save->segments[p]);
+  }
+
+  initialiseGameSave(io_save);
+}
+
+bool saveGame(GameSave *io_save,
+              const Game *_game)
+{
+  io_save->game = *_game;
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    const Player *player = &_game->players[p];
+
+    int count = 0;
+    for(const Node *node = player->tail; node != NULL; node = node->prev)
+    {
+      count++;
+    }
+
+    int linked = 0;
+    for(const Node *node = player->head; node != NULL; node = node->next)
+    {
+      linked++;
+    }
+
+    if(count > io_save->segmentCapacity[p])
+    {
+      const int c_capacity = count * 2;
+      Node *segments = reallocateMemory(MEMORY_ROLLBACK, io_save->segments[p], c_capacity * sizeof(Node));
+
+      if(segments == NULL)
+      {
+        return false;
+      }
+
+      io_save->segments[p] = segments;
+      io_save->segmentCapacity[p] = c_capacity;
+    }
+
+    // Filled from the back so the head ends up first
+    int index = count;
+    for(const Node *node = player->tail; node != NULL; node = node->prev)
+    {
+      io_save->segments[p][--index] = *node;
+    }
+
+    io_save->segmentCount[p] = count;
+    io_save->linkedCount[p] = linked;
+  }
+
+  return true;
+}
+
+void restoreGame(Game *io_game,
+                 const GameSave *_save)
+{
+  Node *spare[PLAYER_TOTAL];
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    spare[p] = io_game->players[p].spare;
+    recycleSnake(io_game->players[p].tail, &spare[p]);
+  }
+
+  // The spawner belongs to the game being restored, not to the match that was saved
+  PickupSpawner *spawner = io_game->spawner;
+
+  *io_game = _save->game;
+  io_game->spawner = spawner;
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    Player *player = &io_game->players[p];
+    Node *prev = NULL;
+
+    player->head = NULL;
+
+    for(int i = 0; i < _save->segmentCount[p]; ++i)
+    {
+      Node *node = reuseSegment(&spare[p], &_save->segments[p][i]);
+
+      if(prev != NULL)
+      {
+        node->prev = prev;
+
+        if(i < _save->linkedCount[p])
+        {
+          prev->next = node;
+        }
+      }
+      else
+      {
+        player->head = node;
+      }
+
+      prev = node;
+    }
+
+    player->tail = prev;
+    player->spare = spare[p];
+  }
+
+  // The gems, snakes and knights may have been somewhere else entirely when the spawner last
+  // saw them
+  if(io_game->spawner != NULL)
+  {
+    const Gems *c_gems = &io_game->pickups.gems;
+
+    clearPickupSpawner(io_game->spawner);
+
+    for(int i = 0; i < c_gems->count; ++i)
+    {
+      addSpawnedPickup(io_game->spawner, c_gems->x[i], c_gems->y[i]);
+    }
+
+    coverSnakes(io_game);
+    coverKnights(io_game, NULL, true);
+  }
+}
+
+void getSnakeHeads(const Game *_game,
+                   Node *o_heads[PLAYER_TOTAL])
+{
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    o_heads[p] = _game->players[p].head;
+  }
+}
+
+///
+/// \brief GrowPlayer Adds a segment to the player's snake. Only the neck (which starts
+/// swallowing) and the new tail change, so only their hashes are updated
+/// \param io_player
+/// \param io_hash The player's running segment hash
+/// \param io_spawner The new tail is covered, can be NULL
+///
+static void growPlayer(Player *io_player,
+                       Uint64 *io_hash,
+                       PickupSpawner *io_spawner)
+{
+  Node *neck = io_player->head->next;
+
+  if(neck != NULL) { *io_hash -= hashSegment(neck); }
+
+  growsnake(io_player->head, &io_player->tail, &io_player->bodyData, &io_player->spare);
+
+  if(neck != NULL) { *io_hash += hashSegment(neck); }
+
+  *io_hash += hashSegment(io_player->tail);
+
+  if(io_spawner != NULL) { coverSpawner(io_spawner, &io_player->tail->pos); }
+}
+
+///
+/// \brief MovePlayer Moves the player's snake. shiftSnakeBody only changes the head, the
+/// old tail (which becomes the neck) and the new tail, so only their hashes are updated.
+/// Every other segment stays where it was, so the cover only loses the old tail and gains
+/// the new head
+/// \param io_player
+/// \param io_hash The player's running segment hash
+/// \param io_spawner Kept covering the snake, can be NULL
+///
+static void movePlayer(Player *io_player,
+                       Uint64 *io_hash,
+                       PickupSpawner *io_spawner)
+{
+  const SDL_Rect c_oldTail = io_player->tail->pos;
+
+  Node *touched[3] = { io_player->head, io_player->tail, io_player->tail->prev };
+  int touchedCount = 2;
+
+  if(touched[2] != NULL && touched[2] != touched[0])
+  {
+    touchedCount = 3;
+  }
+
+  for(int i = 0; i < touchedCount; ++i)
+  {
+    *io_hash -= hashSegment(touched[i]);
+  }
+
+  updateSnakePos(io_player->head, &io_player->tail, io_player->direction);
+
+  for(int i = 0; i < touchedCount; ++i)
+  {
+    *io_hash += hashSegment(touched[i]);
+  }
+
+  if(io_spawner != NULL && io_player->direction != NOTMOVING)
+  {
+    uncoverSpawner(io_spawner, &c_oldTail);
+    coverSpawner(io_spawner, &io_player->head->pos);
+  }
+}
+
+///
+/// \brief GetHeadPath Works out the line a head moves along this tick from the way it is going
+/// \param _player
+/// \param _moves Moves this tick
+/// \param o_path
+///
+static void getHeadPath(const Player *_player,
+                        int _moves,
+                        HeadPath *o_path)
+{
+  const Node *head = _player->head;
+
+  // One move of a rect at the origin, which is too small to wrap
+  SDL_Rect step = { 0, 0, head->pos.w, head->pos.h };
+  moveSprite(_player->direction, &step, head->pos.h / 4);
+
+  o_path->from = head->pos;
+  o_path->stepX = step.x;
+  o_path->stepY = step.y;
+  o_path->steps = _moves - 1;
+}
+
+///
+/// \brief GetHeadAt Where a head will be for a check, wrapped as moveSprite would have
+///
+static SDL_Rect getHeadAt(const HeadPath *_path,
+                          int _check)
+{
+  SDL_Rect pos = _path->from;
+  pos.x += _check * _path->stepX;
+  pos.y += _check * _path->stepY;
+  wrapSprite(&pos);
+
+  return pos;
+}
+
+///
+/// \brief SweepHeads Sweeps each head's path this tick against its body, the walls and every
+/// pickup, keeping what it might reach and on which checks
+/// \param io_game
+/// \param o_sweep
+///
+static void sweepHeads(Game *io_game,
+                       TickSweep *o_sweep)
+{
+  const Gems *c_gems = &io_game->pickups.gems;
+  const Knights *c_knights = &io_game->pickups.knights;
+
+  for(int id = 0; id < PICKUP_TOTAL; ++id)
+  {
+    o_sweep->gemSlots[id] = -1;
+    o_sweep->knightSlots[id] = -1;
+  }
+
+  memset(o_sweep->gemReached, 0, sizeof(o_sweep->gemReached));
+  memset(o_sweep->knightReached, 0, sizeof(o_sweep->knightReached));
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    Player *player = &io_game->players[p];
+    HeadSweep *head = &o_sweep->heads[p];
+
+    getHeadPath(player, io_game->movesPerTick, &head->path);
+
+    head->selfCheck = sweepSelfCollision(player->head, head->path.stepX, head->path.stepY,
+                                         head->path.steps, head->tailEnd, &head->tailEndCount);
+    head->wallCheck = hitsWall(io_game->map, &head->path);
+    head->pickupCount = 0;
+  }
+
+  for(int i = 0; i < c_gems->count; ++i)
+  {
+    sweepGem(io_game, o_sweep, i, 0);
+  }
+
+  for(int i = 0; i < c_knights->count; ++i)
+  {
+    sweepKnight(io_game, o_sweep, i);
+  }
+}
+
+///
+/// \brief SweepGem Sweeps every head against a gem, which stays where it is
+/// \param _game
+/// \param io_sweep
+/// \param _gem Array slot
+/// \param _fromCheck Checks before this are left out, such as ones before it was spawned
+///
+static void sweepGem(const Game *_game,
+                     TickSweep *io_sweep,
+                     int _gem,
+                     int _fromCheck)
+{
+  const Gems *c_gems = &_game->pickups.gems;
+  const SDL_Rect c_box = { c_gems->x[_gem], c_gems->y[_gem], PICKUP_SIZE, PICKUP_SIZE };
+
+  io_sweep->gemSlots[c_gems->id[_gem]] = _gem;
+  addPickupSweep(io_sweep, c_gems->id[_gem], &c_box, _fromCheck);
+}
+
+///
+/// \brief SweepKnight Sweeps every head against a knight. A knight steps at most once a move,
+/// so it is grown by as far as it could go this tick. One close enough to an edge to wrap could
+/// be anywhere, and is checked every time
+/// \param _game
+/// \param io_sweep
+/// \param _knight Array slot
+///
+static void sweepKnight(const Game *_game,
+                        TickSweep *io_sweep,
+                        int _knight)
+{
+  const Knights *c_knights = &_game->pickups.knights;
+  const int c_reach = (_game->movesPerTick - 1) * KNIGHT_SPEED;
+  const int c_x = c_knights->x[_knight];
+  const int c_y = c_knights->y[_knight];
+  const SDL_Rect c_box = { c_x - c_reach, c_y - c_reach, PICKUP_SIZE + c_reach * 2, PICKUP_SIZE + c_reach * 2 };
+
+  const bool c_canWrap = c_x - c_reach < -KNIGHT_SIZE * 2 || c_x + c_reach >= WIDTH ||
+                         c_y - c_reach < -KNIGHT_SIZE * 2 || c_y + c_reach >= HEIGHT;
+
+  io_sweep->knightSlots[c_knights->id[_knight]] = _knight;
+  addPickupSweep(io_sweep, c_knights->id[_knight], c_canWrap ? NULL : &c_box, 0);
+}
+
+///
+/// \brief AddPickupSweep Keeps a pickup for each head whose path collides with its box
+/// \param io_sweep
+/// \param _id
+/// \param _box Anywhere the pickup could be this tick, NULL to keep it for every check
+/// \param _fromCheck
+///
+static void addPickupSweep(TickSweep *io_sweep,
+                           int _id,
+                           const SDL_Rect *_box,
+                           int _fromCheck)
+{
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    HeadSweep *head = &io_sweep->heads[p];
+    const HeadPath *c_path = &head->path;
+    int first = 0;
+    int last = c_path->steps;
+
+    if(_box != NULL &&
+       !sweepSprite(&c_path->from, c_path->stepX, c_path->stepY, c_path->steps, _box, PICKUP_CLIP,
+                    &first, &last))
+    {
+      continue;
+    }
+
+    if(first < _fromCheck)
+    {
+      first = _fromCheck;
+    }
+
+    if(first <= last)
+    {
+      const PickupSweep c_pickup = { _id, first, last };
+      head->pickups[head->pickupCount++] = c_pickup;
+    }
+  }
+}
+
+///
+/// \brief CollectPickups Grows every snake whose head reaches a pickup this check, both can
+/// reach the same one. What each head reaches is found first from what its sweep kept, then
+/// collected in slot order, exactly as a loop over every pickup would, so the arrays end up the same
+/// \param io_game
+/// \param io_sweep
+/// \param _check
+///
+static void collectPickups(Game *io_game,
+                           TickSweep *io_sweep,
+                           int _check)
+{
+  Gems *gems = &io_game->pickups.gems;
+  Knights *knights = &io_game->pickups.knights;
+  int firstGem = gems->count;
+  int firstKnight = knights->count;
+
+  typedef char hasBitPerPlayer[(PLAYER_TOTAL <= 8) ? 1 : -1];
+  (void)sizeof(hasBitPerPlayer);
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    const HeadSweep *c_head = &io_sweep->heads[p];
+    const SDL_Rect *c_pos = &io_game->players[p].head->pos;
+
+    for(int i = 0; i < c_head->pickupCount; ++i)
+    {
+      const PickupSweep *c_pickup = &c_head->pickups[i];
+
+      if(_check < c_pickup->first || _check > c_pickup->last)
+      {
+        continue;
+      }
+
+      // Collected ones are gone, and a spawned gem can take the id of one that was
+      const int c_gem = io_sweep->gemSlots[c_pickup->id];
+      const int c_knight = io_sweep->knightSlots[c_pickup->id];
+
+      if(c_gem >= 0 && isPickupReached(c_pos, gems->x[c_gem], gems->y[c_gem]))
+      {
+        io_sweep->gemReached[c_gem] |= 1 << p;
+        if(c_gem < firstGem) { firstGem = c_gem; }
+      }
+      else if(c_knight >= 0 && isPickupReached(c_pos, knights->x[c_knight], knights->y[c_knight]))
+      {
+        io_sweep->knightReached[c_knight] |= 1 << p;
+        if(c_knight < firstKnight) { firstKnight = c_knight; }
+      }
+    }
+  }
+
+  // A collected pickup is replaced by the last of its kind, which is checked next
+  for(int i = firstGem; i < gems->count;)
+  {
+    if(io_sweep->gemReached[i])
+    {
+      growReached(io_game, io_sweep->gemReached[i]);
+      io_game->pickupHash -= hashGem(gems, i);
+
+      if(io_game->spawner != NULL)
+      {
+        removeSpawnedPickup(io_game->spawner, gems->x[i], gems->y[i]);
+      }
+
+      io_sweep->gemSlots[gems->id[i]] = -1;
+      removeGem(gems, i);
+
+      io_sweep->gemReached[i] = io_sweep->gemReached[gems->count];
+      io_sweep->gemReached[gems->count] = 0;
+
+      if(i < gems->count)
+      {
+        io_sweep->gemSlots[gems->id[i]] = i;
+      }
+    }
+    else
+    {
+      ++i;
+    }
+  }
+
+  for(int i = firstKnight; i < knights->count;)
+  {
+    if(io_sweep->knightReached[i])
+    {
+      growReached(io_game, io_sweep->knightReached[i]);
+      io_game->pickupHash -= hashKnight(knights, i);
+
+      if(io_game->spawner != NULL)
+      {
+        const SDL_Rect c_knight = { knights->x[i], knights->y[i], KNIGHT_SIZE, KNIGHT_SIZE };
+        uncoverSpawner(io_game->spawner, &c_knight);
+      }
+
+      cancelTimer(&io_game->timers, io_game->knightStepTimers[knights->id[i]]);
+      cancelTimer(&io_game->timers, io_game->knightTurnTimers[knights->id[i]]);
+
+      io_sweep->knightSlots[knights->id[i]] = -1;
+      removeKnight(knights, i);
+
+      io_sweep->knightReached[i] = io_sweep->knightReached[knights->count];
+      io_sweep->knightReached[knights->count] = 0;
+
+      if(i < knights->count)
+      {
+        io_sweep->knightSlots[knights->id[i]] = i;
+      }
+    }
+    else
+    {
+      ++i;
+    }
+  }// End collision Pickup check
+}
+
+///
+/// \brief IsPickupReached True if a head is far enough into a pickup's box to collect it.
+/// Knights are collected by the same PICKUP_SIZE box as gems, wrapped by the knight's size as
+/// stepKnights does
+/// \param _head
+/// \param _x Top left of the pickup
+/// \param _y
+///
+static bool isPickupReached(const SDL_Rect *_head,
+                            int _x,
+                            int _y)
+{
+  SDL_Rect box = { _x, _y, KNIGHT_SIZE, KNIGHT_SIZE };
+  wrapSprite(&box);
+  box.w = PICKUP_SIZE;
+  box.h = PICKUP_SIZE;
+
+  return detectCollision(_head, &box, PICKUP_CLIP);
+}
+
+///
+/// \brief GrowReached Grows each player whose bit is set for reaching a pickup
+/// \param io_game
+/// \param _reached A bit for each player, by index
+///
+static void growReached(Game *io_game,
+                        int _reached)
+{
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    if(_reached & (1 << p))
+    {
+      growPlayer(&io_game->players[p], &io_game->segmentHash[p], io_game->spawner);
+      io_game->players[p].pickupCount++;
+    }
+  }
+}
+
+///
+/// \brief UpdateKnights Steps the knights whose animation timer fired this move,
+/// then picks a new direction for those whose turn timer did
+/// \param io_game
+/// \param _isStepDue By knight id
+/// \param _isTurnDue
+///
+static void updateKnights(Game *io_game,
+                          const Uint8 _isStepDue[],
+                          const Uint8 _isTurnDue[])
+{
+  Knights *knights = &io_game->pickups.knights;
+
+  // The same by array slot, past the last knight too so stepKnights can run on whole lanes
+  Uint8 isStepping[PICKUP_TOTAL] = {0};
+  bool isAnyStep = false;
+
+  for(int i = 0; i < knights->count; ++i)
+  {
+    isStepping[i] = _isStepDue[knights->id[i]];
+    isAnyStep |= isStepping[i];
+  }
+
+  // Normally every knight changes, so their hashes are taken out and put back all at once
+  if(isAnyStep)
+  {
+    int headX[PLAYER_TOTAL];
+    int headY[PLAYER_TOTAL];
+
+    for(int p = 0; p < PLAYER_TOTAL; ++p)
+    {
+      const SDL_Rect c_head = io_game->players[p].head->pos;
+
+      headX[p] = c_head.x + c_head.w / 2;
+      headY[p] = c_head.y + c_head.h / 2;
+    }
+
+    io_game->pickupHash -= computeKnightHash(knights);
+    steerKnights(knights, isStepping, headX, headY, PLAYER_TOTAL, io_game->map);
+    coverKnights(io_game, isStepping, false);
+    stepKnights(knights, isStepping);
+    coverKnights(io_game, isStepping, true);
+    io_game->pickupHash += computeKnightHash(knights);
+  }
+
+  // Randomise each knights movement every few seconds, steering takes over again next step
+  // for any knight with something near it. Done in slot order, whatever order the timers fired in
+  for(int i = 0; i < knights->count; ++i)
+  {
+    if(_isTurnDue[knights->id[i]])
+    {
+      Move direction = NOTMOVING;
+
+      // Push knights away from the edge so they don't get hidden
+      if(knights->x[i] < KNIGHT_SIZE) { direction = RIGHT; }
+      if(knights->y[i] < KNIGHT_SIZE) { direction = DOWN;  }
+
+      if(knights->x[i] > WIDTH - KNIGHT_SIZE*2) { direction = LEFT; }
+      if(knights->y[i] > HEIGHT- KNIGHT_SIZE*2) { direction = UP;   }
+
+      if(direction==NOTMOVING)
+      {
+        direction = getRandomMovement(&io_game->seed);
+      }
+
+      io_game->pickupHash -= hashKnight(knights, i);
+      knights->direction[i] = direction;
+      io_game->pickupHash += hashKnight(knights, i);
+    }
+  }
+}
+
+///
+/// \brief HitsWall Finds the first check a snake head's centre is within ARENA_HEAD_CLEARANCE
+/// of a wall on, a single lookup each. Checks it can't reach a wall by from the last lookup are
+/// skipped: the field holds the distance from each cell's centre, so a point in the cell can be
+/// up to half a cell's diagonal either side of it at both ends, which two cells more than allows for
+/// \param _map
+/// \param _path
+/// \return The first check that hits, past the last if none does
+///
+static int hitsWall(const ArenaMap *_map,
+                    const HeadPath *_path)
+{
+  const int c_none = _path->steps + 1;
+
+  if(_map == NULL)
+  {
+    return c_none;
+  }
+
+  // No move goes further than this in any direction
+  const int c_stepLength = abs(_path->stepX) + abs(_path->stepY);
+  int check = 0;
+
+  while(check <= _path->steps)
+  {
+    const SDL_Rect c_pos = getHeadAt(_path, check);
+    const int c_distance = getArenaCell(_map, c_pos.x + c_pos.w / 2, c_pos.y + c_pos.h / 2)->distance;
+
+    if(c_distance < ARENA_HEAD_CLEARANCE)
+    {
+      return check;
+    }
+
+    // Every check is in the same place
+    if(c_stepLength == 0)
+    {
+      break;
+    }
+
+    const int c_spare = c_distance - ARENA_HEAD_CLEARANCE - ARENA_CELL_SIZE * 2;
+    int next = check + 1 + ((c_spare > 0) ? (c_spare / c_stepLength) : 0);
+
+    // The field says nothing about the far side of a wrap, so a skip never goes past one
+    const int c_far = (next <= _path->steps) ? next : _path->steps;
+
+    if(c_far > check + 1)
+    {
+      const SDL_Rect c_farPos = getHeadAt(_path, c_far);
+
+      if(c_farPos.x - c_pos.x != (c_far - check) * _path->stepX ||
+         c_farPos.y - c_pos.y != (c_far - check) * _path->stepY)
+      {
+        next = check + 1;
+      }
+    }
+
+    check = next;
+  }
+
+  return c_none;
+}
+
+///
+/// \brief SpawnGem Tops the board back up by one gem if pickups have been collected. The
+/// snakes and knights are already covered, so the gem doesn't land under something
+///
+static void spawnGem(Game *io_game)
+{
+  Pickups *pickups = &io_game->pickups;
+
+  if(pickups->gems.count + pickups->knights.count >= PICKUP_TOTAL)
+  {
+    return;
+  }
+
+  if(respawnGem(pickups, &io_game->seed, io_game->spawner))
+  {
+    io_game->pickupHash += hashGem(&pickups->gems, pickups->gems.count - 1);
+  }
+}
+
+///
+/// \brief CoverSnakes Covers every segment of both snakes in the spawner, from the tail so
+/// the segments only linked backwards are covered too
+///
+static void coverSnakes(Game *io_game)
+{
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    for(const Node *node = io_game->players[p].tail; node != NULL; node = node->prev)
+    {
+      coverSpawner(io_game->spawner, &node->pos);
+    }
+  }
+}
+
+///
+/// \brief CoverKnights Covers or uncovers knights where they are now, such as either side of
+/// them stepping. Does nothing without a spawner
+/// \param io_game
+/// \param _isCovered By array slot, NULL for every knight
+/// \param _isCovering False to uncover them
+///
+static void coverKnights(Game *io_game,
+                         const Uint8 _isCovered[],
+                         bool _isCovering)
+{
+  const Knights *c_knights = &io_game->pickups.knights;
+
+  if(io_game->spawner == NULL)
+  {
+    return;
+  }
+
+  for(int i = 0; i < c_knights->count; ++i)
+  {
+    if(_isCovered == NULL || _isCovered[i])
+    {
+      const SDL_Rect c_knight = { c_knights->x[i], c_knights->y[i], KNIGHT_SIZE, KNIGHT_SIZE };
+
+      if(_isCovering) { coverSpawner(io_game->spawner, &c_knight); }
+      else            { uncoverSpawner(io_game->spawner, &c_knight); }
+    }
+  }
+}
@@ -0,0 +1,161 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <stdbool.h>
+
+#include "utils.h"
+#include "actor.h"
+#include "arena.h"
+#include "pickup.h"
+#include "timerwheel.h"
+
+#define PLAYER_TOTAL      (2)
+#define SNAKE_START_LENGTH (24)   // Body segments, unless the game is given another length
+#define GAME_TICK_MOVES_MAX (16)  // Most moves a tick can take, a head's path has to stay shorter than the screen
+
+// Timing - ms
+#define GAME_TICK_DELAY   (30)
+#define PLAYER_FRAME_DELAY (150)
+#define PICKUP_FRAME_DELAY (50)
+#define KNIGHT_DIR_UPDATE (1500)
+#define PICKUP_SPAWN_DELAY (600)  // A collected pickup is replaced by a new gem this often, when respawning
+
+// Events are due on the first move after their delay has passed. Timers count moves
+// rather than ticks, so they keep the same pace however many moves a tick takes
+#define GAME_TICKS_AFTER(ms) ((ms) / GAME_TICK_DELAY + 1)
+
+// What each timer in Game.timers does when it fires
+typedef enum{
+  TIMER_PLAYER_FRAMES,  // Step both snakes' animations
+  TIMER_KNIGHT_STEP,    // Step one knight's animation and move it, data is the knight's id
+  TIMER_KNIGHT_TURN,    // Pick a new direction for one knight, data is the knight's id
+  TIMER_PICKUP_SPAWN,   // Place a gem if the board is short of pickups, only with a spawner
+  TIMER_KIND_TOTAL
+} GameTimer;
+
+// Why the match stopped
+typedef enum{
+  GAME_RUNNING = 0,
+  GAME_OVER_COLLISION,  // A snake collided with its own body or a wall
+  GAME_OVER_PICKUPS     // Every pickup has been collected, never while respawning
+} GameState;
+
+typedef struct Player{
+  Node *head;
+  Node *tail;
+  Node bodyData;        // Template copied into every new segment
+  Node *spare;          // Segments left over from earlier matches, reused before allocating
+  Move direction;
+  int pickupCount;
+  bool hasCollided;
+} Player;
+
+// Everything needed to simulate a match, rendering is left to the caller
+typedef struct Game{
+  Player players[PLAYER_TOTAL];
+  Pickups pickups;
+  const ArenaMap *map;  // Walls, shared and never changed so not part of the state. NULL for none
+
+  // Where the gems are, so new ones can be placed clear of them. Only a copy of what is
+  // in pickups, so not part of the state either, and restoreGame refills it. NULL when
+  // collected pickups are never replaced
+  PickupSpawner *spawner;
+
+  int startLength;      // Body segments each snake starts with
+  int movesPerTick;     // Each snake moves this many times a tick, in a straight line
+
+  unsigned int seed;    // Random generator state, owned by this match only
+  unsigned int ticks;
+  unsigned int time;    // Simulated ms, advances by GAME_TICK_DELAY every move
+
+  TimerWheel timers;    // Every timed event, by tick, see GameTimer
+
+  // Each knight's own timers by its id, so they can be cancelled once it is collected
+  int knightStepTimers[PICKUP_TOTAL];
+  int knightTurnTimers[PICKUP_TOTAL];
+
+  GameState state;
+
+  // Running sums of every segment's and pickup's hash, see statehash.h
+  Uint64 segmentHash[PLAYER_TOTAL];
+  Uint64 pickupHash;
+} Game;
+
+// A copy of a whole match that it can be rewound to. Segments are stored head first,
+// linkedCount of them are reachable from the head through next and the rest have only
+// been linked backwards by growsnake yet, which restoreGame reproduces exactly
+typedef struct GameSave{
+  Game game;            // Everything but the snakes, the segment pointers in it are stale
+  Node *segments[PLAYER_TOTAL];
+  int segmentCount[PLAYER_TOTAL];
+  int linkedCount[PLAYER_TOTAL];
+  int segmentCapacity[PLAYER_TOTAL];
+} GameSave;
+
+///
+/// \brief InitialiseGame Creates both snakes and scatters the pickups
+/// \param o_game
+/// \param _seed Matches with the same seed and the same moves play out identically
+/// \param _map Walls, which must outlive the game, or NULL for an open arena
+/// \param io_spawner Replaces collected pickups with new gems over time, so the board never
+/// runs out, or NULL. Covers the whole arena, and is used by this game only
+/// \param _startLength Body segments for each snake, 1 or more, such as SNAKE_START_LENGTH.
+/// Past about 50 a snake wraps round the arena, and past about 175 it starts out touching itself
+/// \param _movesPerTick 1 to GAME_TICK_MOVES_MAX. More runs a match in fewer, coarser ticks,
+/// which play out exactly as that many ticks of one move with the same inputs
+///
+void initialiseGame(Game *o_game, unsigned int _seed, const ArenaMap *_map, PickupSpawner *io_spawner,
+                    int _startLength, int _movesPerTick);
+
+///
+/// \brief ResetGame Starts a new match in an initialised game, reusing the segments
+/// it already has so a restart normally allocates nothing. Plays out exactly like
+/// initialiseGame with the same seed. The walls stay the same
+/// \param io_game
+/// \param _seed
+///
+void resetGame(Game *io_game, unsigned int _seed);
+
+///
+/// \brief FreeGame Frees every snake segment, including the spares
+/// \param io_game
+///
+void freeGame(Game *io_game);
+
+///
+/// \brief UpdateGame Advances the match by one tick. Before each of its moves, collects pickups
+/// and checks for the end of the match, then moves the snakes and knights. Each head's path is
+/// swept once a tick to find what those checks need to look at
+/// \param io_game
+/// \param _moves The direction each player wants to move this tick
+/// \return False once the match is over, the snakes are left where they were when it ended
+///
+bool updateGame(Game *io_game, const Move _moves[PLAYER_TOTAL]);
+
+///
+/// \brief InitialiseGameSave Sets up an empty save, its buffers grow on first use
+///
+void initialiseGameSave(GameSave *o_save);
+void freeGameSave(GameSave *io_save);
+
+///
+/// \brief SaveGame Copies the whole match into _save, reusing its buffers
+/// \return False if a buffer could not grow, the save is then unusable
+///
+bool saveGame(GameSave *io_save, const Game *_game);
+
+///
+/// \brief RestoreGame Rewinds the match to a save, relinking the game's own segments
+/// (and its spares) in place, so nothing is allocated unless the snakes were longer then.
+/// The game keeps its own spawner, if it has one, which is refilled with the saved gems
+/// \param io_game Must have been initialised
+/// \param _save
+///
+void restoreGame(Game *io_game, const GameSave *_save);
+
+///
+/// \brief GetSnakeHeads Fills _heads with the head of each player, in player order
+///
+void getSnakeHeads(const Game *_game, Node *o_heads[PLAYER_TOTAL]);
+
+#endif // GAME_H
@@ -0,0 +1,187 @@
+#include "hud.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "trace.h"
+
+#define HUD_PADDING     (4)
+#define HUD_ADVANCE     ((HUD_GLYPH_W + 1) * HUD_SCALE)
+#define HUD_MARGIN      (8)             // From the corner of the screen
+#define HUD_BACKGROUND  (0x80000000u)   // Half transparent black
+#define HUD_WHITE       (0xFFFFFFFFu)
+
+// Characters in the atlas, in atlas order. Anything else is drawn as the last one
+static const char s_glyphCharacters[HUD_GLYPHS + 1] = "0123456789CEIKLNPSTU?";
+
+// 5x7 glyphs, a byte per row with the leftmost pixel in bit 4
+static const Uint8 s_glyphRows[HUD_GLYPHS][HUD_GLYPH_H] = {
+  {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E},   // 0
+  {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E},   // 1
+  {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F},   // 2
+  {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E},   // 3
+  {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02},   // 4
+  {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E},   // 5
+  {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E},   // 6
+  {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08},   // 7
+  {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E},   // 8
+  {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C},   // 9
+  {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E},   // C
+  {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F},   // E
+  {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E},   // I
+  {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11},   // K
+  {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F},   // L
+  {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11},   // N
+  {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10},   // P
+  {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E},   // S
+  {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04},   // T
+  {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E},   // U
+  {0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04}    // ?
+};
+
+static void composeHud(Hud *io_hud);
+static int drawText(Hud *io_hud, int _x, const char *_text, Uint32 _colour);
+
+bool createHud(Hud *o_hud,
+               const Canvas *_canvas,
+               const SDL_Color _colours[PLAYER_TOTAL])
+{
+  o_hud->w = HUD_COLUMNS * HUD_ADVANCE + HUD_PADDING * 2;
+  o_hud->h = HUD_GLYPH_H * HUD_SCALE + HUD_PADDING * 2;
+  o_hud->pixels = allocateMemory(MEMORY_ASSETS, o_hud->w * o_hud->h * sizeof(Uint32));
+  o_hud->isComposed = false;
+
+  // Bake every glyph at its final size so composing is just copying
+  for(int g = 0; g < HUD_GLYPHS; ++g)
+  {
+    for(int y = 0; y < HUD_GLYPH_H * HUD_SCALE; ++y)
+    {
+      for(int x = 0; x < HUD_GLYPH_W * HUD_SCALE; ++x)
+      {
+        const int c_bit = HUD_GLYPH_W - 1 - x / HUD_SCALE;
+        o_hud->atlas[g][y][x] = (s_glyphRows[g][y / HUD_SCALE] >> c_bit) & 1;
+      }
+    }
+  }
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    o_hud->colours[p] = 0xFF000000u | ((Uint32)_colours[p].r << 16) | ((Uint32)_colours[p].g << 8) | _colours[p].b;
+  }
+
+  if(!o_hud->pixels || !createStreamingSheet(&o_hud->sheet, _canvas, o_hud->w, o_hud->h))
+  {
+    freeMemory(o_hud->pixels);
+    o_hud->pixels = NULL;
+    return false;
+  }
+
+  return true;
+}
+
+void freeHud(Hud *io_hud)
+{
+  freeSheet(&io_hud->sheet);
+  freeMemory(io_hud->pixels);
+  io_hud->pixels = NULL;
+}
+
+void drawHud(Hud *io_hud,
+             Canvas *io_canvas,
+             const Snapshot *_snapshot)
+{
+  bool isChanged = !io_hud->isComposed || io_hud->tickMicroseconds != _snapshot->tickMicroseconds;
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    isChanged |= io_hud->scores[p] != _snapshot->pickupCount[p];
+    isChanged |= io_hud->lengths[p] != _snapshot->segmentCount[p];
+  }
+
+  if(isChanged)
+  {
+    TRACE_BEGIN("composeHud");
+
+    for(int p = 0; p < PLAYER_TOTAL; ++p)
+    {
+      io_hud->scores[p] = _snapshot->pickupCount[p];
+      io_hud->lengths[p] = _snapshot->segmentCount[p];
+    }
+
+    io_hud->tickMicroseconds = _snapshot->tickMicroseconds;
+
+    composeHud(io_hud);
+    updateSheet(&io_hud->sheet, io_hud->pixels);
+    io_hud->isComposed = true;
+
+    TRACE_END("composeHud");
+  }
+
+  const SDL_Rect c_src = {0, 0, io_hud->w, io_hud->h};
+  const SDL_Rect c_dst = {HUD_MARGIN, HUD_MARGIN, io_hud->w, io_hud->h};
+
+  drawSprite(io_canvas, &io_hud->sheet, &c_src, &c_dst);
+}
+
+///
+/// \brief ComposeHud Writes every value onto a cleared HUD, each player in their own colour
+///
+static void composeHud(Hud *io_hud)
+{
+  const int c_total = io_hud->w * io_hud->h;
+  for(int i = 0; i < c_total; ++i)
+  {
+    io_hud->pixels[i] = HUD_BACKGROUND;
+  }
+
+  char text[HUD_COLUMNS + 1];
+  int x = HUD_PADDING;
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    snprintf(text, sizeof(text), "P%d %d LEN %d", p + 1, io_hud->scores[p], io_hud->lengths[p]);
+    x = drawText(io_hud, x, text, io_hud->colours[p]) + HUD_ADVANCE * 2;
+  }
+
+  snprintf(text, sizeof(text), "TICK %uUS", io_hud->tickMicroseconds);
+  drawText(io_hud, x, text, HUD_WHITE);
+}
+
+///
+/// \brief DrawText Copies glyphs from the atlas onto the HUD, cutting the text off at its edge
+/// \return Where the next character would go
+///
+static int drawText(Hud *io_hud,
+                    int _x,
+                    const char *_text,
+                    Uint32 _colour)
+{
+  const int c_right = io_hud->w - HUD_PADDING;
+
+  for(const char *c = _text; *c != '\0' && _x + HUD_ADVANCE <= c_right; ++c, _x += HUD_ADVANCE)
+  {
+    if(*c == ' ')
+    {
+      continue;
+    }
+
+    const char *c_found = strchr(s_glyphCharacters, *c);
+    const int c_glyph = (c_found != NULL) ? (int)(c_found - s_glyphCharacters) : HUD_GLYPHS - 1;
+
+    for(int y = 0; y < HUD_GLYPH_H * HUD_SCALE; ++y)
+    {
+      Uint32 *row = io_hud->pixels + (HUD_PADDING + y) * io_hud->w + _x;
+
+      for(int x = 0; x < HUD_GLYPH_W * HUD_SCALE; ++x)
+      {
+        if(io_hud->atlas[c_glyph][y][x])
+        {
+          row[x] = _colour;
+        }
+      }
+    }
+  }
+
+  return _x;
+}
@@ -0,0 +1,54 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <stdbool.h>
+
+#include "canvas.h"
+#include "snapshot.h"
+
+#define HUD_GLYPH_W   (5)
+#define HUD_GLYPH_H   (7)
+#define HUD_SCALE     (2)                           // Glyphs are baked at this size, never stretched when drawn
+#define HUD_GLYPHS    (21)                          // Digits, the letters used by the labels, and '?'
+#define HUD_COLUMNS   (48)                          // Characters that fit on the HUD
+
+// The scores, snake lengths and simulation tick cost along the top of the screen. The text
+// is composed on the CPU from a glyph atlas baked at start up, and only when one of the
+// values has changed, so a steady frame costs a single drawSprite of the finished HUD
+typedef struct Hud{
+  Sheet sheet;
+  Uint32 *pixels;     // The HUD as it is being composed, copied to the sheet once finished
+  int w;
+  int h;
+
+  // Coverage of each glyph at HUD_SCALE, one byte per pixel
+  Uint8 atlas[HUD_GLYPHS][HUD_GLYPH_H * HUD_SCALE][HUD_GLYPH_W * HUD_SCALE];
+
+  Uint32 colours[PLAYER_TOTAL];
+
+  // What the sheet currently shows
+  bool isComposed;
+  int scores[PLAYER_TOTAL];
+  int lengths[PLAYER_TOTAL];
+  unsigned int tickMicroseconds;
+} Hud;
+
+///
+/// \brief CreateHud Bakes the glyph atlas and creates the sheet the HUD is composed into
+/// \param o_hud
+/// \param _canvas
+/// \param _colours Each player's text colour
+/// \return False if the sheet could not be created
+///
+bool createHud(Hud *o_hud, const Canvas *_canvas, const SDL_Color _colours[PLAYER_TOTAL]);
+void freeHud(Hud *io_hud);
+
+///
+/// \brief DrawHud Composes the HUD again if anything it shows has changed, then draws it
+/// \param io_hud
+/// \param io_canvas
+/// \param _snapshot
+///
+void drawHud(Hud *io_hud, Canvas *io_canvas, const Snapshot *_snapshot);
+
+#endif // HUD_H
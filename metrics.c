@@ -0,0 +1,419 @@
+// poll and friends are POSIX rather than C99
+#define _POSIX_C_SOURCE 200112L
+
+#include "metrics.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "allocator.h"
+
+#define METRICS_POLL_MS     (100)   // How often the server thread checks it should quit
+#define METRICS_REQUEST_MS  (1000)  // A scraper has this long to send its request
+#define METRICS_REQUEST_MAX (4096)
+
+static const unsigned int s_tickBounds[] = {50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000};
+static const unsigned int s_frameBounds[] = {1000, 2000, 4000, 8000, 16667, 33333, 50000, 100000};
+
+// Appends to a fixed buffer, anything past the end is cut off
+typedef struct TextBuffer{
+  char text[METRICS_BODY_SIZE];
+  int length;
+} TextBuffer;
+
+static int runServer(void *_data);
+static void serveClient(Metrics *io_metrics, int _client);
+static void writeMetrics(Metrics *io_metrics, TextBuffer *io_body);
+static void writeHistogram(MetricHistogram *io_histogram, TextBuffer *io_body);
+static void appendText(TextBuffer *io_buffer, const char *_format, ...);
+static void initialiseHistogram(MetricHistogram *o_histogram, const char *_name, const char *_help,
+                                const unsigned int *_bounds, int _bucketCount);
+static void addSample(MetricHistogram *io_histogram, unsigned int _microseconds);
+static void addTotal(MetricTotal *io_total, Uint64 _amount);
+static Uint64 readTotal(MetricTotal *_total);
+
+bool startMetrics(Metrics *o_metrics,
+                  int _port,
+                  Mixer *_mixer)
+{
+  SDL_AtomicSet(&o_metrics->ticks, 0);
+  SDL_AtomicSet(&o_metrics->frames, 0);
+  SDL_AtomicSet(&o_metrics->snapshotFailures, 0);
+  SDL_AtomicSet(&o_metrics->drawCalls, 0);
+  SDL_AtomicSet(&o_metrics->gems, 0);
+  SDL_AtomicSet(&o_metrics->knights, 0);
+  SDL_AtomicSet(&o_metrics->quit, false);
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    SDL_AtomicSet(&o_metrics->segments[p], 0);
+  }
+
+  initialiseHistogram(&o_metrics->tickTime, "snake_tick_seconds", "Time spent simulating each tick",
+                      s_tickBounds, sizeof(s_tickBounds) / sizeof(s_tickBounds[0]));
+  initialiseHistogram(&o_metrics->frameTime, "snake_frame_seconds", "Time spent drawing each frame, before presenting it",
+                      s_frameBounds, sizeof(s_frameBounds) / sizeof(s_frameBounds[0]));
+
+  o_metrics->mixer = _mixer;
+  o_metrics->thread = NULL;
+  o_metrics->socket = socket(AF_INET, SOCK_STREAM, 0);
+
+  if(o_metrics->socket < 0)
+  {
+    printf("Unable to create the metrics socket: %s\n", strerror(errno));
+    return false;
+  }
+
+  // Restarting the game shouldn't have to wait for the old socket to time out
+  const int c_reuse = 1;
+  setsockopt(o_metrics->socket, SOL_SOCKET, SO_REUSEADDR, &c_reuse, sizeof(c_reuse));
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons((Uint16)_port);
+
+  if(bind(o_metrics->socket, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+     listen(o_metrics->socket, 4) < 0 ||
+     fcntl(o_metrics->socket, F_SETFL, fcntl(o_metrics->socket, F_GETFL, 0) | O_NONBLOCK) < 0)
+  {
+    printf("Unable to serve metrics on port %d: %s\n", _port, strerror(errno));
+    close(o_metrics->socket);
+    return false;
+  }
+
+  o_metrics->thread = SDL_CreateThread(runServer, "metrics", o_metrics);
+
+  if(!o_metrics->thread)
+  {
+    printf("%s\n", SDL_GetError());
+    close(o_metrics->socket);
+    return false;
+  }
+
+  return true;
+}
+
+void stopMetrics(Metrics *io_metrics)
+{
+  SDL_AtomicSet(&io_metrics->quit, true);
+
+  if(io_metrics->thread)
+  {
+    SDL_WaitThread(io_metrics->thread, NULL);
+    io_metrics->thread = NULL;
+  }
+
+  close(io_metrics->socket);
+}
+
+void recordTick(Metrics *io_metrics,
+                unsigned int _microseconds)
+{
+  SDL_AtomicAdd(&io_metrics->ticks, 1);
+  addSample(&io_metrics->tickTime, _microseconds);
+}
+
+void recordSnapshot(Metrics *io_metrics,
+                    const Snapshot *_snapshot)
+{
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    SDL_AtomicSet(&io_metrics->segments[p], _snapshot->segmentCount[p]);
+  }
+
+  SDL_AtomicSet(&io_metrics->gems, _snapshot->pickups.gems.count);
+  SDL_AtomicSet(&io_metrics->knights, _snapshot->pickups.knights.count);
+}
+
+void recordSnapshotFailure(Metrics *io_metrics)
+{
+  SDL_AtomicAdd(&io_metrics->snapshotFailures, 1);
+}
+
+void recordFrame(Metrics *io_metrics,
+                 unsigned int _microseconds,
+                 int _drawCalls)
+{
+  SDL_AtomicAdd(&io_metrics->frames, 1);
+  addSample(&io_metrics->frameTime, _microseconds);
+  SDL_AtomicSet(&io_metrics->drawCalls, _drawCalls);
+}
+
+///
+/// \brief RunServer Thread entry point, answers one scrape at a time until told to quit
+/// \param _data The Metrics
+///
+static int runServer(void *_data)
+{
+  Metrics *metrics = _data;
+
+  while(!SDL_AtomicGet(&metrics->quit))
+  {
+    struct pollfd listener = {metrics->socket, POLLIN, 0};
+
+    if(poll(&listener, 1, METRICS_POLL_MS) <= 0)
+    {
+      continue;
+    }
+
+    const int c_client = accept(metrics->socket, NULL, NULL);
+
+    if(c_client >= 0)
+    {
+      serveClient(metrics, c_client);
+      close(c_client);
+    }
+  }
+
+  return 0;
+}
+
+///
+/// \brief ServeClient Reads the request headers and answers any request with every metric.
+/// A client that is slow to send its request is dropped rather than waited on
+/// \param io_metrics
+/// \param _client
+///
+static void serveClient(Metrics *io_metrics,
+                        int _client)
+{
+  fcntl(_client, F_SETFL, fcntl(_client, F_GETFL, 0) | O_NONBLOCK);
+
+  char request[METRICS_REQUEST_MAX + 1];
+  int length = 0;
+  const Uint32 c_deadline = SDL_GetTicks() + METRICS_REQUEST_MS;
+
+  // Only the end of the headers matters, there is nothing to route
+  while(length < METRICS_REQUEST_MAX && SDL_GetTicks() < c_deadline)
+  {
+    struct pollfd client = {_client, POLLIN, 0};
+
+    if(poll(&client, 1, METRICS_POLL_MS) <= 0)
+    {
+      continue;
+    }
+
+    const ssize_t c_read = recv(_client, request + length, METRICS_REQUEST_MAX - length, 0);
+
+    if(c_read <= 0)
+    {
+      return;
+    }
+
+    length += (int)c_read;
+    request[length] = '\0';
+
+    if(strstr(request, "\r\n\r\n") != NULL)
+    {
+      break;
+    }
+  }
+
+  static TextBuffer s_body;
+  s_body.length = 0;
+  writeMetrics(io_metrics, &s_body);
+
+  char header[128];
+  const int c_headerLength = snprintf(header, sizeof(header),
+                                      "HTTP/1.0 200 OK\r\n"
+                                      "Content-Type: text/plain; version=0.0.4\r\n"
+                                      "Content-Length: %d\r\n\r\n", s_body.length);
+
+  // Tiny responses, a full send buffer means the scraper has gone away
+  send(_client, header, c_headerLength, MSG_NOSIGNAL);
+  send(_client, s_body.text, s_body.length, MSG_NOSIGNAL);
+}
+
+///
+/// \brief WriteMetrics Formats every metric in the Prometheus text format
+///
+static void writeMetrics(Metrics *io_metrics,
+                         TextBuffer *io_body)
+{
+  appendText(io_body, "# HELP snake_ticks_total Game ticks simulated\n"
+                      "# TYPE snake_ticks_total counter\n"
+                      "snake_ticks_total %d\n", SDL_AtomicGet(&io_metrics->ticks));
+
+  appendText(io_body, "# HELP snake_frames_total Frames drawn\n"
+                      "# TYPE snake_frames_total counter\n"
+                      "snake_frames_total %d\n", SDL_AtomicGet(&io_metrics->frames));
+
+  appendText(io_body, "# HELP snake_snapshot_failures_total Ticks the render thread was not shown, for want of memory\n"
+                      "# TYPE snake_snapshot_failures_total counter\n"
+                      "snake_snapshot_failures_total %d\n", SDL_AtomicGet(&io_metrics->snapshotFailures));
+
+  writeHistogram(&io_metrics->tickTime, io_body);
+  writeHistogram(&io_metrics->frameTime, io_body);
+
+  appendText(io_body, "# HELP snake_draw_calls Draw calls made for the last frame\n"
+                      "# TYPE snake_draw_calls gauge\n"
+                      "snake_draw_calls %d\n", SDL_AtomicGet(&io_metrics->drawCalls));
+
+  appendText(io_body, "# HELP snake_segments Segments in each snake\n"
+                      "# TYPE snake_segments gauge\n");
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    appendText(io_body, "snake_segments{player=\"%d\"} %d\n", p + 1, SDL_AtomicGet(&io_metrics->segments[p]));
+  }
+
+  appendText(io_body, "# HELP snake_pickups Pickups left to collect\n"
+                      "# TYPE snake_pickups gauge\n"
+                      "snake_pickups{kind=\"gem\"} %d\n"
+                      "snake_pickups{kind=\"knight\"} %d\n",
+             SDL_AtomicGet(&io_metrics->gems), SDL_AtomicGet(&io_metrics->knights));
+
+  appendText(io_body, "# HELP snake_allocations_total Heap blocks allocated or grown\n"
+                      "# TYPE snake_allocations_total counter\n"
+                      "snake_allocations_total %d\n", getAllocationCount());
+
+  appendText(io_body, "# HELP snake_memory_bytes Memory in use by each subsystem, textures are estimated\n"
+                      "# TYPE snake_memory_bytes gauge\n");
+
+  for(int t = 0; t < MEMORY_TAG_TOTAL; ++t)
+  {
+    size_t current;
+    size_t peak;
+    getMemoryUsage((MemoryTag)t, &current, &peak);
+
+    appendText(io_body, "snake_memory_bytes{subsystem=\"%s\"} %lu\n", getMemoryTagName((MemoryTag)t), (unsigned long)current);
+  }
+
+  appendText(io_body, "# HELP snake_memory_peak_bytes Most memory each subsystem has had in use at once\n"
+                      "# TYPE snake_memory_peak_bytes gauge\n");
+
+  for(int t = 0; t < MEMORY_TAG_TOTAL; ++t)
+  {
+    size_t current;
+    size_t peak;
+    getMemoryUsage((MemoryTag)t, &current, &peak);
+
+    appendText(io_body, "snake_memory_peak_bytes{subsystem=\"%s\"} %lu\n", getMemoryTagName((MemoryTag)t), (unsigned long)peak);
+  }
+
+  if(io_metrics->mixer != NULL)
+  {
+    appendText(io_body, "# HELP snake_audio_underruns_total Times the audio device ran out of samples\n"
+                        "# TYPE snake_audio_underruns_total counter\n"
+                        "snake_audio_underruns_total %d\n", getMixerUnderruns(io_metrics->mixer));
+  }
+}
+
+///
+/// \brief WriteHistogram Buckets are stored on their own and made cumulative here. The
+/// writer may add a sample part way through, which at worst makes _count a sample ahead
+///
+static void writeHistogram(MetricHistogram *io_histogram,
+                           TextBuffer *io_body)
+{
+  appendText(io_body, "# HELP %s %s\n# TYPE %s histogram\n", io_histogram->name, io_histogram->help, io_histogram->name);
+
+  int cumulative = 0;
+
+  for(int b = 0; b < io_histogram->bucketCount; ++b)
+  {
+    cumulative += SDL_AtomicGet(&io_histogram->counts[b]);
+    appendText(io_body, "%s_bucket{le=\"%g\"} %d\n", io_histogram->name, io_histogram->bounds[b] / 1e6, cumulative);
+  }
+
+  const int c_count = SDL_AtomicGet(&io_histogram->count);
+
+  appendText(io_body, "%s_bucket{le=\"+Inf\"} %d\n", io_histogram->name, (c_count > cumulative) ? c_count : cumulative);
+  appendText(io_body, "%s_sum %.6f\n", io_histogram->name, readTotal(&io_histogram->sum) / 1e6);
+  appendText(io_body, "%s_count %d\n", io_histogram->name, c_count);
+}
+
+static void appendText(TextBuffer *io_buffer,
+                       const char *_format,
+                       ...)
+{
+  const int c_space = METRICS_BODY_SIZE - io_buffer->length;
+
+  va_list arguments;
+  va_start(arguments, _format);
+  const int c_written = vsnprintf(io_buffer->text + io_buffer->length, c_space, _format, arguments);
+  va_end(arguments);
+
+  if(c_written > 0)
+  {
+    io_buffer->length += (c_written < c_space) ? c_written : c_space - 1;
+  }
+}
+
+static void initialiseHistogram(MetricHistogram *o_histogram,
+                                const char *_name,
+                                const char *_help,
+                                const unsigned int *_bounds,
+                                int _bucketCount)
+{
+  o_histogram->name = _name;
+  o_histogram->help = _help;
+  o_histogram->bounds = _bounds;
+  o_histogram->bucketCount = _bucketCount;
+
+  for(int b = 0; b < METRICS_MAX_BUCKETS; ++b)
+  {
+    SDL_AtomicSet(&o_histogram->counts[b], 0);
+  }
+
+  SDL_AtomicSet(&o_histogram->count, 0);
+  SDL_AtomicSet(&o_histogram->sum.sequence, 0);
+  SDL_AtomicSet(&o_histogram->sum.high, 0);
+  SDL_AtomicSet(&o_histogram->sum.low, 0);
+  o_histogram->sum.value = 0;
+}
+
+///
+/// \brief AddSample Samples past the last bound are only in the count, which is the +Inf bucket
+///
+static void addSample(MetricHistogram *io_histogram,
+                      unsigned int _microseconds)
+{
+  for(int b = 0; b < io_histogram->bucketCount; ++b)
+  {
+    if(_microseconds <= io_histogram->bounds[b])
+    {
+      SDL_AtomicAdd(&io_histogram->counts[b], 1);
+      break;
+    }
+  }
+
+  addTotal(&io_histogram->sum, _microseconds);
+  SDL_AtomicAdd(&io_histogram->count, 1);
+}
+
+static void addTotal(MetricTotal *io_total,
+                     Uint64 _amount)
+{
+  io_total->value += _amount;
+
+  // Odd while the halves don't match each other
+  SDL_AtomicAdd(&io_total->sequence, 1);
+  SDL_AtomicSet(&io_total->high, (int)(io_total->value >> 32));
+  SDL_AtomicSet(&io_total->low, (int)(io_total->value & 0xFFFFFFFFu));
+  SDL_AtomicAdd(&io_total->sequence, 1);
+}
+
+static Uint64 readTotal(MetricTotal *_total)
+{
+  for(;;)
+  {
+    const int c_before = SDL_AtomicGet(&_total->sequence);
+    const Uint32 c_high = (Uint32)SDL_AtomicGet(&_total->high);
+    const Uint32 c_low = (Uint32)SDL_AtomicGet(&_total->low);
+
+    if(!(c_before & 1) && SDL_AtomicGet(&_total->sequence) == c_before)
+    {
+      return ((Uint64)c_high << 32) | c_low;
+    }
+  }
+}
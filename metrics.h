@@ -0,0 +1,93 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdbool.h>
+
+#include "mixer.h"
+#include "snapshot.h"
+
+#define METRICS_MAX_BUCKETS (10)
+#define METRICS_BODY_SIZE   (8192)  // Longest response, the whole exposition easily fits
+
+// A 64 bit total kept in two 32 bit atomics. Only one thread adds to it, and it bumps
+// sequence before and after, so a reader that sees the same even sequence on both sides
+// of reading the halves knows it has a value that was really there
+typedef struct MetricTotal{
+  SDL_atomic_t sequence;
+  SDL_atomic_t high;
+  SDL_atomic_t low;
+  Uint64 value;         // The writer's own copy
+} MetricTotal;
+
+// A Prometheus histogram of durations, written by one thread
+typedef struct MetricHistogram{
+  const char *name;
+  const char *help;
+  const unsigned int *bounds;               // Upper bound of each bucket, microseconds
+  int bucketCount;
+  SDL_atomic_t counts[METRICS_MAX_BUCKETS]; // Samples in each bucket alone, summed when served
+  SDL_atomic_t count;
+  MetricTotal sum;                          // Microseconds
+} MetricHistogram;
+
+// Live statistics served as Prometheus text on a localhost port. The game and render
+// threads only ever write the atomics below, a background thread polls a non-blocking
+// socket and formats whatever they hold when it is scraped, so it never sees game state
+typedef struct Metrics{
+  SDL_atomic_t ticks;
+  SDL_atomic_t frames;
+  SDL_atomic_t snapshotFailures;
+  MetricHistogram tickTime;   // Written by the simulation thread
+  MetricHistogram frameTime;  // Written by the render thread, up to but not including the present
+
+  // Gauges, as of the last tick or frame
+  SDL_atomic_t drawCalls;
+  SDL_atomic_t segments[PLAYER_TOTAL];
+  SDL_atomic_t gems;
+  SDL_atomic_t knights;
+
+  Mixer *mixer;               // Underruns are read from here, NULL without audio
+
+  int socket;
+  SDL_atomic_t quit;
+  SDL_Thread *thread;
+} Metrics;
+
+///
+/// \brief StartMetrics Listens on 127.0.0.1:_port and starts the server thread
+/// \param o_metrics
+/// \param _port
+/// \param _mixer Can be NULL
+/// \return False if the port could not be bound or the thread could not start
+///
+bool startMetrics(Metrics *o_metrics, int _port, Mixer *_mixer);
+void stopMetrics(Metrics *io_metrics);
+
+///
+/// \brief RecordTick Called by the simulation thread after every tick
+/// \param io_metrics
+/// \param _microseconds What the tick cost
+///
+void recordTick(Metrics *io_metrics, unsigned int _microseconds);
+
+///
+/// \brief RecordSnapshot Updates the snake and pickup gauges, called by the simulation
+/// thread with each snapshot it captures before handing it over
+///
+void recordSnapshot(Metrics *io_metrics, const Snapshot *_snapshot);
+
+///
+/// \brief RecordSnapshotFailure Counts a snapshot that could not be captured, called by the
+/// simulation thread, which keeps showing the one before
+///
+void recordSnapshotFailure(Metrics *io_metrics);
+
+///
+/// \brief RecordFrame Called by the render thread once a frame has been drawn
+/// \param io_metrics
+/// \param _microseconds
+/// \param _drawCalls
+///
+void recordFrame(Metrics *io_metrics, unsigned int _microseconds, int _drawCalls);
+
+#endif // METRICS_H
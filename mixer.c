@@ -0,0 +1,397 @@
+#include "mixer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "allocator.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MIXER_HAS_X86 (1)
+#endif
+
+// Made in place of any sound that has no .wav, a sine sweeping between two pitches
+typedef struct Tone{
+  const char *path;
+  float startHz;
+  float endHz;
+  float seconds;
+} Tone;
+
+static const Tone s_tones[SOUND_TOTAL] = {
+  {"eat.wav",      660.0f, 1320.0f, 0.08f},
+  {"death.wav",    440.0f,  110.0f, 0.35f},
+  {"gameover.wav", 523.0f,  131.0f, 0.9f}
+};
+
+static void mixAudio(void *_data, Uint8 *o_stream, int _bytes);
+static void takeCommands(Mixer *io_mixer);
+static void countUnderruns(Mixer *io_mixer, int _frames);
+static void mixVoice(float *io_output, const float *_samples, int _frames, float _left, float _right);
+static void clampOutput(float *io_output, int _samples);
+static float *decodeSound(const char *_path, int _rate, int *o_length);
+static float *makeTone(const Tone *_tone, int _rate, int *o_length);
+
+bool startMixer(Mixer *o_mixer)
+{
+  SDL_AudioSpec wanted;
+  SDL_AudioSpec obtained;
+
+  memset(&wanted, 0, sizeof(wanted));
+  wanted.freq = MIXER_RATE;
+  wanted.format = AUDIO_F32SYS;
+  wanted.channels = 2;
+  wanted.samples = MIXER_BUFFER_FRAMES;
+  wanted.callback = mixAudio;
+  wanted.userdata = o_mixer;
+
+  o_mixer->bank = NULL;
+  o_mixer->voiceCount = 0;
+  o_mixer->framesMixed = 0;
+  o_mixer->startTime = 0;
+  SDL_AtomicSet(&o_mixer->commandHead, 0);
+  SDL_AtomicSet(&o_mixer->commandTail, 0);
+  SDL_AtomicSet(&o_mixer->underruns, 0);
+  SDL_AtomicSet(&o_mixer->dropped, 0);
+
+  // SDL converts to whatever the device really wants, only the rate is left to the device
+  // as the bank is decoded at it
+  o_mixer->device = SDL_OpenAudioDevice(NULL, 0, &wanted, &obtained, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+
+  if(o_mixer->device == 0)
+  {
+    printf("Unable to open audio: %s\n", SDL_GetError());
+    return false;
+  }
+
+  o_mixer->rate = obtained.freq;
+  o_mixer->bufferFrames = obtained.samples;
+
+  // Decode every sound, then gather them into one block
+  float *decoded[SOUND_TOTAL];
+  int total = 0;
+
+  for(int s = 0; s < SOUND_TOTAL; ++s)
+  {
+    decoded[s] = decodeSound(s_tones[s].path, o_mixer->rate, &o_mixer->soundLength[s]);
+
+    if(decoded[s] == NULL)
+    {
+      decoded[s] = makeTone(&s_tones[s], o_mixer->rate, &o_mixer->soundLength[s]);
+    }
+
+    o_mixer->soundStart[s] = total;
+    total += o_mixer->soundLength[s];
+  }
+
+  o_mixer->bank = allocateZeroed(MEMORY_AUDIO, total, sizeof(float));
+
+  for(int s = 0; s < SOUND_TOTAL; ++s)
+  {
+    if(o_mixer->bank != NULL && decoded[s] != NULL)
+    {
+      memcpy(o_mixer->bank + o_mixer->soundStart[s], decoded[s], o_mixer->soundLength[s] * sizeof(float));
+    }
+    else
+    {
+      o_mixer->soundLength[s] = 0;
+    }
+
+    freeMemory(decoded[s]);
+  }
+
+  if(o_mixer->bank == NULL)
+  {
+    SDL_CloseAudioDevice(o_mixer->device);
+    return false;
+  }
+
+  SDL_PauseAudioDevice(o_mixer->device, 0);
+
+  return true;
+}
+
+void stopMixer(Mixer *io_mixer)
+{
+  SDL_CloseAudioDevice(io_mixer->device);
+
+  printf("Audio: %d underruns, %d sounds dropped\n",
+         SDL_AtomicGet(&io_mixer->underruns), SDL_AtomicGet(&io_mixer->dropped));
+
+  freeMemory(io_mixer->bank);
+  io_mixer->bank = NULL;
+}
+
+void playSound(Mixer *io_mixer,
+               Sound _sound,
+               float _gain,
+               float _pan)
+{
+  const int c_head = SDL_AtomicGet(&io_mixer->commandHead);
+
+  if(c_head - SDL_AtomicGet(&io_mixer->commandTail) >= MIXER_QUEUE_SIZE)
+  {
+    SDL_AtomicAdd(&io_mixer->dropped, 1);
+    return;
+  }
+
+  MixerCommand *command = &io_mixer->commands[c_head & (MIXER_QUEUE_SIZE - 1)];
+  command->sound = _sound;
+  command->gain = _gain;
+  command->pan = _pan;
+
+  // A full barrier, the audio thread sees the command before the new head
+  SDL_AtomicSet(&io_mixer->commandHead, c_head + 1);
+}
+
+int getMixerUnderruns(Mixer *_mixer)
+{
+  return SDL_AtomicGet(&_mixer->underruns);
+}
+
+///
+/// \brief MixAudio The SDL audio callback, runs on the audio thread
+/// \param _data The Mixer
+/// \param o_stream Interleaved stereo floats
+/// \param _bytes
+///
+static void mixAudio(void *_data,
+                     Uint8 *o_stream,
+                     int _bytes)
+{
+  Mixer *mixer = _data;
+  float *output = (float *)o_stream;
+  const int c_frames = _bytes / (int)(sizeof(float) * 2);
+
+  countUnderruns(mixer, c_frames);
+  takeCommands(mixer);
+
+  memset(o_stream, 0, _bytes);
+
+  int v = 0;
+  while(v < mixer->voiceCount)
+  {
+    Voice *voice = &mixer->voices[v];
+    const int c_count = (voice->remaining < c_frames) ? voice->remaining : c_frames;
+
+    mixVoice(output, voice->samples, c_count, voice->left, voice->right);
+
+    voice->samples += c_count;
+    voice->remaining -= c_count;
+
+    // Finished voices are replaced by the last one
+    if(voice->remaining == 0)
+    {
+      *voice = mixer->voices[--mixer->voiceCount];
+    }
+    else
+    {
+      ++v;
+    }
+  }
+
+  clampOutput(output, c_frames * 2);
+}
+
+///
+/// \brief TakeCommands Starts a voice for every command the game thread has posted
+///
+static void takeCommands(Mixer *io_mixer)
+{
+  const int c_head = SDL_AtomicGet(&io_mixer->commandHead);
+  int tail = SDL_AtomicGet(&io_mixer->commandTail);
+
+  for(; tail != c_head; ++tail)
+  {
+    const MixerCommand *command = &io_mixer->commands[tail & (MIXER_QUEUE_SIZE - 1)];
+
+    if(io_mixer->voiceCount == MIXER_VOICES || io_mixer->soundLength[command->sound] == 0)
+    {
+      SDL_AtomicAdd(&io_mixer->dropped, 1);
+      continue;
+    }
+
+    Voice *voice = &io_mixer->voices[io_mixer->voiceCount++];
+    voice->samples = io_mixer->bank + io_mixer->soundStart[command->sound];
+    voice->remaining = io_mixer->soundLength[command->sound];
+    voice->left = command->gain * ((command->pan > 0.0f) ? 1.0f - command->pan : 1.0f);
+    voice->right = command->gain * ((command->pan < 0.0f) ? 1.0f + command->pan : 1.0f);
+  }
+
+  // The slots are only handed back once every command in them has been read
+  SDL_AtomicSet(&io_mixer->commandTail, tail);
+}
+
+///
+/// \brief CountUnderruns Compares how much audio has been mixed with how long it has been
+/// playing. SDL asks for buffers a little ahead of time, so if the device has played more
+/// than has been mixed, plus a buffer of slack for timing jitter, it must have run dry
+/// \param io_mixer
+/// \param _frames About to be mixed
+///
+static void countUnderruns(Mixer *io_mixer,
+                           int _frames)
+{
+  const Uint64 c_now = SDL_GetPerformanceCounter();
+
+  if(io_mixer->framesMixed == 0)
+  {
+    io_mixer->startTime = c_now;
+  }
+
+  const Uint64 c_played = (c_now - io_mixer->startTime) * io_mixer->rate / SDL_GetPerformanceFrequency();
+
+  if(c_played > io_mixer->framesMixed + io_mixer->bufferFrames)
+  {
+    SDL_AtomicAdd(&io_mixer->underruns, 1);
+
+    // Carry on from here so one gap is only counted once
+    io_mixer->framesMixed = c_played;
+  }
+
+  io_mixer->framesMixed += _frames;
+}
+
+///
+/// \brief MixVoice Adds _frames mono samples to interleaved stereo output
+///
+static void mixVoice(float *io_output,
+                     const float *_samples,
+                     int _frames,
+                     float _left,
+                     float _right)
+{
+  int i = 0;
+
+#ifdef MIXER_HAS_X86
+  // Four samples become four stereo frames
+  const __m128 c_gain = _mm_setr_ps(_left, _right, _left, _right);
+
+  for(; i + 4 <= _frames; i += 4)
+  {
+    const __m128 c_samples = _mm_loadu_ps(_samples + i);
+    const __m128 c_first = _mm_mul_ps(_mm_unpacklo_ps(c_samples, c_samples), c_gain);
+    const __m128 c_second = _mm_mul_ps(_mm_unpackhi_ps(c_samples, c_samples), c_gain);
+
+    _mm_storeu_ps(io_output + i * 2, _mm_add_ps(_mm_loadu_ps(io_output + i * 2), c_first));
+    _mm_storeu_ps(io_output + i * 2 + 4, _mm_add_ps(_mm_loadu_ps(io_output + i * 2 + 4), c_second));
+  }
+#endif
+
+  for(; i < _frames; ++i)
+  {
+    io_output[i * 2] += _samples[i] * _left;
+    io_output[i * 2 + 1] += _samples[i] * _right;
+  }
+}
+
+///
+/// \brief ClampOutput Keeps overlapping sounds from wrapping around when SDL converts them
+///
+static void clampOutput(float *io_output,
+                        int _samples)
+{
+  int i = 0;
+
+#ifdef MIXER_HAS_X86
+  const __m128 c_min = _mm_set1_ps(-1.0f);
+  const __m128 c_max = _mm_set1_ps(1.0f);
+
+  for(; i + 4 <= _samples; i += 4)
+  {
+    _mm_storeu_ps(io_output + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(io_output + i), c_min), c_max));
+  }
+#endif
+
+  for(; i < _samples; ++i)
+  {
+    io_output[i] = (io_output[i] < -1.0f) ? -1.0f : (io_output[i] > 1.0f) ? 1.0f : io_output[i];
+  }
+}
+
+///
+/// \brief DecodeSound Loads a .wav and converts it to mono floats at _rate
+/// \return The samples, to be freed by the caller, or NULL if there is no such file
+///
+static float *decodeSound(const char *_path,
+                          int _rate,
+                          int *o_length)
+{
+  SDL_AudioSpec spec;
+  Uint8 *data;
+  Uint32 length;
+
+  if(SDL_LoadWAV(_path, &spec, &data, &length) == NULL)
+  {
+    return NULL;
+  }
+
+  // SDL's own copy, counted until it is freed
+  trackMemory(MEMORY_AUDIO, (long)length);
+
+  SDL_AudioCVT convert;
+  float *samples = NULL;
+
+  if(SDL_BuildAudioCVT(&convert, spec.format, spec.channels, spec.freq, AUDIO_F32SYS, 1, _rate) >= 0 &&
+     (convert.buf = allocateMemory(MEMORY_AUDIO, (size_t)length * convert.len_mult)) != NULL)
+  {
+    memcpy(convert.buf, data, length);
+    convert.len = (int)length;
+
+    if(SDL_ConvertAudio(&convert) == 0)
+    {
+      samples = (float *)convert.buf;
+      *o_length = convert.len_cvt / (int)sizeof(float);
+    }
+    else
+    {
+      freeMemory(convert.buf);
+    }
+  }
+
+  SDL_FreeWAV(data);
+  trackMemory(MEMORY_AUDIO, -(long)length);
+
+  return samples;
+}
+
+///
+/// \brief MakeTone Synthesises a tone that fades out over its length
+/// \return The samples, to be freed by the caller, or NULL if they could not be allocated
+///
+static float *makeTone(const Tone *_tone,
+                       int _rate,
+                       int *o_length)
+{
+  const int c_length = (int)(_tone->seconds * _rate);
+  float *samples = allocateMemory(MEMORY_AUDIO, c_length * sizeof(float));
+
+  *o_length = 0;
+
+  if(samples == NULL)
+  {
+    return NULL;
+  }
+
+  const float c_twoPi = 6.2831853f;
+  float phase = 0.0f;
+
+  for(int i = 0; i < c_length; ++i)
+  {
+    const float c_progress = (float)i / c_length;
+    const float c_hz = _tone->startHz + (_tone->endHz - _tone->startHz) * c_progress;
+
+    phase += c_twoPi * c_hz / _rate;
+    if(phase > c_twoPi)
+    {
+      phase -= c_twoPi;
+    }
+
+    samples[i] = sinf(phase) * (1.0f - c_progress) * 0.5f;
+  }
+
+  *o_length = c_length;
+
+  return samples;
+}
@@ -0,0 +1,94 @@
+#ifndef MIXER_H
+#define MIXER_H
+
+#include <stdbool.h>
+
+#include "utils.h"
+
+#define MIXER_RATE          (48000)
+#define MIXER_BUFFER_FRAMES (512)   // About 10ms at MIXER_RATE
+#define MIXER_VOICES        (16)    // Sounds playing at once, any more are dropped
+#define MIXER_QUEUE_SIZE    (64)    // Play commands waiting for the audio thread, a power of 2
+
+typedef enum{
+  SOUND_EAT,
+  SOUND_DEATH,
+  SOUND_GAME_OVER,
+  SOUND_TOTAL
+} Sound;
+
+// A request from the game thread to start a sound
+typedef struct MixerCommand{
+  Sound sound;
+  float gain;   // 0 to 1
+  float pan;    // -1 left to 1 right
+} MixerCommand;
+
+// A sound being played by the audio thread
+typedef struct Voice{
+  const float *samples;
+  int remaining;    // Frames left to play
+  float left;       // Gain of each channel
+  float right;
+} Voice;
+
+// Plays sounds through an SDL audio callback. Every sound is decoded once when the mixer
+// starts into one block of mono float samples at the device's rate, so playing a sound
+// only ever points a voice at it. The game thread posts play commands through a single
+// producer, single consumer ring that the callback drains, neither thread ever waits on
+// the other, and the callback allocates nothing
+typedef struct Mixer{
+  SDL_AudioDeviceID device;
+  int rate;
+  int bufferFrames;
+
+  // The sound bank, every sound one after another
+  float *bank;
+  int soundStart[SOUND_TOTAL];
+  int soundLength[SOUND_TOTAL];
+
+  // Written only by the game thread, commandHead is published after the command is written
+  MixerCommand commands[MIXER_QUEUE_SIZE];
+  SDL_atomic_t commandHead;
+  SDL_atomic_t commandTail;   // Written only by the audio thread
+
+  // Only touched by the audio thread
+  Voice voices[MIXER_VOICES];
+  int voiceCount;
+  Uint64 startTime;           // Performance counter when the first buffer was mixed
+  Uint64 framesMixed;
+
+  SDL_atomic_t underruns;     // Times the device ran out of samples before the callback caught up
+  SDL_atomic_t dropped;       // Commands lost to a full queue or no free voice
+} Mixer;
+
+///
+/// \brief StartMixer Opens the default audio device, decodes the sound bank and starts playing.
+/// Each sound is read from <name>.wav (eat, death, gameover) next to the other assets if it
+/// is there, otherwise a short tone is made for it
+/// \param o_mixer
+/// \return False if there is no audio device or the bank could not be allocated, the game
+/// carries on without sound
+///
+bool startMixer(Mixer *o_mixer);
+
+///
+/// \brief StopMixer Closes the device and reports how often it underran
+///
+void stopMixer(Mixer *io_mixer);
+
+///
+/// \brief PlaySound Called from the game thread only, never waits
+/// \param io_mixer
+/// \param _sound
+/// \param _gain 0 to 1
+/// \param _pan -1 for fully left to 1 for fully right
+///
+void playSound(Mixer *io_mixer, Sound _sound, float _gain, float _pan);
+
+///
+/// \brief GetMixerUnderruns Safe to call from any thread
+///
+int getMixerUnderruns(Mixer *_mixer);
+
+#endif // MIXER_H
@@ -0,0 +1,163 @@
+#include "neighbours.h"
+
+static int getCell(const NeighbourGrid *_grid, int _x, int _y);
+static int clampCell(int _cell, int _total);
+static int minInt(int _a, int _b);
+
+void buildNeighbourGrid(NeighbourGrid *o_grid,
+                        const int _x[],
+                        const int _y[],
+                        int _count)
+{
+  o_grid->cols = (WIDTH + NEIGHBOUR_CELL_SIZE - 1) / NEIGHBOUR_CELL_SIZE;
+  o_grid->rows = (HEIGHT + NEIGHBOUR_CELL_SIZE - 1) / NEIGHBOUR_CELL_SIZE;
+  o_grid->count = (_count < NEIGHBOUR_CAPACITY) ? _count : NEIGHBOUR_CAPACITY;
+
+  const int c_cells = o_grid->cols * o_grid->rows;
+
+  // Count the points in each cell, then add them up so each cell holds where it ends
+  for(int c = 0; c < c_cells; ++c)
+  {
+    o_grid->cellStart[c] = 0;
+  }
+
+  for(int i = 0; i < o_grid->count; ++i)
+  {
+    o_grid->cellStart[getCell(o_grid, _x[i], _y[i])]++;
+  }
+
+  for(int c = 1; c < c_cells; ++c)
+  {
+    o_grid->cellStart[c] += o_grid->cellStart[c - 1];
+  }
+
+  // Fill each cell from its end backwards, which leaves each one holding where it starts
+  for(int i = o_grid->count - 1; i >= 0; --i)
+  {
+    const int c_slot = --o_grid->cellStart[getCell(o_grid, _x[i], _y[i])];
+
+    o_grid->x[c_slot] = _x[i];
+    o_grid->y[c_slot] = _y[i];
+    o_grid->index[c_slot] = i;
+  }
+
+  o_grid->cellStart[c_cells] = o_grid->count;
+}
+
+int findNearestNeighbours(const NeighbourGrid *_grid,
+                          int _x,
+                          int _y,
+                          int _radius,
+                          int _exclude,
+                          int _k,
+                          int o_neighbours[],
+                          int o_distances[])
+{
+  const int c_cell = getCell(_grid, _x, _y);
+  const int c_col = c_cell % _grid->cols;
+  const int c_row = c_cell / _grid->cols;
+  const int c_radiusSq = _radius * _radius;
+  const int c_maxRing = (_grid->cols > _grid->rows) ? _grid->cols : _grid->rows;
+
+  int found = 0;
+
+  for(int ring = 0; ring < c_maxRing; ++ring)
+  {
+    // Nothing in this ring or beyond is nearer than the closest edge of the rings inside it
+    int nearest = 0;
+    if(ring > 0)
+    {
+      const int c_inside = ring - 1;
+      nearest = _x - (c_col - c_inside) * NEIGHBOUR_CELL_SIZE;
+      nearest = minInt(nearest, (c_col + c_inside + 1) * NEIGHBOUR_CELL_SIZE - _x);
+      nearest = minInt(nearest, _y - (c_row - c_inside) * NEIGHBOUR_CELL_SIZE);
+      nearest = minInt(nearest, (c_row + c_inside + 1) * NEIGHBOUR_CELL_SIZE - _y);
+      nearest = (nearest > 0) ? nearest : 0;
+    }
+    const int c_nearestSq = nearest * nearest;
+
+    if(c_nearestSq > c_radiusSq || (found == _k && c_nearestSq >= o_distances[found - 1]))
+    {
+      break;
+    }
+
+    for(int row = c_row - ring; row <= c_row + ring; ++row)
+    {
+      if(row < 0 || row >= _grid->rows)
+      {
+        continue;
+      }
+
+      // Only the edge of the ring, the inside has been searched already
+      const bool c_isEdgeRow = (row == c_row - ring || row == c_row + ring);
+      const int c_step = c_isEdgeRow ? 1 : ring * 2;
+
+      for(int col = c_col - ring; col <= c_col + ring; col += (c_step > 0 ? c_step : 1))
+      {
+        if(col < 0 || col >= _grid->cols)
+        {
+          continue;
+        }
+
+        const int c_searched = row * _grid->cols + col;
+
+        for(int i = _grid->cellStart[c_searched]; i < _grid->cellStart[c_searched + 1]; ++i)
+        {
+          const int c_dx = _grid->x[i] - _x;
+          const int c_dy = _grid->y[i] - _y;
+          const int c_distanceSq = c_dx * c_dx + c_dy * c_dy;
+
+          if(_grid->index[i] == _exclude || c_distanceSq > c_radiusSq ||
+             (found == _k && c_distanceSq >= o_distances[found - 1]))
+          {
+            continue;
+          }
+
+          // Insert in order, pushing the furthest off the end once there are _k
+          int at = (found < _k) ? found++ : _k - 1;
+
+          while(at > 0 && o_distances[at - 1] > c_distanceSq)
+          {
+            o_neighbours[at] = o_neighbours[at - 1];
+            o_distances[at] = o_distances[at - 1];
+            --at;
+          }
+
+          o_neighbours[at] = _grid->index[i];
+          o_distances[at] = c_distanceSq;
+        }
+      }
+    }
+  }
+
+  return found;
+}
+
+///
+/// \brief GetCell Finds the cell a position is in. Positions off the edge of the arena are
+/// put in the nearest edge cell, which only makes them further from the cells a query
+/// expects them to be in, so the search never stops too early
+///
+static int getCell(const NeighbourGrid *_grid,
+                   int _x,
+                   int _y)
+{
+  const int c_col = clampCell(floorDiv(_x, NEIGHBOUR_CELL_SIZE), _grid->cols);
+  const int c_row = clampCell(floorDiv(_y, NEIGHBOUR_CELL_SIZE), _grid->rows);
+
+  return c_row * _grid->cols + c_col;
+}
+
+static int clampCell(int _cell,
+                     int _total)
+{
+  if(_cell < 0)       { return 0; }
+  if(_cell >= _total) { return _total - 1; }
+  return _cell;
+}
+
+static int minInt(int _a,
+                  int _b)
+{
+  return (_a < _b) ? _a : _b;
+}
@@ -0,0 +1,51 @@
+#ifndef NEIGHBOURS_H
+#define NEIGHBOURS_H
+
+#include "pickup.h"
+
+#define NEIGHBOUR_CELL_SIZE (64)            // Pixels, about the size of a knight
+#define NEIGHBOUR_MAX_CELLS (256)           // Enough for the 800x600 arena
+#define NEIGHBOUR_CAPACITY  (PICKUP_TOTAL)  // Points a grid can hold
+
+// Finds the points nearest a position without looking at every point. Points are bucketed
+// into square cells with a counting sort, so a rebuild is linear and needs no allocation,
+// and a query searches outwards a ring of cells at a time, stopping once no unvisited cell
+// can hold anything closer. Small enough to rebuild on the stack every time it is needed
+typedef struct NeighbourGrid{
+  int cols;
+  int rows;
+  int count;
+
+  // The points of cell c are at cellStart[c] up to cellStart[c + 1] in the arrays below,
+  // which are sorted by cell so the points of a cell are next to each other in memory
+  int cellStart[NEIGHBOUR_MAX_CELLS + 1];
+  int x[NEIGHBOUR_CAPACITY];
+  int y[NEIGHBOUR_CAPACITY];
+  int index[NEIGHBOUR_CAPACITY];    // Where each point was in the arrays it was built from
+} NeighbourGrid;
+
+///
+/// \brief BuildNeighbourGrid Buckets every point, replacing whatever the grid held
+/// \param o_grid
+/// \param _x
+/// \param _y
+/// \param _count At most NEIGHBOUR_CAPACITY, any more are left out
+///
+void buildNeighbourGrid(NeighbourGrid *o_grid, const int _x[], const int _y[], int _count);
+
+///
+/// \brief FindNearestNeighbours Finds up to _k points within _radius of a position
+/// \param _grid
+/// \param _x
+/// \param _y
+/// \param _radius
+/// \param _exclude Index of a point to leave out, such as the one asking, or -1
+/// \param _k
+/// \param o_neighbours Indices of the points found, nearest first
+/// \param o_distances Squared distance to each
+/// \return How many were found
+///
+int findNearestNeighbours(const NeighbourGrid *_grid, int _x, int _y, int _radius, int _exclude,
+                          int _k, int o_neighbours[], int o_distances[]);
+
+#endif // NEIGHBOURS_H
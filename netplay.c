@@ -0,0 +1,502 @@
+// getaddrinfo and friends are POSIX rather than C99
+#define _POSIX_C_SOURCE 200112L
+
+#include "netplay.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "statehash.h"
+
+#define NETPLAY_MAGIC     (0x534E4B31u)   // "SNK1"
+#define NETPLAY_NO_HASH   (0xFFFFFFFFu)
+#define NETPLAY_SAVES     (NETPLAY_MAX_ROLLBACK + 1)
+
+// Everything in a packet is little endian:
+// magic u32, first tick u32, input count u8, inputs u8 * count,
+// ack tick u32, hash tick u32, hash u64
+#define NETPLAY_PACKET_MAX (4 + 4 + 1 + NETPLAY_INPUT_WINDOW + 4 + 4 + 8)
+
+static void simulateTick(Netplay *io_netplay, Game *io_game, unsigned int _tick);
+static void rollback(Netplay *io_netplay, Game *io_game);
+static void updateFinalHashes(Netplay *io_netplay);
+static void receiveInputs(Netplay *io_netplay);
+static void readPacket(Netplay *io_netplay, const Uint8 *_packet, int _size);
+static bool isPeer(const Netplay *_netplay, const struct sockaddr_storage *_from);
+static void sendInputs(Netplay *io_netplay);
+static void writeU32(Uint8 *o_bytes, Uint32 _value);
+static Uint32 readU32(const Uint8 *_bytes);
+
+bool startNetplay(Netplay *o_netplay,
+                  int _port,
+                  const char *_address)
+{
+  const bool c_isHost = (_address == NULL);
+
+  o_netplay->localPlayer = c_isHost ? 0 : 1;
+  o_netplay->remotePlayer = c_isHost ? 1 : 0;
+  o_netplay->peerAddressSize = 0;
+
+  if(!c_isHost)
+  {
+    // Split "host:port" at the last colon
+    char host[256];
+    const char *c_colon = strrchr(_address, ':');
+    const size_t c_hostLength = c_colon ? (size_t)(c_colon - _address) : 0;
+
+    if(c_colon == NULL || c_hostLength == 0 || c_hostLength >= sizeof(host))
+    {
+      printf("--join expects an address like 127.0.0.1:7000\n");
+      return false;
+    }
+
+    memcpy(host, _address, c_hostLength);
+    host[c_hostLength] = '\0';
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    struct addrinfo *result = NULL;
+    if(getaddrinfo(host, c_colon + 1, &hints, &result) != 0 || result == NULL)
+    {
+      printf("Unable to find %s\n", _address);
+      return false;
+    }
+
+    memcpy(o_netplay->peerAddress, result->ai_addr, result->ai_addrlen);
+    o_netplay->peerAddressSize = (int)result->ai_addrlen;
+    freeaddrinfo(result);
+  }
+
+  o_netplay->socket = socket(AF_INET, SOCK_DGRAM, 0);
+
+  if(o_netplay->socket < 0)
+  {
+    printf("Unable to open a UDP socket: %s\n", strerror(errno));
+    return false;
+  }
+
+  // Joining binds to any free port, the host learns it from the first packet
+  struct sockaddr_in local;
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_addr.s_addr = htonl(INADDR_ANY);
+  local.sin_port = htons((Uint16)_port);
+
+  // Never block the simulation thread waiting for the network
+  if(bind(o_netplay->socket, (struct sockaddr *)&local, sizeof(local)) != 0 ||
+     fcntl(o_netplay->socket, F_SETFL, fcntl(o_netplay->socket, F_GETFL, 0) | O_NONBLOCK) != 0)
+  {
+    printf("Unable to listen on port %d: %s\n", _port, strerror(errno));
+    close(o_netplay->socket);
+    return false;
+  }
+
+  o_netplay->tick = 0;
+  o_netplay->confirmedTick = -1;
+  o_netplay->peerAckTick = 0;
+  o_netplay->rollbackTick = -1;
+  o_netplay->finalTick = -1;
+
+  for(int i = 0; i < NETPLAY_HISTORY; ++i)
+  {
+    o_netplay->localInputs[i] = NOTMOVING;
+    o_netplay->remoteInputs[i] = NOTMOVING;
+    o_netplay->usedInputs[i] = NOTMOVING;
+    o_netplay->finalHashes[i] = 0;
+  }
+
+  for(int i = 0; i < NETPLAY_SAVES; ++i)
+  {
+    initialiseGameSave(&o_netplay->saves[i]);
+    o_netplay->saveHashes[i] = 0;
+  }
+
+  o_netplay->rollbacks = 0;
+  o_netplay->resimulatedTicks = 0;
+  o_netplay->stalledTicks = 0;
+  o_netplay->desyncs = 0;
+  o_netplay->worstRollback = 0;
+
+  if(c_isHost)
+  {
+    printf("Waiting for player 2 on port %d\n", _port);
+  }
+
+  return true;
+}
+
+void stopNetplay(Netplay *io_netplay)
+{
+  close(io_netplay->socket);
+
+  for(int i = 0; i < NETPLAY_SAVES; ++i)
+  {
+    freeGameSave(&io_netplay->saves[i]);
+  }
+
+  printf("Netplay: %u rollbacks replaying %u ticks (slowest %.0fus), stalled %u ticks, %u desyncs\n",
+         io_netplay->rollbacks, io_netplay->resimulatedTicks,
+         (double)io_netplay->worstRollback * 1000000.0 / (double)SDL_GetPerformanceFrequency(),
+         io_netplay->stalledTicks, io_netplay->desyncs);
+}
+
+bool advanceNetplay(Netplay *io_netplay,
+                    Game *io_game,
+                    Move _localMove)
+{
+  receiveInputs(io_netplay);
+
+  if(io_netplay->rollbackTick >= 0)
+  {
+    rollback(io_netplay, io_game);
+  }
+
+  updateFinalHashes(io_netplay);
+
+  // Any further ahead and a late input could need more rewinding than there are saves for
+  if((int)io_netplay->tick > io_netplay->confirmedTick + NETPLAY_MAX_ROLLBACK)
+  {
+    io_netplay->stalledTicks++;
+    sendInputs(io_netplay);
+    return false;
+  }
+
+  io_netplay->localInputs[io_netplay->tick % NETPLAY_HISTORY] = _localMove;
+
+  simulateTick(io_netplay, io_game, io_netplay->tick);
+  io_netplay->tick++;
+
+  sendInputs(io_netplay);
+
+  return true;
+}
+
+const GameSave *getFinalSave(const Netplay *_netplay,
+                             int _tick)
+{
+  // Before the first tick finalTick is -1, which has no save
+  if(_tick < 0 || _tick > _netplay->finalTick || _tick < (int)_netplay->tick - NETPLAY_SAVES)
+  {
+    return NULL;
+  }
+
+  return &_netplay->saves[_tick % NETPLAY_SAVES];
+}
+
+///
+/// \brief SimulateTick Saves the match, then plays one tick with the local input and
+/// either the remote input or, if it hasn't arrived, a guess that it hasn't changed
+///
+static void simulateTick(Netplay *io_netplay,
+                         Game *io_game,
+                         unsigned int _tick)
+{
+  const int c_slot = _tick % NETPLAY_SAVES;
+
+  saveGame(&io_netplay->saves[c_slot], io_game);
+  io_netplay->saveHashes[c_slot] = getGameHash(io_game);
+
+  Move remoteMove = NOTMOVING;
+
+  if((int)_tick <= io_netplay->confirmedTick)
+  {
+    remoteMove = io_netplay->remoteInputs[_tick % NETPLAY_HISTORY];
+  }
+  else if(io_netplay->confirmedTick >= 0)
+  {
+    remoteMove = io_netplay->remoteInputs[io_netplay->confirmedTick % NETPLAY_HISTORY];
+  }
+
+  io_netplay->usedInputs[_tick % NETPLAY_HISTORY] = remoteMove;
+
+  Move moves[PLAYER_TOTAL];
+  moves[io_netplay->localPlayer] = io_netplay->localInputs[_tick % NETPLAY_HISTORY];
+  moves[io_netplay->remotePlayer] = remoteMove;
+
+  // Checked against the simulated state so both peers agree on it
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    if(isOppositeMove(io_game->players[p].head->idleDirection, moves[p]))
+    {
+      moves[p] = NOTMOVING;
+    }
+  }
+
+  updateGame(io_game, moves);
+}
+
+///
+/// \brief Rollback Rewinds to the first tick that used a wrong prediction and plays
+/// forwards to where the match was, saving each tick again on the way
+///
+static void rollback(Netplay *io_netplay,
+                     Game *io_game)
+{
+  const Uint64 c_start = SDL_GetPerformanceCounter();
+  const unsigned int c_from = (unsigned int)io_netplay->rollbackTick;
+
+  restoreGame(io_game, &io_netplay->saves[c_from % NETPLAY_SAVES]);
+
+  for(unsigned int t = c_from; t < io_netplay->tick; ++t)
+  {
+    simulateTick(io_netplay, io_game, t);
+  }
+
+  const Uint64 c_time = SDL_GetPerformanceCounter() - c_start;
+  if(c_time > io_netplay->worstRollback)
+  {
+    io_netplay->worstRollback = c_time;
+  }
+
+  io_netplay->rollbacks++;
+  io_netplay->resimulatedTicks += io_netplay->tick - c_from;
+  io_netplay->rollbackTick = -1;
+}
+
+///
+/// \brief UpdateFinalHashes Records the hash of every saved tick that every input before
+/// it is now known for, which no later rollback can change
+///
+static void updateFinalHashes(Netplay *io_netplay)
+{
+  const int c_oldest = (int)io_netplay->tick - NETPLAY_SAVES;
+  int last = io_netplay->confirmedTick + 1;
+
+  if(last > (int)io_netplay->tick - 1)
+  {
+    last = (int)io_netplay->tick - 1;
+  }
+
+  for(int t = io_netplay->finalTick + 1; t <= last; ++t)
+  {
+    if(t >= c_oldest)
+    {
+      io_netplay->finalHashes[t % NETPLAY_HISTORY] = io_netplay->saveHashes[t % NETPLAY_SAVES];
+    }
+  }
+
+  if(last > io_netplay->finalTick)
+  {
+    io_netplay->finalTick = last;
+  }
+}
+
+static void receiveInputs(Netplay *io_netplay)
+{
+  Uint8 packet[NETPLAY_PACKET_MAX];
+  struct sockaddr_storage from;
+
+  for(;;)
+  {
+    socklen_t fromSize = sizeof(from);
+    const ssize_t c_size = recvfrom(io_netplay->socket, packet, sizeof(packet), 0,
+                                    (struct sockaddr *)&from, &fromSize);
+
+    if(c_size < 0)
+    {
+      // EWOULDBLOCK once everything waiting has been read
+      return;
+    }
+
+    // The host plays whoever gets in touch first
+    if(io_netplay->peerAddressSize == 0)
+    {
+      memcpy(io_netplay->peerAddress, &from, fromSize);
+      io_netplay->peerAddressSize = (int)fromSize;
+      printf("Player 2 has joined\n");
+    }
+    else if(!isPeer(io_netplay, &from))
+    {
+      // Someone else guessing the port, their inputs would desync us
+      continue;
+    }
+
+    readPacket(io_netplay, packet, (int)c_size);
+  }
+}
+
+///
+/// \brief IsPeer Whether a datagram came from the address and port we are playing against
+///
+static bool isPeer(const Netplay *_netplay,
+                   const struct sockaddr_storage *_from)
+{
+  // Copied out as the byte array has no alignment guarantee
+  struct sockaddr_storage peer;
+
+  memset(&peer, 0, sizeof(peer));
+  memcpy(&peer, _netplay->peerAddress, (size_t)_netplay->peerAddressSize);
+
+  const struct sockaddr_storage *c_peer = &peer;
+
+  if(_from->ss_family != c_peer->ss_family)
+  {
+    return false;
+  }
+
+  // Compared field by field, the padding in the structs is not guaranteed to be zeroed
+  if(_from->ss_family == AF_INET)
+  {
+    const struct sockaddr_in *c_a = (const struct sockaddr_in *)_from;
+    const struct sockaddr_in *c_b = (const struct sockaddr_in *)c_peer;
+
+    return c_a->sin_port == c_b->sin_port && c_a->sin_addr.s_addr == c_b->sin_addr.s_addr;
+  }
+
+  if(_from->ss_family == AF_INET6)
+  {
+    const struct sockaddr_in6 *c_a = (const struct sockaddr_in6 *)_from;
+    const struct sockaddr_in6 *c_b = (const struct sockaddr_in6 *)c_peer;
+
+    return c_a->sin6_port == c_b->sin6_port &&
+           memcmp(&c_a->sin6_addr, &c_b->sin6_addr, sizeof(c_a->sin6_addr)) == 0;
+  }
+
+  return false;
+}
+
+///
+/// \brief ReadPacket Takes any remote inputs that carry on from the last one received,
+/// and flags a rollback if a tick was already played with a different guess
+///
+static void readPacket(Netplay *io_netplay,
+                       const Uint8 *_packet,
+                       int _size)
+{
+  if(_size < 9 || readU32(_packet) != NETPLAY_MAGIC)
+  {
+    return;
+  }
+
+  const int c_first = (int)readU32(_packet + 4);
+  const int c_count = _packet[8];
+
+  if(c_count > NETPLAY_INPUT_WINDOW || _size != 9 + c_count + 16)
+  {
+    return;
+  }
+
+  // Inputs go straight into the simulation, so a corrupt one drops the whole packet
+  for(int i = 0; i < c_count; ++i)
+  {
+    const int c_move = (int)_packet[9 + i] - 1;
+
+    if(c_move < NOTMOVING || c_move > DOWNRIGHT)
+    {
+      return;
+    }
+  }
+
+  for(int i = 0; i < c_count; ++i)
+  {
+    const int c_tick = c_first + i;
+
+    // Inputs are always resent from the last acknowledged one, so there are never gaps to fill
+    if(c_tick != io_netplay->confirmedTick + 1)
+    {
+      continue;
+    }
+
+    const Move c_move = (Move)((int)_packet[9 + i] - 1);
+
+    io_netplay->remoteInputs[c_tick % NETPLAY_HISTORY] = c_move;
+    io_netplay->confirmedTick = c_tick;
+
+    if(c_tick < (int)io_netplay->tick &&
+       io_netplay->usedInputs[c_tick % NETPLAY_HISTORY] != c_move &&
+       (io_netplay->rollbackTick < 0 || c_tick < io_netplay->rollbackTick))
+    {
+      io_netplay->rollbackTick = c_tick;
+    }
+  }
+
+  const Uint8 *c_tail = _packet + 9 + c_count;
+  const int c_ack = (int)readU32(c_tail);
+  const Uint32 c_hashTick = readU32(c_tail + 4);
+  const Uint64 c_hash = ((Uint64)readU32(c_tail + 12) << 32) | readU32(c_tail + 8);
+
+  if(c_ack > io_netplay->peerAckTick)
+  {
+    io_netplay->peerAckTick = c_ack;
+  }
+
+  // Compare with our own final hash for the same tick, if it's still in the history
+  if(c_hashTick != NETPLAY_NO_HASH &&
+     (int)c_hashTick <= io_netplay->finalTick &&
+     (int)c_hashTick > io_netplay->finalTick - NETPLAY_HISTORY &&
+     io_netplay->finalHashes[c_hashTick % NETPLAY_HISTORY] != c_hash)
+  {
+    if(io_netplay->desyncs == 0)
+    {
+      printf("Netplay desync detected at tick %u\n", c_hashTick);
+    }
+
+    io_netplay->desyncs++;
+  }
+}
+
+///
+/// \brief SendInputs Sends every local input the peer hasn't acknowledged, up to the window,
+/// so a lost packet is covered by the next one
+///
+static void sendInputs(Netplay *io_netplay)
+{
+  if(io_netplay->peerAddressSize == 0)
+  {
+    return;
+  }
+
+  Uint8 packet[NETPLAY_PACKET_MAX];
+
+  int first = io_netplay->peerAckTick;
+  int count = (int)io_netplay->tick - first;
+
+  if(count > NETPLAY_INPUT_WINDOW)
+  {
+    count = NETPLAY_INPUT_WINDOW;
+  }
+
+  writeU32(packet, NETPLAY_MAGIC);
+  writeU32(packet + 4, (Uint32)first);
+  packet[8] = (Uint8)count;
+
+  for(int i = 0; i < count; ++i)
+  {
+    packet[9 + i] = (Uint8)(io_netplay->localInputs[(first + i) % NETPLAY_HISTORY] + 1);
+  }
+
+  Uint8 *tail = packet + 9 + count;
+  const Uint64 c_hash = (io_netplay->finalTick >= 0) ? io_netplay->finalHashes[io_netplay->finalTick % NETPLAY_HISTORY] : 0;
+
+  writeU32(tail, (Uint32)(io_netplay->confirmedTick + 1));
+  writeU32(tail + 4, (io_netplay->finalTick >= 0) ? (Uint32)io_netplay->finalTick : NETPLAY_NO_HASH);
+  writeU32(tail + 8, (Uint32)c_hash);
+  writeU32(tail + 12, (Uint32)(c_hash >> 32));
+
+  // A full socket buffer just loses this packet, the next one repeats it
+  sendto(io_netplay->socket, packet, 9 + count + 16, 0,
+         (const struct sockaddr *)io_netplay->peerAddress, (socklen_t)io_netplay->peerAddressSize);
+}
+
+static void writeU32(Uint8 *o_bytes,
+                     Uint32 _value)
+{
+  o_bytes[0] = (Uint8)(_value);
+  o_bytes[1] = (Uint8)(_value >> 8);
+  o_bytes[2] = (Uint8)(_value >> 16);
+  o_bytes[3] = (Uint8)(_value >> 24);
+}
+
+static Uint32 readU32(const Uint8 *_bytes)
+{
+  return (Uint32)_bytes[0] | ((Uint32)_bytes[1] << 8) | ((Uint32)_bytes[2] << 16) | ((Uint32)_bytes[3] << 24);
+}
@@ -0,0 +1,86 @@
+#ifndef NETPLAY_H
+#define NETPLAY_H
+
+#include <stdbool.h>
+
+#include "game.h"
+
+// Ticks the local game may run ahead of the last input received from the peer,
+// and so the furthest it ever has to rewind
+#define NETPLAY_MAX_ROLLBACK  (8)
+// Unacknowledged local inputs resent in every packet
+#define NETPLAY_INPUT_WINDOW  (16)
+// Inputs and hashes are kept for this many ticks, more than the window plus the rollback
+#define NETPLAY_HISTORY       (64)
+
+// Two player play over UDP. Each peer runs the whole match itself, sending only its own
+// player's input for every tick. The peer's input is predicted to stay the same until it
+// arrives, and if the prediction was wrong the match is rewound to that tick and played
+// forwards again with the real input, all within one tick
+typedef struct Netplay{
+  int socket;
+  Uint8 peerAddress[128];   // struct sockaddr_storage, kept opaque so the header has no socket includes
+  int peerAddressSize;      // 0 until the host has heard from the peer
+  int localPlayer;
+  int remotePlayer;
+
+  unsigned int tick;        // Next tick to simulate
+  int confirmedTick;        // Last tick whose remote input has arrived, -1 before any
+  int peerAckTick;          // Local inputs before this tick have reached the peer
+  int rollbackTick;         // Earliest tick simulated with a wrong prediction, -1 if none
+
+  Move localInputs[NETPLAY_HISTORY];
+  Move remoteInputs[NETPLAY_HISTORY];   // Only valid up to confirmedTick
+  Move usedInputs[NETPLAY_HISTORY];     // What each tick was simulated with for the remote player
+
+  GameSave saves[NETPLAY_MAX_ROLLBACK + 1];  // The match before each of the last few ticks
+  Uint64 saveHashes[NETPLAY_MAX_ROLLBACK + 1];
+
+  // Hash of the match before each tick once no rollback can change it, swapped with the
+  // peer to catch desyncs
+  Uint64 finalHashes[NETPLAY_HISTORY];
+  int finalTick;
+
+  // Stats, reported when netplay stops
+  unsigned int rollbacks;
+  unsigned int resimulatedTicks;
+  unsigned int stalledTicks;
+  unsigned int desyncs;
+  Uint64 worstRollback;     // Performance counter ticks for the slowest rewind and replay
+} Netplay;
+
+///
+/// \brief StartNetplay Opens the UDP socket. The host is player 1 and waits for the peer
+/// to get in touch, the peer joining it is player 2
+/// \param o_netplay
+/// \param _port Port to listen on when hosting, 0 when joining
+/// \param _address "host:port" to join, NULL when hosting
+/// \return False if the socket could not be opened or the address was not found
+///
+bool startNetplay(Netplay *o_netplay, int _port, const char *_address);
+
+///
+/// \brief StopNetplay Closes the socket and prints the rollback stats
+///
+void stopNetplay(Netplay *io_netplay);
+
+///
+/// \brief AdvanceNetplay Reads the peer's inputs, rewinds and replays if any prediction
+/// was wrong, then plays the next tick with _localMove unless the peer is too far behind
+/// \param io_netplay
+/// \param io_game
+/// \param _localMove This peer's input for the next tick
+/// \return False if the game was not advanced because it is waiting for the peer
+///
+bool advanceNetplay(Netplay *io_netplay, Game *io_game, Move _localMove);
+
+///
+/// \brief GetFinalSave The match before _tick, once every input before it has arrived
+/// so no rollback can change it
+/// \param _netplay
+/// \param _tick
+/// \return NULL if _tick is not final yet, or its save has already been reused
+///
+const GameSave *getFinalSave(const Netplay *_netplay, int _tick);
+
+#endif // NETPLAY_H
@@ -0,0 +1,152 @@
+#include "observation.h"
+
+#include <string.h>
+
+#include "allocator.h"
+
+static int wrapDelta(int _delta, int _period);
+static void stampRect(Observation *io_obs,
+                      Uint8 *io_plane,
+                      const SDL_Rect *_rect,
+                      const SDL_Point *_centre);
+
+bool createObservation(Observation *o_obs,
+                       int _resolution,
+                       int _cellSize)
+{
+  o_obs->resolution = _resolution;
+  o_obs->cellSize = _cellSize;
+  o_obs->grid = NULL;
+
+  if(_resolution <= 0 || _resolution > OBS_RESOLUTION_MAX || _cellSize <= 0)
+  {
+    return false;
+  }
+
+  o_obs->grid = allocateMemory(MEMORY_AI, OBS_CHANNEL_TOTAL * _resolution * _resolution);
+
+  return o_obs->grid != NULL;
+}
+
+void freeObservation(Observation *io_obs)
+{
+  freeMemory(io_obs->grid);
+  io_obs->grid = NULL;
+}
+
+Uint8 *getObservationPlane(Observation *_obs,
+                           ObservationChannel _channel)
+{
+  if(_obs->grid == NULL || (int)_channel < 0 || _channel >= OBS_CHANNEL_TOTAL)
+  {
+    return NULL;
+  }
+
+  return _obs->grid + _channel * _obs->resolution * _obs->resolution;
+}
+
+void rasteriseObservation(Observation *io_obs,
+                          Node *_self,
+                          Node *const *_others,
+                          int _otherCount,
+                          const Pickups *_pickups)
+{
+  const int c_planeSize = io_obs->resolution * io_obs->resolution;
+
+  memset(io_obs->grid, 0, OBS_CHANNEL_TOTAL * c_planeSize);
+
+  if(_self == NULL)
+  {
+    return;
+  }
+
+  SDL_Point centre = { _self->pos.x + _self->pos.w/2,
+                       _self->pos.y + _self->pos.h/2 };
+
+  Uint8 *plane = getObservationPlane(io_obs, OBS_OWN_BODY);
+  for(Node *node = _self; node != NULL; node = node->next)
+  {
+    stampRect(io_obs, plane, &node->pos, &centre);
+  }
+
+  plane = getObservationPlane(io_obs, OBS_OTHER_BODY);
+  for(int i = 0; i < _otherCount; ++i)
+  {
+    for(Node *node = _others[i]; node != NULL; node = node->next)
+    {
+      stampRect(io_obs, plane, &node->pos, &centre);
+    }
+  }
+
+  const Gems *c_gems = &_pickups->gems;
+
+  for(int i = 0; i < c_gems->count; ++i)
+  {
+    const SDL_Rect c_pos = { c_gems->x[i], c_gems->y[i], PICKUP_SIZE, PICKUP_SIZE };
+    stampRect(io_obs, getObservationPlane(io_obs, OBS_GEM_BLUE + c_gems->type[i]), &c_pos, &centre);
+  }
+
+  const Knights *c_knights = &_pickups->knights;
+  plane = getObservationPlane(io_obs, OBS_KNIGHT);
+
+  for(int i = 0; i < c_knights->count; ++i)
+  {
+    const SDL_Rect c_pos = { c_knights->x[i], c_knights->y[i], KNIGHT_SIZE, KNIGHT_SIZE };
+    stampRect(io_obs, plane, &c_pos, &centre);
+  }
+}
+
+///
+/// \brief WrapDelta Brings an offset into the range [-_period/2, _period/2)
+/// so the shortest way around the arena is used
+///
+static int wrapDelta(int _delta,
+                     int _period)
+{
+  _delta %= _period;
+
+  if(_delta <  -_period/2) { _delta += _period; }
+  if(_delta >=  _period/2) { _delta -= _period; }
+
+  return _delta;
+}
+
+///
+/// \brief StampRect Marks every cell that _rect covers, one memset per row
+/// \param io_obs
+/// \param io_plane The channel to write into
+/// \param _rect Arena space rectangle
+/// \param _centre Arena space point that maps to the centre of the grid
+///
+static void stampRect(Observation *io_obs,
+                      Uint8 *io_plane,
+                      const SDL_Rect *_rect,
+                      const SDL_Point *_centre)
+{
+  const int c_res = io_obs->resolution;
+  const int c_cell = io_obs->cellSize;
+
+  // moveSprite lets a sprite travel its own size past the edge before wrapping
+  const int c_relX = wrapDelta(_rect->x - _centre->x, WIDTH  + _rect->w*2);
+  const int c_relY = wrapDelta(_rect->y - _centre->y, HEIGHT + _rect->h*2);
+
+  int x0 = floorDiv(c_relX, c_cell) + c_res/2;
+  int y0 = floorDiv(c_relY, c_cell) + c_res/2;
+  int x1 = floorDiv(c_relX + _rect->w - 1, c_cell) + c_res/2;
+  int y1 = floorDiv(c_relY + _rect->h - 1, c_cell) + c_res/2;
+
+  if(x1 < 0 || y1 < 0 || x0 >= c_res || y0 >= c_res)
+  {
+    return;
+  }
+
+  if(x0 < 0)      { x0 = 0; }
+  if(y0 < 0)      { y0 = 0; }
+  if(x1 >= c_res) { x1 = c_res - 1; }
+  if(y1 >= c_res) { y1 = c_res - 1; }
+
+  for(int y = y0; y <= y1; ++y)
+  {
+    memset(io_plane + y*c_res + x0, 255, x1 - x0 + 1);
+  }
+}
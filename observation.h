@@ -0,0 +1,65 @@
+#ifndef OBSERVATION_H
+#define OBSERVATION_H
+
+#include <stdbool.h>
+
+#include "utils.h"
+#include "actor.h"
+#include "pickup.h"
+
+#define OBS_RESOLUTION_MAX (256)  // Cells along each side, larger would see the whole arena many times over
+
+// Each channel is a separate resolution*resolution plane in the grid
+typedef enum{
+  OBS_OWN_BODY    = 0,
+  OBS_OTHER_BODY  = 1,
+  OBS_GEM_BLUE    = 2,  // Gem channels follow the order of the Gem enum
+  OBS_GEM_GREEN   = 3,
+  OBS_GEM_RED     = 4,
+  OBS_GEM_CRYSTAL = 5,
+  OBS_KNIGHT      = 6,
+  OBS_CHANNEL_TOTAL
+} ObservationChannel;
+
+// A low resolution, multi-channel view of the arena centred on a snake's head
+typedef struct Observation{
+  int resolution;   // Cells along each side of a channel
+  int cellSize;     // Pixels covered by each cell
+
+  Uint8 *grid;      // OBS_CHANNEL_TOTAL planes, each resolution*resolution bytes
+} Observation;
+
+///
+/// \brief CreateObservation Allocates the grid for an observation
+/// \param o_obs The observation to set up
+/// \param _resolution Cells along each side, 1 to OBS_RESOLUTION_MAX, the head sits in the centre cell
+/// \param _cellSize How many pixels of the arena each cell covers, at least 1
+/// \return False, with a NULL grid, if either size is out of range or the grid could not be allocated
+///
+bool createObservation(Observation *o_obs, int _resolution, int _cellSize);
+void freeObservation(Observation *io_obs);
+
+///
+/// \brief GetObservationPlane
+/// \return A pointer to the first cell of the channel's plane, NULL for an unknown channel
+/// or an observation that was never created
+///
+Uint8 *getObservationPlane(Observation *_obs, ObservationChannel _channel);
+
+///
+/// \brief RasteriseObservation Clears the grid and stamps every snake segment and pickup
+/// into it, cells are 255 when covered and 0 otherwise. Positions wrap around the arena
+/// the same way moveSprite does, so the grid is always centred on _self's head
+/// \param io_obs
+/// \param _self The head of the snake the observation belongs to
+/// \param _others Heads of every other snake, NULL entries are skipped
+/// \param _otherCount
+/// \param _pickups
+///
+void rasteriseObservation(Observation *io_obs,
+                          Node *_self,
+                          Node *const *_others,
+                          int _otherCount,
+                          const Pickups *_pickups);
+
+#endif // OBSERVATION_H
@@ -0,0 +1,276 @@
+#include "options.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "observation.h"
+#include "viewports.h"
+
+bool parseOptions(int _argc,
+                  char *_argv[],
+                  Options *o_options)
+{
+  for(int i = 0; i < PLAYER_TOTAL; ++i)
+  {
+    o_options->isAIPlayer[i] = false;
+  }
+  o_options->aiBudgetUs = 2000;
+  o_options->isSoftwareRender = false;
+  o_options->isMuted = false;
+  o_options->viewportCount = 1;
+  o_options->mapPath = NULL;
+  o_options->isRespawning = false;
+  o_options->snakeLength = SNAKE_START_LENGTH;
+  o_options->tickMoves = 1;
+  o_options->capturePath = NULL;
+  o_options->tracePath = NULL;
+  o_options->feedName = NULL;
+  o_options->recordPath = NULL;
+  o_options->metricsPort = 0;
+  o_options->memoryLogSeconds = 0;
+  o_options->inspectPath = NULL;
+  o_options->inspectFrame = -1;
+  o_options->hostPort = 0;
+  o_options->joinAddress = NULL;
+
+  o_options->matchCount = 0;
+  o_options->threadCount = 0;
+  o_options->seed = 1;
+  o_options->maxTicks = 20000;
+  o_options->resultsPath = "results.csv";
+  o_options->hashLogPath = NULL;
+  o_options->isHashChecked = false;
+  o_options->observeResolution = 0;
+
+  bool isValid = true;
+
+  for(int i = 1; i < _argc; ++i)
+  {
+    const char *arg = _argv[i];
+    const bool hasValue = (i + 1 < _argc);
+
+    if(strcmp(arg, "--ai") == 0 && hasValue)
+    {
+      const int c_player = atoi(_argv[++i]);
+
+      if(c_player < 1 || c_player > PLAYER_TOTAL)
+      {
+        printf("--ai expects a player number between 1 and %d\n", PLAYER_TOTAL);
+        isValid = false;
+        break;
+      }
+
+      o_options->isAIPlayer[c_player - 1] = true;
+    }
+    else if(strcmp(arg, "--ai-budget") == 0 && hasValue)
+    {
+      o_options->aiBudgetUs = (unsigned int)strtoul(_argv[++i], NULL, 10);
+    }
+    else if(strcmp(arg, "--software-render") == 0)
+    {
+      o_options->isSoftwareRender = true;
+    }
+    else if(strcmp(arg, "--mute") == 0)
+    {
+      o_options->isMuted = true;
+    }
+    else if(strcmp(arg, "--respawn") == 0)
+    {
+      o_options->isRespawning = true;
+    }
+    else if(strcmp(arg, "--length") == 0 && hasValue)
+    {
+      o_options->snakeLength = atoi(_argv[++i]);
+
+      if(o_options->snakeLength < 1)
+      {
+        printf("--length expects at least 1 segment\n");
+        isValid = false;
+        break;
+      }
+    }
+    else if(strcmp(arg, "--tick-moves") == 0 && hasValue)
+    {
+      o_options->tickMoves = atoi(_argv[++i]);
+
+      if(o_options->tickMoves < 1 || o_options->tickMoves > GAME_TICK_MOVES_MAX)
+      {
+        printf("--tick-moves expects between 1 and %d moves\n", GAME_TICK_MOVES_MAX);
+        isValid = false;
+        break;
+      }
+    }
+    else if(strcmp(arg, "--split") == 0 && hasValue)
+    {
+      o_options->viewportCount = atoi(_argv[++i]);
+
+      if(o_options->viewportCount < 2 || o_options->viewportCount > VIEWPORT_MAX)
+      {
+        printf("--split expects between 2 and %d views\n", VIEWPORT_MAX);
+        isValid = false;
+        break;
+      }
+    }
+    else if(strcmp(arg, "--map") == 0 && hasValue)
+    {
+      o_options->mapPath = _argv[++i];
+    }
+    else if(strcmp(arg, "--capture") == 0 && hasValue)
+    {
+      o_options->capturePath = _argv[++i];
+    }
+    else if(strcmp(arg, "--trace") == 0 && hasValue)
+    {
+      o_options->tracePath = _argv[++i];
+    }
+    else if(strcmp(arg, "--feed") == 0 && hasValue)
+    {
+      o_options->feedName = _argv[++i];
+    }
+    else if(strcmp(arg, "--record") == 0 && hasValue)
+    {
+      o_options->recordPath = _argv[++i];
+    }
+    else if(strcmp(arg, "--metrics") == 0 && hasValue)
+    {
+      o_options->metricsPort = atoi(_argv[++i]);
+
+      if(o_options->metricsPort < 1 || o_options->metricsPort > 65535)
+      {
+        printf("--metrics expects a port between 1 and 65535\n");
+        isValid = false;
+        break;
+      }
+    }
+    else if(strcmp(arg, "--memory-log") == 0 && hasValue)
+    {
+      o_options->memoryLogSeconds = (unsigned int)strtoul(_argv[++i], NULL, 10);
+    }
+    else if(strcmp(arg, "--inspect") == 0 && hasValue)
+    {
+      o_options->inspectPath = _argv[++i];
+    }
+    else if(strcmp(arg, "--frame") == 0 && hasValue)
+    {
+      o_options->inspectFrame = atol(_argv[++i]);
+    }
+    else if(strcmp(arg, "--host") == 0 && hasValue)
+    {
+      o_options->hostPort = atoi(_argv[++i]);
+
+      if(o_options->hostPort < 1 || o_options->hostPort > 65535)
+      {
+        printf("--host expects a port between 1 and 65535\n");
+        isValid = false;
+        break;
+      }
+    }
+    else if(strcmp(arg, "--join") == 0 && hasValue)
+    {
+      o_options->joinAddress = _argv[++i];
+    }
+    else if(strcmp(arg, "--tournament") == 0 && hasValue)
+    {
+      o_options->matchCount = atoi(_argv[++i]);
+    }
+    else if(strcmp(arg, "--threads") == 0 && hasValue)
+    {
+      o_options->threadCount = atoi(_argv[++i]);
+    }
+    else if(strcmp(arg, "--seed") == 0 && hasValue)
+    {
+      o_options->seed = (unsigned int)strtoul(_argv[++i], NULL, 10);
+    }
+    else if(strcmp(arg, "--max-ticks") == 0 && hasValue)
+    {
+      o_options->maxTicks = (unsigned int)strtoul(_argv[++i], NULL, 10);
+    }
+    else if(strcmp(arg, "--results") == 0 && hasValue)
+    {
+      o_options->resultsPath = _argv[++i];
+    }
+    else if(strcmp(arg, "--hash-log") == 0 && hasValue)
+    {
+      o_options->hashLogPath = _argv[++i];
+    }
+    else if(strcmp(arg, "--check-hash") == 0)
+    {
+      o_options->isHashChecked = true;
+    }
+    else if(strcmp(arg, "--observe") == 0 && hasValue)
+    {
+      o_options->observeResolution = atoi(_argv[++i]);
+
+      if(o_options->observeResolution < 1 || o_options->observeResolution > OBS_RESOLUTION_MAX)
+      {
+        printf("--observe expects between 1 and %d cells\n", OBS_RESOLUTION_MAX);
+        isValid = false;
+        break;
+      }
+    }
+    else
+    {
+      isValid = false;
+      break;
+    }
+  }
+
+  if(isValid && o_options->hostPort > 0 && o_options->joinAddress != NULL)
+  {
+    printf("--host and --join can't be used together\n");
+    isValid = false;
+  }
+
+  // Whatever was wrong, show what would have been right
+  if(!isValid)
+  {
+    printUsage(_argv[0]);
+  }
+
+  return isValid;
+}
+
+bool isNetplay(const Options *_options)
+{
+  return _options->hostPort > 0 || _options->joinAddress != NULL;
+}
+
+void printUsage(const char *_program)
+{
+  printf("Usage: %s [options]\n"
+         "  --ai <player>        Let the computer control player 1 or 2, can be repeated\n"
+         "  --ai-budget <us>     Microseconds the AI may spend pathfinding each tick, 0 for no limit (default 2000)\n"
+         "  --software-render    Draw sprites with the built in SIMD blitter instead of the SDL renderer\n"
+         "  --mute               Play no sound\n"
+         "  --split <views>      Split the window into 2 to 4 views, each following a snake\n"
+         "  --map <file>         Play in an arena with the walls in a map file, see README.md\n"
+         "  --respawn            Replace collected pickups with new gems, so a match only ends on a collision\n"
+         "  --length <segments>  Body segments each snake starts with (default %d)\n"
+         "  --tick-moves <n>     Move the snakes n times a tick, in ticks n times as long, for faster tournaments\n"
+         "  --capture <file>     Record every frame, .y4m for YUV4MPEG2 otherwise raw RGBA, - for stdout\n"
+         "  --trace <file>       Write a Chrome trace (chrome://tracing or Perfetto) of every frame and tick on exit\n"
+         "  --feed <name>        Publish every tick to POSIX shared memory, such as /snakes, see feedreader.c\n"
+         "  --record <file>      Record the state of every tick, compressed, to analyse afterwards\n"
+         "  --metrics <port>     Serve live statistics in Prometheus format on 127.0.0.1:<port>/metrics\n"
+         "  --memory-log <s>     Print each subsystem's memory use every s seconds, it is always printed on exit\n"
+         "\n"
+         "Recordings:\n"
+         "  --inspect <file>     Check a recording and print the state at one frame, then exit\n"
+         "  --frame <n>          Frame for --inspect (default the last)\n"
+         "\n"
+         "Two machines over UDP, both sides must use the same --seed, --length, --tick-moves and --respawn:\n"
+         "  --host <port>        Host a match as player 1 and wait for player 2\n"
+         "  --join <host:port>   Join a hosted match as player 2\n"
+         "\n"
+         "Headless tournament, players without --ai follow a scripted random walk:\n"
+         "  --tournament <n>     Play n matches without opening a window, then exit\n"
+         "  --threads <n>        Matches to play in parallel, 0 for one per CPU (default 0)\n"
+         "  --seed <n>           Match i is seeded from n + i (default 1)\n"
+         "  --max-ticks <n>      Stop a match after n ticks (default 20000)\n"
+         "  --results <file>     Where to stream results, .jsonl for JSON lines (default results.csv)\n"
+         "  --hash-log <file>    Write the state hash of every tick of every match, to diff two runs\n"
+         "  --check-hash         Check the running state hash against a full rehash every tick (slow)\n"
+         "  --observe <cells>    Rasterise what each snake sees every tick, cells a side, and report the cost\n",
+         _program, SNAKE_START_LENGTH);
+}
@@ -0,0 +1,61 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <stdbool.h>
+
+#include "game.h"
+
+// Settings taken from the command line
+typedef struct Options{
+  bool isAIPlayer[PLAYER_TOTAL];  // Computer controlled instead of reading the keyboard
+  unsigned int aiBudgetUs;        // Time the AI may spend pathfinding per tick, 0 for no limit
+  bool isSoftwareRender;          // Blit sprites on the CPU, for machines without a GPU
+  bool isMuted;                   // Never open an audio device
+  int viewportCount;              // Split the window between this many views, 1 to VIEWPORT_MAX
+  const char *mapPath;            // Walls to load, NULL for an open arena
+  bool isRespawning;              // Replace collected pickups with new gems, matches then only end on a collision
+  int snakeLength;                // Body segments each snake starts with
+  int tickMoves;                  // Moves each snake makes a tick, 1 to GAME_TICK_MOVES_MAX
+  const char *capturePath;        // Record every frame here, NULL to not record
+  const char *tracePath;          // Write a Chrome trace of every phase here on exit, NULL to not trace
+  const char *feedName;           // Shared memory to publish every tick to, NULL to not publish
+  const char *recordPath;         // Record every tick here, NULL to not record
+  int metricsPort;                // Serve live metrics on this localhost port, 0 to not serve
+  unsigned int memoryLogSeconds;  // Print memory use this often, 0 for only on exit
+
+  // Print a summary of a recording and the state at inspectFrame (-1 for the last), then exit
+  const char *inspectPath;
+  long inspectFrame;
+
+  // Two machine play, the host is player 1 and whoever joins it is player 2
+  int hostPort;                   // Port to host on, 0 if not hosting
+  const char *joinAddress;        // host:port to join, NULL if not joining
+
+  // Headless tournament, only used when matchCount is above 0
+  int matchCount;
+  int threadCount;                // 0 uses one thread per CPU
+  unsigned int seed;              // Match n is seeded from seed + n
+  unsigned int maxTicks;          // Matches still running after this many ticks are stopped
+  const char *resultsPath;        // .jsonl writes JSON lines, anything else writes CSV
+  const char *hashLogPath;        // Write every tick's state hash here, NULL to not write them
+  bool isHashChecked;             // Compare the running state hash with a full rehash every tick
+  int observeResolution;          // Rasterise each snake's Observation every tick with this many cells a side, 0 to not
+} Options;
+
+///
+/// \brief ParseOptions Fills in the options from the command line, anything not passed keeps its default
+/// \param _argc
+/// \param _argv
+/// \param o_options
+/// \return False if an argument was not recognised, the usage has already been printed
+///
+bool parseOptions(int _argc, char *_argv[], Options *o_options);
+
+void printUsage(const char *_program);
+
+///
+/// \brief IsNetplay True if this peer is hosting or joining a match over the network
+///
+bool isNetplay(const Options *_options);
+
+#endif // OPTIONS_H
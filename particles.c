@@ -0,0 +1,251 @@
+#include "particles.h"
+
+#include <string.h>
+
+#include "allocator.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PARTICLES_HAS_X86 (1)
+#endif
+
+// Moves the first _count particles on by _seconds, rounded up to a whole number of lanes
+typedef void (*MoveParticles)(Particles *io_particles, int _count, float _seconds);
+
+static MoveParticles s_moveParticles = NULL;
+
+static void moveParticlesScalar(Particles *io_particles, int _count, float _seconds);
+static void removeFaded(Particles *io_particles);
+
+#ifdef PARTICLES_HAS_X86
+static void moveParticlesSSE(Particles *io_particles, int _count, float _seconds);
+static void moveParticlesAVX(Particles *io_particles, int _count, float _seconds);
+#endif
+
+bool createParticles(Particles *o_particles,
+                     unsigned int _seed)
+{
+  // Pick the widest kernel this CPU supports
+  s_moveParticles = moveParticlesScalar;
+#ifdef PARTICLES_HAS_X86
+  s_moveParticles = SDL_HasAVX() ? moveParticlesAVX : moveParticlesSSE;
+#endif
+
+  // One allocation for every array, each starts a multiple of 32 bytes in
+  const size_t c_floats = PARTICLE_CAPACITY * sizeof(float);
+  const size_t c_size = c_floats * 6 + PARTICLE_CAPACITY * (sizeof(SDL_Color) * 2 + sizeof(SDL_Rect));
+  Uint8 *block = allocateMemory(MEMORY_RENDER, c_size);
+
+  o_particles->count = 0;
+  o_particles->seed = _seed;
+
+  if(block == NULL)
+  {
+    o_particles->x = NULL;
+    return false;
+  }
+
+  o_particles->x = (float *)block;
+  o_particles->y = (float *)(block + c_floats);
+  o_particles->vx = (float *)(block + c_floats * 2);
+  o_particles->vy = (float *)(block + c_floats * 3);
+  o_particles->life = (float *)(block + c_floats * 4);
+  o_particles->fade = (float *)(block + c_floats * 5);
+
+  block += c_floats * 6;
+  o_particles->colour = (SDL_Color *)block;
+  o_particles->colours = (SDL_Color *)(block + PARTICLE_CAPACITY * sizeof(SDL_Color));
+  o_particles->rects = (SDL_Rect *)(block + PARTICLE_CAPACITY * sizeof(SDL_Color) * 2);
+
+  // The kernels read a little past the last live particle
+  memset(o_particles->x, 0, c_floats * 6);
+
+  return true;
+}
+
+void freeParticles(Particles *io_particles)
+{
+  // The start of the single allocation
+  freeMemory(io_particles->x);
+
+  io_particles->x = NULL;
+  io_particles->count = 0;
+}
+
+void emitParticles(Particles *io_particles,
+                   float _x,
+                   float _y,
+                   int _count,
+                   float _speed,
+                   float _life,
+                   SDL_Color _colour)
+{
+  if(_count > PARTICLE_CAPACITY - io_particles->count)
+  {
+    _count = PARTICLE_CAPACITY - io_particles->count;
+  }
+
+  for(int n = 0; n < _count; ++n)
+  {
+    const int c_i = io_particles->count++;
+
+    // Any point in the unit circle, which gives a spread of speeds without any trigonometry
+    int dx;
+    int dy;
+    do
+    {
+      dx = randRange(&io_particles->seed, -256, 256);
+      dy = randRange(&io_particles->seed, -256, 256);
+    } while(dx * dx + dy * dy > 256 * 256);
+
+    const float c_life = _life * (0.5f + randRange(&io_particles->seed, 0, 256) / 512.0f);
+
+    io_particles->x[c_i] = _x;
+    io_particles->y[c_i] = _y;
+    io_particles->vx[c_i] = dx * (_speed / 256.0f);
+    io_particles->vy[c_i] = dy * (_speed / 256.0f);
+    io_particles->life[c_i] = c_life;
+    io_particles->fade[c_i] = 1.0f / c_life;
+    io_particles->colour[c_i] = _colour;
+  }
+}
+
+void updateParticles(Particles *io_particles,
+                     float _seconds)
+{
+  if(io_particles->count == 0)
+  {
+    return;
+  }
+
+  s_moveParticles(io_particles, io_particles->count, _seconds);
+  removeFaded(io_particles);
+}
+
+void prepareParticles(Particles *io_particles)
+{
+  const int c_count = io_particles->count;
+
+  for(int i = 0; i < c_count; ++i)
+  {
+    const float c_alpha = io_particles->life[i] * io_particles->fade[i] * 255.0f;
+
+    io_particles->rects[i].x = (int)io_particles->x[i] - PARTICLE_SIZE / 2;
+    io_particles->rects[i].y = (int)io_particles->y[i] - PARTICLE_SIZE / 2;
+    io_particles->rects[i].w = PARTICLE_SIZE;
+    io_particles->rects[i].h = PARTICLE_SIZE;
+
+    io_particles->colours[i] = io_particles->colour[i];
+    io_particles->colours[i].a = (Uint8)(c_alpha > 255.0f ? 255.0f : c_alpha);
+  }
+}
+
+void drawParticles(const Particles *_particles,
+                   Canvas *io_canvas)
+{
+  fillRects(io_canvas, _particles->rects, _particles->colours, _particles->count);
+}
+
+///
+/// \brief RemoveFaded Moves the last live particle into each one that has run out of life
+///
+static void removeFaded(Particles *io_particles)
+{
+  int count = io_particles->count;
+  int i = 0;
+
+  while(i < count)
+  {
+    if(io_particles->life[i] > 0.0f)
+    {
+      ++i;
+      continue;
+    }
+
+    --count;
+    io_particles->x[i] = io_particles->x[count];
+    io_particles->y[i] = io_particles->y[count];
+    io_particles->vx[i] = io_particles->vx[count];
+    io_particles->vy[i] = io_particles->vy[count];
+    io_particles->life[i] = io_particles->life[count];
+    io_particles->fade[i] = io_particles->fade[count];
+    io_particles->colour[i] = io_particles->colour[count];
+  }
+
+  io_particles->count = count;
+}
+
+static void moveParticlesScalar(Particles *io_particles,
+                                int _count,
+                                float _seconds)
+{
+  const float c_damping = (_seconds * PARTICLE_DRAG < 1.0f) ? 1.0f - _seconds * PARTICLE_DRAG : 0.0f;
+  const float c_fall = PARTICLE_GRAVITY * _seconds;
+
+  for(int i = 0; i < _count; ++i)
+  {
+    io_particles->vx[i] = io_particles->vx[i] * c_damping;
+    io_particles->vy[i] = io_particles->vy[i] * c_damping + c_fall;
+    io_particles->x[i] += io_particles->vx[i] * _seconds;
+    io_particles->y[i] += io_particles->vy[i] * _seconds;
+    io_particles->life[i] -= _seconds;
+  }
+}
+
+#ifdef PARTICLES_HAS_X86
+
+///
+/// \brief MoveParticlesSSE The scalar kernel four particles at a time. PARTICLE_CAPACITY
+/// is a multiple of the width, so the last group can always be read and written whole
+///
+static void moveParticlesSSE(Particles *io_particles,
+                             int _count,
+                             float _seconds)
+{
+  const float c_damping = (_seconds * PARTICLE_DRAG < 1.0f) ? 1.0f - _seconds * PARTICLE_DRAG : 0.0f;
+
+  const __m128 c_dt = _mm_set1_ps(_seconds);
+  const __m128 c_damp = _mm_set1_ps(c_damping);
+  const __m128 c_fall = _mm_set1_ps(PARTICLE_GRAVITY * _seconds);
+
+  for(int i = 0; i < _count; i += 4)
+  {
+    const __m128 c_vx = _mm_mul_ps(_mm_loadu_ps(io_particles->vx + i), c_damp);
+    const __m128 c_vy = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(io_particles->vy + i), c_damp), c_fall);
+
+    _mm_storeu_ps(io_particles->vx + i, c_vx);
+    _mm_storeu_ps(io_particles->vy + i, c_vy);
+    _mm_storeu_ps(io_particles->x + i, _mm_add_ps(_mm_loadu_ps(io_particles->x + i), _mm_mul_ps(c_vx, c_dt)));
+    _mm_storeu_ps(io_particles->y + i, _mm_add_ps(_mm_loadu_ps(io_particles->y + i), _mm_mul_ps(c_vy, c_dt)));
+    _mm_storeu_ps(io_particles->life + i, _mm_sub_ps(_mm_loadu_ps(io_particles->life + i), c_dt));
+  }
+}
+
+///
+/// \brief MoveParticlesAVX The SSE kernel at twice the width
+///
+__attribute__((target("avx")))
+static void moveParticlesAVX(Particles *io_particles,
+                             int _count,
+                             float _seconds)
+{
+  const float c_damping = (_seconds * PARTICLE_DRAG < 1.0f) ? 1.0f - _seconds * PARTICLE_DRAG : 0.0f;
+
+  const __m256 c_dt = _mm256_set1_ps(_seconds);
+  const __m256 c_damp = _mm256_set1_ps(c_damping);
+  const __m256 c_fall = _mm256_set1_ps(PARTICLE_GRAVITY * _seconds);
+
+  for(int i = 0; i < _count; i += 8)
+  {
+    const __m256 c_vx = _mm256_mul_ps(_mm256_loadu_ps(io_particles->vx + i), c_damp);
+    const __m256 c_vy = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(io_particles->vy + i), c_damp), c_fall);
+
+    _mm256_storeu_ps(io_particles->vx + i, c_vx);
+    _mm256_storeu_ps(io_particles->vy + i, c_vy);
+    _mm256_storeu_ps(io_particles->x + i, _mm256_add_ps(_mm256_loadu_ps(io_particles->x + i), _mm256_mul_ps(c_vx, c_dt)));
+    _mm256_storeu_ps(io_particles->y + i, _mm256_add_ps(_mm256_loadu_ps(io_particles->y + i), _mm256_mul_ps(c_vy, c_dt)));
+    _mm256_storeu_ps(io_particles->life + i, _mm256_sub_ps(_mm256_loadu_ps(io_particles->life + i), c_dt));
+  }
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <stdbool.h>
+
+#include "canvas.h"
+
+#define PARTICLE_CAPACITY (65536)   // A multiple of 8, so the update never needs a scalar tail
+#define PARTICLE_SIZE     (3)       // Pixels square
+#define PARTICLE_DRAG     (3.0f)    // Fraction of its speed a particle loses a second
+#define PARTICLE_GRAVITY  (240.0f)  // Pixels a second squared, downwards
+
+// Short lived coloured specks for eating and dying. Each field is its own array so the
+// update streams through them a few particles at a time with SIMD, and the live particles
+// are kept packed at the front by moving the last one into any that dies. Everything is
+// allocated once up front, emitting never allocates and drops particles once it is full
+typedef struct Particles{
+  float *x;
+  float *y;
+  float *vx;          // Pixels a second
+  float *vy;
+  float *life;        // Seconds left
+  float *fade;        // 1 / the life it started with, so alpha is life * fade
+  SDL_Color *colour;  // Alpha is ignored, it comes from the life left
+
+  int count;          // Live particles, all at the front of every array
+
+  // Filled by prepareParticles for drawParticles' single fillRects call
+  SDL_Rect *rects;
+  SDL_Color *colours;
+
+  unsigned int seed;  // Only looks random, it never affects the game
+} Particles;
+
+///
+/// \brief CreateParticles Allocates every array at PARTICLE_CAPACITY
+/// \return False if the allocation failed
+///
+bool createParticles(Particles *o_particles, unsigned int _seed);
+void freeParticles(Particles *io_particles);
+
+///
+/// \brief EmitParticles Sends _count particles out from a point in random directions
+/// \param io_particles
+/// \param _x
+/// \param _y
+/// \param _count Any that don't fit are dropped
+/// \param _speed Fastest a particle can start, in pixels a second
+/// \param _life Seconds until the slowest to fade has gone
+/// \param _colour
+///
+void emitParticles(Particles *io_particles, float _x, float _y, int _count,
+                   float _speed, float _life, SDL_Color _colour);
+
+///
+/// \brief UpdateParticles Moves every particle on and removes the ones that have faded
+/// \param io_particles
+/// \param _seconds Time since the last update
+///
+void updateParticles(Particles *io_particles, float _seconds);
+
+///
+/// \brief PrepareParticles Works out the rect and colour of every live particle, once a frame
+/// however many times they are drawn
+///
+void prepareParticles(Particles *io_particles);
+
+///
+/// \brief DrawParticles Draws every live particle in one batch, as of the last prepareParticles
+///
+void drawParticles(const Particles *_particles, Canvas *io_canvas);
+
+#endif // PARTICLES_H
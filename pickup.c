@@ -1,73 +1,240 @@
 #include "pickup.h"
 
-void initialisePickups(Pickup *_array)
+#include <string.h>
+
+#include "neighbours.h"
+
+// Steering - distances are in pixels between centres
+#define KNIGHT_FLEE_RADIUS     (160)
+#define KNIGHT_SPACING_RADIUS  (96)
+#define KNIGHT_SPACING_COUNT   (4)  // Nearest knights each one keeps away from
+#define KNIGHT_FLEE_WEIGHT     (2)  // How much more a snake head matters than another knight
+#define KNIGHT_WALL_RADIUS     (80) // From a knight's centre, it starts turning away this close to a wall
+#define KNIGHT_WALL_WEIGHT     (4)  // Walls matter most, a knight can run from a snake but not through a wall
+
+#define PICKUP_SPAWN_ATTEMPTS  (32) // Rolls for a spot clear of walls before taking the last one anyway
+
+static void addPush(int *io_pushX, int *io_pushY, int _dx, int _dy, int _distanceSq, int _radius, int _weight);
+static bool isClearOfWalls(const ArenaMap *_map, int _x, int _y, int _size);
+
+void initialisePickups(Pickups *o_pickups,
+                       unsigned int *io_seed,
+                       const ArenaMap *_map,
+                       PickupSpawner *io_spawner)
 {
   const int WIDTH=800;
   const int HEIGHT=600;
 
-  // Populate Pickup array with randomised positions/types
+  Gems *gems = &o_pickups->gems;
+  Knights *knights = &o_pickups->knights;
+
+  // Zeroed so that stepKnights only ever finds real positions past the last knight
+  memset(o_pickups, 0, sizeof(*o_pickups));
+
+  // Populate the arrays with randomised positions/types
   for(int i = 0; i < PICKUP_TOTAL; ++i)
   {
     // A hacky way of setting a 1/5 chance of creating a moving Pickup (knight)
-    _array[i].canTravel = !(randRange(0, 4));
+    const bool c_isKnight = !(randRange(io_seed, 0, 4));
 
-    if(_array[i].canTravel)
+    if(c_isKnight)
     {
-      _array[i].pos.x = randRange(0, WIDTH - KNIGHT_SIZE);
-      _array[i].pos.y = randRange(0, HEIGHT - KNIGHT_SIZE);
+      const int k = knights->count++;
+
+      knights->id[k] = i;
+
+      for(int attempt = 0; attempt < PICKUP_SPAWN_ATTEMPTS; ++attempt)
+      {
+        knights->x[k] = randRange(io_seed, 0, WIDTH - KNIGHT_SIZE);
+        knights->y[k] = randRange(io_seed, 0, HEIGHT - KNIGHT_SIZE);
+
+        if(isClearOfWalls(_map, knights->x[k], knights->y[k], KNIGHT_SIZE))
+        {
+          break;
+        }
+      }
+
+      knights->frame[k] = 0;
+
+      if(io_spawner != NULL)
+      {
+        const SDL_Rect c_knight = { knights->x[k], knights->y[k], KNIGHT_SIZE, KNIGHT_SIZE };
+        coverSpawner(io_spawner, &c_knight);
+      }
 
-      _array[i].Anim.offset.x = 0;
-      _array[i].Anim.offset.y = getRandomMovement();
       //Randomly choose a knight direction
+      knights->direction[k] = getRandomMovement(io_seed);
+    }
+    else if(io_spawner != NULL)
+    {
+      const int g = gems->count;
+
+      if(spawnPickup(io_spawner, io_seed, &gems->x[g], &gems->y[g]))
+      {
+        gems->id[g] = i;
+        gems->type[g] = randRange(io_seed, BLUE, CRYSTAL);
+        gems->count++;
+      }
     }
     else
     {
-      _array[i].pos.x = randRange(0, WIDTH - PICKUP_SIZE);
-      _array[i].pos.y = randRange(0, HEIGHT - PICKUP_SIZE);
+      const int g = gems->count++;
+
+      gems->id[g] = i;
+
+      for(int attempt = 0; attempt < PICKUP_SPAWN_ATTEMPTS; ++attempt)
+      {
+        gems->x[g] = randRange(io_seed, 0, WIDTH - PICKUP_SIZE);
+        gems->y[g] = randRange(io_seed, 0, HEIGHT - PICKUP_SIZE);
+
+        if(isClearOfWalls(_map, gems->x[g], gems->y[g], PICKUP_SIZE))
+        {
+          break;
+        }
+      }
 
       //Randomly choose a type of gem
-      _array[i].Anim.type = randRange(BLUE, CRYSTAL);
+      gems->type[g] = randRange(io_seed, BLUE, CRYSTAL);
     }
+  }
+}
+
+bool respawnGem(Pickups *io_pickups,
+                unsigned int *io_seed,
+                PickupSpawner *io_spawner)
+{
+  Gems *gems = &io_pickups->gems;
+  const Knights *c_knights = &io_pickups->knights;
+
+  // Ids stay below PICKUP_TOTAL, so anything that follows pickups by id sees a new gem in
+  // the place of one that was collected
+  bool isUsed[PICKUP_TOTAL] = { false };
+
+  for(int i = 0; i < gems->count; ++i)
+  {
+    isUsed[gems->id[i]] = true;
+  }
 
-    _array[i].isVisible = true;
+  for(int i = 0; i < c_knights->count; ++i)
+  {
+    isUsed[c_knights->id[i]] = true;
   }
+
+  int id = 0;
+  while(id < PICKUP_TOTAL && isUsed[id])
+  {
+    ++id;
+  }
+
+  const int g = gems->count;
+
+  if(id == PICKUP_TOTAL || !spawnPickup(io_spawner, io_seed, &gems->x[g], &gems->y[g]))
+  {
+    return false;
+  }
+
+  gems->id[g] = id;
+  gems->type[g] = randRange(io_seed, BLUE, CRYSTAL);
+  gems->count++;
+
+  return true;
 }
 
-void renderPickups(Pickup *_array,
-                   SDL_Renderer *_renderer,
-                   SDL_Texture *_pickupTex,
-                   SDL_Texture *_specialTex)
+void removeGem(Gems *io_gems,
+               int _gem)
 {
-  for(int i=0; i < PICKUP_TOTAL; i++)
+  const int c_last = --io_gems->count;
+
+  io_gems->id[_gem] = io_gems->id[c_last];
+  io_gems->x[_gem] = io_gems->x[c_last];
+  io_gems->y[_gem] = io_gems->y[c_last];
+  io_gems->type[_gem] = io_gems->type[c_last];
+}
+
+void removeKnight(Knights *io_knights,
+                  int _knight)
+{
+  const int c_last = --io_knights->count;
+
+  io_knights->id[_knight] = io_knights->id[c_last];
+  io_knights->x[_knight] = io_knights->x[c_last];
+  io_knights->y[_knight] = io_knights->y[c_last];
+  io_knights->frame[_knight] = io_knights->frame[c_last];
+  io_knights->direction[_knight] = io_knights->direction[c_last];
+}
+
+void stepKnights(Knights *io_knights,
+                 const Uint8 _isDue[])
+{
+  // Rounded up to a multiple of 4, which lets the compiler vectorise the loop without a
+  // scalar tail. The few slots past the last knight are stepped too but never read
+  typedef char isWholeLanes[(PICKUP_TOTAL % 4 == 0) ? 1 : -1];
+  (void)sizeof(isWholeLanes);
+
+  const int c_count = (io_knights->count + 3) & ~3;
+  const int c_wrapX = WIDTH + KNIGHT_SIZE * 2;
+  const int c_wrapY = HEIGHT + KNIGHT_SIZE * 2;
+
+  int *restrict x = io_knights->x;
+  int *restrict y = io_knights->y;
+  int *restrict frame = io_knights->frame;
+  const int *restrict direction = io_knights->direction;
+  const Uint8 *restrict isDue = _isDue;
+
+  // Arithmetic in place of every branch, so the compiler is free to do several knights at once
+  for(int i = 0; i < c_count; ++i)
   {
-    SDL_Rect src;
-    SDL_Rect dst;
+    const int c_due = isDue[i];
+    const int c_next = frame[i] + c_due;
+    frame[i] = c_next - (c_next >= KNIGHT_FRAMETOTAL) * KNIGHT_FRAMETOTAL;
 
-    if(_array[i].isVisible)
-    {
-      dst.x = _array[i].pos.x;
-      dst.y = _array[i].pos.y;
+    // LEFT and RIGHT are the odd directions, each axis goes -1 or +1 about the one between
+    const int c_isAcross = direction[i] & 1;
+    const int c_stepX = c_due * c_isAcross * (direction[i] - 2) * KNIGHT_SPEED;
+    const int c_stepY = c_due * (1 - c_isAcross) * (direction[i] - 1) * KNIGHT_SPEED;
+    int newX = x[i] + c_stepX;
+    int newY = y[i] + c_stepY;
 
-      if(_array[i].canTravel)
-      {
-        src = getFrameOffset(_array[i].Anim.offset.y, KNIGHT_SIZE,
-                             _array[i].Anim.offset.x, 0);
+    // The same wrap as moveSprite, each test seeing the result of the one before
+    newY += (newY <= -KNIGHT_SIZE) * c_wrapY;
+    newY -= (newY >= HEIGHT) * c_wrapY;
+    newX += (newX <= -KNIGHT_SIZE) * c_wrapX;
+    newX -= (newX >= WIDTH) * c_wrapX;
+
+    x[i] = newX;
+    y[i] = newY;
+  }
+}
 
-        dst.w = KNIGHT_SIZE;
-        dst.h = KNIGHT_SIZE;
+void renderPickups(const Pickups *_pickups,
+                   const int _gems[],
+                   int _gemCount,
+                   const int _knights[],
+                   int _knightCount,
+                   Canvas *_canvas,
+                   const Sheet *_pickupSheet,
+                   const Sheet *_specialSheet)
+{
+  const Gems *c_gems = &_pickups->gems;
 
-        SDL_RenderCopy(_renderer, _specialTex, &src, &dst);
-      }
-      else
-      {
-        src = getFrameOffset(0, PICKUP_SIZE, _array[i].Anim.type, 0);
+  for(int n = 0; n < _gemCount; ++n)
+  {
+    const int i = _gems[n];
+    const SDL_Rect c_src = getFrameOffset(0, PICKUP_SIZE, c_gems->type[i], 0);
+    const SDL_Rect c_dst = { c_gems->x[i], c_gems->y[i], PICKUP_SIZE, PICKUP_SIZE };
 
-        dst.w = PICKUP_SIZE;
-        dst.h = PICKUP_SIZE;
+    drawSprite(_canvas, _pickupSheet, &c_src, &c_dst);
+  }
 
-        SDL_RenderCopy(_renderer, _pickupTex, &src, &dst);
-      }
-    }
+  const Knights *c_knights = &_pickups->knights;
+
+  for(int n = 0; n < _knightCount; ++n)
+  {
+    const int i = _knights[n];
+    const SDL_Rect c_src = getFrameOffset(c_knights->direction[i], KNIGHT_SIZE, c_knights->frame[i], 0);
+    const SDL_Rect c_dst = { c_knights->x[i], c_knights->y[i], KNIGHT_SIZE, KNIGHT_SIZE };
+
+    drawSprite(_canvas, _specialSheet, &c_src, &c_dst);
   }
 }
 
@@ -87,7 +254,126 @@ SDL_Rect getFrameOffset(Move _dir,
 
 
 
-Move getRandomMovement()
+void steerKnights(Knights *io_knights,
+                  const Uint8 _isDue[],
+                  const int _headX[],
+                  const int _headY[],
+                  int _headCount,
+                  const ArenaMap *_map)
+{
+  int centreX[PICKUP_TOTAL];
+  int centreY[PICKUP_TOTAL];
+
+  for(int i = 0; i < io_knights->count; ++i)
+  {
+    centreX[i] = io_knights->x[i] + KNIGHT_SIZE / 2;
+    centreY[i] = io_knights->y[i] + KNIGHT_SIZE / 2;
+  }
+
+  // Rebuilt from scratch every step, it costs about as much as one pass over the knights
+  NeighbourGrid grid;
+  buildNeighbourGrid(&grid, centreX, centreY, io_knights->count);
+
+  for(int i = 0; i < io_knights->count; ++i)
+  {
+    if(!_isDue[i])
+    {
+      continue;
+    }
+
+    int pushX = 0;
+    int pushY = 0;
+
+    for(int h = 0; h < _headCount; ++h)
+    {
+      const int c_dx = centreX[i] - _headX[h];
+      const int c_dy = centreY[i] - _headY[h];
+
+      addPush(&pushX, &pushY, c_dx, c_dy, c_dx * c_dx + c_dy * c_dy, KNIGHT_FLEE_RADIUS, KNIGHT_FLEE_WEIGHT);
+    }
+
+    int neighbours[KNIGHT_SPACING_COUNT];
+    int distances[KNIGHT_SPACING_COUNT];
+    const int c_found = findNearestNeighbours(&grid, centreX[i], centreY[i], KNIGHT_SPACING_RADIUS, i,
+                                              KNIGHT_SPACING_COUNT, neighbours, distances);
+
+    for(int n = 0; n < c_found; ++n)
+    {
+      addPush(&pushX, &pushY, centreX[i] - centreX[neighbours[n]], centreY[i] - centreY[neighbours[n]],
+              distances[n], KNIGHT_SPACING_RADIUS, 1);
+    }
+
+    // Straight out along the gradient, at full strength once a knight is touching or inside a wall
+    if(_map != NULL)
+    {
+      const ArenaCell *c_cell = getArenaCell(_map, centreX[i], centreY[i]);
+      const int c_distance = (c_cell->distance < 0) ? 0 :
+                             (c_cell->distance > KNIGHT_WALL_RADIUS) ? KNIGHT_WALL_RADIUS : c_cell->distance;
+
+      addPush(&pushX, &pushY, c_cell->gradientX * KNIGHT_WALL_RADIUS / 127, c_cell->gradientY * KNIGHT_WALL_RADIUS / 127,
+              c_distance * c_distance, KNIGHT_WALL_RADIUS, KNIGHT_WALL_WEIGHT);
+    }
+
+    if(pushX == 0 && pushY == 0)
+    {
+      continue;
+    }
+
+    // Whichever way lines up best with the push, the current way wins a tie so knights don't dither
+    const int c_alignment[4] = {-pushY, -pushX, pushY, pushX};  // UP, LEFT, DOWN, RIGHT
+    int best = io_knights->direction[i];
+
+    for(int d = UP; d <= RIGHT; ++d)
+    {
+      if(c_alignment[d] > c_alignment[best])
+      {
+        best = d;
+      }
+    }
+
+    io_knights->direction[i] = best;
+  }
+}
+
+Move getRandomMovement(unsigned int *io_seed)
+{
+  return (Move)(randRange(io_seed, UP, RIGHT));
+}
+
+///
+/// \brief AddPush Adds a push along (_dx, _dy) that fades from full strength when touching
+/// to nothing at _radius. Integer only, so every machine steers identically
+///
+static void addPush(int *io_pushX,
+                    int *io_pushY,
+                    int _dx,
+                    int _dy,
+                    int _distanceSq,
+                    int _radius,
+                    int _weight)
+{
+  const int c_radiusSq = _radius * _radius;
+
+  if(_distanceSq >= c_radiusSq)
+  {
+    return;
+  }
+
+  // 0 to 256 before weighting, only the direction of the total push matters
+  const int c_strength = ((c_radiusSq - _distanceSq) * 256 / c_radiusSq) * _weight;
+
+  *io_pushX += _dx * c_strength;
+  *io_pushY += _dy * c_strength;
+}
+
+///
+/// \brief IsClearOfWalls True if a _size square pickup at (_x, _y) doesn't reach a wall,
+/// which is one lookup at its centre
+///
+static bool isClearOfWalls(const ArenaMap *_map,
+                           int _x,
+                           int _y,
+                           int _size)
 {
-  return (Move)(randRange(UP, RIGHT));
+  return _map == NULL || getArenaCell(_map, _x + _size / 2, _y + _size / 2)->distance >= _size / 2;
 }
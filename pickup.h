@@ -5,12 +5,28 @@
 
 #include "utils.h"
 #include "actor.h"
+#include "arena.h"
+#include "canvas.h"
+#include "spawner.h"
 
 
+// Pickups scattered at the start of a match, and the most the board ever holds. Every
+// pickup array is this long and held by value, so a Game stays one flat block that
+// saveGame, netplay's rollback saves and the render snapshots copy without allocating or
+// following pointers. The price is that each copy moves the whole capacity, about 48 bytes
+// for every pickup there could be, and netplay saves a Game every tick and replays up to
+// NETPLAY_MAX_ROLLBACK of them at once. At 32 that is next to nothing. A crowd of thousands
+// can be built in instead, for profiling the knights or the spawner, with something like
+//   qmake "DEFINES+=PICKUP_TOTAL=4096 TIMER_CAPACITY=8194"
+// which makes every copy about 200KB, plus the larger timer wheel. It has to be a multiple
+// of 4 below 65536, and resetGame needs 2 + 2 * PICKUP_TOTAL timers
+#ifndef PICKUP_TOTAL
 #define PICKUP_TOTAL      (32)
+#endif
 #define PICKUP_SIZE       (28)
 #define KNIGHT_SIZE       (64)
 #define KNIGHT_FRAMETOTAL (9)
+#define KNIGHT_SPEED      (2)   // Pixels a step, knights step at most once a move
 
 typedef enum{
   BLUE,
@@ -25,21 +41,33 @@ typedef struct Coord
   int y;
 } Coord;
 
-// Can store either a regular static Pickup (gem)
-// or a mobile knight sprite
-typedef struct {
-  union
-  {
-    Gem type;       // Used by gem
-    Coord offset;   // Used by knight
-  } Anim;
+// Gems that have not been collected yet, each field in its own array
+typedef struct Gems{
+  int count;                  // Live gems, packed at the front of every array
+  int id[PICKUP_TOTAL];       // Order it was scattered in, so it can be followed while it moves about the arrays
+  int x[PICKUP_TOTAL];        // Top left
+  int y[PICKUP_TOTAL];
+  Gem type[PICKUP_TOTAL];
+} Gems;
 
-  SDL_Rect pos;
+// Knights that have not been collected yet, laid out like Gems
+typedef struct Knights{
+  int count;
+  int id[PICKUP_TOTAL];
+  int x[PICKUP_TOTAL];
+  int y[PICKUP_TOTAL];
+  int frame[PICKUP_TOTAL];     // Animation frame, 0 to KNIGHT_FRAMETOTAL-1
+  int direction[PICKUP_TOTAL]; // A Move, UP to RIGHT
+} Knights;
 
-  bool canTravel;   // True if the Pickup is a knight
-
-  bool isVisible;
-} Pickup;
+// Every pickup still on the board. Gems and knights are kept apart so no loop has to ask
+// what a pickup is, and a collected pickup is replaced by the last of its kind so none has
+// to ask whether it is still there either. The arrays have room for a whole match and are
+// held by value, so copying a Game (such as into a GameSave) copies its pickups with it
+typedef struct Pickups{
+  Gems gems;
+  Knights knights;
+} Pickups;
 
 ////
 /// \brief GetFrameOffset Calculates the x/y frame offset
@@ -55,29 +83,83 @@ SDL_Rect getFrameOffset(Move _dir,
                         int _frame,
                         int _startOffset);
 ///
-/// \brief InitialisePickups Sets up random position and type/direction for each pickup
-/// \param _array Array of pickups
+/// \brief InitialisePickups Scatters PICKUP_TOTAL pickups with random positions and
+/// types/directions, about one in five of them knights. Positions inside or touching a wall
+/// are rolled again, so an open arena rolls exactly as many numbers as it always has
+/// \param o_pickups
+/// \param io_seed Random generator state
+/// \param _map Can be NULL
+/// \param io_spawner When not NULL gems are placed by it instead, clear of each other, the
+/// knights and whatever it already has covered. Any gem it finds no room for is left out.
+/// It must be empty
+///
+void initialisePickups(Pickups *o_pickups, unsigned int *io_seed, const ArenaMap *_map,
+                       PickupSpawner *io_spawner);
+
+///
+/// \brief RespawnGem Places one new gem with the spawner, under the lowest id not on the board
+/// \param io_pickups
+/// \param io_seed
+/// \param io_spawner Holds every gem, with anything else to keep clear of already covered
+/// \return False if the board is full or the spawner found no room this time
+///
+bool respawnGem(Pickups *io_pickups, unsigned int *io_seed, PickupSpawner *io_spawner);
+
+///
+/// \brief RemoveGem Takes a collected gem off the board, moving the last gem into its place
+/// \param io_gems
+/// \param _gem Index into the arrays, not the id
 ///
-void initialisePickups(Pickup *_array);
+void removeGem(Gems *io_gems, int _gem);
+void removeKnight(Knights *io_knights, int _knight);
 
 ///
-/// \brief RenderPickups Renders gems and knights onto _renderer, the type is automatically
-/// determined
-/// \param _array Array of pickups
-/// \param _renderer The renderer to RenderCopy() to
-/// \param _pickupTex The sprite sheet to use for regular pickups (gems)
-/// \param _specialTex The sprite sheet to use for moving pickups (knights)
+/// \brief StepKnights Advances each due knight's animation and moves it 2 pixels on, wrapping
+/// at the edges the same way as moveSprite
+/// \param io_knights
+/// \param _isDue 1 for each knight to step, by array slot. Must be set up to the knight count
+/// rounded up to a multiple of 4, with 0 past the last knight
 ///
-void renderPickups(Pickup *_array,
-                   SDL_Renderer *_renderer,
-                   SDL_Texture *_pickupTex,
-                   SDL_Texture *_specialTex);
+void stepKnights(Knights *io_knights, const Uint8 _isDue[]);
+
+///
+/// \brief SteerKnights Turns each knight away from any snake head close to it, from the
+/// knights crowding it and from walls, leaving knights with nothing near them going the way they were
+/// \param io_knights
+/// \param _isDue 1 for each knight to steer, by array slot. Every knight still crowds the others
+/// \param _headX Centre of each snake head
+/// \param _headY
+/// \param _headCount
+/// \param _map Walls are avoided by following the field's gradient, can be NULL
+///
+void steerKnights(Knights *io_knights, const Uint8 _isDue[], const int _headX[], const int _headY[],
+                  int _headCount, const ArenaMap *_map);
+
+///
+/// \brief RenderPickups Renders the listed gems then the listed knights onto _canvas
+/// \param _pickups
+/// \param _gems Indices into _pickups->gems
+/// \param _gemCount
+/// \param _knights Indices into _pickups->knights
+/// \param _knightCount
+/// \param _canvas The canvas to draw to
+/// \param _pickupSheet The sprite sheet to use for regular pickups (gems)
+/// \param _specialSheet The sprite sheet to use for moving pickups (knights)
+///
+void renderPickups(const Pickups *_pickups,
+                   const int _gems[],
+                   int _gemCount,
+                   const int _knights[],
+                   int _knightCount,
+                   Canvas *_canvas,
+                   const Sheet *_pickupSheet,
+                   const Sheet *_specialSheet);
 
 ////
 /// \brief RandomMovement
-///
+/// \param io_seed Random generator state
 /// \return A random move direction
 ///
-Move getRandomMovement();
+Move getRandomMovement(unsigned int *io_seed);
 
 #endif // PICKUP_H
@@ -0,0 +1,1326 @@
+// mmap is POSIX rather than C99
+#define _POSIX_C_SOURCE 200112L
+
+#include "recording.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "allocator.h"
+#include "trace.h"
+
+// File layout, every fixed size field is little-endian:
+//   header   "SNKR", version, players (16 bit), pickups (16 bit), frames per chunk
+//   chunks   "CHNK", frame count, first frame (64 bit), payload size, then the payload:
+//            a keyframe and frame count - 1 deltas, all varints
+//   index    first frame (64 bit), offset (64 bit), frame count, for every chunk
+//   trailer  index offset (64 bit), chunk count, "SNKI"
+#define RECORD_MAGIC       (0x524B4E53u)
+#define RECORD_VERSION     (1)
+#define CHUNK_MAGIC        (0x4B4E4843u)
+#define INDEX_MAGIC        (0x494B4E53u)
+#define HEADER_SIZE        (16)
+#define CHUNK_HEADER_SIZE  (20)
+#define INDEX_ENTRY_SIZE   (20)
+#define TRAILER_SIZE       (16)
+
+#define WRITE_BUFFER_SIZE  (1 << 16)
+#define MAX_SEGMENTS       (1 << 20)  // Anything longer is a corrupt recording
+
+// Bounds checked reading from a mapped chunk, isValid is cleared by any read past the end
+typedef struct ByteReader{
+  const Uint8 *at;
+  const Uint8 *end;
+  bool isValid;
+} ByteReader;
+
+static int runWriter(void *_data);
+static bool writeChunk(Recorder *io_recorder, const RecordBuffer *_buffer);
+static int takeBuffer(Recorder *io_recorder);
+static void releaseBuffer(Recorder *io_recorder, int _index, bool _isQueued);
+static void freeRecorder(Recorder *io_recorder);
+
+static void initialiseFrame(RecordFrame *o_frame);
+static void freeFrame(RecordFrame *io_frame);
+static void swapFrames(RecordFrame *io_a, RecordFrame *io_b);
+static bool reserveSegments(RecordFrame *io_frame, int _player, int _count);
+static bool fillFrame(RecordFrame *io_frame, const Game *_game);
+static RecordPoint predictSegment(const RecordFrame *_previous, int _player, int _index, bool _isShifted);
+static bool isSamePickup(const RecordPickup *_a, const RecordPickup *_b);
+
+static size_t getFrameBound(const RecordFrame *_frame);
+static void putVarint(RecordBuffer *io_buffer, Uint64 _value);
+static void putSigned(RecordBuffer *io_buffer, Sint64 _value);
+static void encodeKeyframe(RecordBuffer *io_buffer, const RecordFrame *_frame);
+static void encodeDelta(RecordBuffer *io_buffer, const RecordFrame *_previous, const RecordFrame *_frame);
+
+static Uint64 getVarint(ByteReader *io_reader);
+static Sint64 getSigned(ByteReader *io_reader);
+static int getCount(ByteReader *io_reader, int _maximum);
+static void decodeKeyframe(ByteReader *io_reader, RecordFrame *o_frame);
+static void decodeDelta(ByteReader *io_reader, const RecordFrame *_previous, RecordFrame *o_frame);
+
+static void putLittleEndian(Uint8 *o_bytes, Uint64 _value, int _size);
+static Uint64 getLittleEndian(const Uint8 *_bytes, int _size);
+static bool addChunk(RecordChunk **io_chunks, int *io_count, int *io_capacity, const RecordChunk *_chunk);
+static bool readChunkIndex(Recording *io_recording);
+static int findChunk(const Recording *_recording, Uint64 _frame);
+
+bool startRecording(Recorder *o_recorder,
+                    const char *_path)
+{
+  o_recorder->output = fopen(_path, "wb");
+  o_recorder->outputBuffer = allocateMemory(MEMORY_REPLAYS, WRITE_BUFFER_SIZE);
+  o_recorder->lock = SDL_CreateMutex();
+  o_recorder->isQueued = SDL_CreateCond();
+  o_recorder->thread = NULL;
+
+  initialiseFrame(&o_recorder->frame);
+  initialiseFrame(&o_recorder->previous);
+  o_recorder->active = -1;
+  o_recorder->frameCount = 0;
+
+  bool isCreated = (o_recorder->output && o_recorder->outputBuffer && o_recorder->lock && o_recorder->isQueued);
+
+  for(int i = 0; i < RECORD_BUFFERS; ++i)
+  {
+    // Grown by the simulation thread if a chunk ever needs more
+    RecordBuffer *buffer = &o_recorder->buffers[i];
+    buffer->capacity = WRITE_BUFFER_SIZE;
+    buffer->bytes = allocateMemory(MEMORY_REPLAYS, buffer->capacity);
+    buffer->size = 0;
+    buffer->firstFrame = 0;
+    buffer->frameCount = 0;
+    o_recorder->freeBuffers[i] = i;
+    isCreated &= (buffer->bytes != NULL);
+  }
+
+  o_recorder->freeCount = RECORD_BUFFERS;
+  o_recorder->queueHead = 0;
+  o_recorder->queueCount = 0;
+  o_recorder->quit = false;
+  o_recorder->hasFailed = false;
+
+  o_recorder->chunks = NULL;
+  o_recorder->chunkCount = 0;
+  o_recorder->chunkCapacity = 0;
+  o_recorder->offset = HEADER_SIZE;
+
+  if(isCreated)
+  {
+    setvbuf(o_recorder->output, o_recorder->outputBuffer, _IOFBF, WRITE_BUFFER_SIZE);
+
+    Uint8 header[HEADER_SIZE];
+    putLittleEndian(header,      RECORD_MAGIC,        4);
+    putLittleEndian(header + 4,  RECORD_VERSION,      4);
+    putLittleEndian(header + 8,  PLAYER_TOTAL,        2);
+    putLittleEndian(header + 10, PICKUP_TOTAL,        2);
+    putLittleEndian(header + 12, RECORD_CHUNK_FRAMES, 4);
+
+    isCreated = (fwrite(header, 1, HEADER_SIZE, o_recorder->output) == HEADER_SIZE);
+  }
+
+  if(!isCreated)
+  {
+    printf("Unable to open %s for recording\n", _path);
+    freeRecorder(o_recorder);
+    return false;
+  }
+
+  o_recorder->thread = SDL_CreateThread(runWriter, "recording", o_recorder);
+
+  if(!o_recorder->thread)
+  {
+    printf("%s\n", SDL_GetError());
+    freeRecorder(o_recorder);
+    return false;
+  }
+
+  return true;
+}
+
+void stopRecording(Recorder *io_recorder)
+{
+  // The last chunk is usually cut short
+  if(io_recorder->active >= 0)
+  {
+    releaseBuffer(io_recorder, io_recorder->active, io_recorder->buffers[io_recorder->active].frameCount > 0);
+    io_recorder->active = -1;
+  }
+
+  SDL_LockMutex(io_recorder->lock);
+  io_recorder->quit = true;
+  SDL_CondSignal(io_recorder->isQueued);
+  SDL_UnlockMutex(io_recorder->lock);
+
+  SDL_WaitThread(io_recorder->thread, NULL);
+  io_recorder->thread = NULL;
+
+  Uint64 written = 0;
+  for(int i = 0; i < io_recorder->chunkCount; ++i)
+  {
+    written += io_recorder->chunks[i].frameCount;
+  }
+
+  const Uint64 c_size = io_recorder->offset + (Uint64)io_recorder->chunkCount * INDEX_ENTRY_SIZE + TRAILER_SIZE;
+
+  printf("Recorded %llu of %llu frames in %d chunks, %llu bytes (%.1f per frame)%s\n",
+         (unsigned long long)written, (unsigned long long)io_recorder->frameCount,
+         io_recorder->chunkCount, (unsigned long long)c_size,
+         written > 0 ? (double)c_size / (double)written : 0.0,
+         io_recorder->hasFailed ? ", the recording could not be finished" : "");
+
+  freeRecorder(io_recorder);
+}
+
+void recordGame(Recorder *io_recorder,
+                const Game *_game)
+{
+  TRACE_BEGIN("recordGame");
+
+  // Chunks line up with frame numbers, so one dropped chunk never shifts the rest
+  const unsigned int c_position = (unsigned int)(io_recorder->frameCount % RECORD_CHUNK_FRAMES);
+
+  if(c_position == 0)
+  {
+    io_recorder->active = takeBuffer(io_recorder);
+
+    if(io_recorder->active >= 0)
+    {
+      RecordBuffer *buffer = &io_recorder->buffers[io_recorder->active];
+      buffer->size = 0;
+      buffer->firstFrame = io_recorder->frameCount;
+      buffer->frameCount = 0;
+    }
+  }
+
+  if(io_recorder->active >= 0)
+  {
+    RecordBuffer *buffer = &io_recorder->buffers[io_recorder->active];
+    bool isEncoded = fillFrame(&io_recorder->frame, _game);
+
+    // Make sure the whole frame fits so the encoders never have to check
+    const size_t c_needed = buffer->size + getFrameBound(&io_recorder->frame);
+
+    if(isEncoded && c_needed > buffer->capacity)
+    {
+      const size_t c_capacity = c_needed * 2;
+      Uint8 *bytes = reallocateMemory(MEMORY_REPLAYS, buffer->bytes, c_capacity);
+
+      if(bytes != NULL)
+      {
+        buffer->bytes = bytes;
+        buffer->capacity = c_capacity;
+      }
+
+      isEncoded = (bytes != NULL);
+    }
+
+    if(isEncoded)
+    {
+      if(c_position == 0)
+      {
+        encodeKeyframe(buffer, &io_recorder->frame);
+      }
+      else
+      {
+        encodeDelta(buffer, &io_recorder->previous, &io_recorder->frame);
+      }
+
+      buffer->frameCount++;
+      swapFrames(&io_recorder->frame, &io_recorder->previous);
+    }
+    else
+    {
+      // Every delta after a missing frame would be wrong, so the chunk is dropped
+      releaseBuffer(io_recorder, io_recorder->active, false);
+      io_recorder->active = -1;
+    }
+  }
+
+  io_recorder->frameCount++;
+
+  if(io_recorder->active >= 0 && c_position == RECORD_CHUNK_FRAMES - 1)
+  {
+    releaseBuffer(io_recorder, io_recorder->active, true);
+    io_recorder->active = -1;
+  }
+
+  TRACE_END("recordGame");
+}
+
+bool openRecording(Recording *o_recording,
+                   const char *_path)
+{
+  o_recording->data = NULL;
+  o_recording->size = 0;
+  o_recording->chunks = NULL;
+  o_recording->chunkCount = 0;
+  o_recording->frameCount = 0;
+  o_recording->frameIndex = 0;
+  o_recording->chunk = -1;
+  o_recording->position = 0;
+  o_recording->chunkEnd = 0;
+  initialiseFrame(&o_recording->frame);
+  initialiseFrame(&o_recording->scratch);
+
+  const int c_file = open(_path, O_RDONLY);
+
+  if(c_file < 0)
+  {
+    printf("Unable to open %s\n", _path);
+    return false;
+  }
+
+  struct stat info;
+  void *memory = MAP_FAILED;
+
+  if(fstat(c_file, &info) == 0 && info.st_size >= HEADER_SIZE)
+  {
+    memory = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, c_file, 0);
+  }
+
+  close(c_file);
+
+  if(memory == MAP_FAILED)
+  {
+    printf("Unable to map %s\n", _path);
+    return false;
+  }
+
+  o_recording->data = memory;
+  o_recording->size = (size_t)info.st_size;
+
+  const Uint8 *c_header = o_recording->data;
+
+  if(getLittleEndian(c_header, 4) != RECORD_MAGIC ||
+     getLittleEndian(c_header + 4, 4) != RECORD_VERSION ||
+     getLittleEndian(c_header + 8, 2) != PLAYER_TOTAL ||
+     getLittleEndian(c_header + 10, 2) != PICKUP_TOTAL ||
+     !readChunkIndex(o_recording))
+  {
+    printf("%s is not a version %d recording\n", _path, RECORD_VERSION);
+    closeRecording(o_recording);
+    return false;
+  }
+
+  return true;
+}
+
+void closeRecording(Recording *io_recording)
+{
+  if(io_recording->data != NULL)
+  {
+    munmap((void *)io_recording->data, io_recording->size);
+  }
+
+  freeMemory(io_recording->chunks);
+  freeFrame(&io_recording->frame);
+  freeFrame(&io_recording->scratch);
+
+  io_recording->data = NULL;
+  io_recording->chunks = NULL;
+  io_recording->chunkCount = 0;
+  io_recording->chunk = -1;
+}
+
+const RecordFrame *seekRecording(Recording *io_recording,
+                                 Uint64 _frame)
+{
+  io_recording->chunk = -1;
+
+  const int c_chunk = findChunk(io_recording, _frame);
+
+  if(c_chunk < 0)
+  {
+    return NULL;
+  }
+
+  const RecordChunk *c_info = &io_recording->chunks[c_chunk];
+  const Uint8 *c_start = io_recording->data + c_info->offset;
+
+  ByteReader reader;
+  reader.at = c_start + CHUNK_HEADER_SIZE;
+  reader.end = reader.at + getLittleEndian(c_start + 16, 4);
+  reader.isValid = true;
+
+  decodeKeyframe(&reader, &io_recording->frame);
+
+  for(Uint64 i = c_info->firstFrame; i < _frame && reader.isValid; ++i)
+  {
+    decodeDelta(&reader, &io_recording->frame, &io_recording->scratch);
+    swapFrames(&io_recording->frame, &io_recording->scratch);
+  }
+
+  if(!reader.isValid)
+  {
+    return NULL;
+  }
+
+  io_recording->chunk = c_chunk;
+  io_recording->frameIndex = _frame;
+  io_recording->position = (size_t)(reader.at - io_recording->data);
+  io_recording->chunkEnd = (size_t)(reader.end - io_recording->data);
+
+  return &io_recording->frame;
+}
+
+const RecordFrame *stepRecording(Recording *io_recording)
+{
+  if(io_recording->chunk < 0)
+  {
+    return NULL;
+  }
+
+  const RecordChunk *c_info = &io_recording->chunks[io_recording->chunk];
+  const Uint64 c_next = io_recording->frameIndex + 1;
+
+  // The next chunk starts with a keyframe, so seeking to it decodes nothing more
+  if(c_next >= c_info->firstFrame + c_info->frameCount)
+  {
+    return seekRecording(io_recording, c_next);
+  }
+
+  ByteReader reader;
+  reader.at = io_recording->data + io_recording->position;
+  reader.end = io_recording->data + io_recording->chunkEnd;
+  reader.isValid = true;
+
+  decodeDelta(&reader, &io_recording->frame, &io_recording->scratch);
+
+  if(!reader.isValid)
+  {
+    io_recording->chunk = -1;
+    return NULL;
+  }
+
+  swapFrames(&io_recording->frame, &io_recording->scratch);
+  io_recording->frameIndex = c_next;
+  io_recording->position = (size_t)(reader.at - io_recording->data);
+
+  return &io_recording->frame;
+}
+
+int inspectRecording(const char *_path,
+                     long _frame)
+{
+  Recording recording;
+
+  if(!openRecording(&recording, _path))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Decode everything once, which also checks the whole file
+  Uint64 decoded = 0;
+  for(int c = 0; c < recording.chunkCount; ++c)
+  {
+    for(const RecordFrame *frame = seekRecording(&recording, recording.chunks[c].firstFrame);
+        frame != NULL && recording.chunk == c;
+        frame = stepRecording(&recording))
+    {
+      decoded++;
+    }
+  }
+
+  printf("%s: %llu frames in %d chunks, %llu decoded, %zu bytes (%.1f per frame)\n",
+         _path, (unsigned long long)recording.frameCount, recording.chunkCount,
+         (unsigned long long)decoded, recording.size,
+         decoded > 0 ? (double)recording.size / (double)decoded : 0.0);
+
+  if(recording.frameCount == 0)
+  {
+    closeRecording(&recording);
+    return EXIT_SUCCESS;
+  }
+
+  const Uint64 c_target = (_frame < 0) ? recording.frameCount - 1 : (Uint64)_frame;
+
+  const Uint64 c_start = SDL_GetPerformanceCounter();
+  const RecordFrame *frame = seekRecording(&recording, c_target);
+  const Uint64 c_elapsed = SDL_GetPerformanceCounter() - c_start;
+
+  if(frame == NULL)
+  {
+    printf("Frame %llu was not recorded\n", (unsigned long long)c_target);
+    closeRecording(&recording);
+    return EXIT_FAILURE;
+  }
+
+  int gems = 0;
+  int knights = 0;
+  for(int i = 0; i < PICKUP_TOTAL; ++i)
+  {
+    knights += (frame->pickups[i].isVisible && frame->pickups[i].isKnight);
+    gems += (frame->pickups[i].isVisible && !frame->pickups[i].isKnight);
+  }
+
+  printf("Frame %llu, tick %u, sought in %.1fus%s\n",
+         (unsigned long long)c_target, frame->ticks,
+         (double)c_elapsed * 1000000.0 / (double)SDL_GetPerformanceFrequency(),
+         frame->state != GAME_RUNNING ? ", game over" : "");
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    const RecordPoint c_head = frame->segmentCount[p] > 0 ? frame->segments[p][0] : (RecordPoint){0, 0};
+
+    printf("  Player %d: score %d, %d segments, head at %d,%d\n",
+           p + 1, frame->scores[p], frame->segmentCount[p], c_head.x, c_head.y);
+  }
+
+  printf("  %d gems and %d knights left\n", gems, knights);
+
+  closeRecording(&recording);
+  return EXIT_SUCCESS;
+}
+
+///
+/// \brief RunWriter Thread entry point, writes queued chunks in order until told to quit,
+/// then drains whatever is left and finishes the file with the chunk index
+/// \param _data The Recorder
+///
+static int runWriter(void *_data)
+{
+  Recorder *recorder = _data;
+
+  setTraceThreadName("recording");
+
+  SDL_LockMutex(recorder->lock);
+
+  for(;;)
+  {
+    while(recorder->queueCount == 0 && !recorder->quit)
+    {
+      SDL_CondWait(recorder->isQueued, recorder->lock);
+    }
+
+    if(recorder->queueCount == 0)
+    {
+      break;
+    }
+
+    const int c_index = recorder->queue[recorder->queueHead];
+    const bool c_hasFailed = recorder->hasFailed;
+
+    SDL_UnlockMutex(recorder->lock);
+
+    TRACE_BEGIN("writeChunk");
+    const bool c_isWritten = !c_hasFailed && writeChunk(recorder, &recorder->buffers[c_index]);
+    TRACE_END("writeChunk");
+
+    SDL_LockMutex(recorder->lock);
+
+    recorder->queueHead = (recorder->queueHead + 1) % RECORD_BUFFERS;
+    recorder->queueCount--;
+    recorder->freeBuffers[recorder->freeCount++] = c_index;
+
+    // A full disk won't recover, so stop trying
+    if(!c_isWritten && !recorder->hasFailed)
+    {
+      printf("Recording stopped, the output could not be written\n");
+      recorder->hasFailed = true;
+    }
+  }
+
+  const bool c_hasFailed = recorder->hasFailed;
+
+  SDL_UnlockMutex(recorder->lock);
+
+  if(c_hasFailed)
+  {
+    return 0;
+  }
+
+  bool isWritten = true;
+
+  for(int i = 0; i < recorder->chunkCount && isWritten; ++i)
+  {
+    Uint8 entry[INDEX_ENTRY_SIZE];
+    putLittleEndian(entry,      recorder->chunks[i].firstFrame, 8);
+    putLittleEndian(entry + 8,  recorder->chunks[i].offset,     8);
+    putLittleEndian(entry + 16, recorder->chunks[i].frameCount, 4);
+
+    isWritten = (fwrite(entry, 1, INDEX_ENTRY_SIZE, recorder->output) == INDEX_ENTRY_SIZE);
+  }
+
+  Uint8 trailer[TRAILER_SIZE];
+  putLittleEndian(trailer,      recorder->offset,     8);
+  putLittleEndian(trailer + 8,  recorder->chunkCount, 4);
+  putLittleEndian(trailer + 12, INDEX_MAGIC,          4);
+
+  isWritten = isWritten && (fwrite(trailer, 1, TRAILER_SIZE, recorder->output) == TRAILER_SIZE);
+  isWritten = isWritten && (fflush(recorder->output) == 0);
+
+  if(!isWritten)
+  {
+    // Still readable, the chunks are walked instead of using the index
+    SDL_LockMutex(recorder->lock);
+    recorder->hasFailed = true;
+    SDL_UnlockMutex(recorder->lock);
+  }
+
+  return 0;
+}
+
+///
+/// \brief WriteChunk Writes one chunk and adds it to the index, on the writer thread
+/// \return False if it could not be written
+///
+static bool writeChunk(Recorder *io_recorder,
+                       const RecordBuffer *_buffer)
+{
+  const RecordChunk c_chunk = {_buffer->firstFrame, io_recorder->offset, _buffer->frameCount};
+
+  if(!addChunk(&io_recorder->chunks, &io_recorder->chunkCount, &io_recorder->chunkCapacity, &c_chunk))
+  {
+    return false;
+  }
+
+  Uint8 header[CHUNK_HEADER_SIZE];
+  putLittleEndian(header,      CHUNK_MAGIC,           4);
+  putLittleEndian(header + 4,  _buffer->frameCount,   4);
+  putLittleEndian(header + 8,  _buffer->firstFrame,   8);
+  putLittleEndian(header + 16, _buffer->size,         4);
+
+  if(fwrite(header, 1, CHUNK_HEADER_SIZE, io_recorder->output) != CHUNK_HEADER_SIZE ||
+     fwrite(_buffer->bytes, 1, _buffer->size, io_recorder->output) != _buffer->size)
+  {
+    io_recorder->chunkCount--;
+    return false;
+  }
+
+  io_recorder->offset += CHUNK_HEADER_SIZE + _buffer->size;
+
+  return true;
+}
+
+///
+/// \brief TakeBuffer Claims a free buffer for the next chunk
+/// \return Its index, or -1 if every buffer is waiting for the writer or writing has failed
+///
+static int takeBuffer(Recorder *io_recorder)
+{
+  SDL_LockMutex(io_recorder->lock);
+
+  int index = -1;
+
+  if(io_recorder->freeCount > 0 && !io_recorder->hasFailed)
+  {
+    index = io_recorder->freeBuffers[--io_recorder->freeCount];
+  }
+
+  SDL_UnlockMutex(io_recorder->lock);
+
+  return index;
+}
+
+///
+/// \brief ReleaseBuffer Hands a chunk to the writer, or puts the buffer back if it isn't to be written
+///
+static void releaseBuffer(Recorder *io_recorder,
+                          int _index,
+                          bool _isQueued)
+{
+  SDL_LockMutex(io_recorder->lock);
+
+  if(_isQueued)
+  {
+    io_recorder->queue[(io_recorder->queueHead + io_recorder->queueCount) % RECORD_BUFFERS] = _index;
+    io_recorder->queueCount++;
+    SDL_CondSignal(io_recorder->isQueued);
+  }
+  else
+  {
+    io_recorder->freeBuffers[io_recorder->freeCount++] = _index;
+  }
+
+  SDL_UnlockMutex(io_recorder->lock);
+}
+
+///
+/// \brief FreeRecorder Closes the file and frees everything, once the writer has stopped
+///
+static void freeRecorder(Recorder *io_recorder)
+{
+  if(io_recorder->output)
+  {
+    fclose(io_recorder->output);
+  }
+
+  for(int i = 0; i < RECORD_BUFFERS; ++i)
+  {
+    freeMemory(io_recorder->buffers[i].bytes);
+  }
+
+  freeFrame(&io_recorder->frame);
+  freeFrame(&io_recorder->previous);
+  freeMemory(io_recorder->chunks);
+  freeMemory(io_recorder->outputBuffer);
+
+  if(io_recorder->isQueued)
+  {
+    SDL_DestroyCond(io_recorder->isQueued);
+  }
+
+  if(io_recorder->lock)
+  {
+    SDL_DestroyMutex(io_recorder->lock);
+  }
+
+  io_recorder->output = NULL;
+  io_recorder->outputBuffer = NULL;
+  io_recorder->chunks = NULL;
+  io_recorder->isQueued = NULL;
+  io_recorder->lock = NULL;
+}
+
+static void initialiseFrame(RecordFrame *o_frame)
+{
+  memset(o_frame, 0, sizeof(RecordFrame));
+}
+
+static void freeFrame(RecordFrame *io_frame)
+{
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    freeMemory(io_frame->segments[p]);
+  }
+
+  initialiseFrame(io_frame);
+}
+
+static void swapFrames(RecordFrame *io_a,
+                       RecordFrame *io_b)
+{
+  const RecordFrame c_temp = *io_a;
+  *io_a = *io_b;
+  *io_b = c_temp;
+}
+
+///
+/// \brief ReserveSegments Grows a player's segment array to hold _count segments
+/// \return False if it could not be grown
+///
+static bool reserveSegments(RecordFrame *io_frame,
+                            int _player,
+                            int _count)
+{
+  if(_count <= io_frame->segmentCapacity[_player])
+  {
+    return true;
+  }
+
+  const int c_capacity = _count * 2;
+  RecordPoint *segments = reallocateMemory(MEMORY_REPLAYS, io_frame->segments[_player], c_capacity * sizeof(RecordPoint));
+
+  if(segments == NULL)
+  {
+    return false;
+  }
+
+  io_frame->segments[_player] = segments;
+  io_frame->segmentCapacity[_player] = c_capacity;
+
+  return true;
+}
+
+///
+/// \brief FillFrame Copies what is recorded out of the game
+/// \return False if a segment array could not be grown
+///
+static bool fillFrame(RecordFrame *io_frame,
+                      const Game *_game)
+{
+  io_frame->ticks = _game->ticks;
+  io_frame->state = _game->state;
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    const Player *player = &_game->players[p];
+
+    // Count from the tail, growsnake only links new tails backwards
+    int count = 0;
+    for(const Node *node = player->tail; node != NULL; node = node->prev)
+    {
+      count++;
+    }
+
+    if(!reserveSegments(io_frame, p, count))
+    {
+      return false;
+    }
+
+    int i = count;
+    for(const Node *node = player->tail; node != NULL; node = node->prev)
+    {
+      --i;
+      io_frame->segments[p][i].x = node->pos.x;
+      io_frame->segments[p][i].y = node->pos.y;
+    }
+
+    io_frame->segmentCount[p] = count;
+    io_frame->scores[p] = player->pickupCount;
+  }
+
+  // Pickups are recorded by id, collected ones are left blank so they never change again
+  memset(io_frame->pickups, 0, sizeof(io_frame->pickups));
+
+  const Gems *c_gems = &_game->pickups.gems;
+
+  for(int i = 0; i < c_gems->count; ++i)
+  {
+    RecordPickup *recorded = &io_frame->pickups[c_gems->id[i]];
+
+    recorded->x = c_gems->x[i];
+    recorded->y = c_gems->y[i];
+    recorded->type = c_gems->type[i];
+    recorded->isVisible = true;
+  }
+
+  const Knights *c_knights = &_game->pickups.knights;
+
+  for(int i = 0; i < c_knights->count; ++i)
+  {
+    RecordPickup *recorded = &io_frame->pickups[c_knights->id[i]];
+
+    recorded->x = c_knights->x[i];
+    recorded->y = c_knights->y[i];
+    recorded->type = c_knights->direction[i];
+    recorded->isKnight = true;
+    recorded->isVisible = true;
+  }
+
+  return true;
+}
+
+///
+/// \brief PredictSegment Where a segment is expected to be from the frame before. A moving
+/// snake takes its tail to the front, so every segment is where the one ahead of it was,
+/// otherwise it hasn't moved at all
+///
+static RecordPoint predictSegment(const RecordFrame *_previous,
+                                  int _player,
+                                  int _index,
+                                  bool _isShifted)
+{
+  const int c_count = _previous->segmentCount[_player];
+
+  if(c_count == 0)
+  {
+    return (RecordPoint){0, 0};
+  }
+
+  int from = _isShifted ? _index - 1 : _index;
+  from = (from < 0) ? 0 : (from >= c_count ? c_count - 1 : from);
+
+  return _previous->segments[_player][from];
+}
+
+static bool isSamePickup(const RecordPickup *_a,
+                         const RecordPickup *_b)
+{
+  return _a->x == _b->x && _a->y == _b->y && _a->type == _b->type &&
+         _a->isKnight == _b->isKnight && _a->isVisible == _b->isVisible;
+}
+
+///
+/// \brief GetFrameBound The most bytes a frame can take, as a keyframe or a delta
+///
+static size_t getFrameBound(const RecordFrame *_frame)
+{
+  // Varints take at most 10 bytes
+  size_t bound = 32 + PICKUP_TOTAL * 41;
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    bound += 32 + (size_t)_frame->segmentCount[p] * 30;
+  }
+
+  return bound;
+}
+
+static void putVarint(RecordBuffer *io_buffer,
+                      Uint64 _value)
+{
+  while(_value >= 0x80)
+  {
+    io_buffer->bytes[io_buffer->size++] = (Uint8)(_value | 0x80);
+    _value >>= 7;
+  }
+
+  io_buffer->bytes[io_buffer->size++] = (Uint8)_value;
+}
+
+///
+/// \brief PutSigned Zigzag encodes so small negative numbers stay small
+///
+static void putSigned(RecordBuffer *io_buffer,
+                      Sint64 _value)
+{
+  putVarint(io_buffer, (_value < 0) ? (((Uint64)(-(_value + 1))) << 1) | 1 : ((Uint64)_value) << 1);
+}
+
+///
+/// \brief EncodeKeyframe Writes a whole frame, each segment relative to the one before it
+///
+static void encodeKeyframe(RecordBuffer *io_buffer,
+                           const RecordFrame *_frame)
+{
+  putVarint(io_buffer, _frame->ticks);
+  putVarint(io_buffer, _frame->state);
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    putSigned(io_buffer, _frame->scores[p]);
+    putVarint(io_buffer, (Uint64)_frame->segmentCount[p]);
+
+    RecordPoint last = {0, 0};
+
+    for(int i = 0; i < _frame->segmentCount[p]; ++i)
+    {
+      const RecordPoint c_point = _frame->segments[p][i];
+
+      putSigned(io_buffer, c_point.x - last.x);
+      putSigned(io_buffer, c_point.y - last.y);
+      last = c_point;
+    }
+  }
+
+  for(int i = 0; i < PICKUP_TOTAL; ++i)
+  {
+    const RecordPickup *c_pickup = &_frame->pickups[i];
+
+    putSigned(io_buffer, c_pickup->x);
+    putSigned(io_buffer, c_pickup->y);
+    putVarint(io_buffer, (Uint64)c_pickup->type);
+    putVarint(io_buffer, (Uint64)(c_pickup->isVisible | (c_pickup->isKnight << 1)));
+  }
+}
+
+///
+/// \brief EncodeDelta Writes only what differs from the frame before: for each snake,
+/// whichever of shifted along or standing still predicts more segments, then every
+/// segment the prediction got wrong, then every pickup that changed
+///
+static void encodeDelta(RecordBuffer *io_buffer,
+                        const RecordFrame *_previous,
+                        const RecordFrame *_frame)
+{
+  putSigned(io_buffer, (Sint64)_frame->ticks - (Sint64)_previous->ticks);
+  putVarint(io_buffer, _frame->state);
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    const int c_count = _frame->segmentCount[p];
+    const RecordPoint *c_segments = _frame->segments[p];
+
+    putSigned(io_buffer, _frame->scores[p] - _previous->scores[p]);
+    putVarint(io_buffer, (Uint64)c_count);
+
+    int misses[2] = {0, 0};
+
+    for(int i = 0; i < c_count; ++i)
+    {
+      for(int shifted = 0; shifted < 2; ++shifted)
+      {
+        const RecordPoint c_predicted = predictSegment(_previous, p, i, shifted);
+        misses[shifted] += (c_predicted.x != c_segments[i].x || c_predicted.y != c_segments[i].y);
+      }
+    }
+
+    const bool c_isShifted = misses[1] < misses[0];
+
+    putVarint(io_buffer, c_isShifted);
+    putVarint(io_buffer, (Uint64)misses[c_isShifted]);
+
+    int last = -1;
+
+    for(int i = 0; i < c_count; ++i)
+    {
+      const RecordPoint c_predicted = predictSegment(_previous, p, i, c_isShifted);
+
+      if(c_predicted.x != c_segments[i].x || c_predicted.y != c_segments[i].y)
+      {
+        putVarint(io_buffer, (Uint64)(i - last - 1));
+        putSigned(io_buffer, c_segments[i].x - c_predicted.x);
+        putSigned(io_buffer, c_segments[i].y - c_predicted.y);
+        last = i;
+      }
+    }
+  }
+
+  int changed = 0;
+  for(int i = 0; i < PICKUP_TOTAL; ++i)
+  {
+    changed += !isSamePickup(&_previous->pickups[i], &_frame->pickups[i]);
+  }
+
+  putVarint(io_buffer, (Uint64)changed);
+
+  int last = -1;
+
+  for(int i = 0; i < PICKUP_TOTAL; ++i)
+  {
+    const RecordPickup *c_old = &_previous->pickups[i];
+    const RecordPickup *c_new = &_frame->pickups[i];
+
+    if(!isSamePickup(c_old, c_new))
+    {
+      putVarint(io_buffer, (Uint64)(i - last - 1));
+      putSigned(io_buffer, c_new->x - c_old->x);
+      putSigned(io_buffer, c_new->y - c_old->y);
+      putVarint(io_buffer, (Uint64)c_new->type);
+      putVarint(io_buffer, (Uint64)(c_new->isVisible | (c_new->isKnight << 1)));
+      last = i;
+    }
+  }
+}
+
+static Uint64 getVarint(ByteReader *io_reader)
+{
+  Uint64 value = 0;
+
+  for(int shift = 0; shift < 64; shift += 7)
+  {
+    if(io_reader->at >= io_reader->end)
+    {
+      io_reader->isValid = false;
+      return 0;
+    }
+
+    const Uint8 c_byte = *io_reader->at++;
+    value |= (Uint64)(c_byte & 0x7F) << shift;
+
+    if((c_byte & 0x80) == 0)
+    {
+      return value;
+    }
+  }
+
+  io_reader->isValid = false;
+  return 0;
+}
+
+static Sint64 getSigned(ByteReader *io_reader)
+{
+  const Uint64 c_value = getVarint(io_reader);
+
+  return (c_value & 1) ? -(Sint64)(c_value >> 1) - 1 : (Sint64)(c_value >> 1);
+}
+
+///
+/// \brief GetCount Reads a segment or pickup count, anything too large is a corrupt recording
+///
+static int getCount(ByteReader *io_reader,
+                    int _maximum)
+{
+  const Uint64 c_count = getVarint(io_reader);
+
+  if(c_count > (Uint64)_maximum)
+  {
+    io_reader->isValid = false;
+    return 0;
+  }
+
+  return (int)c_count;
+}
+
+static void decodeKeyframe(ByteReader *io_reader,
+                           RecordFrame *o_frame)
+{
+  o_frame->ticks = (unsigned int)getVarint(io_reader);
+  o_frame->state = (GameState)getVarint(io_reader);
+
+  for(int p = 0; p < PLAYER_TOTAL && io_reader->isValid; ++p)
+  {
+    o_frame->scores[p] = (int)getSigned(io_reader);
+
+    const int c_count = getCount(io_reader, MAX_SEGMENTS);
+
+    if(!reserveSegments(o_frame, p, c_count))
+    {
+      io_reader->isValid = false;
+      return;
+    }
+
+    RecordPoint last = {0, 0};
+
+    for(int i = 0; i < c_count && io_reader->isValid; ++i)
+    {
+      last.x += (int)getSigned(io_reader);
+      last.y += (int)getSigned(io_reader);
+      o_frame->segments[p][i] = last;
+    }
+
+    o_frame->segmentCount[p] = io_reader->isValid ? c_count : 0;
+  }
+
+  for(int i = 0; i < PICKUP_TOTAL && io_reader->isValid; ++i)
+  {
+    RecordPickup *pickup = &o_frame->pickups[i];
+    pickup->x = (int)getSigned(io_reader);
+    pickup->y = (int)getSigned(io_reader);
+    pickup->type = (int)getVarint(io_reader);
+
+    const Uint64 c_flags = getVarint(io_reader);
+    pickup->isVisible = (c_flags & 1) != 0;
+    pickup->isKnight = (c_flags & 2) != 0;
+  }
+}
+
+static void decodeDelta(ByteReader *io_reader,
+                        const RecordFrame *_previous,
+                        RecordFrame *o_frame)
+{
+  o_frame->ticks = (unsigned int)((Sint64)_previous->ticks + getSigned(io_reader));
+  o_frame->state = (GameState)getVarint(io_reader);
+
+  for(int p = 0; p < PLAYER_TOTAL && io_reader->isValid; ++p)
+  {
+    o_frame->scores[p] = _previous->scores[p] + (int)getSigned(io_reader);
+
+    const int c_count = getCount(io_reader, MAX_SEGMENTS);
+    const bool c_isShifted = getVarint(io_reader) != 0;
+    const int c_misses = getCount(io_reader, c_count);
+
+    if(!io_reader->isValid || !reserveSegments(o_frame, p, c_count))
+    {
+      io_reader->isValid = false;
+      return;
+    }
+
+    RecordPoint *segments = o_frame->segments[p];
+
+    for(int i = 0; i < c_count; ++i)
+    {
+      segments[i] = predictSegment(_previous, p, i, c_isShifted);
+    }
+
+    int last = -1;
+
+    for(int m = 0; m < c_misses && io_reader->isValid; ++m)
+    {
+      const int c_index = last + 1 + getCount(io_reader, c_count);
+
+      if(c_index >= c_count)
+      {
+        io_reader->isValid = false;
+        return;
+      }
+
+      segments[c_index].x += (int)getSigned(io_reader);
+      segments[c_index].y += (int)getSigned(io_reader);
+      last = c_index;
+    }
+
+    o_frame->segmentCount[p] = c_count;
+  }
+
+  memcpy(o_frame->pickups, _previous->pickups, sizeof(o_frame->pickups));
+
+  const int c_changed = getCount(io_reader, PICKUP_TOTAL);
+  int last = -1;
+
+  for(int c = 0; c < c_changed && io_reader->isValid; ++c)
+  {
+    const int c_index = last + 1 + getCount(io_reader, PICKUP_TOTAL);
+
+    if(c_index >= PICKUP_TOTAL)
+    {
+      io_reader->isValid = false;
+      return;
+    }
+
+    RecordPickup *pickup = &o_frame->pickups[c_index];
+    pickup->x += (int)getSigned(io_reader);
+    pickup->y += (int)getSigned(io_reader);
+    pickup->type = (int)getVarint(io_reader);
+
+    const Uint64 c_flags = getVarint(io_reader);
+    pickup->isVisible = (c_flags & 1) != 0;
+    pickup->isKnight = (c_flags & 2) != 0;
+
+    last = c_index;
+  }
+}
+
+static void putLittleEndian(Uint8 *o_bytes,
+                            Uint64 _value,
+                            int _size)
+{
+  for(int i = 0; i < _size; ++i)
+  {
+    o_bytes[i] = (Uint8)(_value >> (8 * i));
+  }
+}
+
+static Uint64 getLittleEndian(const Uint8 *_bytes,
+                              int _size)
+{
+  Uint64 value = 0;
+
+  for(int i = 0; i < _size; ++i)
+  {
+    value |= (Uint64)_bytes[i] << (8 * i);
+  }
+
+  return value;
+}
+
+static bool addChunk(RecordChunk **io_chunks,
+                     int *io_count,
+                     int *io_capacity,
+                     const RecordChunk *_chunk)
+{
+  if(*io_count == *io_capacity)
+  {
+    const int c_capacity = (*io_capacity > 0) ? *io_capacity * 2 : 64;
+    RecordChunk *chunks = reallocateMemory(MEMORY_REPLAYS, *io_chunks, c_capacity * sizeof(RecordChunk));
+
+    if(chunks == NULL)
+    {
+      return false;
+    }
+
+    *io_chunks = chunks;
+    *io_capacity = c_capacity;
+  }
+
+  (*io_chunks)[(*io_count)++] = *_chunk;
+
+  return true;
+}
+
+///
+/// \brief ReadChunkIndex Reads the index from the end of the file, or walks the chunks
+/// from the start if the recording was cut short, and checks every chunk it finds
+/// \return False if the index is damaged or memory ran out
+///
+static bool readChunkIndex(Recording *io_recording)
+{
+  const Uint8 *c_data = io_recording->data;
+  const size_t c_size = io_recording->size;
+  int capacity = 0;
+
+  size_t chunksEnd = c_size;
+
+  if(c_size >= HEADER_SIZE + TRAILER_SIZE &&
+     getLittleEndian(c_data + c_size - TRAILER_SIZE + 12, 4) == INDEX_MAGIC)
+  {
+    const Uint8 *c_trailer = c_data + c_size - TRAILER_SIZE;
+    const Uint64 c_indexOffset = getLittleEndian(c_trailer, 8);
+    const Uint64 c_chunkCount = getLittleEndian(c_trailer + 8, 4);
+    const Uint64 c_indexEnd = c_size - TRAILER_SIZE;
+
+    // Every offset and count comes from the file, so nothing is added to them until they
+    // are known to be in range, a huge offset could otherwise wrap round and pass
+    if(c_indexOffset < HEADER_SIZE ||
+       c_indexOffset > c_indexEnd ||
+       (c_indexEnd - c_indexOffset) % INDEX_ENTRY_SIZE != 0 ||
+       c_chunkCount != (c_indexEnd - c_indexOffset) / INDEX_ENTRY_SIZE)
+    {
+      return false;
+    }
+
+    for(Uint64 i = 0; i < c_chunkCount; ++i)
+    {
+      const Uint8 *c_entry = c_data + c_indexOffset + i * INDEX_ENTRY_SIZE;
+      const RecordChunk c_chunk = {getLittleEndian(c_entry, 8), getLittleEndian(c_entry + 8, 8),
+                                   (unsigned int)getLittleEndian(c_entry + 16, 4)};
+
+      if(!addChunk(&io_recording->chunks, &io_recording->chunkCount, &capacity, &c_chunk))
+      {
+        return false;
+      }
+    }
+
+    chunksEnd = (size_t)c_indexOffset;
+  }
+  else
+  {
+    size_t offset = HEADER_SIZE;
+
+    while(offset + CHUNK_HEADER_SIZE <= c_size && getLittleEndian(c_data + offset, 4) == CHUNK_MAGIC)
+    {
+      const Uint64 c_end = offset + CHUNK_HEADER_SIZE + getLittleEndian(c_data + offset + 16, 4);
+
+      if(c_end > c_size)
+      {
+        break;
+      }
+
+      const RecordChunk c_chunk = {getLittleEndian(c_data + offset + 8, 8), offset,
+                                   (unsigned int)getLittleEndian(c_data + offset + 4, 4)};
+
+      if(!addChunk(&io_recording->chunks, &io_recording->chunkCount, &capacity, &c_chunk))
+      {
+        return false;
+      }
+
+      offset = (size_t)c_end;
+    }
+  }
+
+  // Chunks must be in order and lie where their headers say, findChunk relies on both
+  Uint64 nextFrame = 0;
+
+  for(int i = 0; i < io_recording->chunkCount; ++i)
+  {
+    const RecordChunk *c_chunk = &io_recording->chunks[i];
+
+    if(c_chunk->offset > chunksEnd ||
+       CHUNK_HEADER_SIZE > chunksEnd - c_chunk->offset ||
+       getLittleEndian(c_data + c_chunk->offset, 4) != CHUNK_MAGIC ||
+       getLittleEndian(c_data + c_chunk->offset + 16, 4) > chunksEnd - c_chunk->offset - CHUNK_HEADER_SIZE ||
+       c_chunk->frameCount == 0 ||
+       c_chunk->firstFrame < nextFrame ||
+       c_chunk->firstFrame > ~(Uint64)0 - c_chunk->frameCount)
+    {
+      return false;
+    }
+
+    nextFrame = c_chunk->firstFrame + c_chunk->frameCount;
+  }
+
+  io_recording->frameCount = nextFrame;
+
+  return true;
+}
+
+///
+/// \brief FindChunk Binary searches the index for the chunk holding a frame
+/// \return Its index, or -1 if the frame is past the end or in a dropped chunk
+///
+static int findChunk(const Recording *_recording,
+                     Uint64 _frame)
+{
+  int low = 0;
+  int high = _recording->chunkCount - 1;
+  int found = -1;
+
+  while(low <= high)
+  {
+    const int c_middle = (low + high) / 2;
+
+    if(_recording->chunks[c_middle].firstFrame <= _frame)
+    {
+      found = c_middle;
+      low = c_middle + 1;
+    }
+    else
+    {
+      high = c_middle - 1;
+    }
+  }
+
+  if(found < 0 || _frame >= _recording->chunks[found].firstFrame + _recording->chunks[found].frameCount)
+  {
+    return -1;
+  }
+
+  return found;
+}
@@ -0,0 +1,163 @@
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "game.h"
+
+// Frames per chunk, each chunk starts with a keyframe so this is the most a seek decodes
+#define RECORD_CHUNK_FRAMES (128)
+// Encoded chunks that can be waiting for the writer before new ones are dropped
+#define RECORD_BUFFERS      (4)
+
+// The state of the match after one published tick, enough to analyse it afterwards
+typedef struct RecordPoint{
+  int x;
+  int y;
+} RecordPoint;
+
+typedef struct RecordPickup{
+  int x;
+  int y;
+  int type;           // Gem colour, or the knight's direction
+  bool isKnight;
+  bool isVisible;
+} RecordPickup;
+
+typedef struct RecordFrame{
+  unsigned int ticks;
+  GameState state;
+  int scores[PLAYER_TOTAL];
+
+  RecordPoint *segments[PLAYER_TOTAL];  // Top left of each segment, head first
+  int segmentCount[PLAYER_TOTAL];
+  int segmentCapacity[PLAYER_TOTAL];
+
+  RecordPickup pickups[PICKUP_TOTAL];
+} RecordFrame;
+
+typedef struct RecordBuffer{
+  Uint8 *bytes;
+  size_t size;
+  size_t capacity;
+  Uint64 firstFrame;
+  unsigned int frameCount;
+} RecordBuffer;
+
+// Where each chunk is in the file, written as the index at the end
+typedef struct RecordChunk{
+  Uint64 firstFrame;
+  Uint64 offset;
+  unsigned int frameCount;
+} RecordChunk;
+
+// Records every published tick to a chunked file. Each chunk holds a keyframe followed by
+// every other tick as a delta from the one before, which is tiny as a moving snake mostly
+// shifts along by one segment. The simulation thread only encodes into a buffer from the
+// pool, a writer thread does the I/O and keeps the chunk index, so a slow disk drops
+// whole chunks rather than stalling a tick
+typedef struct Recorder{
+  FILE *output;
+  char *outputBuffer;
+
+  // Only touched by the simulation thread
+  RecordFrame frame;
+  RecordFrame previous;
+  int active;                 // Buffer being filled, -1 while dropping to the next chunk
+  Uint64 frameCount;
+
+  RecordBuffer buffers[RECORD_BUFFERS];
+
+  SDL_mutex *lock;            // Guards the queues and flags below
+  SDL_cond *isQueued;
+  int freeBuffers[RECORD_BUFFERS];
+  int freeCount;
+  int queue[RECORD_BUFFERS];  // Ring of chunks waiting to be written, oldest first
+  int queueHead;
+  int queueCount;
+  bool quit;
+  bool hasFailed;
+
+  // Only touched by the writer thread until it has finished
+  RecordChunk *chunks;
+  int chunkCount;
+  int chunkCapacity;
+  Uint64 offset;
+
+  SDL_Thread *thread;
+} Recorder;
+
+// A recording opened for reading, mapped into memory so seeking costs nothing until a
+// chunk is decoded
+typedef struct Recording{
+  const Uint8 *data;
+  size_t size;
+
+  RecordChunk *chunks;
+  int chunkCount;
+  Uint64 frameCount;          // One past the last recorded frame
+
+  // Left by the last seek or step
+  RecordFrame frame;
+  RecordFrame scratch;
+  Uint64 frameIndex;
+  int chunk;                  // -1 until a frame has been decoded
+  size_t position;            // Start of the next delta in data
+  size_t chunkEnd;
+} Recording;
+
+///
+/// \brief StartRecording Opens the file and starts the writer thread
+/// \param o_recorder
+/// \param _path
+/// \return False if the file, the buffers or the thread could not be created
+///
+bool startRecording(Recorder *o_recorder, const char *_path);
+
+///
+/// \brief StopRecording Writes the unfinished chunk and everything still queued, then the
+/// chunk index, and reports the totals
+///
+void stopRecording(Recorder *io_recorder);
+
+///
+/// \brief RecordGame Encodes the game as the next frame, called by the simulation thread
+/// after every published tick. Never waits on the writer
+///
+void recordGame(Recorder *io_recorder, const Game *_game);
+
+///
+/// \brief OpenRecording Maps a recording and reads its chunk index, rebuilding the index
+/// by walking the chunks if the recording was never finished
+/// \param o_recording
+/// \param _path
+/// \return False if the file could not be mapped or is not a recording
+///
+bool openRecording(Recording *o_recording, const char *_path);
+
+void closeRecording(Recording *io_recording);
+
+///
+/// \brief SeekRecording Decodes the keyframe of the frame's chunk and the deltas up to it
+/// \param io_recording
+/// \param _frame
+/// \return The frame, valid until the next seek or step, or NULL if it was not recorded
+///
+const RecordFrame *seekRecording(Recording *io_recording, Uint64 _frame);
+
+///
+/// \brief StepRecording Decodes the frame after the last one sought or stepped to
+/// \return The frame, or NULL at the end of the recording or a dropped chunk
+///
+const RecordFrame *stepRecording(Recording *io_recording);
+
+///
+/// \brief InspectRecording Prints a recording's size and the state at one frame
+/// \param _path
+/// \param _frame Frame to print, or -1 for the last one
+/// \return EXIT_SUCCESS, or EXIT_FAILURE if the recording could not be read
+///
+int inspectRecording(const char *_path, long _frame);
+
+#endif // RECORDING_H
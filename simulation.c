@@ -0,0 +1,557 @@
+#include "simulation.h"
+
+#include "trace.h"
+
+static int runSimulation(void *_data);
+static void tickSimulation(Simulation *io_sim);
+static void tickNetplay(Simulation *io_sim);
+static void publishGame(Simulation *io_sim);
+static void showGame(Simulation *io_sim);
+static void exportGame(Simulation *io_sim, const Game *_game);
+static void exportFinalGames(Simulation *io_sim);
+static void addTickCost(Simulation *io_sim, Uint64 _cost);
+static void playTickSounds(Simulation *io_sim, const int _pickupCounts[PLAYER_TOTAL],
+                           const bool _hasCollided[PLAYER_TOTAL], GameState _state);
+
+bool startSimulation(Simulation *o_sim,
+                     const Options *_options,
+                     unsigned int _seed,
+                     Mixer *_mixer,
+                     Metrics *_metrics)
+{
+  o_sim->options = _options;
+  o_sim->mixer = _mixer;
+  o_sim->metrics = _metrics;
+  o_sim->hasMap = _options->mapPath != NULL;
+
+  if(o_sim->hasMap && !loadArenaMap(&o_sim->map, _options->mapPath, WIDTH, HEIGHT))
+  {
+    return false;
+  }
+
+  const ArenaMap *c_map = o_sim->hasMap ? &o_sim->map : NULL;
+  o_sim->isRespawning = _options->isRespawning;
+
+  if(o_sim->isRespawning && !createPickupSpawner(&o_sim->spawner, WIDTH, HEIGHT, PICKUP_SIZE, c_map))
+  {
+    if(o_sim->hasMap)
+    {
+      freeArenaMap(&o_sim->map);
+    }
+
+    return false;
+  }
+
+  o_sim->hasAIPlayer = _options->isAIPlayer[0] || _options->isAIPlayer[1];
+
+  if(o_sim->hasAIPlayer && !createAIPlanner(&o_sim->planner, SNAKE_RADIUS, _options->aiBudgetUs, c_map))
+  {
+    if(o_sim->isRespawning)
+    {
+      freePickupSpawner(&o_sim->spawner);
+    }
+
+    if(o_sim->hasMap)
+    {
+      freeArenaMap(&o_sim->map);
+    }
+
+    return false;
+  }
+
+  o_sim->isNetplay = isNetplay(_options);
+
+  if(o_sim->isNetplay && !startNetplay(&o_sim->netplay, _options->hostPort, _options->joinAddress))
+  {
+    if(o_sim->hasAIPlayer)
+    {
+      freeAIPlanner(&o_sim->planner);
+    }
+
+    if(o_sim->isRespawning)
+    {
+      freePickupSpawner(&o_sim->spawner);
+    }
+
+    if(o_sim->hasMap)
+    {
+      freeArenaMap(&o_sim->map);
+    }
+
+    return false;
+  }
+
+  o_sim->hasFeed = _options->feedName != NULL;
+  o_sim->isRecording = _options->recordPath != NULL;
+
+  if((o_sim->hasFeed && !openStateFeed(&o_sim->feed, _options->feedName)) ||
+     (o_sim->isRecording && !startRecording(&o_sim->recorder, _options->recordPath)))
+  {
+    if(o_sim->hasFeed && o_sim->feed.header != NULL)
+    {
+      closeStateFeed(&o_sim->feed);
+    }
+
+    if(o_sim->isNetplay)
+    {
+      stopNetplay(&o_sim->netplay);
+    }
+
+    if(o_sim->hasAIPlayer)
+    {
+      freeAIPlanner(&o_sim->planner);
+    }
+
+    if(o_sim->isRespawning)
+    {
+      freePickupSpawner(&o_sim->spawner);
+    }
+
+    if(o_sim->hasMap)
+    {
+      freeArenaMap(&o_sim->map);
+    }
+
+    return false;
+  }
+
+  initialiseGame(&o_sim->game, _seed, c_map, o_sim->isRespawning ? &o_sim->spawner : NULL,
+                 _options->snakeLength, _options->tickMoves);
+  initialiseTripleBuffer(&o_sim->snapshots);
+
+  // Starts out as the same match, which is published below
+  if(o_sim->isNetplay)
+  {
+    initialiseGame(&o_sim->finalGame, _seed, c_map, NULL, _options->snakeLength, _options->tickMoves);
+    o_sim->finalTick = 0;
+  }
+
+  o_sim->tickCost = 0;
+  o_sim->tickCostCount = 0;
+  o_sim->tickMicroseconds = 0;
+  o_sim->match = 0;
+  o_sim->snapshotFailures = 0;
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    SDL_AtomicSet(&o_sim->inputs[p], NOTMOVING);
+  }
+  SDL_AtomicSet(&o_sim->restartSeed, 0);
+  SDL_AtomicSet(&o_sim->restart, false);
+  SDL_AtomicSet(&o_sim->quit, false);
+
+  // Make sure there is something to draw before the first tick
+  publishGame(o_sim);
+
+  o_sim->thread = SDL_CreateThread(runSimulation, "simulation", o_sim);
+
+  if(!o_sim->thread)
+  {
+    printf("%s\n", SDL_GetError());
+    stopSimulation(o_sim);
+    return false;
+  }
+
+  return true;
+}
+
+void stopSimulation(Simulation *io_sim)
+{
+  SDL_AtomicSet(&io_sim->quit, true);
+
+  if(io_sim->thread)
+  {
+    SDL_WaitThread(io_sim->thread, NULL);
+    io_sim->thread = NULL;
+  }
+
+  if(io_sim->isNetplay)
+  {
+    stopNetplay(&io_sim->netplay);
+  }
+
+  if(io_sim->hasFeed)
+  {
+    closeStateFeed(&io_sim->feed);
+  }
+
+  if(io_sim->isRecording)
+  {
+    stopRecording(&io_sim->recorder);
+  }
+
+  freeGame(&io_sim->game);
+  freeTripleBuffer(&io_sim->snapshots);
+
+  if(io_sim->isNetplay)
+  {
+    freeGame(&io_sim->finalGame);
+  }
+
+  if(io_sim->hasAIPlayer)
+  {
+    freeAIPlanner(&io_sim->planner);
+  }
+
+  if(io_sim->isRespawning)
+  {
+    freePickupSpawner(&io_sim->spawner);
+  }
+
+  if(io_sim->hasMap)
+  {
+    freeArenaMap(&io_sim->map);
+  }
+}
+
+void setSimulationInput(Simulation *io_sim,
+                        int _player,
+                        Move _move)
+{
+  SDL_AtomicSet(&io_sim->inputs[_player], _move);
+}
+
+void restartSimulation(Simulation *io_sim,
+                       unsigned int _seed)
+{
+  // The seed is stored first, setting the flag is a full barrier so it's seen along with it
+  SDL_AtomicSet(&io_sim->restartSeed, (int)_seed);
+  SDL_AtomicSet(&io_sim->restart, true);
+}
+
+///
+/// \brief RunSimulation Thread entry point, ticks every GAME_TICK_DELAY ms for each move a tick
+/// takes until told to quit
+/// \param _data The Simulation
+///
+static int runSimulation(void *_data)
+{
+  Simulation *sim = _data;
+  const Uint32 c_tickDelay = GAME_TICK_DELAY * (Uint32)sim->game.movesPerTick;
+
+  setTraceThreadName("simulation");
+
+  Uint32 nextTick = SDL_GetTicks() + c_tickDelay;
+
+  while(!SDL_AtomicGet(&sim->quit))
+  {
+    const Uint32 c_now = SDL_GetTicks();
+
+    if(c_now < nextTick)
+    {
+      SDL_Delay(nextTick - c_now);
+      continue;
+    }
+
+    // If we have fallen well behind (e.g. the process was suspended),
+    // carry on from now rather than running a burst of catch-up ticks
+    nextTick += c_tickDelay;
+    if(c_now > nextTick + c_tickDelay*4)
+    {
+      nextTick = c_now + c_tickDelay;
+    }
+
+    // The snake segments, pickups, planner and snapshots are all reused by the new match
+    if(SDL_AtomicGet(&sim->restart) && !sim->isNetplay)
+    {
+      resetGame(&sim->game, (unsigned int)SDL_AtomicGet(&sim->restartSeed));
+      sim->match++;
+
+      if(sim->hasAIPlayer)
+      {
+        resetAIPlanner(&sim->planner);
+      }
+
+      for(int p = 0; p < PLAYER_TOTAL; ++p)
+      {
+        SDL_AtomicSet(&sim->inputs[p], NOTMOVING);
+      }
+
+      publishGame(sim);
+      SDL_AtomicSet(&sim->restart, false);
+
+      nextTick = c_now + c_tickDelay;
+      continue;
+    }
+
+    const Uint64 c_start = SDL_GetPerformanceCounter();
+
+    if(sim->isNetplay)
+    {
+      // Keeps ticking after the match ends, a rollback can still change how it ended
+      tickNetplay(sim);
+    }
+    else if(sim->game.state == GAME_RUNNING)
+    {
+      tickSimulation(sim);
+    }
+    else
+    {
+      continue;
+    }
+
+    addTickCost(sim, SDL_GetPerformanceCounter() - c_start);
+  }
+
+  return 0;
+}
+
+///
+/// \brief TickSimulation Gathers each player's move, advances the game and publishes the result
+/// \param io_sim
+///
+static void tickSimulation(Simulation *io_sim)
+{
+  TRACE_BEGIN("tick");
+
+  Game *game = &io_sim->game;
+
+  Node *snakes[PLAYER_TOTAL];
+  getSnakeHeads(game, snakes);
+
+  if(io_sim->hasAIPlayer)
+  {
+    TRACE_BEGIN("updateAIPlanner");
+    updateAIPlanner(&io_sim->planner, snakes, PLAYER_TOTAL, &game->pickups);
+    TRACE_END("updateAIPlanner");
+  }
+
+  Move moves[PLAYER_TOTAL];
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    if(io_sim->options->isAIPlayer[p])
+    {
+      moves[p] = getAIMovement(&io_sim->planner, snakes[p]);
+    }
+    else
+    {
+      // The input was checked against the direction in the last snapshot the
+      // render thread saw, which may be a tick behind, so check it again here
+      moves[p] = SDL_AtomicGet(&io_sim->inputs[p]);
+
+      if(isOppositeMove(snakes[p]->idleDirection, moves[p]))
+      {
+        moves[p] = NOTMOVING;
+      }
+    }
+  }
+
+  int pickupCounts[PLAYER_TOTAL];
+  bool hasCollided[PLAYER_TOTAL];
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    pickupCounts[p] = game->players[p].pickupCount;
+    hasCollided[p] = game->players[p].hasCollided;
+  }
+
+  const GameState c_state = game->state;
+
+  updateGame(game, moves);
+
+  playTickSounds(io_sim, pickupCounts, hasCollided, c_state);
+  publishGame(io_sim);
+
+  TRACE_END("tick");
+}
+
+///
+/// \brief TickNetplay Decides the local player's move and lets netplay advance the match,
+/// which may also rewind and replay it when the peer's inputs arrive
+/// \param io_sim
+///
+static void tickNetplay(Simulation *io_sim)
+{
+  TRACE_BEGIN("tick");
+
+  Game *game = &io_sim->game;
+  const int c_local = io_sim->netplay.localPlayer;
+
+  Move move;
+
+  if(io_sim->options->isAIPlayer[c_local])
+  {
+    Node *snakes[PLAYER_TOTAL];
+    getSnakeHeads(game, snakes);
+
+    updateAIPlanner(&io_sim->planner, snakes, PLAYER_TOTAL, &game->pickups);
+    move = getAIMovement(&io_sim->planner, snakes[c_local]);
+  }
+  else
+  {
+    move = SDL_AtomicGet(&io_sim->inputs[c_local]);
+  }
+
+  int pickupCounts[PLAYER_TOTAL];
+  bool hasCollided[PLAYER_TOTAL];
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    pickupCounts[p] = game->players[p].pickupCount;
+    hasCollided[p] = game->players[p].hasCollided;
+  }
+
+  const GameState c_state = game->state;
+
+  // Waiting for the peer leaves the match where it was, so there is nothing new to show
+  if(advanceNetplay(&io_sim->netplay, game, move))
+  {
+    // A rollback can also take back a sound that has already played, which is left to play out
+    playTickSounds(io_sim, pickupCounts, hasCollided, c_state);
+    showGame(io_sim);
+  }
+
+  // Even a stalled tick may have received inputs that make earlier ticks final
+  exportFinalGames(io_sim);
+
+  TRACE_END("tick");
+}
+
+///
+/// \brief PublishGame Hands a copy of the game as it is now to the render thread,
+/// and to the state feed and recording if there are any
+///
+static void publishGame(Simulation *io_sim)
+{
+  showGame(io_sim);
+  exportGame(io_sim, &io_sim->game);
+}
+
+///
+/// \brief ShowGame Hands a copy of the game as it is now to the render thread. If it can't
+/// be copied the render thread keeps the last snapshot, which is still whole, and catches up
+/// with a later tick
+///
+static void showGame(Simulation *io_sim)
+{
+  Snapshot *snapshot = getWriteSnapshot(&io_sim->snapshots);
+
+  if(!captureSnapshot(snapshot, &io_sim->game))
+  {
+    io_sim->snapshotFailures++;
+
+    if(io_sim->metrics != NULL)
+    {
+      recordSnapshotFailure(io_sim->metrics);
+    }
+
+    return;
+  }
+
+  snapshot->tickMicroseconds = io_sim->tickMicroseconds;
+  snapshot->match = io_sim->match;
+
+  if(io_sim->metrics != NULL)
+  {
+    recordSnapshot(io_sim->metrics, snapshot);
+  }
+
+  publishSnapshot(&io_sim->snapshots);
+}
+
+///
+/// \brief ExportGame Writes a tick to the state feed and recording if there are any
+///
+static void exportGame(Simulation *io_sim,
+                       const Game *_game)
+{
+  if(io_sim->hasFeed)
+  {
+    publishStateFeed(&io_sim->feed, _game);
+  }
+
+  if(io_sim->isRecording)
+  {
+    recordGame(&io_sim->recorder, _game);
+  }
+}
+
+///
+/// \brief ExportFinalGames Exports every tick that has become final since the last call,
+/// in order, so nothing outside the process ever sees a prediction that was taken back
+///
+static void exportFinalGames(Simulation *io_sim)
+{
+  if(!io_sim->hasFeed && !io_sim->isRecording)
+  {
+    return;
+  }
+
+  const GameSave *save;
+
+  while((save = getFinalSave(&io_sim->netplay, io_sim->finalTick + 1)) != NULL)
+  {
+    restoreGame(&io_sim->finalGame, save);
+    io_sim->finalTick++;
+
+    exportGame(io_sim, &io_sim->finalGame);
+  }
+}
+
+///
+/// \brief AddTickCost Adds up what each tick cost, updating the average shown on the HUD
+/// once a whole window has been measured so it doesn't change every tick
+/// \param io_sim
+/// \param _cost Performance counter ticks
+///
+static void addTickCost(Simulation *io_sim,
+                        Uint64 _cost)
+{
+  if(io_sim->metrics != NULL)
+  {
+    recordTick(io_sim->metrics, (unsigned int)(_cost * 1000000 / SDL_GetPerformanceFrequency()));
+  }
+
+  io_sim->tickCost += _cost;
+
+  if(++io_sim->tickCostCount == SIMULATION_COST_WINDOW)
+  {
+    io_sim->tickMicroseconds = (unsigned int)(io_sim->tickCost * 1000000 /
+                                              (SDL_GetPerformanceFrequency() * SIMULATION_COST_WINDOW));
+    io_sim->tickCost = 0;
+    io_sim->tickCostCount = 0;
+  }
+}
+
+///
+/// \brief PlayTickSounds Posts a sound for everything that changed since the state passed in,
+/// panned to where the snake's head is
+/// \param io_sim
+/// \param _pickupCounts Each player's pickups before the tick
+/// \param _hasCollided Whether each player had collided before the tick
+/// \param _state The match's state before the tick
+///
+static void playTickSounds(Simulation *io_sim,
+                           const int _pickupCounts[PLAYER_TOTAL],
+                           const bool _hasCollided[PLAYER_TOTAL],
+                           GameState _state)
+{
+  if(io_sim->mixer == NULL)
+  {
+    return;
+  }
+
+  const Game *game = &io_sim->game;
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    const Player *player = &game->players[p];
+    const float c_pan = (player->head->pos.x + player->head->pos.w * 0.5f) * 2.0f / WIDTH - 1.0f;
+
+    if(player->pickupCount > _pickupCounts[p])
+    {
+      playSound(io_sim->mixer, SOUND_EAT, 0.6f, c_pan);
+    }
+
+    if(player->hasCollided && !_hasCollided[p])
+    {
+      playSound(io_sim->mixer, SOUND_DEATH, 0.8f, c_pan);
+    }
+  }
+
+  if(game->state != GAME_RUNNING && _state == GAME_RUNNING)
+  {
+    playSound(io_sim->mixer, SOUND_GAME_OVER, 0.8f, 0.0f);
+  }
+}
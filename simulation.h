@@ -0,0 +1,102 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <stdbool.h>
+
+#include "ai.h"
+#include "game.h"
+#include "metrics.h"
+#include "mixer.h"
+#include "netplay.h"
+#include "options.h"
+#include "recording.h"
+#include "snapshot.h"
+#include "statefeed.h"
+
+// Ticks averaged together for the tick cost shown on the HUD
+#define SIMULATION_COST_WINDOW (32)
+
+// Runs the game on its own thread at a fixed tick rate, publishing a snapshot after
+// every tick. The render thread only ever reads snapshots and writes inputs, so a slow
+// present never delays a tick and a long tick never delays a frame
+typedef struct Simulation{
+  Game game;              // Only touched by the simulation thread once it has started
+  const Options *options;
+  Mixer *mixer;           // Sounds for what happens each tick are posted here, NULL for silence
+  Metrics *metrics;       // Every tick is counted here, NULL to not count them
+
+  // Walls from --map, never changed once loaded so the render thread may read them too
+  bool hasMap;
+  ArenaMap map;
+
+  // Replaces collected pickups with --respawn, only the simulation thread touches it
+  bool isRespawning;
+  PickupSpawner spawner;
+
+  bool hasAIPlayer;
+  AIPlanner planner;
+
+  // Over the network only the local player's input is read, see netplay.h
+  bool isNetplay;
+  Netplay netplay;
+
+  // The last tick no rollback can change, rebuilt from netplay's saves. Only this reaches
+  // the feed and recording, the render thread is shown the predicted match
+  Game finalGame;
+  int finalTick;
+
+  // Every published tick is also written to shared memory, see statefeed.h
+  bool hasFeed;
+  StateFeed feed;
+
+  bool isRecording;
+  Recorder recorder;
+
+  // What ticks have cost lately, averaged over SIMULATION_COST_WINDOW ticks at a time
+  Uint64 tickCost;
+  int tickCostCount;
+  unsigned int tickMicroseconds;
+
+  unsigned int match;     // Matches started since the first, so the renderer can tell them apart
+  int snapshotFailures;   // Snapshots that could not be captured, the one before was shown again
+
+  TripleBuffer snapshots;
+  SDL_atomic_t inputs[PLAYER_TOTAL];  // Latest Move read from the keyboard for each player
+  SDL_atomic_t restartSeed;
+  SDL_atomic_t restart;               // Set by the render thread, cleared once the new match is published
+  SDL_atomic_t quit;
+
+  SDL_Thread *thread;
+} Simulation;
+
+///
+/// \brief StartSimulation Sets up a new match, publishes its first snapshot and starts ticking it
+/// \param o_sim
+/// \param _options
+/// \param _seed
+/// \param _mixer Must outlive the simulation, or NULL to play no sound
+/// \param _metrics Must outlive the simulation too, or NULL
+/// \return False if the map, the AI planner, the network socket, the state feed, the recording or the thread could not be created
+///
+bool startSimulation(Simulation *o_sim, const Options *_options, unsigned int _seed, Mixer *_mixer, Metrics *_metrics);
+
+///
+/// \brief StopSimulation Waits for the simulation thread to finish and frees the match
+///
+void stopSimulation(Simulation *io_sim);
+
+///
+/// \brief SetSimulationInput Called from the render thread, the move is used from the next tick onwards
+///
+void setSimulationInput(Simulation *io_sim, int _player, Move _move);
+
+///
+/// \brief RestartSimulation Called from the render thread, the simulation thread resets the
+/// match in place before its next tick and publishes a snapshot of it straight away.
+/// Ignored over the network, both peers would have to agree on it
+/// \param io_sim
+/// \param _seed Seed for the new match
+///
+void restartSimulation(Simulation *io_sim, unsigned int _seed);
+
+#endif // SIMULATION_H
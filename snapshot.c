@@ -0,0 +1,143 @@
+#include "snapshot.h"
+
+#include <string.h>
+
+#include "allocator.h"
+
+#define SNAPSHOT_FRESH (0x4)
+#define SNAPSHOT_INDEX (0x3)
+
+static void initialiseSnapshot(Snapshot *o_snapshot);
+
+void initialiseTripleBuffer(TripleBuffer *o_buffer)
+{
+  for(int i = 0; i < 3; ++i)
+  {
+    initialiseSnapshot(&o_buffer->buffers[i]);
+  }
+
+  o_buffer->back = 0;
+  SDL_AtomicSet(&o_buffer->middle, 1);
+  o_buffer->front = 2;
+}
+
+void freeTripleBuffer(TripleBuffer *io_buffer)
+{
+  for(int i = 0; i < 3; ++i)
+  {
+    for(int p = 0; p < PLAYER_TOTAL; ++p)
+    {
+      freeMemory(io_buffer->buffers[i].segments[p]);
+      io_buffer->buffers[i].segments[p] = NULL;
+    }
+  }
+}
+
+Snapshot *getWriteSnapshot(TripleBuffer *_buffer)
+{
+  return &_buffer->buffers[_buffer->back];
+}
+
+void publishSnapshot(TripleBuffer *io_buffer)
+{
+  // SDL_AtomicSet is a full barrier, so the reader sees every write made to the buffer
+  const int c_old = SDL_AtomicSet(&io_buffer->middle, io_buffer->back | SNAPSHOT_FRESH);
+  io_buffer->back = c_old & SNAPSHOT_INDEX;
+}
+
+const Snapshot *acquireSnapshot(TripleBuffer *io_buffer)
+{
+  if(SDL_AtomicGet(&io_buffer->middle) & SNAPSHOT_FRESH)
+  {
+    const int c_old = SDL_AtomicSet(&io_buffer->middle, io_buffer->front);
+    io_buffer->front = c_old & SNAPSHOT_INDEX;
+  }
+
+  return &io_buffer->buffers[io_buffer->front];
+}
+
+bool captureSnapshot(Snapshot *io_snapshot,
+                     const Game *_game)
+{
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    const Player *player = &_game->players[p];
+
+    // Count from the tail, growsnake only links new tails backwards
+    int count = 0;
+    for(const Node *node = player->tail; node != NULL; node = node->prev)
+    {
+      count++;
+    }
+
+    if(count > io_snapshot->segmentCapacity[p])
+    {
+      const int c_capacity = count * 2;
+      Node *segments = reallocateMemory(MEMORY_SNAPSHOTS, io_snapshot->segments[p], c_capacity * sizeof(Node));
+
+      if(segments == NULL)
+      {
+        return false;
+      }
+
+      io_snapshot->segments[p] = segments;
+      io_snapshot->segmentCapacity[p] = c_capacity;
+    }
+
+    // Fill head first, walking back from the tail
+    Node *segments = io_snapshot->segments[p];
+    int i = count;
+    for(const Node *node = player->tail; node != NULL; node = node->prev)
+    {
+      segments[--i] = *node;
+    }
+
+    for(i = 0; i < count; ++i)
+    {
+      segments[i].prev = (i > 0)         ? &segments[i - 1] : NULL;
+      segments[i].next = (i < count - 1) ? &segments[i + 1] : NULL;
+    }
+
+    io_snapshot->segmentCount[p] = count;
+    io_snapshot->pickupCount[p] = player->pickupCount;
+    io_snapshot->hasCollided[p] = player->hasCollided;
+  }
+
+  io_snapshot->pickups = _game->pickups;
+
+  io_snapshot->ticks = _game->ticks;
+  io_snapshot->state = _game->state;
+
+  return true;
+}
+
+Node *getSnapshotHead(const Snapshot *_snapshot,
+                      int _player)
+{
+  return (_snapshot->segmentCount[_player] > 0) ? &_snapshot->segments[_player][0] : NULL;
+}
+
+Node *getSnapshotTail(const Snapshot *_snapshot,
+                      int _player)
+{
+  const int c_count = _snapshot->segmentCount[_player];
+  return (c_count > 0) ? &_snapshot->segments[_player][c_count - 1] : NULL;
+}
+
+static void initialiseSnapshot(Snapshot *o_snapshot)
+{
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    o_snapshot->segments[p] = NULL;
+    o_snapshot->segmentCount[p] = 0;
+    o_snapshot->segmentCapacity[p] = 0;
+    o_snapshot->pickupCount[p] = 0;
+    o_snapshot->hasCollided[p] = false;
+  }
+
+  memset(&o_snapshot->pickups, 0, sizeof(o_snapshot->pickups));
+  o_snapshot->ticks = 0;
+  o_snapshot->state = GAME_RUNNING;
+  o_snapshot->tickMicroseconds = 0;
+  o_snapshot->match = 0;
+}
@@ -0,0 +1,72 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+
+#include "game.h"
+
+// A copy of everything the renderer needs from one tick of the simulation.
+// Segments are stored head first and relinked to each other, so the usual
+// render functions can walk them like a live snake
+typedef struct Snapshot{
+  Node *segments[PLAYER_TOTAL];
+  int segmentCount[PLAYER_TOTAL];
+  int segmentCapacity[PLAYER_TOTAL];
+
+  Pickups pickups;
+  int pickupCount[PLAYER_TOTAL];
+  bool hasCollided[PLAYER_TOTAL];
+
+  unsigned int ticks;
+  GameState state;
+
+  unsigned int tickMicroseconds;  // Recent average cost of a tick, filled in by the simulation
+  unsigned int match;             // Goes up with every restart, filled in by the simulation
+} Snapshot;
+
+// Lock-free handoff between one writer and one reader. The writer always has a buffer
+// to fill and the reader always has one to draw, the third sits in the middle waiting
+// to be swapped out by either side, so neither thread ever waits for the other
+typedef struct TripleBuffer{
+  Snapshot buffers[3];
+  SDL_atomic_t middle;  // Index of the middle buffer, with SNAPSHOT_FRESH set until the reader takes it
+  int back;             // Only touched by the writer
+  int front;            // Only touched by the reader
+} TripleBuffer;
+
+void initialiseTripleBuffer(TripleBuffer *o_buffer);
+void freeTripleBuffer(TripleBuffer *io_buffer);
+
+///
+/// \brief GetWriteSnapshot
+/// \return The buffer the writer should fill before calling publishSnapshot
+///
+Snapshot *getWriteSnapshot(TripleBuffer *_buffer);
+
+///
+/// \brief PublishSnapshot Hands the filled buffer to the reader, replacing any snapshot it hasn't taken yet
+///
+void publishSnapshot(TripleBuffer *io_buffer);
+
+///
+/// \brief AcquireSnapshot Swaps in the most recently published snapshot, if there is one
+/// \return The newest snapshot, valid until the next call
+///
+const Snapshot *acquireSnapshot(TripleBuffer *io_buffer);
+
+///
+/// \brief CaptureSnapshot Copies the snakes and pickups out of a game
+/// \param io_snapshot Segment arrays are grown as needed and reused afterwards
+/// \param _game
+/// \return False if the segment arrays could not be grown
+///
+bool captureSnapshot(Snapshot *io_snapshot, const Game *_game);
+
+///
+/// \brief GetSnapshotHead
+/// \return The head of a player's snake, or NULL before anything has been captured
+///
+Node *getSnapshotHead(const Snapshot *_snapshot, int _player);
+Node *getSnapshotTail(const Snapshot *_snapshot, int _player);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,217 @@
+#include "spawner.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+
+static bool isSpotClear(const PickupSpawner *_spawner, int _x, int _y);
+static int clampCell(int _cell, int _total);
+static void addCover(PickupSpawner *io_spawner, const SDL_Rect *_area, Uint32 _change);
+
+bool createPickupSpawner(PickupSpawner *o_spawner,
+                         int _w,
+                         int _h,
+                         int _size,
+                         const ArenaMap *_map)
+{
+  o_spawner->w = _w;
+  o_spawner->h = _h;
+  o_spawner->size = _size;
+  o_spawner->cellSize = _size + SPAWNER_GAP;
+  o_spawner->cols = (_w + o_spawner->cellSize - 1) / o_spawner->cellSize;
+  o_spawner->rows = (_h + o_spawner->cellSize - 1) / o_spawner->cellSize;
+  o_spawner->map = _map;
+
+  const int c_cellTotal = o_spawner->cols * o_spawner->rows;
+
+  o_spawner->cells = allocateMemory(MEMORY_PICKUPS, c_cellTotal * sizeof(SpawnCell));
+  o_spawner->covered = allocateZeroed(MEMORY_PICKUPS, c_cellTotal, sizeof(Uint32));
+
+  if(!o_spawner->cells || !o_spawner->covered)
+  {
+    freePickupSpawner(o_spawner);
+    return false;
+  }
+
+  clearPickupSpawner(o_spawner);
+
+  return true;
+}
+
+void freePickupSpawner(PickupSpawner *io_spawner)
+{
+  freeMemory(io_spawner->cells);
+  freeMemory(io_spawner->covered);
+
+  io_spawner->cells = NULL;
+  io_spawner->covered = NULL;
+}
+
+void clearPickupSpawner(PickupSpawner *io_spawner)
+{
+  const int c_cellTotal = io_spawner->cols * io_spawner->rows;
+
+  for(int c = 0; c < c_cellTotal; ++c)
+  {
+    io_spawner->cells[c].x = -1;
+  }
+
+  memset(io_spawner->covered, 0, c_cellTotal * sizeof(Uint32));
+  io_spawner->count = 0;
+}
+
+bool addSpawnedPickup(PickupSpawner *io_spawner,
+                      int _x,
+                      int _y)
+{
+  const int c_cell = clampCell(_y / io_spawner->cellSize, io_spawner->rows) * io_spawner->cols +
+                     clampCell(_x / io_spawner->cellSize, io_spawner->cols);
+
+  if(io_spawner->cells[c_cell].x >= 0)
+  {
+    return false;
+  }
+
+  io_spawner->cells[c_cell].x = _x;
+  io_spawner->cells[c_cell].y = _y;
+  io_spawner->count++;
+
+  return true;
+}
+
+void removeSpawnedPickup(PickupSpawner *io_spawner,
+                         int _x,
+                         int _y)
+{
+  const int c_cell = clampCell(_y / io_spawner->cellSize, io_spawner->rows) * io_spawner->cols +
+                     clampCell(_x / io_spawner->cellSize, io_spawner->cols);
+  SpawnCell *cell = &io_spawner->cells[c_cell];
+
+  // Left alone if it is somebody else's, such as a pickup that was never added
+  if(cell->x == _x && cell->y == _y)
+  {
+    cell->x = -1;
+    io_spawner->count--;
+  }
+}
+
+void coverSpawner(PickupSpawner *io_spawner,
+                  const SDL_Rect *_area)
+{
+  addCover(io_spawner, _area, 1);
+}
+
+void uncoverSpawner(PickupSpawner *io_spawner,
+                    const SDL_Rect *_area)
+{
+  // Unsigned, so taking one off is adding its two's complement
+  addCover(io_spawner, _area, (Uint32)-1);
+}
+
+bool spawnPickup(PickupSpawner *io_spawner,
+                 unsigned int *io_seed,
+                 int *o_x,
+                 int *o_y)
+{
+  for(int attempt = 0; attempt < SPAWNER_ATTEMPTS; ++attempt)
+  {
+    const int c_x = randRange(io_seed, 0, io_spawner->w - io_spawner->size);
+    const int c_y = randRange(io_seed, 0, io_spawner->h - io_spawner->size);
+
+    if(isSpotClear(io_spawner, c_x, c_y))
+    {
+      addSpawnedPickup(io_spawner, c_x, c_y);
+
+      *o_x = c_x;
+      *o_y = c_y;
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+///
+/// \brief IsSpotClear True if a pickup at (_x, _y) would overlap no other pickup, nothing
+/// covered and no wall. Anything it could overlap has its top left in one of the nine cells
+/// around it, and the pickup itself covers at most four cells
+///
+static bool isSpotClear(const PickupSpawner *_spawner,
+                        int _x,
+                        int _y)
+{
+  const int c_cellSize = _spawner->cellSize;
+  const int c_col = clampCell(_x / c_cellSize, _spawner->cols);
+  const int c_row = clampCell(_y / c_cellSize, _spawner->rows);
+  const int c_right = clampCell((_x + _spawner->size - 1) / c_cellSize, _spawner->cols);
+  const int c_bottom = clampCell((_y + _spawner->size - 1) / c_cellSize, _spawner->rows);
+
+  for(int row = c_row; row <= c_bottom; ++row)
+  {
+    for(int col = c_col; col <= c_right; ++col)
+    {
+      if(_spawner->covered[row * _spawner->cols + col] != 0)
+      {
+        return false;
+      }
+    }
+  }
+
+  for(int row = c_row - 1; row <= c_row + 1; ++row)
+  {
+    if(row < 0 || row >= _spawner->rows)
+    {
+      continue;
+    }
+
+    for(int col = c_col - 1; col <= c_col + 1; ++col)
+    {
+      if(col < 0 || col >= _spawner->cols)
+      {
+        continue;
+      }
+
+      const SpawnCell *c_cell = &_spawner->cells[row * _spawner->cols + col];
+
+      if(c_cell->x >= 0 && abs(c_cell->x - _x) < c_cellSize && abs(c_cell->y - _y) < c_cellSize)
+      {
+        return false;
+      }
+    }
+  }
+
+  return _spawner->map == NULL ||
+         getArenaCell(_spawner->map, _x + _spawner->size / 2, _y + _spawner->size / 2)->distance >= _spawner->size / 2;
+}
+
+///
+/// \brief AddCover Adds _change to the count of every cell under an area. Areas hanging off
+/// the arena, such as a snake wrapping, only cover the part on it
+///
+static void addCover(PickupSpawner *io_spawner,
+                     const SDL_Rect *_area,
+                     Uint32 _change)
+{
+  const int c_left = clampCell(floorDiv(_area->x, io_spawner->cellSize), io_spawner->cols);
+  const int c_right = clampCell(floorDiv(_area->x + _area->w - 1, io_spawner->cellSize), io_spawner->cols);
+  const int c_top = clampCell(floorDiv(_area->y, io_spawner->cellSize), io_spawner->rows);
+  const int c_bottom = clampCell(floorDiv(_area->y + _area->h - 1, io_spawner->cellSize), io_spawner->rows);
+
+  for(int row = c_top; row <= c_bottom; ++row)
+  {
+    for(int col = c_left; col <= c_right; ++col)
+    {
+      io_spawner->covered[row * io_spawner->cols + col] += _change;
+    }
+  }
+}
+
+static int clampCell(int _cell,
+                     int _total)
+{
+  if(_cell < 0)       { return 0; }
+  if(_cell >= _total) { return _total - 1; }
+  return _cell;
+}
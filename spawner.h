@@ -0,0 +1,95 @@
+#ifndef SPAWNER_H
+#define SPAWNER_H
+
+#include <stdbool.h>
+
+#include "utils.h"
+#include "arena.h"
+
+#define SPAWNER_GAP       (4)   // Pixels kept clear between neighbouring pickups
+#define SPAWNER_ATTEMPTS  (16)  // Random spots tried for each pickup before giving up until next time
+
+// Where a pickup is, the top left. x is negative while the cell is empty
+typedef struct SpawnCell{
+  int x;
+  int y;
+} SpawnCell;
+
+// Finds free spots for new pickups without looking at the ones already placed. Cells are
+// as wide as two pickups can be apart without overlapping, so a cell can only ever hold one
+// and a spot only has to be checked against the nine cells around it. Snakes and anything
+// else that moves are covered when they arrive and uncovered when they leave, one area at a
+// time, so neither keeping the cover up to date nor checking a spot depends on how many
+// pickups and snakes there are. Spots are
+// picked by trying random ones until one is clear, which takes a handful of tries while the
+// arena is less than about half full
+typedef struct PickupSpawner{
+  int w;              // Arena
+  int h;
+  int size;           // Of a pickup, square
+  int cellSize;       // Pickup size plus SPAWNER_GAP
+  int cols;
+  int rows;
+  int count;          // Pickups in the grid
+
+  SpawnCell *cells;
+  Uint32 *covered;    // How many covered areas reach each cell, any is blocked
+
+  const ArenaMap *map;  // Walls, NULL for none
+} PickupSpawner;
+
+///
+/// \brief CreatePickupSpawner Allocates an empty grid over an arena
+/// \param o_spawner
+/// \param _w At most 32768, as far as randRange reaches
+/// \param _h
+/// \param _size Width of a pickup, pickups are placed wholly inside the arena
+/// \param _map Pickups are never placed touching a wall, can be NULL. Must outlive the spawner
+/// \return False if there was no memory
+///
+bool createPickupSpawner(PickupSpawner *o_spawner, int _w, int _h, int _size, const ArenaMap *_map);
+void freePickupSpawner(PickupSpawner *io_spawner);
+
+///
+/// \brief ClearPickupSpawner Forgets every pickup and uncovers everything, such as before
+/// refilling it from a saved game
+///
+void clearPickupSpawner(PickupSpawner *io_spawner);
+
+///
+/// \brief AddSpawnedPickup Puts a pickup placed some other way into the grid
+/// \return False if it would overlap one already there, it is then left out
+///
+bool addSpawnedPickup(PickupSpawner *io_spawner, int _x, int _y);
+
+///
+/// \brief RemoveSpawnedPickup Takes a pickup out of the grid once it has been collected
+/// \param _x Where it was added
+/// \param _y
+///
+void removeSpawnedPickup(PickupSpawner *io_spawner, int _x, int _y);
+
+///
+/// \brief CoverSpawner Keeps pickups out of an area until it is uncovered again. Whole cells
+/// are covered, so a little around it is kept clear too. Areas can overlap
+///
+void coverSpawner(PickupSpawner *io_spawner, const SDL_Rect *_area);
+
+///
+/// \brief UncoverSpawner Takes back an area, which must be the same as one covered before.
+/// Cells another area still covers stay blocked
+///
+void uncoverSpawner(PickupSpawner *io_spawner, const SDL_Rect *_area);
+
+///
+/// \brief SpawnPickup Tries up to SPAWNER_ATTEMPTS random spots, and adds a pickup at the
+/// first that is clear of the others, anything covered and walls
+/// \param io_spawner
+/// \param io_seed Random generator state, two numbers are rolled each try
+/// \param o_x Top left of the new pickup
+/// \param o_y
+/// \return False if every try was blocked, nothing is added
+///
+bool spawnPickup(PickupSpawner *io_spawner, unsigned int *io_seed, int *o_x, int *o_y);
+
+#endif // SPAWNER_H
@@ -0,0 +1,146 @@
+// shm_open and mmap are POSIX rather than C99
+#define _POSIX_C_SOURCE 200112L
+
+#include "statefeed.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+bool openStateFeed(StateFeed *o_feed,
+                   const char *_name)
+{
+  // Fixed by the feed format, so catch it growing past it at compile time. Pickups are cut
+  // short instead, a build can hold more of them than the feed has room for
+  typedef char feedHasRoomForPlayers[(PLAYER_TOTAL <= FEED_PLAYERS) ? 1 : -1];
+  (void)sizeof(feedHasRoomForPlayers);
+
+  snprintf(o_feed->name, sizeof(o_feed->name), "%s", _name);
+  o_feed->size = sizeof(FeedHeader) + FEED_SLOTS * sizeof(FeedSlot);
+  o_feed->header = NULL;
+  o_feed->slots = NULL;
+
+  const int c_file = shm_open(_name, O_CREAT | O_RDWR, 0644);
+
+  if(c_file < 0)
+  {
+    printf("Unable to open shared memory %s: %s\n", _name, strerror(errno));
+    return false;
+  }
+
+  void *memory = MAP_FAILED;
+
+  if(ftruncate(c_file, (off_t)o_feed->size) == 0)
+  {
+    memory = mmap(NULL, o_feed->size, PROT_READ | PROT_WRITE, MAP_SHARED, c_file, 0);
+  }
+
+  // The mapping stays valid without the descriptor
+  close(c_file);
+
+  if(memory == MAP_FAILED)
+  {
+    printf("Unable to map shared memory %s: %s\n", _name, strerror(errno));
+    shm_unlink(_name);
+    return false;
+  }
+
+  memset(memory, 0, o_feed->size);
+
+  o_feed->header = memory;
+  o_feed->slots = (FeedSlot *)(o_feed->header + 1);
+
+  o_feed->header->version = FEED_VERSION;
+  o_feed->header->slotCount = FEED_SLOTS;
+  o_feed->header->slotSize = sizeof(FeedSlot);
+  __atomic_store_n(&o_feed->header->magic, FEED_MAGIC, __ATOMIC_RELEASE);
+
+  return true;
+}
+
+void closeStateFeed(StateFeed *io_feed)
+{
+  if(io_feed->header != NULL)
+  {
+    munmap(io_feed->header, io_feed->size);
+    shm_unlink(io_feed->name);
+  }
+
+  io_feed->header = NULL;
+  io_feed->slots = NULL;
+}
+
+void publishStateFeed(StateFeed *io_feed,
+                      const Game *_game)
+{
+  const uint64_t c_published = io_feed->header->published;
+  FeedSlot *slot = &io_feed->slots[c_published % FEED_SLOTS];
+
+  // Odd while writing, the fence keeps the slot's writes after it
+  const uint32_t c_sequence = slot->sequence;
+  __atomic_store_n(&slot->sequence, c_sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  slot->tick = _game->ticks;
+  slot->state = _game->state;
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    const Player *player = &_game->players[p];
+
+    // Count from the tail, then fill in from the head end so the segments are head first
+    int count = 0;
+    for(const Node *node = player->tail; node != NULL; node = node->prev)
+    {
+      count++;
+    }
+
+    int index = count;
+    for(const Node *node = player->tail; node != NULL; node = node->prev)
+    {
+      if(--index < FEED_MAX_SEGMENTS)
+      {
+        slot->segments[p][index].x = (int16_t)node->pos.x;
+        slot->segments[p][index].y = (int16_t)node->pos.y;
+      }
+    }
+
+    slot->scores[p] = player->pickupCount;
+    slot->segmentCount[p] = (uint16_t)count;
+  }
+
+  // Only what is still on the board, gems first, as much of it as fits
+  const Gems *c_gems = &_game->pickups.gems;
+  const Knights *c_knights = &_game->pickups.knights;
+  int count = 0;
+
+  for(int i = 0; i < c_gems->count && count < FEED_MAX_PICKUPS; ++i, ++count)
+  {
+    FeedPickup *feedPickup = &slot->pickups[count];
+
+    feedPickup->x = (int16_t)c_gems->x[i];
+    feedPickup->y = (int16_t)c_gems->y[i];
+    feedPickup->isVisible = 1;
+    feedPickup->isKnight = 0;
+    feedPickup->type = (uint8_t)c_gems->type[i];
+  }
+
+  for(int i = 0; i < c_knights->count && count < FEED_MAX_PICKUPS; ++i, ++count)
+  {
+    FeedPickup *feedPickup = &slot->pickups[count];
+
+    feedPickup->x = (int16_t)c_knights->x[i];
+    feedPickup->y = (int16_t)c_knights->y[i];
+    feedPickup->isVisible = 1;
+    feedPickup->isKnight = 1;
+    feedPickup->type = (uint8_t)c_knights->direction[i];
+  }
+
+  slot->pickupCount = (uint16_t)count;
+
+  __atomic_store_n(&slot->sequence, c_sequence + 2, __ATOMIC_RELEASE);
+  __atomic_store_n(&io_feed->header->published, c_published + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,36 @@
+#ifndef STATEFEED_H
+#define STATEFEED_H
+
+#include <stdbool.h>
+
+#include "feedformat.h"
+#include "game.h"
+
+// Publishes every tick to shared memory for spectators and stats tools, see feedformat.h
+typedef struct StateFeed{
+  char name[64];
+  FeedHeader *header;
+  FeedSlot *slots;
+  size_t size;
+} StateFeed;
+
+///
+/// \brief OpenStateFeed Creates (or takes over) the shared memory and marks it ready
+/// \param o_feed
+/// \param _name Shared memory name, such as /snakes
+/// \return False if the shared memory could not be created or mapped
+///
+bool openStateFeed(StateFeed *o_feed, const char *_name);
+
+///
+/// \brief CloseStateFeed Unmaps and unlinks the shared memory, readers that
+/// already have it mapped keep their view of the last tick
+///
+void closeStateFeed(StateFeed *io_feed);
+
+///
+/// \brief PublishStateFeed Writes the game into the next slot, never waits for readers
+///
+void publishStateFeed(StateFeed *io_feed, const Game *_game);
+
+#endif // STATEFEED_H
@@ -0,0 +1,109 @@
+#include "statehash.h"
+
+static Uint64 packPair(int _a, int _b);
+
+Uint64 mixHash(Uint64 _value)
+{
+  // SplitMix64 finaliser, every input bit affects every output bit
+  _value += 0x9E3779B97F4A7C15ull;
+  _value = (_value ^ (_value >> 30)) * 0xBF58476D1CE4E5B9ull;
+  _value = (_value ^ (_value >> 27)) * 0x94D049BB133111EBull;
+  return _value ^ (_value >> 31);
+}
+
+Uint64 hashSegment(const Node *_node)
+{
+  Uint64 hash = mixHash(packPair(_node->pos.x, _node->pos.y));
+  hash = mixHash(hash ^ packPair(_node->pos.w, _node->pos.h));
+  return mixHash(hash ^ packPair(_node->state, _node->idleDirection));
+}
+
+Uint64 hashGem(const Gems *_gems,
+               int _gem)
+{
+  Uint64 hash = mixHash(packPair(_gems->id[_gem], 0));
+  hash = mixHash(hash ^ packPair(_gems->x[_gem], _gems->y[_gem]));
+  return mixHash(hash ^ packPair(_gems->type[_gem], 0));
+}
+
+Uint64 hashKnight(const Knights *_knights,
+                  int _knight)
+{
+  Uint64 hash = mixHash(packPair(_knights->id[_knight], 1));
+  hash = mixHash(hash ^ packPair(_knights->x[_knight], _knights->y[_knight]));
+  return mixHash(hash ^ packPair(_knights->frame[_knight], _knights->direction[_knight]));
+}
+
+Uint64 getGameHash(const Game *_game)
+{
+  Uint64 hash = mixHash(_game->pickupHash);
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    const Player *player = &_game->players[p];
+
+    hash = mixHash(hash ^ _game->segmentHash[p]);
+    hash = mixHash(hash ^ packPair(player->pickupCount, player->hasCollided));
+  }
+
+  hash = mixHash(hash ^ packPair(_game->seed, _game->state));
+  hash = mixHash(hash ^ packPair(_game->ticks, _game->time));
+  return mixHash(hash ^ _game->timers.checksum);
+}
+
+Uint64 computeGameHash(const Game *_game)
+{
+  Game copy = *_game;
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    copy.segmentHash[p] = computeSegmentHash(_game->players[p].tail);
+  }
+
+  copy.pickupHash = computePickupHash(&_game->pickups);
+  copy.timers.checksum = computeTimerChecksum(&_game->timers);
+
+  return getGameHash(&copy);
+}
+
+Uint64 computeSegmentHash(const Node *_tail)
+{
+  Uint64 sum = 0;
+
+  for(const Node *node = _tail; node != NULL; node = node->prev)
+  {
+    sum += hashSegment(node);
+  }
+
+  return sum;
+}
+
+Uint64 computeKnightHash(const Knights *_knights)
+{
+  Uint64 sum = 0;
+
+  for(int i = 0; i < _knights->count; ++i)
+  {
+    sum += hashKnight(_knights, i);
+  }
+
+  return sum;
+}
+
+Uint64 computePickupHash(const Pickups *_pickups)
+{
+  Uint64 sum = computeKnightHash(&_pickups->knights);
+
+  for(int i = 0; i < _pickups->gems.count; ++i)
+  {
+    sum += hashGem(&_pickups->gems, i);
+  }
+
+  return sum;
+}
+
+static Uint64 packPair(int _a,
+                       int _b)
+{
+  return ((Uint64)(Uint32)_a << 32) | (Uint32)_b;
+}
@@ -0,0 +1,55 @@
+#ifndef STATEHASH_H
+#define STATEHASH_H
+
+#include "game.h"
+
+// The game hash is built from per-segment and per-pickup hashes that are summed, so when
+// something changes only its own term has to be taken away and added back. Segments are
+// summed regardless of their order in the list, which lets the tail move up to the neck
+// without touching any other term. Animation frames are cosmetic and left out
+
+///
+/// \brief HashSegment Hashes a segment's position, size, state flags and direction
+///
+Uint64 hashSegment(const Node *_node);
+
+///
+/// \brief HashGem Hashes everything about a gem, including its id but not where it is in
+/// the arrays, so moving it into the place of a collected gem leaves its hash alone
+///
+Uint64 hashGem(const Gems *_gems, int _gem);
+Uint64 hashKnight(const Knights *_knights, int _knight);
+
+///
+/// \brief GetGameHash Combines the running segment and pickup sums with the scores,
+/// random generator, clocks and pending timers. Constant time, call it after every tick
+///
+Uint64 getGameHash(const Game *_game);
+
+///
+/// \brief ComputeGameHash Rebuilds the same hash from scratch by visiting every segment
+/// and pickup, to check the running sums haven't drifted
+///
+Uint64 computeGameHash(const Game *_game);
+
+///
+/// \brief ComputeSegmentHash Sums hashSegment over a whole snake, walking from the tail
+///
+Uint64 computeSegmentHash(const Node *_tail);
+
+///
+/// \brief ComputeKnightHash Sums hashKnight over every knight
+///
+Uint64 computeKnightHash(const Knights *_knights);
+
+///
+/// \brief ComputePickupHash Sums hashGem and hashKnight over everything still on the board
+///
+Uint64 computePickupHash(const Pickups *_pickups);
+
+///
+/// \brief MixHash Scrambles a 64 bit value, also used to chain hashes together
+///
+Uint64 mixHash(Uint64 _value);
+
+#endif // STATEHASH_H
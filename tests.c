@@ -0,0 +1,1399 @@
+// Unit tests for the modules that don't need a window, run with make check. Each test
+// returns false at its first failed check, which has been printed, and the run fails if
+// any test did
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "actor.h"
+#include "allocator.h"
+#include "arena.h"
+#include "game.h"
+#include "hud.h"
+#include "neighbours.h"
+#include "netplay.h"
+#include "observation.h"
+#include "particles.h"
+#include "pickup.h"
+#include "recording.h"
+#include "spawner.h"
+#include "statehash.h"
+#include "timerwheel.h"
+#include "viewports.h"
+
+#define TEST_RECORDING_PATH "tests.snkr"
+#define TEST_NETPLAY_PORT   (47310)   // The first port tried, it moves on if that one is taken
+
+#define CHECK(_condition) do { if(!(_condition)) \
+  { printf("  %s:%d: %s\n", __FILE__, __LINE__, #_condition); return false; } } while(0)
+
+typedef struct Test{
+  const char *name;
+  bool (*run)(void);
+} Test;
+
+static bool testNearestNeighbours(void);
+static bool testSteerKnights(void);
+static bool testTimerWheelFiresOnTime(void);
+static bool testTimerWheelRandom(void);
+static bool testRecordingRoundTrip(void);
+static bool testAllocatorCounts(void);
+static bool testArenaDistance(void);
+static bool testSpawnerGrid(void);
+static bool testSpawnerDensity(void);
+static bool testSweepSelfCollision(void);
+static bool testPickupSweep(void);
+static bool testObservation(void);
+static bool testNetplayRollback(void);
+static bool testIncrementalHash(void);
+static bool testParticlesSwapRemove(void);
+static bool testViewportsTile(void);
+static bool testHud(void);
+static bool testSpawnerCover(void);
+static bool testTickMoves(void);
+
+int main(void)
+{
+  static const Test c_tests[] = {
+    { "nearest neighbours", testNearestNeighbours },
+    { "steer knights", testSteerKnights },
+    { "timer wheel fires on time", testTimerWheelFiresOnTime },
+    { "timer wheel random schedule", testTimerWheelRandom },
+    { "recording round trip", testRecordingRoundTrip },
+    { "allocator counts", testAllocatorCounts },
+    { "arena distance", testArenaDistance },
+    { "spawner grid", testSpawnerGrid },
+    { "spawner density", testSpawnerDensity },
+    { "sweep self collision", testSweepSelfCollision },
+    { "pickup sweep", testPickupSweep },
+    { "observation", testObservation },
+    { "netplay rollback", testNetplayRollback },
+    { "incremental hash", testIncrementalHash },
+    { "particles swap remove", testParticlesSwapRemove },
+    { "viewports tile", testViewportsTile },
+    { "hud", testHud },
+    { "spawner cover", testSpawnerCover },
+    { "tick moves", testTickMoves }
+  };
+  const int c_testCount = (int)(sizeof(c_tests) / sizeof(c_tests[0]));
+  int failed = 0;
+
+  for(int i = 0; i < c_testCount; ++i)
+  {
+    const bool c_passed = c_tests[i].run();
+
+    printf("%s %s\n", c_passed ? "PASS" : "FAIL", c_tests[i].name);
+    failed += c_passed ? 0 : 1;
+  }
+
+  printf("%d of %d tests passed\n", c_testCount - failed, c_testCount);
+
+  return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+///
+/// \brief TestNearestNeighbours Checks queries against looking at every point. Points and
+/// queries include ones past the arena's edges, where knights sit while they wrap, and
+/// clusters that leave most cells empty
+///
+static bool testNearestNeighbours(void)
+{
+  static NeighbourGrid grid;
+  int x[NEIGHBOUR_CAPACITY] = { 0 };
+  int y[NEIGHBOUR_CAPACITY] = { 0 };
+  unsigned int seed = 7;
+
+  // With nothing in it every query comes back empty
+  buildNeighbourGrid(&grid, x, y, 0);
+  int neighbours[8];
+  int distances[8];
+  CHECK(findNearestNeighbours(&grid, WIDTH / 2, HEIGHT / 2, WIDTH, -1, 8, neighbours, distances) == 0);
+
+  for(int round = 0; round < 200; ++round)
+  {
+    const int c_count = randRange(&seed, 1, NEIGHBOUR_CAPACITY);
+    const bool c_isClustered = (round % 2 == 1);
+    const int c_clusterX = randRange(&seed, 0, WIDTH - 1);
+    const int c_clusterY = randRange(&seed, 0, HEIGHT - 1);
+
+    for(int i = 0; i < c_count; ++i)
+    {
+      x[i] = c_isClustered ? c_clusterX + randRange(&seed, -40, 40) : randRange(&seed, -64, WIDTH + 63);
+      y[i] = c_isClustered ? c_clusterY + randRange(&seed, -40, 40) : randRange(&seed, -64, HEIGHT + 63);
+    }
+
+    buildNeighbourGrid(&grid, x, y, c_count);
+
+    for(int q = 0; q < 50; ++q)
+    {
+      const int c_queryX = randRange(&seed, -64, WIDTH + 63);
+      const int c_queryY = randRange(&seed, -64, HEIGHT + 63);
+      const int c_radius = randRange(&seed, 0, 400);
+      const int c_exclude = randRange(&seed, -1, c_count - 1);
+      const int c_k = randRange(&seed, 1, 8);
+
+      const int c_found = findNearestNeighbours(&grid, c_queryX, c_queryY, c_radius, c_exclude, c_k,
+                                                neighbours, distances);
+
+      // Brute force: the k-th nearest distance, and how many points are in range
+      int inRange = 0;
+      int nearest[8];
+
+      for(int i = 0; i < c_count; ++i)
+      {
+        const int c_distanceSq = (x[i] - c_queryX) * (x[i] - c_queryX) + (y[i] - c_queryY) * (y[i] - c_queryY);
+
+        if(i == c_exclude || c_distanceSq > c_radius * c_radius)
+        {
+          continue;
+        }
+
+        int at = (inRange < c_k) ? inRange : c_k;
+        ++inRange;
+
+        while(at > 0 && nearest[at - 1] > c_distanceSq)
+        {
+          if(at < c_k)
+          {
+            nearest[at] = nearest[at - 1];
+          }
+          --at;
+        }
+
+        if(at < c_k)
+        {
+          nearest[at] = c_distanceSq;
+        }
+      }
+
+      CHECK(c_found == ((inRange < c_k) ? inRange : c_k));
+
+      // Ties can come back in any order, so check distances and that each index is real
+      for(int n = 0; n < c_found; ++n)
+      {
+        const int c_i = neighbours[n];
+
+        CHECK(distances[n] == nearest[n]);
+        CHECK(c_i >= 0 && c_i < c_count && c_i != c_exclude);
+        CHECK((x[c_i] - c_queryX) * (x[c_i] - c_queryX) + (y[c_i] - c_queryY) * (y[c_i] - c_queryY) == distances[n]);
+
+        for(int m = 0; m < n; ++m)
+        {
+          CHECK(neighbours[m] != c_i);
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+///
+/// \brief TestSteerKnights Knights turn away from a nearby head and from each other, and one
+/// with nothing near it keeps going the way it was
+///
+static bool testSteerKnights(void)
+{
+  static Knights knights;
+  const Uint8 c_isDue[4] = { 1, 1, 1, 1 };
+
+  // Two knights side by side in the middle, one alone in a corner
+  knights.count = 3;
+  knights.x[0] = 300; knights.y[0] = 300; knights.direction[0] = UP;
+  knights.x[1] = 340; knights.y[1] = 300; knights.direction[1] = UP;
+  knights.x[2] = 10;  knights.y[2] = 10;  knights.direction[2] = DOWN;
+
+  const int c_farX[1] = { WIDTH - 10 };
+  const int c_farY[1] = { HEIGHT - 10 };
+  steerKnights(&knights, c_isDue, c_farX, c_farY, 1, NULL);
+
+  CHECK(knights.direction[0] == LEFT);
+  CHECK(knights.direction[1] == RIGHT);
+  CHECK(knights.direction[2] == DOWN);
+
+  // A head just below the corner knight sends it up, however it was going
+  const int c_nearX[1] = { 10 + KNIGHT_SIZE / 2 };
+  const int c_nearY[1] = { 10 + KNIGHT_SIZE / 2 + 50 };
+  steerKnights(&knights, c_isDue, c_nearX, c_nearY, 1, NULL);
+
+  CHECK(knights.direction[2] == UP);
+
+  return true;
+}
+
+///
+/// \brief TestTimerWheelFiresOnTime One shot, repeating, cancelled and far off timers
+///
+static bool testTimerWheelFiresOnTime(void)
+{
+  static TimerWheel wheel;
+  initialiseTimerWheel(&wheel);
+
+  const int c_once = scheduleTimer(&wheel, 3, 0, 1, 10);
+  const int c_repeat = scheduleTimer(&wheel, 2, 5, 2, 20);
+  const int c_cancelled = scheduleTimer(&wheel, 4, 0, 3, 30);
+  const int c_far = scheduleTimer(&wheel, 70000, 0, 4, 40);
+
+  CHECK(c_once >= 0 && c_repeat >= 0 && c_cancelled >= 0 && c_far >= 0);
+  cancelTimer(&wheel, c_cancelled);
+
+  int onceFired = 0;
+  int repeatFired = 0;
+  int farFired = 0;
+
+  for(unsigned int t = 1; t <= 70000; ++t)
+  {
+    advanceTimerWheel(&wheel);
+    CHECK(wheel.now == t);
+
+    int kind;
+    int data;
+
+    while(popExpiredTimer(&wheel, &kind, &data))
+    {
+      CHECK(kind != 3);
+
+      if(kind == 1) { CHECK(t == 3 && data == 10); ++onceFired; }
+      if(kind == 2) { CHECK(t >= 2 && (t - 2) % 5 == 0 && data == 20); ++repeatFired; }
+      if(kind == 4) { CHECK(t == 70000 && data == 40); ++farFired; }
+    }
+  }
+
+  CHECK(onceFired == 1 && farFired == 1);
+  CHECK(repeatFired == (70000 - 2) / 5 + 1);
+  CHECK(computeTimerChecksum(&wheel) == wheel.checksum);
+
+  // Every timer is in use once the repeating one and the rest of the capacity are taken
+  for(int i = 1; i < TIMER_CAPACITY; ++i)
+  {
+    CHECK(scheduleTimer(&wheel, 1, 0, 5, i) >= 0);
+  }
+
+  CHECK(scheduleTimer(&wheel, 1, 0, 5, 0) == -1);
+
+  return true;
+}
+
+///
+/// \brief TestTimerWheelRandom Schedules and cancels at random against a plain list of
+/// when each timer is due, checking nothing fires early, late or twice
+///
+static bool testTimerWheelRandom(void)
+{
+  static TimerWheel wheel;
+  initialiseTimerWheel(&wheel);
+
+  bool isLive[TIMER_CAPACITY] = { false };
+  unsigned int due[TIMER_CAPACITY];
+  unsigned int period[TIMER_CAPACITY];
+  unsigned int seed = 1;
+  long fired = 0;
+
+  for(int t = 0; t < 300000; ++t)
+  {
+    if(randRange(&seed, 0, 49) == 0)
+    {
+      const unsigned int c_delay = randRange(&seed, 0, 3) ? (unsigned int)randRange(&seed, 1, 5000)
+                                                          : (unsigned int)randRange(&seed, 1, 300000);
+      const unsigned int c_period = randRange(&seed, 0, 2) ? 0 : (unsigned int)randRange(&seed, 1, 100000);
+
+      // The free list head is the index the timer will get, which doubles as its data
+      const int c_timer = scheduleTimer(&wheel, c_delay, c_period, 1, wheel.freeTimers);
+
+      if(c_timer >= 0)
+      {
+        CHECK(!isLive[c_timer]);
+        isLive[c_timer] = true;
+        due[c_timer] = wheel.now + c_delay;
+        period[c_timer] = c_period;
+      }
+    }
+
+    if(randRange(&seed, 0, 299) == 0)
+    {
+      const int c_timer = randRange(&seed, 0, TIMER_CAPACITY - 1);
+
+      if(isLive[c_timer])
+      {
+        cancelTimer(&wheel, c_timer);
+        isLive[c_timer] = false;
+      }
+    }
+
+    advanceTimerWheel(&wheel);
+
+    int kind;
+    int timer;
+
+    while(popExpiredTimer(&wheel, &kind, &timer))
+    {
+      CHECK(isLive[timer] && due[timer] == wheel.now);
+
+      isLive[timer] = (period[timer] != 0);
+      due[timer] = wheel.now + period[timer];
+      ++fired;
+    }
+
+    for(int i = 0; i < TIMER_CAPACITY; ++i)
+    {
+      CHECK(!isLive[i] || due[i] > wheel.now);
+    }
+
+    CHECK(computeTimerChecksum(&wheel) == wheel.checksum);
+  }
+
+  CHECK(fired > 0);
+
+  return true;
+}
+
+///
+/// \brief TestRecordingRoundTrip Records a few matches and reads every frame back, so the
+/// varints, the signed deltas between frames and the keyframes all have to decode exactly
+///
+static bool testRecordingRoundTrip(void)
+{
+  enum { c_frames = 3000 };
+  static unsigned int ticks[c_frames];
+  static int heads[c_frames][PLAYER_TOTAL][2];
+  static int lengths[c_frames][PLAYER_TOTAL];
+
+  Recorder recorder;
+  CHECK(startRecording(&recorder, TEST_RECORDING_PATH));
+
+  Game game;
+  initialiseGame(&game, 5, NULL, NULL, 24, 1);
+
+  static const Move c_turns[] = { UP, LEFT, DOWN, RIGHT };
+  Move moves[PLAYER_TOTAL] = { RIGHT, LEFT };
+  unsigned int seed = 99;
+
+  for(int f = 0; f < c_frames; ++f)
+  {
+    if(game.state != GAME_RUNNING)
+    {
+      resetGame(&game, (unsigned int)f);
+    }
+    else
+    {
+      for(int p = 0; p < PLAYER_TOTAL; ++p)
+      {
+        if(randRange(&seed, 0, 10) == 0) { moves[p] = c_turns[randRange(&seed, 0, 3)]; }
+      }
+
+      updateGame(&game, moves);
+    }
+
+    ticks[f] = game.ticks;
+
+    for(int p = 0; p < PLAYER_TOTAL; ++p)
+    {
+      int length = 0;
+
+      for(const Node *node = game.players[p].head; node != NULL; node = node->next) { ++length; }
+
+      heads[f][p][0] = game.players[p].head->pos.x;
+      heads[f][p][1] = game.players[p].head->pos.y;
+      lengths[f][p] = length;
+    }
+
+    recordGame(&recorder, &game);
+  }
+
+  freeGame(&game);
+  stopRecording(&recorder);
+
+  Recording recording;
+  CHECK(openRecording(&recording, TEST_RECORDING_PATH));
+
+  // Whole chunks are dropped if the writer falls behind, so only the frames that were kept are compared
+  const RecordFrame *frame = seekRecording(&recording, 0);
+  bool isMatching = true;
+  int compared = 0;
+
+  for(int f = 0; f < c_frames && isMatching; ++f)
+  {
+    if(frame == NULL && (frame = seekRecording(&recording, (Uint64)f)) == NULL)
+    {
+      continue;
+    }
+
+    isMatching = (frame->ticks == ticks[f]);
+
+    for(int p = 0; p < PLAYER_TOTAL && isMatching; ++p)
+    {
+      isMatching = (frame->segments[p][0].x == heads[f][p][0] &&
+                    frame->segments[p][0].y == heads[f][p][1] &&
+                    frame->segmentCount[p] >= lengths[f][p]);
+    }
+
+    ++compared;
+    frame = stepRecording(&recording);
+  }
+
+  // Seeking starts again from the keyframe at the front of a chunk
+  int seekMismatches = 0;
+
+  for(int f = c_frames - 1; f >= 0; f -= 97)
+  {
+    const RecordFrame *c_seeked = seekRecording(&recording, (Uint64)f);
+
+    if(c_seeked != NULL && (c_seeked->ticks != ticks[f] || c_seeked->segments[1][0].x != heads[f][1][0]))
+    {
+      ++seekMismatches;
+    }
+  }
+
+  const bool c_isPastEnd = (seekRecording(&recording, c_frames) == NULL);
+
+  closeRecording(&recording);
+  remove(TEST_RECORDING_PATH);
+
+  CHECK(isMatching && compared > 0);
+  CHECK(seekMismatches == 0);
+  CHECK(c_isPastEnd);
+
+  return true;
+}
+
+///
+/// \brief TestAllocatorCounts Allocating, growing and freeing moves a tag's count and peak
+///
+static bool testAllocatorCounts(void)
+{
+  // Nothing else uses this tag in the tests
+  const MemoryTag c_tag = MEMORY_CAPTURE;
+  size_t start;
+  size_t current;
+  size_t peak;
+
+  getMemoryUsage(c_tag, &start, &peak);
+  const int c_allocations = getAllocationCount();
+
+  char *block = allocateMemory(c_tag, 1000);
+  CHECK(block != NULL);
+  getMemoryUsage(c_tag, &current, &peak);
+  CHECK(current == start + 1000 && peak >= current);
+
+  block = reallocateMemory(c_tag, block, 3000);
+  CHECK(block != NULL);
+  getMemoryUsage(c_tag, &current, &peak);
+  CHECK(current == start + 3000 && peak >= start + 3000);
+
+  char *zeroed = allocateZeroed(c_tag, 10, 10);
+  CHECK(zeroed != NULL && zeroed[0] == 0 && zeroed[99] == 0);
+  CHECK(getAllocationCount() == c_allocations + 3);
+
+  // More than a size_t can hold is refused rather than wrapping round
+  CHECK(allocateZeroed(c_tag, (size_t)-1 / 2, 4) == NULL);
+
+  freeMemory(zeroed);
+  freeMemory(block);
+  freeMemory(NULL);
+  getMemoryUsage(c_tag, &current, &peak);
+  CHECK(current == start && peak >= start + 3100);
+
+  trackMemory(c_tag, 500);
+  getMemoryUsage(c_tag, &current, &peak);
+  CHECK(current == start + 500);
+  trackMemory(c_tag, -500);
+  getMemoryUsage(c_tag, &current, &peak);
+  CHECK(current == start);
+
+  return true;
+}
+
+///
+/// \brief TestArenaDistance Checks the field against the distance to the nearest cell on
+/// the other side of a wall edge, found the slow way
+///
+static bool testArenaDistance(void)
+{
+  ArenaMap map;
+  CHECK(buildArenaMap(&map, NULL, 0, 160, 120));
+  CHECK(map.wallCount == 0 && map.walls == NULL);
+  CHECK(getArenaCell(&map, 80, 60)->distance == ARENA_FAR);
+  freeArenaMap(&map);
+
+  unsigned int seed = 7;
+  SDL_Rect walls[6];
+
+  for(int i = 0; i < 6; ++i)
+  {
+    walls[i].x = randRange(&seed, -20, 170);
+    walls[i].y = randRange(&seed, -20, 130);
+    walls[i].w = randRange(&seed, 1, 40);
+    walls[i].h = randRange(&seed, 1, 40);
+  }
+
+  CHECK(buildArenaMap(&map, walls, 6, 160, 120));
+
+  int mismatches = 0;
+
+  for(int cy = 0; cy < map.rows; ++cy)
+  {
+    for(int cx = 0; cx < map.cols; ++cx)
+    {
+      const int c_x = cx * ARENA_CELL_SIZE + ARENA_CELL_SIZE / 2;
+      const int c_y = cy * ARENA_CELL_SIZE + ARENA_CELL_SIZE / 2;
+      const bool c_isBlocked = isArenaBlocked(&map, c_x, c_y);
+      float nearest = 1e9f;
+
+      for(int y = 0; y < map.rows; ++y)
+      {
+        for(int x = 0; x < map.cols; ++x)
+        {
+          if(isArenaBlocked(&map, x * ARENA_CELL_SIZE, y * ARENA_CELL_SIZE) != c_isBlocked)
+          {
+            const float c_cells = sqrtf((float)((x - cx) * (x - cx) + (y - cy) * (y - cy)));
+            nearest = (c_cells < nearest) ? c_cells : nearest;
+          }
+        }
+      }
+
+      // The edge is half a cell short of the nearest cell across it
+      int expected = (int)(nearest * ARENA_CELL_SIZE - ARENA_CELL_SIZE / 2 + 0.5f);
+      expected = c_isBlocked ? -expected : expected;
+
+      if(abs(getArenaCell(&map, c_x, c_y)->distance - expected) > 1)
+      {
+        ++mismatches;
+      }
+    }
+  }
+
+  freeArenaMap(&map);
+  CHECK(mismatches == 0);
+
+  return true;
+}
+
+///
+/// \brief TestSpawnerGrid Fills a small arena until no spot is left, then checks no two
+/// pickups overlap and that removed, covered and duplicate spots are handled
+///
+static bool testSpawnerGrid(void)
+{
+  enum { c_maxPickups = 512 };
+  static int xs[c_maxPickups];
+  static int ys[c_maxPickups];
+
+  PickupSpawner spawner;
+  CHECK(createPickupSpawner(&spawner, 200, 200, PICKUP_SIZE, NULL));
+
+  unsigned int seed = 5;
+  int count = 0;
+  int misses = 0;
+
+  while(count < c_maxPickups && misses < 200)
+  {
+    if(spawnPickup(&spawner, &seed, &xs[count], &ys[count])) { ++count; misses = 0; }
+    else { ++misses; }
+  }
+
+  CHECK(count > 0 && spawner.count == count);
+
+  const int c_gap = PICKUP_SIZE + SPAWNER_GAP;
+
+  for(int i = 0; i < count; ++i)
+  {
+    CHECK(xs[i] >= 0 && ys[i] >= 0 && xs[i] + PICKUP_SIZE <= 200 && ys[i] + PICKUP_SIZE <= 200);
+
+    for(int j = i + 1; j < count; ++j)
+    {
+      CHECK(abs(xs[i] - xs[j]) >= c_gap || abs(ys[i] - ys[j]) >= c_gap);
+    }
+  }
+
+  // A spot that is taken can't be added twice, and is free again once removed
+  CHECK(!addSpawnedPickup(&spawner, xs[0], ys[0]));
+  removeSpawnedPickup(&spawner, xs[0], ys[0]);
+  CHECK(spawner.count == count - 1);
+  CHECK(addSpawnedPickup(&spawner, xs[0], ys[0]));
+
+  // Nothing spawns under a cover, until every area over it has been uncovered
+  const SDL_Rect c_everywhere = { 0, 0, 200, 200 };
+  clearPickupSpawner(&spawner);
+  coverSpawner(&spawner, &c_everywhere);
+  coverSpawner(&spawner, &c_everywhere);
+
+  int x;
+  int y;
+  CHECK(!spawnPickup(&spawner, &seed, &x, &y));
+
+  uncoverSpawner(&spawner, &c_everywhere);
+  CHECK(!spawnPickup(&spawner, &seed, &x, &y));
+
+  uncoverSpawner(&spawner, &c_everywhere);
+  CHECK(spawnPickup(&spawner, &seed, &x, &y));
+
+  freePickupSpawner(&spawner);
+
+  return true;
+}
+
+///
+/// \brief TestSpawnerDensity Holds 50,000 pickups in a large arena while they are collected
+/// and respawned, far more than a match ever has, and checks the spawner rarely runs out of
+/// tries to find them a spot
+///
+static bool testSpawnerDensity(void)
+{
+  enum { c_target = 50000, c_churn = 100000 };
+  static int xs[c_target];
+  static int ys[c_target];
+
+  // About a fifth of the cells are taken once it is full
+  PickupSpawner spawner;
+  CHECK(createPickupSpawner(&spawner, 16384, 16384, PICKUP_SIZE, NULL));
+
+  unsigned int seed = 8;
+  int count = 0;
+  int misses = 0;
+
+  while(count < c_target && misses < 1000)
+  {
+    if(spawnPickup(&spawner, &seed, &xs[count], &ys[count])) { ++count; }
+    else { ++misses; }
+  }
+
+  CHECK(count == c_target && spawner.count == c_target);
+
+  // One out, one in, retrying on later spawns as the game does
+  for(int i = 0; i < c_churn; ++i)
+  {
+    // Two rolls, as one only reaches 32767
+    const int c_collected = (randRange(&seed, 0, 32767) * 32768 + randRange(&seed, 0, 32767)) % count;
+
+    removeSpawnedPickup(&spawner, xs[c_collected], ys[c_collected]);
+    xs[c_collected] = xs[count - 1];
+    ys[c_collected] = ys[count - 1];
+    --count;
+
+    while(count < c_target && misses < 1000)
+    {
+      if(spawnPickup(&spawner, &seed, &xs[count], &ys[count])) { ++count; }
+      else { ++misses; }
+    }
+  }
+
+  CHECK(count == c_target && spawner.count == c_target && misses < 100);
+
+  freePickupSpawner(&spawner);
+
+  return true;
+}
+
+///
+/// \brief TestSweepSelfCollision A head that isn't moving has only where it is to check, so
+/// the sweep has to agree with collidesWithSelf on every tick of a run of random matches
+///
+static bool testSweepSelfCollision(void)
+{
+  static const Move c_turns[] = { UP, LEFT, DOWN, RIGHT };
+  unsigned int seed = 3;
+  int collisions = 0;
+
+  for(unsigned int match = 1; match <= 50; ++match)
+  {
+    Game game;
+    initialiseGame(&game, match, NULL, NULL, 40, 1);
+
+    Move moves[PLAYER_TOTAL] = { RIGHT, RIGHT };
+    bool isRunning = true;
+
+    while(isRunning && game.ticks < 2000)
+    {
+      for(int p = 0; p < PLAYER_TOTAL; ++p)
+      {
+        Node *head = game.players[p].head;
+        SegmentSweep tailEnd[GAME_TICK_MOVES_MAX];
+        int tailEndCount;
+
+        const bool c_isSwept = (sweepSelfCollision(head, 0, 0, 0, tailEnd, &tailEndCount) == 0);
+        CHECK(tailEndCount == 0);
+
+        CHECK(c_isSwept == collidesWithSelf(head));
+        collisions += c_isSwept ? 1 : 0;
+
+        if(randRange(&seed, 0, 3) == 0)
+        {
+          moves[p] = c_turns[randRange(&seed, 0, 3)];
+        }
+      }
+
+      isRunning = updateGame(&game, moves);
+    }
+
+    freeGame(&game);
+  }
+
+  CHECK(collisions > 0);
+
+  return true;
+}
+
+///
+/// \brief TestPickupSweep A snake making several moves a tick collects a gem lying part way
+/// along them that tick, but not one it only gets to after the last
+///
+static bool testPickupSweep(void)
+{
+  static const int c_moves = 8;
+
+  for(int isAhead = 0; isAhead < 2; ++isAhead)
+  {
+    Game game;
+    initialiseGame(&game, 7, NULL, NULL, SNAKE_START_LENGTH, c_moves);
+
+    // Nothing else to collect, and nothing to replace it with
+    game.pickups.gems.count = 0;
+    game.pickups.knights.count = 0;
+
+    // The first snake turns down, where there is the most room ahead of it, and the other
+    // carries on right, out of the way
+    const Move c_straight[PLAYER_TOTAL] = { DOWN, RIGHT };
+
+    const Node *head = game.players[0].head;
+    SDL_Rect step = { 0, 0, head->pos.w, head->pos.h };
+    moveSprite(c_straight[0], &step, head->pos.h / 4);
+
+    // Half way along this tick's moves, or a few past the last of them
+    const int c_ahead = isAhead ? c_moves / 2 : c_moves + 4;
+    Gems *gems = &game.pickups.gems;
+
+    gems->count = 1;
+    gems->id[0] = 0;
+    gems->type[0] = 0;
+    gems->x[0] = head->pos.x + c_ahead * step.x + (head->pos.w - PICKUP_SIZE) / 2;
+    gems->y[0] = head->pos.y + c_ahead * step.y + (head->pos.h - PICKUP_SIZE) / 2;
+
+    CHECK(gems->x[0] >= 0 && gems->x[0] + PICKUP_SIZE <= WIDTH);
+    CHECK(gems->y[0] >= 0 && gems->y[0] + PICKUP_SIZE <= HEIGHT);
+
+    const int c_score = game.players[0].pickupCount;
+    CHECK(updateGame(&game, c_straight));
+
+    CHECK(game.players[0].pickupCount == c_score + (isAhead ? 1 : 0));
+    CHECK(gems->count == (isAhead ? 0 : 1));
+
+    // The one further on is reached the tick after
+    if(!isAhead)
+    {
+      updateGame(&game, c_straight);
+      CHECK(game.players[0].pickupCount == c_score + 1);
+    }
+
+    freeGame(&game);
+  }
+
+  return true;
+}
+
+///
+/// \brief TestObservation Rasterises a known board and checks every cell of every channel,
+/// including a knight seen across the arena's edge
+///
+static bool testObservation(void)
+{
+  typedef struct Cells{
+    ObservationChannel channel;
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+  } Cells;
+
+  Observation obs;
+  CHECK(createObservation(&obs, 9, 16));
+
+  static Node self[2];
+  static Node other;
+  static Pickups pickups;
+
+  // The head's centre is the middle of cell (4, 4), its body one to the right and above
+  self[0].pos = (SDL_Rect){ 400, 300, 16, 16 };
+  self[1].pos = (SDL_Rect){ 424, 292, 16, 16 };
+  self[0].next = &self[1];
+  other.pos = (SDL_Rect){ 380, 330, 16, 16 };
+  Node *const c_others[2] = { &other, NULL };
+
+  pickups.gems.count = 1;
+  pickups.gems.x[0] = 344;
+  pickups.gems.y[0] = 348;
+  pickups.gems.type[0] = RED;
+
+  // Too far away to be seen
+  pickups.knights.count = 1;
+  pickups.knights.x[0] = 100;
+  pickups.knights.y[0] = 100;
+
+  const Cells c_expected[] = {
+    { OBS_OWN_BODY, 3, 3, 4, 4 },
+    { OBS_OWN_BODY, 5, 3, 5, 3 },
+    { OBS_OTHER_BODY, 2, 5, 3, 6 },
+    { OBS_GEM_RED, 0, 6, 1, 8 }
+  };
+
+  // The same knight just past the left edge is right beside a head at the right edge
+  Node edgeHead = self[0];
+  edgeHead.pos.x = WIDTH - 10;
+  edgeHead.next = NULL;
+  const Cells c_edgeExpected[] = {
+    { OBS_OWN_BODY, 3, 3, 4, 4 },
+    { OBS_KNIGHT, 8, 2, 8, 6 }
+  };
+
+  for(int board = 0; board < 2; ++board)
+  {
+    const Cells *c_cells = (board == 0) ? c_expected : c_edgeExpected;
+    const int c_cellCount = (board == 0) ? 4 : 2;
+
+    if(board == 0)
+    {
+      rasteriseObservation(&obs, &self[0], c_others, 2, &pickups);
+    }
+    else
+    {
+      pickups.gems.count = 0;
+      pickups.knights.x[0] = -60;
+      pickups.knights.y[0] = 290;
+      rasteriseObservation(&obs, &edgeHead, NULL, 0, &pickups);
+    }
+
+    for(int c = 0; c < OBS_CHANNEL_TOTAL; ++c)
+    {
+      const Uint8 *c_plane = getObservationPlane(&obs, (ObservationChannel)c);
+
+      for(int y = 0; y < obs.resolution; ++y)
+      {
+        for(int x = 0; x < obs.resolution; ++x)
+        {
+          bool isCovered = false;
+
+          for(int i = 0; i < c_cellCount; ++i)
+          {
+            isCovered = isCovered || ((int)c_cells[i].channel == c &&
+                                      x >= c_cells[i].x0 && x <= c_cells[i].x1 &&
+                                      y >= c_cells[i].y0 && y <= c_cells[i].y1);
+          }
+
+          CHECK(c_plane[y * obs.resolution + x] == (isCovered ? 255 : 0));
+        }
+      }
+    }
+  }
+
+  CHECK(getObservationPlane(&obs, OBS_CHANNEL_TOTAL) == NULL);
+  freeObservation(&obs);
+
+  // Out of range sizes are refused
+  CHECK(!createObservation(&obs, OBS_RESOLUTION_MAX + 1, 16) && obs.grid == NULL);
+  CHECK(!createObservation(&obs, 9, 0) && obs.grid == NULL);
+
+  return true;
+}
+
+///
+/// \brief TestNetplayRollback Two peers on localhost take turns running a few ticks each, so
+/// they keep guessing each other's input wrong and rolling back. Every final save either
+/// peer gives out has to match the same match played straight through with the real inputs
+///
+static bool testNetplayRollback(void)
+{
+  enum { c_rounds = 300, c_tickMax = c_rounds * 8 };
+  static const Move c_moves[4] = { UP, LEFT, DOWN, RIGHT };
+  static Netplay peers[PLAYER_TOTAL];
+  static Game games[PLAYER_TOTAL];
+  static Game straight;
+  static Game final;
+  static Move inputs[PLAYER_TOTAL][c_tickMax];
+  static Uint64 straightHashes[c_tickMax];   // Before each tick
+
+  // Any free port will do
+  int port = TEST_NETPLAY_PORT;
+  while(port < TEST_NETPLAY_PORT + 10 && !startNetplay(&peers[0], port, NULL))
+  {
+    ++port;
+  }
+
+  char address[32];
+  sprintf(address, "127.0.0.1:%d", port);
+  CHECK(port < TEST_NETPLAY_PORT + 10 && startNetplay(&peers[1], 0, address));
+
+  // Nothing is final before the first tick, whatever is asked for
+  CHECK(getFinalSave(&peers[0], -1) == NULL && getFinalSave(&peers[0], 0) == NULL);
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    initialiseGame(&games[p], 9, NULL, NULL, SNAKE_START_LENGTH, 1);
+  }
+
+  initialiseGame(&straight, 9, NULL, NULL, SNAKE_START_LENGTH, 1);
+  initialiseGame(&final, 9, NULL, NULL, SNAKE_START_LENGTH, 1);
+  straightHashes[0] = computeGameHash(&straight);
+
+  unsigned int seed = 11;
+  Move held[PLAYER_TOTAL] = { RIGHT, RIGHT };
+  int nextFinal[PLAYER_TOTAL] = { 0, 0 };
+  int played = 0;
+  int compared = 0;
+
+  for(int round = 0; round < c_rounds; ++round)
+  {
+    const int p = round % PLAYER_TOTAL;
+    const int c_ticks = randRange(&seed, 1, 8);
+
+    for(int i = 0; i < c_ticks; ++i)
+    {
+      held[p] = randRange(&seed, 0, 2) ? held[p] : c_moves[randRange(&seed, 0, 3)];
+
+      if(advanceNetplay(&peers[p], &games[p], held[p]))
+      {
+        inputs[p][peers[p].tick - 1] = held[p];
+      }
+
+      // Older saves than the last few have been reused, and later ones aren't final
+      CHECK(getFinalSave(&peers[p], peers[p].finalTick + 1) == NULL);
+      CHECK(getFinalSave(&peers[p], (int)peers[p].tick - NETPLAY_MAX_ROLLBACK - 2) == NULL);
+
+      const GameSave *save;
+      while((save = getFinalSave(&peers[p], nextFinal[p])) != NULL)
+      {
+        // Play the straight match on to the same tick, filtering moves as netplay does
+        while(played < nextFinal[p])
+        {
+          Move moves[PLAYER_TOTAL];
+
+          for(int q = 0; q < PLAYER_TOTAL; ++q)
+          {
+            const Move c_move = inputs[q][played];
+            moves[q] = isOppositeMove(straight.players[q].head->idleDirection, c_move) ? NOTMOVING : c_move;
+          }
+
+          updateGame(&straight, moves);
+          straightHashes[++played] = computeGameHash(&straight);
+        }
+
+        restoreGame(&final, save);
+        CHECK(computeGameHash(&final) == straightHashes[nextFinal[p]]);
+        ++compared;
+        ++nextFinal[p];
+      }
+    }
+  }
+
+  const unsigned int c_rollbacks = peers[0].rollbacks + peers[1].rollbacks;
+  const unsigned int c_desyncs = peers[0].desyncs + peers[1].desyncs;
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    stopNetplay(&peers[p]);
+    freeGame(&games[p]);
+  }
+
+  freeGame(&straight);
+  freeGame(&final);
+
+  CHECK(c_rollbacks > 0 && c_desyncs == 0);
+  CHECK(compared > c_rounds);
+
+  return true;
+}
+
+///
+/// \brief TestIncrementalHash The running hash kept up to date by every move, pickup and
+/// timer has to match one rebuilt from scratch, over whole matches of random moves with
+/// pickups respawning and after restarts
+///
+static bool testIncrementalHash(void)
+{
+  static const Move c_moves[4] = { UP, LEFT, DOWN, RIGHT };
+  static Game game;
+  PickupSpawner spawner;
+  CHECK(createPickupSpawner(&spawner, WIDTH, HEIGHT, PICKUP_SIZE, NULL));
+
+  initialiseGame(&game, 21, NULL, &spawner, SNAKE_START_LENGTH, 1);
+
+  unsigned int seed = 3;
+  int checked = 0;
+  int collected = 0;
+
+  for(int match = 0; match < 20; ++match)
+  {
+    Move held[PLAYER_TOTAL] = { RIGHT, RIGHT };
+
+    for(int t = 0; t < 3000 && game.state == GAME_RUNNING; ++t)
+    {
+      for(int p = 0; p < PLAYER_TOTAL; ++p)
+      {
+        const Move c_move = randRange(&seed, 0, 9) ? held[p] : c_moves[randRange(&seed, 0, 3)];
+        held[p] = isOppositeMove(game.players[p].head->idleDirection, c_move) ? held[p] : c_move;
+      }
+
+      updateGame(&game, held);
+
+      CHECK(getGameHash(&game) == computeGameHash(&game));
+      ++checked;
+    }
+
+    collected += game.players[0].pickupCount + game.players[1].pickupCount;
+    resetGame(&game, 100 + match);
+    CHECK(getGameHash(&game) == computeGameHash(&game));
+  }
+
+  freeGame(&game);
+  freePickupSpawner(&spawner);
+
+  CHECK(checked > 1000 && collected > 0);
+
+  return true;
+}
+
+///
+/// \brief TestParticlesSwapRemove Gives every particle its own colour to follow it through
+/// the updates, and checks that exactly the ones with life left are live, each still with
+/// its own life and fade after the faded ones were swapped out from under it
+///
+static bool testParticlesSwapRemove(void)
+{
+  enum { c_total = 3000 };
+  static float life[c_total];
+  static float fade[c_total];
+  static bool isSeen[c_total];
+
+  Particles particles;
+  CHECK(createParticles(&particles, 1));
+
+  unsigned int seed = 4;
+
+  for(int id = 0; id < c_total; ++id)
+  {
+    const SDL_Color c_colour = { (Uint8)(id >> 8), (Uint8)id, 0, 255 };
+    emitParticles(&particles, 400.0f, 300.0f, 1, 100.0f, randRange(&seed, 1, 100) / 50.0f, c_colour);
+
+    life[id] = particles.life[particles.count - 1];
+    fade[id] = particles.fade[particles.count - 1];
+  }
+
+  CHECK(particles.count == c_total);
+
+  for(int step = 0; step < 200 && particles.count > 0; ++step)
+  {
+    const float c_seconds = randRange(&seed, 1, 30) / 1000.0f;
+    updateParticles(&particles, c_seconds);
+
+    int live = 0;
+
+    for(int id = 0; id < c_total; ++id)
+    {
+      life[id] -= c_seconds;
+      live += (life[id] > 0.0f) ? 1 : 0;
+      isSeen[id] = false;
+    }
+
+    CHECK(particles.count == live);
+
+    for(int i = 0; i < particles.count; ++i)
+    {
+      const int c_id = particles.colour[i].r * 256 + particles.colour[i].g;
+
+      CHECK(c_id < c_total && !isSeen[c_id]);
+      CHECK(particles.life[i] == life[c_id] && particles.life[i] > 0.0f);
+      CHECK(particles.fade[i] == fade[c_id]);
+      isSeen[c_id] = true;
+    }
+  }
+
+  CHECK(particles.count == 0);
+
+  // Once it is full any more are dropped
+  const SDL_Color c_white = { 255, 255, 255, 255 };
+  emitParticles(&particles, 0.0f, 0.0f, PARTICLE_CAPACITY + 10, 10.0f, 1.0f, c_white);
+  CHECK(particles.count == PARTICLE_CAPACITY);
+
+  freeParticles(&particles);
+
+  return true;
+}
+
+///
+/// \brief TestViewportsTile Every split has to cover the whole canvas without any two views
+/// overlapping, for odd sizes too, with each camera the size of its view
+///
+static bool testViewportsTile(void)
+{
+  static const int c_sizes[3][2] = { { 800, 600 }, { 801, 601 }, { 7, 5 } };
+
+  for(int s = 0; s < 3; ++s)
+  {
+    const int c_w = c_sizes[s][0];
+    const int c_h = c_sizes[s][1];
+
+    for(int count = 1; count <= VIEWPORT_MAX; ++count)
+    {
+      Viewports views;
+      initialiseViewports(&views, count, c_w, c_h);
+      CHECK(views.count == count);
+
+      long area = 0;
+
+      for(int v = 0; v < count; ++v)
+      {
+        const SDL_Rect *c_screen = &views.views[v].screen;
+
+        CHECK(c_screen->w > 0 && c_screen->h > 0);
+        CHECK(c_screen->x >= 0 && c_screen->y >= 0 && c_screen->x + c_screen->w <= c_w && c_screen->y + c_screen->h <= c_h);
+        CHECK(views.views[v].camera.w == c_screen->w && views.views[v].camera.h == c_screen->h);
+        CHECK(views.views[v].player == v % PLAYER_TOTAL);
+        area += (long)c_screen->w * c_screen->h;
+
+        for(int u = 0; u < v; ++u)
+        {
+          const SDL_Rect *c_other = &views.views[u].screen;
+
+          CHECK(c_screen->x >= c_other->x + c_other->w || c_other->x >= c_screen->x + c_screen->w ||
+                c_screen->y >= c_other->y + c_other->h || c_other->y >= c_screen->y + c_screen->h);
+        }
+      }
+
+      // Inside the canvas and not overlapping, so covering all of it is down to the area
+      CHECK(area == (long)c_w * c_h);
+
+      freeViewports(&views);
+    }
+  }
+
+  return true;
+}
+
+///
+/// \brief TestHud Composes the HUD on a software canvas, checks the first glyph is drawn
+/// from the atlas in the player's colour, and that it is only composed again when a value
+/// it shows changes
+///
+static bool testHud(void)
+{
+  // Rows of the 5x7 'P', the leftmost pixel in bit 4
+  static const Uint8 c_p[HUD_GLYPH_H] = { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 };
+  static Snapshot snapshot;
+
+  SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, 800, 600, 32, SDL_PIXELFORMAT_ARGB8888);
+  CHECK(surface != NULL);
+  SDL_Renderer *renderer = SDL_CreateSoftwareRenderer(surface);
+  CHECK(renderer != NULL);
+
+  Canvas canvas;
+  CHECK(createCanvas(&canvas, renderer, true, 800, 600));
+
+  const SDL_Color c_colours[PLAYER_TOTAL] = { { 255, 96, 0, 255 }, { 255, 255, 0, 255 } };
+  Hud hud;
+  CHECK(createHud(&hud, &canvas, c_colours));
+
+  snapshot.pickupCount[0] = 12;
+  snapshot.segmentCount[0] = 36;
+  snapshot.pickupCount[1] = 7;
+  snapshot.segmentCount[1] = 31;
+  snapshot.tickMicroseconds = 48;
+  drawHud(&hud, &canvas, &snapshot);
+
+  // "P1 ..." starts at the padding, each glyph pixel HUD_SCALE wide and tall
+  const Uint32 c_background = hud.pixels[0];
+  const Uint32 c_p1 = 0xFF000000u | (255u << 16) | (96u << 8);
+  const int c_padding = (hud.h - HUD_GLYPH_H * HUD_SCALE) / 2;
+
+  for(int y = 0; y < HUD_GLYPH_H * HUD_SCALE; ++y)
+  {
+    for(int x = 0; x < HUD_GLYPH_W * HUD_SCALE; ++x)
+    {
+      const bool c_isSet = (c_p[y / HUD_SCALE] >> (HUD_GLYPH_W - 1 - x / HUD_SCALE)) & 1;
+      const Uint32 c_pixel = hud.pixels[(c_padding + y) * hud.w + c_padding + x];
+
+      CHECK(c_pixel == (c_isSet ? c_p1 : c_background));
+    }
+  }
+
+  // Nothing has changed, so the HUD isn't composed again
+  hud.pixels[0] = 0;
+  drawHud(&hud, &canvas, &snapshot);
+  CHECK(hud.pixels[0] == 0);
+
+  snapshot.segmentCount[1] = 32;
+  drawHud(&hud, &canvas, &snapshot);
+  CHECK(hud.pixels[0] == c_background);
+
+  freeHud(&hud);
+  freeCanvas(&canvas);
+  SDL_DestroyRenderer(renderer);
+  SDL_FreeSurface(surface);
+
+  return true;
+}
+
+///
+/// \brief TestSpawnerCover Plays matches with the spawner's cover kept up to date as things
+/// move, and checks it against covering every segment and knight again from scratch, also
+/// after restoring a save
+///
+static bool testSpawnerCover(void)
+{
+  static const Move c_moves[4] = { UP, LEFT, DOWN, RIGHT };
+  static Game game;
+  PickupSpawner spawner;
+  PickupSpawner fresh;
+  GameSave save;
+  CHECK(createPickupSpawner(&spawner, WIDTH, HEIGHT, PICKUP_SIZE, NULL));
+  CHECK(createPickupSpawner(&fresh, WIDTH, HEIGHT, PICKUP_SIZE, NULL));
+  initialiseGameSave(&save);
+
+  const int c_cellTotal = spawner.cols * spawner.rows;
+  unsigned int seed = 6;
+  int checked = 0;
+
+  for(int match = 0; match < 8; ++match)
+  {
+    initialiseGame(&game, 30 + match, NULL, &spawner, SNAKE_START_LENGTH, 1 + match % 4);
+
+    Move held[PLAYER_TOTAL] = { RIGHT, RIGHT };
+
+    for(int t = 0; t < 1500 && game.state == GAME_RUNNING; ++t)
+    {
+      for(int p = 0; p < PLAYER_TOTAL; ++p)
+      {
+        const Move c_move = randRange(&seed, 0, 9) ? held[p] : c_moves[randRange(&seed, 0, 3)];
+        held[p] = isOppositeMove(game.players[p].head->idleDirection, c_move) ? held[p] : c_move;
+      }
+
+      if(t == 500)
+      {
+        CHECK(saveGame(&save, &game));
+      }
+      else if(t == 1000)
+      {
+        restoreGame(&game, &save);
+      }
+
+      updateGame(&game, held);
+
+      clearPickupSpawner(&fresh);
+
+      for(int p = 0; p < PLAYER_TOTAL; ++p)
+      {
+        for(const Node *node = game.players[p].tail; node != NULL; node = node->prev)
+        {
+          coverSpawner(&fresh, &node->pos);
+        }
+      }
+
+      const Knights *c_knights = &game.pickups.knights;
+
+      for(int i = 0; i < c_knights->count; ++i)
+      {
+        const SDL_Rect c_knight = { c_knights->x[i], c_knights->y[i], KNIGHT_SIZE, KNIGHT_SIZE };
+        coverSpawner(&fresh, &c_knight);
+      }
+
+      CHECK(memcmp(spawner.covered, fresh.covered, c_cellTotal * sizeof(Uint32)) == 0);
+      ++checked;
+    }
+
+    freeGame(&game);
+  }
+
+  freeGameSave(&save);
+  freePickupSpawner(&fresh);
+  freePickupSpawner(&spawner);
+
+  CHECK(checked > 1000);
+
+  return true;
+}
+
+///
+/// \brief TestTickMoves Plays the same matches with one move a tick and with several, holding
+/// each input for as many one move ticks, and checks the games are the same at the end of every
+/// longer tick, with and without walls and a spawner
+///
+static bool testTickMoves(void)
+{
+  static const Move c_turns[4] = { UP, LEFT, DOWN, RIGHT };
+  static Game fine;
+  static Game coarse;
+  PickupSpawner fineSpawner;
+  PickupSpawner coarseSpawner;
+  ArenaMap map;
+  SDL_Rect walls[4];
+  unsigned int seed = 11;
+
+  for(int i = 0; i < 4; ++i)
+  {
+    walls[i].x = randRange(&seed, 0, WIDTH - 100);
+    walls[i].y = randRange(&seed, 0, HEIGHT - 100);
+    walls[i].w = randRange(&seed, 8, 100);
+    walls[i].h = randRange(&seed, 8, 100);
+  }
+
+  CHECK(buildArenaMap(&map, walls, 4, WIDTH, HEIGHT));
+  CHECK(createPickupSpawner(&fineSpawner, WIDTH, HEIGHT, PICKUP_SIZE, &map));
+  CHECK(createPickupSpawner(&coarseSpawner, WIDTH, HEIGHT, PICKUP_SIZE, &map));
+
+  int collected = 0;
+
+  for(int match = 0; match < 128; ++match)
+  {
+    const int c_moves = 2 + match % 15;
+    const ArenaMap *c_map = (match & 8) ? &map : NULL;
+    const bool c_isRespawning = (match & 16) != 0;
+
+    // The spawner is made for the walls, which only matters while it spawns
+    initialiseGame(&fine, 40 + match, c_map, c_isRespawning ? &fineSpawner : NULL, 24, 1);
+    initialiseGame(&coarse, 40 + match, c_map, c_isRespawning ? &coarseSpawner : NULL, 24, c_moves);
+
+    Move held[PLAYER_TOTAL] = { RIGHT, RIGHT };
+    bool isRunning = true;
+
+    for(int t = 0; t < 600 && isRunning; ++t)
+    {
+      for(int p = 0; p < PLAYER_TOTAL; ++p)
+      {
+        const Move c_move = randRange(&seed, 0, 3) ? held[p] : c_turns[randRange(&seed, 0, 3)];
+        held[p] = isOppositeMove(coarse.players[p].head->idleDirection, c_move) ? held[p] : c_move;
+      }
+
+      bool isFineRunning = true;
+
+      for(int m = 0; m < c_moves && isFineRunning; ++m)
+      {
+        isFineRunning = updateGame(&fine, held);
+      }
+
+      isRunning = updateGame(&coarse, held);
+
+      CHECK(isRunning == isFineRunning);
+      CHECK(fine.state == coarse.state && fine.time == coarse.time);
+      CHECK(fine.pickupHash == coarse.pickupHash);
+      CHECK(memcmp(fine.segmentHash, coarse.segmentHash, sizeof(fine.segmentHash)) == 0);
+      CHECK(memcmp(&fine.pickups, &coarse.pickups, sizeof(fine.pickups)) == 0);
+
+      for(int p = 0; p < PLAYER_TOTAL; ++p)
+      {
+        CHECK(fine.players[p].pickupCount == coarse.players[p].pickupCount);
+      }
+    }
+
+    collected += coarse.players[0].pickupCount + coarse.players[1].pickupCount;
+
+    freeGame(&fine);
+    freeGame(&coarse);
+  }
+
+  freePickupSpawner(&coarseSpawner);
+  freePickupSpawner(&fineSpawner);
+  freeArenaMap(&map);
+
+  CHECK(collected > 0);
+
+  return true;
+}
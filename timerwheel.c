@@ -0,0 +1,273 @@
+#include "timerwheel.h"
+
+// The last list holds the timers due on the current tick
+#define EXPIRED_LIST (TIMER_LISTS - 1)
+
+static int getList(const TimerWheel *_wheel, unsigned int _due);
+static void appendTimer(TimerWheel *io_wheel, int _list, int _timer);
+static void unlinkTimer(TimerWheel *io_wheel, int _timer);
+static void cascadeList(TimerWheel *io_wheel, int _list);
+static Uint64 getTimerKey(const TimerWheel *_wheel, int _timer);
+
+void initialiseTimerWheel(TimerWheel *o_wheel)
+{
+  o_wheel->now = 0;
+  o_wheel->checksum = 0;
+
+  for(int i = 0; i < TIMER_LISTS; ++i)
+  {
+    o_wheel->heads[i] = -1;
+    o_wheel->tails[i] = -1;
+  }
+
+  for(int i = 0; i < TIMER_CAPACITY; ++i)
+  {
+    o_wheel->timers[i].list = -1;
+    o_wheel->timers[i].prev = -1;
+    o_wheel->timers[i].next = (i < TIMER_CAPACITY - 1) ? i + 1 : -1;
+  }
+
+  o_wheel->freeTimers = 0;
+}
+
+int scheduleTimer(TimerWheel *io_wheel,
+                  unsigned int _delay,
+                  unsigned int _period,
+                  int _kind,
+                  int _data)
+{
+  const int c_timer = io_wheel->freeTimers;
+
+  if(c_timer < 0)
+  {
+    return -1;
+  }
+
+  io_wheel->freeTimers = io_wheel->timers[c_timer].next;
+
+  Timer *timer = &io_wheel->timers[c_timer];
+  timer->due = io_wheel->now + (_delay > 0 ? _delay : 1);
+  timer->period = _period;
+  timer->kind = _kind;
+  timer->data = _data;
+
+  appendTimer(io_wheel, getList(io_wheel, timer->due), c_timer);
+  io_wheel->checksum += getTimerKey(io_wheel, c_timer);
+
+  return c_timer;
+}
+
+void cancelTimer(TimerWheel *io_wheel,
+                 int _timer)
+{
+  if(_timer < 0 || _timer >= TIMER_CAPACITY || io_wheel->timers[_timer].list < 0)
+  {
+    return;
+  }
+
+  io_wheel->checksum -= getTimerKey(io_wheel, _timer);
+  unlinkTimer(io_wheel, _timer);
+
+  io_wheel->timers[_timer].next = io_wheel->freeTimers;
+  io_wheel->freeTimers = _timer;
+}
+
+void advanceTimerWheel(TimerWheel *io_wheel)
+{
+  io_wheel->now++;
+
+  // Each time a level wraps round, the next slot of the level above is spread over the
+  // levels below it. Its timers are all due within that slot's span, so none of them
+  // can land back in the slot being emptied
+  for(int level = TIMER_WHEEL_LEVELS - 1; level > 0; --level)
+  {
+    const unsigned int c_shift = level * TIMER_WHEEL_BITS;
+
+    if((io_wheel->now & ((1u << c_shift) - 1)) == 0)
+    {
+      cascadeList(io_wheel, level * TIMER_WHEEL_SLOTS + ((io_wheel->now >> c_shift) & (TIMER_WHEEL_SLOTS - 1)));
+    }
+  }
+
+  // Everything in this tick's level 0 slot is due now, splice the whole list on
+  const int c_list = io_wheel->now & (TIMER_WHEEL_SLOTS - 1);
+  const int c_head = io_wheel->heads[c_list];
+
+  if(c_head < 0)
+  {
+    return;
+  }
+
+  for(int timer = c_head; timer >= 0; timer = io_wheel->timers[timer].next)
+  {
+    io_wheel->timers[timer].list = EXPIRED_LIST;
+  }
+
+  if(io_wheel->tails[EXPIRED_LIST] < 0)
+  {
+    io_wheel->heads[EXPIRED_LIST] = c_head;
+  }
+  else
+  {
+    io_wheel->timers[io_wheel->tails[EXPIRED_LIST]].next = c_head;
+    io_wheel->timers[c_head].prev = io_wheel->tails[EXPIRED_LIST];
+  }
+
+  io_wheel->tails[EXPIRED_LIST] = io_wheel->tails[c_list];
+  io_wheel->heads[c_list] = -1;
+  io_wheel->tails[c_list] = -1;
+}
+
+bool popExpiredTimer(TimerWheel *io_wheel,
+                     int *o_kind,
+                     int *o_data)
+{
+  const int c_timer = io_wheel->heads[EXPIRED_LIST];
+
+  if(c_timer < 0)
+  {
+    return false;
+  }
+
+  Timer *timer = &io_wheel->timers[c_timer];
+  *o_kind = timer->kind;
+  *o_data = timer->data;
+
+  if(timer->period > 0)
+  {
+    io_wheel->checksum -= getTimerKey(io_wheel, c_timer);
+    unlinkTimer(io_wheel, c_timer);
+
+    timer->due = io_wheel->now + timer->period;
+    appendTimer(io_wheel, getList(io_wheel, timer->due), c_timer);
+    io_wheel->checksum += getTimerKey(io_wheel, c_timer);
+  }
+  else
+  {
+    cancelTimer(io_wheel, c_timer);
+  }
+
+  return true;
+}
+
+Uint64 computeTimerChecksum(const TimerWheel *_wheel)
+{
+  Uint64 sum = 0;
+
+  for(int i = 0; i < TIMER_CAPACITY; ++i)
+  {
+    if(_wheel->timers[i].list >= 0)
+    {
+      sum += getTimerKey(_wheel, i);
+    }
+  }
+
+  return sum;
+}
+
+///
+/// \brief GetList Finds the slot for a due tick: the lowest level whose span reaches it,
+/// or the furthest slot of the top level for anything beyond, to be placed again from there
+///
+static int getList(const TimerWheel *_wheel,
+                   unsigned int _due)
+{
+  const unsigned int c_delta = _due - _wheel->now;
+
+  for(int level = 0; level < TIMER_WHEEL_LEVELS; ++level)
+  {
+    const unsigned int c_shift = level * TIMER_WHEEL_BITS;
+    const unsigned int c_span = 1u << (c_shift + TIMER_WHEEL_BITS);
+
+    if(c_delta < c_span || level == TIMER_WHEEL_LEVELS - 1)
+    {
+      const unsigned int c_at = (c_delta < c_span) ? _due : _wheel->now + c_span - 1;
+
+      return level * TIMER_WHEEL_SLOTS + ((c_at >> c_shift) & (TIMER_WHEEL_SLOTS - 1));
+    }
+  }
+
+  return EXPIRED_LIST;
+}
+
+static void appendTimer(TimerWheel *io_wheel,
+                        int _list,
+                        int _timer)
+{
+  Timer *timer = &io_wheel->timers[_timer];
+  timer->list = _list;
+  timer->prev = io_wheel->tails[_list];
+  timer->next = -1;
+
+  if(timer->prev < 0)
+  {
+    io_wheel->heads[_list] = _timer;
+  }
+  else
+  {
+    io_wheel->timers[timer->prev].next = _timer;
+  }
+
+  io_wheel->tails[_list] = _timer;
+}
+
+static void unlinkTimer(TimerWheel *io_wheel,
+                        int _timer)
+{
+  Timer *timer = &io_wheel->timers[_timer];
+
+  if(timer->prev < 0)
+  {
+    io_wheel->heads[timer->list] = timer->next;
+  }
+  else
+  {
+    io_wheel->timers[timer->prev].next = timer->next;
+  }
+
+  if(timer->next < 0)
+  {
+    io_wheel->tails[timer->list] = timer->prev;
+  }
+  else
+  {
+    io_wheel->timers[timer->next].prev = timer->prev;
+  }
+
+  timer->list = -1;
+  timer->prev = -1;
+  timer->next = -1;
+}
+
+///
+/// \brief CascadeList Places every timer in a slot again, in order, now that the wheel is closer to them
+///
+static void cascadeList(TimerWheel *io_wheel,
+                        int _list)
+{
+  int timer = io_wheel->heads[_list];
+
+  io_wheel->heads[_list] = -1;
+  io_wheel->tails[_list] = -1;
+
+  while(timer >= 0)
+  {
+    const int c_next = io_wheel->timers[timer].next;
+    appendTimer(io_wheel, getList(io_wheel, io_wheel->timers[timer].due), timer);
+    timer = c_next;
+  }
+}
+
+///
+/// \brief GetTimerKey What a timer adds to the checksum, any change to when or what it fires changes it
+///
+static Uint64 getTimerKey(const TimerWheel *_wheel,
+                          int _timer)
+{
+  const Timer *c_timer = &_wheel->timers[_timer];
+
+  const Uint64 c_when = ((Uint64)c_timer->due << 32) | (Uint32)c_timer->period;
+  const Uint64 c_what = ((Uint64)(Uint32)c_timer->kind << 32) | (Uint32)c_timer->data;
+
+  return (c_when * 0x9E3779B97F4A7C15ull) ^ ((c_what + (Uint64)_timer) * 0xC2B2AE3D27D4EB4Full);
+}
@@ -0,0 +1,86 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <stdbool.h>
+
+#include "utils.h"
+
+#define TIMER_WHEEL_BITS    (6)
+#define TIMER_WHEEL_SLOTS   (1 << TIMER_WHEEL_BITS)   // Slots per level
+#define TIMER_WHEEL_LEVELS  (3)                       // 64^3 ticks ahead before a timer has to wait at the top
+#ifndef TIMER_CAPACITY
+#define TIMER_CAPACITY      (128)                     // Timers scheduled at once, the game needs 2 + 2 * PICKUP_TOTAL
+#endif
+
+// Every slot of every level, plus the list of timers that are due now
+#define TIMER_LISTS         (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS + 1)
+
+typedef struct Timer{
+  unsigned int due;       // Tick it fires on
+  unsigned int period;    // Ticks until it fires again, 0 to fire once
+  int kind;               // What the owner should do when it fires
+  int data;               // Such as which pickup it is for
+  int list;               // Slot it is waiting in, -1 if free
+  int prev;               // Neighbours in its slot, -1 at either end
+  int next;
+} Timer;
+
+// Schedules game events by tick. Level 0 has a slot for each of the next 64 ticks, each
+// level above covers 64 times as long and its slots are moved down a level as their turn
+// comes round, so scheduling, cancelling and firing are all O(1) no matter how many timers
+// are waiting. Timers due on the same tick fire in an order that depends on how they got
+// to level 0, not on when they were scheduled, so owners must not rely on it. It is the same
+// on every machine though, so it never breaks determinism.
+// Everything is held by value and linked by index, so a copy of the wheel (such as in a
+// GameSave) is complete on its own
+typedef struct TimerWheel{
+  unsigned int now;
+  int heads[TIMER_LISTS];
+  int tails[TIMER_LISTS];
+  int freeTimers;         // Chained through next
+  Timer timers[TIMER_CAPACITY];
+  Uint64 checksum;        // Running sum over the waiting timers, see computeTimerChecksum
+} TimerWheel;
+
+///
+/// \brief InitialiseTimerWheel Empties the wheel and sets it to tick 0
+///
+void initialiseTimerWheel(TimerWheel *o_wheel);
+
+///
+/// \brief ScheduleTimer
+/// \param io_wheel
+/// \param _delay Ticks from now until it fires, at least 1
+/// \param _period Ticks between firings after that, 0 to fire once
+/// \param _kind
+/// \param _data
+/// \return The timer, or -1 if all TIMER_CAPACITY are in use
+///
+int scheduleTimer(TimerWheel *io_wheel, unsigned int _delay, unsigned int _period, int _kind, int _data);
+
+///
+/// \brief CancelTimer Stops a timer, even if it is already due this tick
+///
+void cancelTimer(TimerWheel *io_wheel, int _timer);
+
+///
+/// \brief AdvanceTimerWheel Moves on to the next tick, after which popExpiredTimer returns
+/// every timer due on it
+///
+void advanceTimerWheel(TimerWheel *io_wheel);
+
+///
+/// \brief PopExpiredTimer Takes the next timer that is due, rescheduling it if it repeats
+/// \param io_wheel
+/// \param o_kind
+/// \param o_data
+/// \return False once every due timer has been taken
+///
+bool popExpiredTimer(TimerWheel *io_wheel, int *o_kind, int *o_data);
+
+///
+/// \brief ComputeTimerChecksum Rebuilds the running checksum from every waiting timer
+///
+Uint64 computeTimerChecksum(const TimerWheel *_wheel);
+
+#endif // TIMERWHEEL_H
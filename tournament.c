@@ -0,0 +1,505 @@
+#include "tournament.h"
+
+#include <string.h>
+
+#include "ai.h"
+#include "allocator.h"
+#include "game.h"
+#include "observation.h"
+#include "statehash.h"
+#include "trace.h"
+
+#define TOURNAMENT_OBSERVATION_CELL (SNAKE_RADIUS / 4)  // Pixels per observation cell, one move of a head
+
+// Shared between the worker threads
+typedef struct Tournament{
+  const Options *options;
+  const ArenaMap *map;    // Walls every match is played in, NULL for an open arena
+  SDL_atomic_t nextMatch;
+
+  SDL_mutex *outputLock;  // Guards everything below
+  FILE *output;
+  FILE *hashLog;          // Every tick's hash, NULL if not asked for
+  bool isJson;
+  int finished;
+  int wins[PLAYER_TOTAL];
+  int draws;
+  Uint64 observations;    // Snake views rasterised for --observe, and the counter ticks they took
+  Uint64 observeTime;
+} Tournament;
+
+static int playMatches(Tournament *io_tournament);
+static int runWorker(void *_data);
+static Move getScriptedMovement(unsigned int *io_seed, Move _current);
+static int getSnakeLength(const Player *_player);
+static const char *getResultCause(const Game *_game, unsigned int _maxTicks);
+static void writeResult(Tournament *io_tournament, int _match, unsigned int _seed,
+                        const Game *_game, Uint64 _hashChain);
+static void writeHashLog(Tournament *io_tournament, int _match, const Uint64 *_hashes, int _count);
+
+int runTournament(const Options *_options)
+{
+  // Only the timer is needed, there is no window or renderer in a tournament
+  if(SDL_Init(SDL_INIT_TIMER) == -1)
+  {
+    printf("%s\n", SDL_GetError());
+    return EXIT_FAILURE;
+  }
+
+  // Loaded once and shared, nothing writes to it
+  ArenaMap map;
+
+  if(_options->mapPath != NULL && !loadArenaMap(&map, _options->mapPath, WIDTH, HEIGHT))
+  {
+    SDL_Quit();
+    return EXIT_FAILURE;
+  }
+
+  Tournament tournament;
+  tournament.options = _options;
+  tournament.map = (_options->mapPath != NULL) ? &map : NULL;
+  SDL_AtomicSet(&tournament.nextMatch, 0);
+  tournament.finished = 0;
+  tournament.draws = 0;
+  tournament.observations = 0;
+  tournament.observeTime = 0;
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    tournament.wins[p] = 0;
+  }
+
+  const char *c_extension = strrchr(_options->resultsPath, '.');
+  tournament.isJson = (c_extension != NULL && strcmp(c_extension, ".jsonl") == 0);
+
+  tournament.output = fopen(_options->resultsPath, "w");
+  tournament.outputLock = SDL_CreateMutex();
+  tournament.hashLog = NULL;
+  int status = EXIT_FAILURE;
+
+  if(!tournament.output)
+  {
+    printf("Unable to open %s for results\n", _options->resultsPath);
+  }
+  else if(!tournament.outputLock)
+  {
+    printf("%s\n", SDL_GetError());
+  }
+  else if(_options->hashLogPath != NULL &&
+          (tournament.hashLog = fopen(_options->hashLogPath, "w")) == NULL)
+  {
+    printf("Unable to open %s for hashes\n", _options->hashLogPath);
+  }
+  else
+  {
+    status = playMatches(&tournament);
+  }
+
+  // Every way out comes through here, so only free what was actually made
+  if(tournament.output)
+  {
+    fclose(tournament.output);
+  }
+
+  if(tournament.hashLog)
+  {
+    fclose(tournament.hashLog);
+  }
+
+  if(tournament.outputLock)
+  {
+    SDL_DestroyMutex(tournament.outputLock);
+  }
+
+  if(tournament.map != NULL)
+  {
+    freeArenaMap(&map);
+  }
+
+  SDL_Quit();
+
+  return status;
+}
+
+///
+/// \brief PlayMatches Plays every match across the worker threads and prints the summary
+/// \param io_tournament The tournament, with its output files and lock already open
+/// \return EXIT_SUCCESS, or EXIT_FAILURE if a worker could not be started or failed
+///
+static int playMatches(Tournament *io_tournament)
+{
+  const Options *options = io_tournament->options;
+
+  if(io_tournament->hashLog)
+  {
+    fprintf(io_tournament->hashLog, "match,tick,hash\n");
+  }
+
+  if(!io_tournament->isJson)
+  {
+    fprintf(io_tournament->output, "match,seed,ticks,sim_ms,cause,p1_score,p2_score,p1_length,p2_length,hash\n");
+  }
+
+  int threadCount = (options->threadCount > 0) ? options->threadCount : SDL_GetCPUCount();
+  if(threadCount > options->matchCount)
+  {
+    threadCount = options->matchCount;
+  }
+
+  SDL_Thread **workers = allocateMemory(MEMORY_TOURNAMENT, threadCount * sizeof(SDL_Thread *));
+
+  if(!workers)
+  {
+    printf("Unable to allocate %d worker threads\n", threadCount);
+    return EXIT_FAILURE;
+  }
+
+  const Uint64 c_start = SDL_GetPerformanceCounter();
+  int status = EXIT_SUCCESS;
+
+  for(int i = 0; i < threadCount; ++i)
+  {
+    workers[i] = SDL_CreateThread(runWorker, "tournament", io_tournament);
+
+    if(!workers[i])
+    {
+      printf("%s\n", SDL_GetError());
+      status = EXIT_FAILURE;
+    }
+  }
+
+  for(int i = 0; i < threadCount; ++i)
+  {
+    int workerStatus = EXIT_SUCCESS;
+
+    if(workers[i])
+    {
+      SDL_WaitThread(workers[i], &workerStatus);
+    }
+
+    if(workerStatus != EXIT_SUCCESS)
+    {
+      status = EXIT_FAILURE;
+    }
+  }
+
+  freeMemory(workers);
+
+  const double c_seconds = (double)(SDL_GetPerformanceCounter() - c_start) /
+                           (double)SDL_GetPerformanceFrequency();
+
+  printf("%d matches on %d threads in %.2fs (%.1f matches/s)\n",
+         io_tournament->finished, threadCount, c_seconds,
+         (c_seconds > 0.0) ? io_tournament->finished / c_seconds : 0.0);
+  printf("Player 1 wins %d, player 2 wins %d, draws %d\n",
+         io_tournament->wins[0], io_tournament->wins[1], io_tournament->draws);
+
+  if(io_tournament->observations > 0)
+  {
+    printf("Observations of %dx%d cells took %.2fus per snake per tick\n",
+           options->observeResolution, options->observeResolution,
+           (double)io_tournament->observeTime * 1000000.0 /
+           ((double)SDL_GetPerformanceFrequency() * (double)io_tournament->observations));
+  }
+
+  return status;
+}
+
+///
+/// \brief RunWorker Keeps claiming the next unplayed match until they have all been played
+/// \param _data The shared Tournament
+/// \return EXIT_SUCCESS, or EXIT_FAILURE if the planner, spawner, observation or hashes could not be allocated
+///
+static int runWorker(void *_data)
+{
+  Tournament *tournament = _data;
+  const Options *options = tournament->options;
+
+  setTraceThreadName("tournament");
+  const bool c_hasAIPlayer = options->isAIPlayer[0] || options->isAIPlayer[1];
+
+  // Each worker reuses one planner for all of its matches. The time budget is
+  // ignored so the AI finishes its search every tick and matches stay reproducible
+  AIPlanner planner;
+  const bool c_hasPlanner = c_hasAIPlayer && createAIPlanner(&planner, SNAKE_RADIUS, 0, tournament->map);
+
+  // The spawner follows one game's gems, so every worker needs its own
+  PickupSpawner spawner;
+  const bool c_hasSpawner = options->isRespawning &&
+                            createPickupSpawner(&spawner, WIDTH, HEIGHT, PICKUP_SIZE, tournament->map);
+
+  // What a bot would see of the arena each tick, built to measure what that costs
+  Observation observation;
+  const bool c_isObserving = options->observeResolution > 0;
+  const bool c_hasObservation = c_isObserving &&
+                                createObservation(&observation, options->observeResolution, TOURNAMENT_OBSERVATION_CELL);
+  Uint64 observations = 0;
+  Uint64 observeTime = 0;
+
+  // Likewise the game, each match after the first reuses the last one's segments
+  Game game;
+  bool isInitialised = false;
+  int status = (c_hasPlanner == c_hasAIPlayer && c_hasSpawner == options->isRespawning &&
+                c_hasObservation == c_isObserving) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+  // Room for the hash of every tick of the longest match, plus its starting state
+  Uint64 *tickHashes = NULL;
+  if(status == EXIT_SUCCESS && tournament->hashLog)
+  {
+    tickHashes = allocateMemory(MEMORY_TOURNAMENT, (options->maxTicks + 1) * sizeof(Uint64));
+
+    if(!tickHashes)
+    {
+      status = EXIT_FAILURE;
+    }
+  }
+
+  int match;
+  while(status == EXIT_SUCCESS &&
+        (match = SDL_AtomicAdd(&tournament->nextMatch, 1)) < options->matchCount)
+  {
+    const unsigned int c_seed = options->seed + (unsigned int)match;
+    unsigned int scriptSeed = c_seed ^ 0x5bd1e995u;
+
+    if(isInitialised)
+    {
+      resetGame(&game, c_seed);
+    }
+    else
+    {
+      initialiseGame(&game, c_seed, tournament->map, options->isRespawning ? &spawner : NULL,
+                     options->snakeLength, options->tickMoves);
+      isInitialised = true;
+    }
+
+    Node *snakes[PLAYER_TOTAL];
+    getSnakeHeads(&game, snakes);
+
+    Move moves[PLAYER_TOTAL];
+
+    // Chaining every tick's hash means two runs with the same chain matched on every tick
+    Uint64 hash = getGameHash(&game);
+    Uint64 hashChain = mixHash(hash);
+    int hashCount = 0;
+    bool isRunning;
+
+    if(tickHashes) { tickHashes[hashCount++] = hash; }
+
+    do
+    {
+      if(c_hasAIPlayer)
+      {
+        updateAIPlanner(&planner, snakes, PLAYER_TOTAL, &game.pickups);
+      }
+
+      if(c_isObserving)
+      {
+        const Uint64 c_observeStart = SDL_GetPerformanceCounter();
+
+        for(int p = 0; p < PLAYER_TOTAL; ++p)
+        {
+          Node *others[PLAYER_TOTAL - 1];
+          int otherCount = 0;
+
+          for(int o = 0; o < PLAYER_TOTAL; ++o)
+          {
+            if(o != p) { others[otherCount++] = snakes[o]; }
+          }
+
+          rasteriseObservation(&observation, snakes[p], others, otherCount, &game.pickups);
+        }
+
+        observeTime += SDL_GetPerformanceCounter() - c_observeStart;
+        observations += PLAYER_TOTAL;
+      }
+
+      for(int p = 0; p < PLAYER_TOTAL; ++p)
+      {
+        moves[p] = options->isAIPlayer[p] ? getAIMovement(&planner, snakes[p])
+                                          : getScriptedMovement(&scriptSeed, snakes[p]->idleDirection);
+      }
+
+      isRunning = updateGame(&game, moves);
+
+      hash = getGameHash(&game);
+      hashChain = mixHash(hashChain ^ hash);
+
+      if(tickHashes && hashCount <= (int)options->maxTicks) { tickHashes[hashCount++] = hash; }
+
+      // Rehashing everything is slow, but catches a change the running sums missed on the tick it happens
+      if(options->isHashChecked && hash != computeGameHash(&game))
+      {
+        printf("Match %d: running hash differs from a full rehash at tick %u\n", match, game.ticks);
+        status = EXIT_FAILURE;
+        break;
+      }
+    } while(isRunning && game.ticks < options->maxTicks);
+
+    writeResult(tournament, match, c_seed, &game, hashChain);
+
+    if(tickHashes)
+    {
+      writeHashLog(tournament, match, tickHashes, hashCount);
+    }
+  }
+
+  // Every way out comes through here, so only free what was actually made
+  freeMemory(tickHashes);
+
+  if(c_hasObservation)
+  {
+    freeObservation(&observation);
+
+    SDL_LockMutex(tournament->outputLock);
+    tournament->observations += observations;
+    tournament->observeTime += observeTime;
+    SDL_UnlockMutex(tournament->outputLock);
+  }
+
+  if(isInitialised)
+  {
+    freeGame(&game);
+  }
+
+  if(c_hasPlanner)
+  {
+    freeAIPlanner(&planner);
+  }
+
+  if(c_hasSpawner)
+  {
+    freePickupSpawner(&spawner);
+  }
+
+  return status;
+}
+
+///
+/// \brief GetScriptedMovement A random walk that mostly carries on in a straight line,
+/// turning at most 45 degrees at a time so it never reverses into itself
+/// \param io_seed Random generator state for this player
+/// \param _current The direction the snake is heading
+/// \return The move for this tick
+///
+static Move getScriptedMovement(unsigned int *io_seed,
+                                Move _current)
+{
+  // Directions in clockwise order, so neighbours in the table are 45 degrees apart
+  static const Move c_clockwise[8] = { UP, UPRIGHT, RIGHT, DOWNRIGHT, DOWN, DOWNLEFT, LEFT, UPLEFT };
+
+  if(randRange(io_seed, 0, 9) != 0)
+  {
+    return _current;
+  }
+
+  int index = 0;
+  while(c_clockwise[index] != _current)
+  {
+    index++;
+  }
+
+  return c_clockwise[(index + randRange(io_seed, -1, 1) + 8) % 8];
+}
+
+///
+/// \brief GetSnakeLength Counts segments from the tail, which also finds
+/// segments growsnake has added but that haven't been linked in yet
+///
+static int getSnakeLength(const Player *_player)
+{
+  int length = 0;
+
+  for(const Node *node = _player->tail; node != NULL; node = node->prev)
+  {
+    length++;
+  }
+
+  return length;
+}
+
+static const char *getResultCause(const Game *_game,
+                                  unsigned int _maxTicks)
+{
+  if(_game->state == GAME_OVER_PICKUPS)
+  {
+    return "pickups";
+  }
+
+  if(_game->state == GAME_OVER_COLLISION)
+  {
+    if(_game->players[0].hasCollided && _game->players[1].hasCollided) { return "collision_both"; }
+    return _game->players[0].hasCollided ? "collision_p1" : "collision_p2";
+  }
+
+  return (_game->ticks >= _maxTicks) ? "tick_limit" : "running";
+}
+
+///
+/// \brief WriteResult Appends a match to the results file and the running totals,
+/// flushing straight away so partial results survive an interrupted run
+///
+static void writeResult(Tournament *io_tournament,
+                        int _match,
+                        unsigned int _seed,
+                        const Game *_game,
+                        Uint64 _hashChain)
+{
+  const char *c_cause = getResultCause(_game, io_tournament->options->maxTicks);
+  const int c_score1 = _game->players[0].pickupCount;
+  const int c_score2 = _game->players[1].pickupCount;
+  const int c_length1 = getSnakeLength(&_game->players[0]);
+  const int c_length2 = getSnakeLength(&_game->players[1]);
+
+  SDL_LockMutex(io_tournament->outputLock);
+
+  if(io_tournament->isJson)
+  {
+    fprintf(io_tournament->output,
+            "{\"match\":%d,\"seed\":%u,\"ticks\":%u,\"sim_ms\":%u,\"cause\":\"%s\","
+            "\"scores\":[%d,%d],\"lengths\":[%d,%d],\"hash\":\"%016llx\"}\n",
+            _match, _seed, _game->ticks, _game->time, c_cause,
+            c_score1, c_score2, c_length1, c_length2, (unsigned long long)_hashChain);
+  }
+  else
+  {
+    fprintf(io_tournament->output, "%d,%u,%u,%u,%s,%d,%d,%d,%d,%016llx\n",
+            _match, _seed, _game->ticks, _game->time, c_cause,
+            c_score1, c_score2, c_length1, c_length2, (unsigned long long)_hashChain);
+  }
+
+  fflush(io_tournament->output);
+
+  if(c_score1 != c_score2)
+  {
+    io_tournament->wins[(c_score1 > c_score2) ? 0 : 1]++;
+  }
+  else
+  {
+    io_tournament->draws++;
+  }
+
+  io_tournament->finished++;
+
+  SDL_UnlockMutex(io_tournament->outputLock);
+}
+
+///
+/// \brief WriteHashLog Appends the hash of every tick of a match, tick 0 being the starting state.
+/// Sorting two logs and diffing them finds the first tick where runs went different ways
+///
+static void writeHashLog(Tournament *io_tournament,
+                         int _match,
+                         const Uint64 *_hashes,
+                         int _count)
+{
+  SDL_LockMutex(io_tournament->outputLock);
+
+  for(int i = 0; i < _count; ++i)
+  {
+    fprintf(io_tournament->hashLog, "%d,%d,%016llx\n", _match, i, (unsigned long long)_hashes[i]);
+  }
+
+  fflush(io_tournament->hashLog);
+
+  SDL_UnlockMutex(io_tournament->outputLock);
+}
@@ -0,0 +1,14 @@
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+#include "options.h"
+
+///
+/// \brief RunTournament Plays options.matchCount matches headlessly across worker threads,
+/// streaming one result line per match to options.resultsPath as each one finishes
+/// \param _options
+/// \return EXIT_SUCCESS, or EXIT_FAILURE if the results file or a worker could not be created
+///
+int runTournament(const Options *_options);
+
+#endif // TOURNAMENT_H
@@ -0,0 +1,210 @@
+#include "trace.h"
+
+#include <stdio.h>
+
+#include "allocator.h"
+
+typedef struct TraceRecord{
+  const char *name;
+  Uint64 time;
+  char phase;
+} TraceRecord;
+
+// Only the thread that owns a ring ever writes to it, so recording needs no locks
+typedef struct TraceRing{
+  const char *threadName;
+  unsigned int count;   // Total events recorded, the ring holds the last TRACE_EVENTS_PER_THREAD
+  TraceRecord records[TRACE_EVENTS_PER_THREAD];
+} TraceRing;
+
+bool g_isTracing = false;
+
+static const char *s_path = NULL;
+static SDL_TLSID s_ringKey = 0;
+static Uint64 s_start = 0;
+static SDL_atomic_t s_ringCount;
+static TraceRing *s_rings[TRACE_MAX_THREADS];
+
+static TraceRing *getThreadRing(void);
+static void writeRing(FILE *io_file, const TraceRing *_ring, int _tid, bool *io_isFirst);
+
+bool startTracing(const char *_path)
+{
+  s_ringKey = SDL_TLSCreate();
+
+  if(s_ringKey == 0)
+  {
+    return false;
+  }
+
+  s_path = _path;
+  s_start = SDL_GetPerformanceCounter();
+  SDL_AtomicSet(&s_ringCount, 0);
+
+  g_isTracing = true;
+  setTraceThreadName("main");
+
+  return true;
+}
+
+void stopTracing(void)
+{
+  if(!g_isTracing)
+  {
+    return;
+  }
+
+  g_isTracing = false;
+
+  FILE *file = fopen(s_path, "w");
+
+  if(file == NULL)
+  {
+    printf("Unable to open %s for the trace\n", s_path);
+  }
+
+  int ringTotal = SDL_AtomicGet(&s_ringCount);
+  if(ringTotal > TRACE_MAX_THREADS)
+  {
+    ringTotal = TRACE_MAX_THREADS;
+  }
+
+  if(file != NULL)
+  {
+    bool isFirst = true;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    for(int i = 0; i < ringTotal; ++i)
+    {
+      writeRing(file, s_rings[i], i, &isFirst);
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+  }
+
+  for(int i = 0; i < ringTotal; ++i)
+  {
+    freeMemory(s_rings[i]);
+    s_rings[i] = NULL;
+  }
+}
+
+void setTraceThreadName(const char *_name)
+{
+  if(g_isTracing)
+  {
+    TraceRing *ring = getThreadRing();
+
+    if(ring != NULL)
+    {
+      ring->threadName = _name;
+    }
+  }
+}
+
+void traceEvent(const char *_name,
+                char _phase)
+{
+  TraceRing *ring = getThreadRing();
+
+  if(ring == NULL)
+  {
+    return;
+  }
+
+  TraceRecord *record = &ring->records[ring->count % TRACE_EVENTS_PER_THREAD];
+  record->name = _name;
+  record->time = SDL_GetPerformanceCounter();
+  record->phase = _phase;
+
+  ring->count++;
+}
+
+///
+/// \brief GetThreadRing Finds the calling thread's ring, claiming one the first time it records
+/// \return NULL if every ring has been claimed or could not be allocated
+///
+static TraceRing *getThreadRing(void)
+{
+  TraceRing *ring = SDL_TLSGet(s_ringKey);
+
+  if(ring != NULL)
+  {
+    return ring;
+  }
+
+  const int c_slot = SDL_AtomicAdd(&s_ringCount, 1);
+
+  if(c_slot >= TRACE_MAX_THREADS)
+  {
+    return NULL;
+  }
+
+  ring = allocateMemory(MEMORY_TRACE, sizeof(TraceRing));
+
+  if(ring == NULL)
+  {
+    return NULL;
+  }
+
+  ring->threadName = NULL;
+  ring->count = 0;
+
+  s_rings[c_slot] = ring;
+  SDL_TLSSet(s_ringKey, ring, NULL);
+
+  return ring;
+}
+
+///
+/// \brief WriteRing Writes a ring's events oldest first. If it wrapped, end events
+/// whose begin was overwritten are skipped so the viewer doesn't see stray closes
+///
+static void writeRing(FILE *io_file,
+                      const TraceRing *_ring,
+                      int _tid,
+                      bool *io_isFirst)
+{
+  if(_ring == NULL)
+  {
+    return;
+  }
+
+  const double c_toMicroseconds = 1000000.0 / (double)SDL_GetPerformanceFrequency();
+
+  if(_ring->threadName != NULL)
+  {
+    fprintf(io_file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            *io_isFirst ? "" : ",\n", _tid, _ring->threadName);
+    *io_isFirst = false;
+  }
+
+  const unsigned int c_first = (_ring->count > TRACE_EVENTS_PER_THREAD) ? _ring->count - TRACE_EVENTS_PER_THREAD : 0;
+  int depth = 0;
+
+  for(unsigned int i = c_first; i < _ring->count; ++i)
+  {
+    const TraceRecord *record = &_ring->records[i % TRACE_EVENTS_PER_THREAD];
+
+    if(record->phase == 'E')
+    {
+      if(depth == 0)
+      {
+        continue;
+      }
+
+      depth--;
+    }
+    else
+    {
+      depth++;
+    }
+
+    fprintf(io_file, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}",
+            *io_isFirst ? "" : ",\n", record->name, record->phase, _tid,
+            (double)(record->time - s_start) * c_toMicroseconds);
+    *io_isFirst = false;
+  }
+}
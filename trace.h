@@ -0,0 +1,43 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+
+#include "utils.h"
+
+// Events kept per thread, once a thread's ring is full its oldest events are overwritten
+#define TRACE_EVENTS_PER_THREAD (1 << 16)
+#define TRACE_MAX_THREADS       (32)
+
+// Checked by every TRACE_ macro, so tracing costs one well predicted branch when it's off
+extern bool g_isTracing;
+
+#define TRACE_BEGIN(_name) do { if(g_isTracing) { traceEvent((_name), 'B'); } } while(0)
+#define TRACE_END(_name)   do { if(g_isTracing) { traceEvent((_name), 'E'); } } while(0)
+
+///
+/// \brief StartTracing Turns on recording, must be called before any other thread is started
+/// \param _path Where stopTracing writes the Chrome trace JSON
+/// \return False if tracing could not be set up, tracing stays off
+///
+bool startTracing(const char *_path);
+
+///
+/// \brief StopTracing Writes every recorded event and frees the rings. Any other thread
+/// that recorded events must have finished first
+///
+void stopTracing(void);
+
+///
+/// \brief SetTraceThreadName Labels the calling thread in the trace viewer
+///
+void setTraceThreadName(const char *_name);
+
+///
+/// \brief TraceEvent Appends an event to the calling thread's ring, use the TRACE_ macros instead
+/// \param _name Must be a string literal, only the pointer is stored
+/// \param _phase 'B' or 'E'
+///
+void traceEvent(const char *_name, char _phase);
+
+#endif // TRACE_H
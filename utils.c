@@ -34,11 +34,112 @@ bool detectCollision(const SDL_Rect *_a, const SDL_Rect *_b, int _clipRadius)
   return true;
 }
 
+///
+/// \brief SweepAxis Narrows when, during a move, two spans overlap on one axis. Times are
+/// fractions of the move, kept as numerator and denominator so no rounding creeps in
+/// \param _d How far span a moves along the axis
+/// \param io_enter Latest time found so far that the spans start to overlap, over io_enterDen
+/// \param io_leave Earliest time found so far that they stop, over io_leaveDen
+/// \return False if they never overlap on this axis
+///
+static bool sweepAxis(int _aMin, int _aMax, int _bMin, int _bMax, int _d,
+                      Sint64 *io_enter, Sint64 *io_enterDen, Sint64 *io_leave, Sint64 *io_leaveDen)
+{
+  if(_d == 0)
+  {
+    return (_aMin <= _bMax) && (_aMax >= _bMin);
+  }
+
+  const Sint64 c_den = (_d > 0) ? _d : -_d;
+  const Sint64 c_enter = (_d > 0) ? (_bMin - _aMax) : (_aMin - _bMax);
+  const Sint64 c_leave = (_d > 0) ? (_bMax - _aMin) : (_aMax - _bMin);
+
+  if(c_enter * (*io_enterDen) > (*io_enter) * c_den)
+  {
+    *io_enter = c_enter;
+    *io_enterDen = c_den;
+  }
+
+  if(c_leave * (*io_leaveDen) < (*io_leave) * c_den)
+  {
+    *io_leave = c_leave;
+    *io_leaveDen = c_den;
+  }
+
+  return true;
+}
+
+///
+/// \brief SweepCollision Swept version of detectCollision, for a rect moving in a straight line
+/// past one that is still. Each rect is grown by the other and the move tested against the
+/// result one axis at a time, so a fast move can't jump clean over something it should have hit.
+/// Only integers are used, so every machine finds the same times
+/// \param _a The moving rectangle, where the move starts
+/// \param _dx How far it moves
+/// \param _dy
+/// \param _b The still rectangle, for two moving ones pass how far _a moves relative to _b
+/// \param _clipRadius As detectCollision
+/// \param o_enter When they first collide, 0 at the start of the move to SWEEP_TIME_ONE at the
+/// end. Rounded down
+/// \param o_leave When they last collide, rounded up
+/// \return True if they collide at any point of the move, including where it starts and ends
+///
+bool sweepCollision(const SDL_Rect *_a,
+                    int _dx,
+                    int _dy,
+                    const SDL_Rect *_b,
+                    int _clipRadius,
+                    int *o_enter,
+                    int *o_leave)
+{
+  // Start at the whole move and cut it down to when both axes overlap
+  Sint64 enter = 0;
+  Sint64 enterDen = 1;
+  Sint64 leave = 1;
+  Sint64 leaveDen = 1;
+
+  if(!sweepAxis(_a->x + _clipRadius, _a->x + _a->w - _clipRadius,
+                _b->x + _clipRadius, _b->x + _b->w - _clipRadius, _dx,
+                &enter, &enterDen, &leave, &leaveDen) ||
+     !sweepAxis(_a->y + _clipRadius, _a->y + _a->h - _clipRadius,
+                _b->y + _clipRadius, _b->y + _b->h - _clipRadius, _dy,
+                &enter, &enterDen, &leave, &leaveDen))
+  {
+    return false;
+  }
+
+  if(enter * leaveDen > leave * enterDen)
+  {
+    return false;
+  }
+
+  *o_enter = (int)(enter * SWEEP_TIME_ONE / enterDen);
+  *o_leave = (int)((leave * SWEEP_TIME_ONE + leaveDen - 1) / leaveDen);
+  return true;
+}
+
 /// @brief RandRange Returns a random value between _min and _max
 /// Modified : Removed srand initialisation, it's now part of main()
+/// Modified : Takes the generator state so every match owns its own sequence,
+/// matches replay identically from the same seed and can run on separate threads
 /// 'tripplet' (December 9, 2011). Stack Overflow.
 /// [Accessed 2013]. Available from: <http://stackoverflow.com/questions/8449234/c-random-number-between-2-numbers-reset>.
-int randRange(const int _min, const int _max)
+int randRange(unsigned int *io_seed, const int _min, const int _max)
+{
+  // Same linear congruential step as the C standard's example rand()
+  *io_seed = *io_seed * 1103515245u + 12345u;
+  const int c_random = (int)((*io_seed / 65536u) % 32768u);
+
+  return (c_random%((_max+1)-_min)+_min);
+}
+
+///
+/// \brief FloorDiv Integer division that rounds towards negative infinity,
+/// so positions just off the left/top of the screen land in the right cell
+/// \param _a
+/// \param _b Must be positive
+///
+int floorDiv(int _a, int _b)
 {
-  return (rand()%((_max+1)-_min)+_min);
+  return (_a >= 0) ? (_a / _b) : -((_b - 1 - _a) / _b);
 }
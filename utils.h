@@ -6,8 +6,14 @@
 #include <stdbool.h>
 
 
+#define SWEEP_TIME_ONE    (65536) // A whole move in the times sweepCollision gives, it is fixed point
+
 bool detectCollision(const SDL_Rect *_a, const SDL_Rect *_b, int _clipRadius);
+bool sweepCollision(const SDL_Rect *_a, int _dx, int _dy, const SDL_Rect *_b, int _clipRadius,
+                    int *o_enter, int *o_leave);
+
+int randRange(unsigned int *io_seed, int _Min, int _Max);
 
-int randRange(int _Min, int _Max);
+int floorDiv(int _a, int _b);
 
 #endif // UTILS_H
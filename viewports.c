@@ -0,0 +1,252 @@
+#include "viewports.h"
+
+#include "allocator.h"
+
+static void moveCamera(Viewport *io_view, const Snapshot *_frame);
+static Uint8 getViews(const Viewports *_views, int _x, int _y, int _w, int _h);
+static int clampInt(int _value, int _min, int _max);
+
+void initialiseViewports(Viewports *o_views,
+                         int _count,
+                         int _w,
+                         int _h)
+{
+  o_views->count = clampInt(_count, 1, VIEWPORT_MAX);
+  o_views->cols = (WIDTH + VIEWPORT_CELL_SIZE - 1) / VIEWPORT_CELL_SIZE;
+  o_views->rows = (HEIGHT + VIEWPORT_CELL_SIZE - 1) / VIEWPORT_CELL_SIZE;
+
+  // The right and bottom halves take the odd pixel, so the views always cover the canvas
+  const int c_halfW = _w / 2;
+  const int c_halfH = _h / 2;
+  const int c_widths[2] = { c_halfW, _w - c_halfW };
+  const int c_heights[2] = { c_halfH, _h - c_halfH };
+
+  for(int v = 0; v < o_views->count; ++v)
+  {
+    Viewport *view = &o_views->views[v];
+    SDL_Rect *screen = &view->screen;
+
+    switch(o_views->count)
+    {
+      case 1:
+        screen->x = 0;  screen->y = 0;  screen->w = _w;  screen->h = _h;
+        break;
+
+      case 2:
+        screen->x = v * c_halfW;  screen->y = 0;  screen->w = c_widths[v];  screen->h = _h;
+        break;
+
+      default:
+        screen->x = (v % 2) * c_halfW;
+        screen->y = (v / 2) * c_halfH;
+        screen->w = (o_views->count == 3 && v == 2) ? _w : c_widths[v % 2];
+        screen->h = c_heights[v / 2];
+        break;
+    }
+
+    view->camera = *screen;
+    view->player = v % PLAYER_TOTAL;
+    view->gemCount = 0;
+    view->knightCount = 0;
+    view->segments = NULL;
+    view->segmentCapacity = 0;
+
+    for(int p = 0; p < PLAYER_TOTAL; ++p)
+    {
+      view->segmentEnd[p] = 0;
+    }
+  }
+}
+
+void freeViewports(Viewports *io_views)
+{
+  for(int v = 0; v < io_views->count; ++v)
+  {
+    freeMemory(io_views->views[v].segments);
+    io_views->views[v].segments = NULL;
+    io_views->views[v].segmentCapacity = 0;
+  }
+}
+
+bool cullViewports(Viewports *io_views,
+                   const Snapshot *_frame)
+{
+  int segmentTotal = 0;
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    segmentTotal += _frame->segmentCount[p];
+  }
+
+  // Mark the cells each camera can see
+  const int c_cells = io_views->cols * io_views->rows;
+
+  for(int c = 0; c < c_cells; ++c)
+  {
+    io_views->cellViews[c] = 0;
+  }
+
+  bool isGrown = true;
+
+  for(int v = 0; v < io_views->count; ++v)
+  {
+    Viewport *view = &io_views->views[v];
+
+    moveCamera(view, _frame);
+
+    const int c_col0 = clampInt(view->camera.x / VIEWPORT_CELL_SIZE, 0, io_views->cols - 1);
+    const int c_row0 = clampInt(view->camera.y / VIEWPORT_CELL_SIZE, 0, io_views->rows - 1);
+    const int c_col1 = clampInt((view->camera.x + view->camera.w - 1) / VIEWPORT_CELL_SIZE, 0, io_views->cols - 1);
+    const int c_row1 = clampInt((view->camera.y + view->camera.h - 1) / VIEWPORT_CELL_SIZE, 0, io_views->rows - 1);
+
+    for(int row = c_row0; row <= c_row1; ++row)
+    {
+      for(int col = c_col0; col <= c_col1; ++col)
+      {
+        io_views->cellViews[row * io_views->cols + col] |= (Uint8)(1 << v);
+      }
+    }
+
+    view->gemCount = 0;
+    view->knightCount = 0;
+
+    if(segmentTotal > view->segmentCapacity)
+    {
+      const int c_capacity = segmentTotal * 2;
+      int *segments = reallocateMemory(MEMORY_RENDER, view->segments, c_capacity * sizeof(int));
+
+      if(segments == NULL)
+      {
+        isGrown = false;
+      }
+      else
+      {
+        view->segments = segments;
+        view->segmentCapacity = c_capacity;
+      }
+    }
+  }
+
+  if(!isGrown)
+  {
+    for(int v = 0; v < io_views->count; ++v)
+    {
+      for(int p = 0; p < PLAYER_TOTAL; ++p)
+      {
+        io_views->views[v].segmentEnd[p] = 0;
+      }
+    }
+
+    return false;
+  }
+
+  // Then add every object to each view that sees it, in a single pass
+  const Gems *c_gems = &_frame->pickups.gems;
+
+  for(int i = 0; i < c_gems->count; ++i)
+  {
+    Uint8 seen = getViews(io_views, c_gems->x[i], c_gems->y[i], PICKUP_SIZE, PICKUP_SIZE);
+
+    for(int v = 0; seen != 0; ++v, seen >>= 1)
+    {
+      if(seen & 1) { io_views->views[v].gems[io_views->views[v].gemCount++] = i; }
+    }
+  }
+
+  const Knights *c_knights = &_frame->pickups.knights;
+
+  for(int i = 0; i < c_knights->count; ++i)
+  {
+    Uint8 seen = getViews(io_views, c_knights->x[i], c_knights->y[i], KNIGHT_SIZE, KNIGHT_SIZE);
+
+    for(int v = 0; seen != 0; ++v, seen >>= 1)
+    {
+      if(seen & 1) { io_views->views[v].knights[io_views->views[v].knightCount++] = i; }
+    }
+  }
+
+  int segmentCount[VIEWPORT_MAX] = {0};
+
+  for(int p = 0; p < PLAYER_TOTAL; ++p)
+  {
+    const Node *c_segments = _frame->segments[p];
+
+    for(int i = _frame->segmentCount[p] - 1; i >= 0; --i)
+    {
+      const SDL_Rect *c_pos = &c_segments[i].pos;
+      Uint8 seen = getViews(io_views, c_pos->x, c_pos->y, c_pos->w, c_pos->h);
+
+      for(int v = 0; seen != 0; ++v, seen >>= 1)
+      {
+        if(seen & 1) { io_views->views[v].segments[segmentCount[v]++] = i; }
+      }
+    }
+
+    for(int v = 0; v < io_views->count; ++v)
+    {
+      io_views->views[v].segmentEnd[p] = segmentCount[v];
+    }
+  }
+
+  return true;
+}
+
+///
+/// \brief MoveCamera Centres the camera on its snake's head, keeping it inside the arena
+///
+static void moveCamera(Viewport *io_view,
+                       const Snapshot *_frame)
+{
+  const Node *c_head = getSnapshotHead(_frame, io_view->player);
+
+  if(c_head == NULL)
+  {
+    return;
+  }
+
+  const int c_centreX = c_head->pos.x + c_head->pos.w / 2;
+  const int c_centreY = c_head->pos.y + c_head->pos.h / 2;
+
+  io_view->camera.x = clampInt(c_centreX - io_view->camera.w / 2, 0, WIDTH - io_view->camera.w);
+  io_view->camera.y = clampInt(c_centreY - io_view->camera.h / 2, 0, HEIGHT - io_view->camera.h);
+}
+
+///
+/// \brief GetViews Finds which views see any of the cells an area covers. Anything off the
+/// edge of the arena is treated as being in the nearest edge cell
+/// \return Bit v set for each view v
+///
+static Uint8 getViews(const Viewports *_views,
+                      int _x,
+                      int _y,
+                      int _w,
+                      int _h)
+{
+  const int c_col0 = clampInt(floorDiv(_x, VIEWPORT_CELL_SIZE), 0, _views->cols - 1);
+  const int c_row0 = clampInt(floorDiv(_y, VIEWPORT_CELL_SIZE), 0, _views->rows - 1);
+  const int c_col1 = clampInt(floorDiv(_x + _w - 1, VIEWPORT_CELL_SIZE), 0, _views->cols - 1);
+  const int c_row1 = clampInt(floorDiv(_y + _h - 1, VIEWPORT_CELL_SIZE), 0, _views->rows - 1);
+
+  Uint8 seen = 0;
+
+  for(int row = c_row0; row <= c_row1; ++row)
+  {
+    for(int col = c_col0; col <= c_col1; ++col)
+    {
+      seen |= _views->cellViews[row * _views->cols + col];
+    }
+  }
+
+  return seen;
+}
+
+///
+/// \brief ClampInt _min wins if the range is empty, so a camera wider than the arena sits at 0
+///
+static int clampInt(int _value,
+                    int _min,
+                    int _max)
+{
+  if(_value > _max) { _value = _max; }
+  if(_value < _min) { _value = _min; }
+  return _value;
+}
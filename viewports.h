@@ -0,0 +1,65 @@
+#ifndef VIEWPORTS_H
+#define VIEWPORTS_H
+
+#include <stdbool.h>
+
+#include "pickup.h"
+#include "snapshot.h"
+
+#define VIEWPORT_MAX        (4)
+#define VIEWPORT_CELL_SIZE  (64)    // Pixels, the culling pass is only this precise
+#define VIEWPORT_MAX_CELLS  (256)   // Enough for the 800x600 arena
+
+// One player's view of the arena, and what the culling pass found in it
+typedef struct Viewport{
+  SDL_Rect screen;      // Where on the canvas it is drawn
+  SDL_Rect camera;      // Area of the arena it shows, the same size as screen
+  int player;           // Snake it follows
+
+  // Everything inside the camera, in the order it is drawn
+  int gemCount;
+  int gems[PICKUP_TOTAL];
+  int knightCount;
+  int knights[PICKUP_TOTAL];
+
+  // Indices into each snake's snapshot segments, tail first so the head is drawn on top.
+  // Player p's run ends at segmentEnd[p], the next player's starts there
+  int *segments;
+  int segmentEnd[PLAYER_TOTAL];
+  int segmentCapacity;
+} Viewport;
+
+// Splits the canvas between up to VIEWPORT_MAX views. Culling is one pass over every snake
+// segment and pickup: each cell of a coarse grid over the arena knows which cameras can
+// see it, so an object looks up the few cells it covers and is added to every view that
+// sees any of them, however many views there are
+typedef struct Viewports{
+  int count;
+  Viewport views[VIEWPORT_MAX];
+
+  int cols;
+  int rows;
+  Uint8 cellViews[VIEWPORT_MAX_CELLS];  // Bit v is set when view v sees the cell
+} Viewports;
+
+///
+/// \brief InitialiseViewports Lays the views out over the canvas. One fills it, two sit side
+/// by side, four share it in quarters and three do too but with the third across the bottom.
+/// View v follows snake v, wrapping around when there are more views than snakes
+/// \param o_views
+/// \param _count 1 to VIEWPORT_MAX
+/// \param _w Size of the canvas
+/// \param _h
+///
+void initialiseViewports(Viewports *o_views, int _count, int _w, int _h);
+void freeViewports(Viewports *io_views);
+
+///
+/// \brief CullViewports Moves each camera to its snake then fills every view's lists
+/// \param io_views
+/// \param _frame
+/// \return False if the segment lists could not grow, they are then left empty
+///
+bool cullViewports(Viewports *io_views, const Snapshot *_frame);
+
+#endif // VIEWPORTS_H